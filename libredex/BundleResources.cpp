@@ -12,16 +12,21 @@
 #ifdef HAS_PROTOBUF
 #include "BundleResources.h"
 
+#include <array>
 #include <boost/filesystem.hpp>
 #include <boost/optional.hpp>
 #include <boost/range/iterator_range.hpp>
+#include <ctime>
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <mutex>
 #include <queue>
 #include <stdexcept>
 #include <string>
+#include <sys/stat.h>
 
+#include <google/protobuf/arena.h>
 #include <google/protobuf/descriptor.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/message.h>
@@ -30,8 +35,10 @@
 #include "Debug.h"
 #include "DexUtil.h"
 #include "ReadMaybeMapped.h"
+#include "RedexContext.h"
 #include "RedexMappedFile.h"
 #include "RedexResources.h"
+#include "Sha1.h"
 #include "Trace.h"
 #include "androidfw/LocaleValue.h"
 #include "androidfw/ResourceTypes.h"
@@ -45,8 +52,8 @@ namespace {
 
 void read_protobuf_file_contents(
     const std::string& file,
-    const std::function<void(google::protobuf::io::CodedInputStream&, size_t)>&
-        fn) {
+    const std::function<void(
+        const char*, google::protobuf::io::CodedInputStream&, size_t)>& fn) {
   redex::read_file_with_contents(file, [&](const char* data, size_t size) {
     if (size == 0) {
       fprintf(stderr, "Unable to read protobuf file: %s\n", file.c_str());
@@ -54,10 +61,231 @@ void read_protobuf_file_contents(
     }
     google::protobuf::io::CodedInputStream input(
         (const google::protobuf::uint8*)data, size);
-    fn(input, size);
+    fn(data, input, size);
   });
 }
 
+// Identifies the contents of a file, so that cached parses of it can be
+// validated cheaply.
+struct FileStamp {
+  uint64_t inode{0};
+  uint64_t size{0};
+  int64_t mtime_sec{0};
+  int64_t mtime_nsec{0};
+
+  bool operator==(const FileStamp& that) const {
+    return inode == that.inode && size == that.size &&
+           mtime_sec == that.mtime_sec && mtime_nsec == that.mtime_nsec;
+  }
+  bool operator!=(const FileStamp& that) const { return !(*this == that); }
+};
+
+boost::optional<FileStamp> get_file_stamp(const std::string& file) {
+  struct stat st = {};
+  if (stat(file.c_str(), &st) == -1) {
+    return boost::none;
+  }
+  FileStamp stamp;
+  stamp.inode = st.st_ino;
+  stamp.size = st.st_size;
+  stamp.mtime_sec = st.st_mtime;
+#ifdef __linux__
+  stamp.mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+  return stamp;
+}
+
+// The SHA-1 of a file's contents.
+using FileDigest = std::array<unsigned char, 20>;
+
+FileDigest get_digest(const char* data, size_t size) {
+  Sha1Context context;
+  sha1_init(&context);
+  sha1_update(&context, (const unsigned char*)data, size);
+  FileDigest digest;
+  sha1_final(digest.data(), &context);
+  return digest;
+}
+
+// A file can be rewritten without changing its stamp if it was last modified
+// within the mtime granularity of the file system, taken to be at most this
+// many seconds, before the stamp was taken.
+constexpr int64_t RACY_STAMP_SECONDS = 2;
+
+/*
+ * Parsed resources.pb and proto xml files, shared by all BundleResources and
+ * ResourcesPbFile operations so that each file of a bundle module is parsed
+ * once per RedexContext rather than once per query. Each message lives on its
+ * own arena, which makes allocating and freeing the many small submessages
+ * cheap. The cache is cleared when the RedexContext goes away.
+ *
+ * Files are keyed by path, and a cached message is only used while the
+ * file's stamp is unchanged, so files that are written, replaced or deleted
+ * by anyone else are parsed again. While a stamp could still miss a rewrite,
+ * the file's contents are compared against a digest of the parsed ones
+ * instead. Modifications made through update() are written back right away,
+ * and only for the files that were changed.
+ */
+template <typename Message>
+class ProtobufFileCache {
+ public:
+  // Calls `fn` with the contents of `file`. Does nothing if the file is empty.
+  void read(const std::string& file,
+            const std::function<void(const Message&)>& fn) {
+    update(file, [&](Message* message) {
+      fn(*message);
+      return false;
+    });
+  }
+
+  // Calls `fn` with the contents of `file`, and writes them back if `fn`
+  // returns true to indicate that it modified them. Returns false if the
+  // write failed.
+  bool update(const std::string& file,
+              const std::function<bool(Message*)>& fn) {
+    Entry* entry;
+    {
+      std::lock_guard<std::mutex> lock(m_entries_mutex);
+      if (!m_clear_scheduled && g_redex != nullptr) {
+        g_redex->add_destruction_task([this]() { clear(); });
+        m_clear_scheduled = true;
+      }
+      auto& entry_ptr = m_entries[file];
+      if (!entry_ptr) {
+        entry_ptr = std::make_unique<Entry>();
+      }
+      entry = entry_ptr.get();
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    int64_t now = time(nullptr);
+    auto stamp = get_file_stamp(file);
+    if (!is_valid(file, stamp, now, entry)) {
+      entry->message = nullptr;
+      entry->arena.Reset();
+      read_protobuf_file_contents(
+          file,
+          [&](const char* data,
+              google::protobuf::io::CodedInputStream& input,
+              size_t size) {
+            auto message =
+                google::protobuf::Arena::CreateMessage<Message>(&entry->arena);
+            always_assert_log(message->ParseFromCodedStream(&input),
+                              "BundleResource failed to read %s",
+                              file.c_str());
+            entry->message = message;
+            entry->digest = get_digest(data, size);
+          });
+      if (entry->message == nullptr) {
+        return true;
+      }
+      entry->stamp = stamp.get_value_or(FileStamp());
+      entry->stamped_at = now;
+    }
+    if (!fn(entry->message)) {
+      return true;
+    }
+    std::string contents;
+    if (!entry->message->SerializeToString(&contents)) {
+      entry->message = nullptr;
+      return false;
+    }
+    {
+      std::ofstream out(file, std::ofstream::binary);
+      if (!out.write(contents.data(), contents.size())) {
+        entry->message = nullptr;
+        return false;
+      }
+    }
+    entry->digest = get_digest(contents.data(), contents.size());
+    entry->stamped_at = time(nullptr);
+    stamp = get_file_stamp(file);
+    if (stamp) {
+      entry->stamp = *stamp;
+    } else {
+      entry->message = nullptr;
+    }
+    return true;
+  }
+
+  // Drops all cached messages.
+  void clear() {
+    std::lock_guard<std::mutex> lock(m_entries_mutex);
+    m_entries.clear();
+    m_clear_scheduled = false;
+  }
+
+ private:
+  struct Entry {
+    std::mutex mutex;
+    google::protobuf::Arena arena;
+    Message* message{nullptr};
+    FileStamp stamp;
+    // When `stamp` was taken.
+    int64_t stamped_at{0};
+    FileDigest digest;
+  };
+
+  // Whether the message of `entry` still has the contents of `file`, whose
+  // stamp was `stamp` at `now`.
+  static bool is_valid(const std::string& file,
+                       const boost::optional<FileStamp>& stamp,
+                       int64_t now,
+                       Entry* entry) {
+    if (entry->message == nullptr || !stamp || *stamp != entry->stamp) {
+      return false;
+    }
+    if (entry->stamp.mtime_sec + RACY_STAMP_SECONDS < entry->stamped_at) {
+      return true;
+    }
+    bool unchanged = false;
+    redex::read_file_with_contents(file, [&](const char* data, size_t size) {
+      unchanged = get_digest(data, size) == entry->digest;
+    });
+    if (unchanged) {
+      // Any later rewrite will show in the stamp once this is not racy.
+      entry->stamped_at = now;
+    }
+    return unchanged;
+  }
+
+  std::mutex m_entries_mutex;
+  std::unordered_map<std::string, std::unique_ptr<Entry>> m_entries;
+  // Whether clear() will run when the current RedexContext goes away.
+  bool m_clear_scheduled{false};
+};
+
+ProtobufFileCache<aapt::pb::XmlNode>& xml_node_cache() {
+  static ProtobufFileCache<aapt::pb::XmlNode> cache;
+  return cache;
+}
+
+ProtobufFileCache<aapt::pb::ResourceTable>& resource_table_cache() {
+  static ProtobufFileCache<aapt::pb::ResourceTable> cache;
+  return cache;
+}
+
+void read_xml_node(const std::string& file,
+                   const std::function<void(const aapt::pb::XmlNode&)>& fn) {
+  xml_node_cache().read(file, fn);
+}
+
+bool update_xml_node(const std::string& file,
+                     const std::function<bool(aapt::pb::XmlNode*)>& fn) {
+  return xml_node_cache().update(file, fn);
+}
+
+void read_resource_table(
+    const std::string& file,
+    const std::function<void(const aapt::pb::ResourceTable&)>& fn) {
+  resource_table_cache().read(file, fn);
+}
+
+bool update_resource_table(
+    const std::string& file,
+    const std::function<bool(aapt::pb::ResourceTable*)>& fn) {
+  return resource_table_cache().update(file, fn);
+}
+
 bool has_attribute(const aapt::pb::XmlElement& element,
                    const std::string& name) {
   for (const aapt::pb::XmlAttribute& pb_attr : element.attribute()) {
@@ -262,107 +490,100 @@ std::vector<aapt::pb::Reference> get_references(
 void read_single_manifest(const std::string& manifest,
                           ManifestClassInfo* manifest_classes) {
   TRACE(RES, 1, "Reading proto manifest at %s", manifest.c_str());
-  read_protobuf_file_contents(
-      manifest,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        std::unordered_map<std::string, ComponentTag> string_to_tag{
-            {"activity", ComponentTag::Activity},
-            {"activity-alias", ComponentTag::ActivityAlias},
-            {"provider", ComponentTag::Provider},
-            {"receiver", ComponentTag::Receiver},
-            {"service", ComponentTag::Service},
-        };
-        aapt::pb::XmlNode pb_node;
-
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          manifest.c_str());
-        if (pb_node.has_element() && pb_node.element().name() == "manifest") {
-          const auto& manifest_element = pb_node.element();
-          auto package_name =
-              get_string_attribute_value(manifest_element, "package");
-          traverse_element_and_children(
-              manifest_element, [&](const aapt::pb::XmlElement& element) {
-                const auto& tag = element.name();
-                if (tag == "application") {
-                  auto classname = get_string_attribute_value(element, "name");
-                  if (!classname.empty()) {
-                    manifest_classes->application_classes.emplace(
-                        fully_qualified_external(package_name, classname));
-                  }
-                  auto app_factory_cls = get_string_attribute_value(
-                      element, "appComponentFactory");
-                  if (!app_factory_cls.empty()) {
-                    manifest_classes->application_classes.emplace(
-                        fully_qualified_external(package_name,
-                                                 app_factory_cls));
-                  }
-                } else if (tag == "instrumentation") {
-                  auto classname = get_string_attribute_value(element, "name");
-                  always_assert(classname.size());
-                  manifest_classes->instrumentation_classes.emplace(
-                      fully_qualified_external(package_name, classname));
-                } else if (string_to_tag.count(tag)) {
-                  std::string classname = get_string_attribute_value(
-                      element,
-                      tag != "activity-alias" ? "name" : "targetActivity");
-                  always_assert(classname.size());
-
-                  bool has_exported_attribute = has_primitive_attribute(
-                      element, "exported", aapt::pb::Primitive::kBooleanValue);
-                  bool has_permission_attribute =
-                      has_attribute(element, "permission");
-                  bool has_protection_level_attribute =
-                      has_attribute(element, "protectionLevel");
-                  bool is_exported =
-                      get_bool_attribute_value(element, "exported",
-                                               /* default_value */ false);
-
-                  BooleanXMLAttribute export_attribute;
-                  if (has_exported_attribute) {
-                    if (is_exported) {
-                      export_attribute = BooleanXMLAttribute::True;
-                    } else {
-                      export_attribute = BooleanXMLAttribute::False;
-                    }
-                  } else {
-                    export_attribute = BooleanXMLAttribute::Undefined;
-                  }
-                  // NOTE: This logic is analogous to the APK manifest reading
-                  // code, which is wrong. This should be a bitmask, not a
-                  // string. Returning the same messed up values here to at
-                  // least be consistent for now.
-                  std::string permission_attribute;
-                  std::string protection_level_attribute;
-                  if (has_permission_attribute) {
-                    permission_attribute =
-                        get_string_attribute_value(element, "permission");
-                  }
-                  if (has_protection_level_attribute) {
-                    protection_level_attribute =
-                        get_string_attribute_value(element, "protectionLevel");
-                  }
-
-                  ComponentTagInfo tag_info(
-                      string_to_tag.at(tag),
-                      fully_qualified_external(package_name, classname),
-                      export_attribute,
-                      permission_attribute,
-                      protection_level_attribute);
-                  if (tag == "provider") {
-                    auto text =
-                        get_string_attribute_value(element, "authorities");
-                    parse_authorities(text, &tag_info.authority_classes);
-                  } else {
-                    tag_info.has_intent_filters =
-                        find_nested_tag("intent-filter", element);
-                  }
-                  manifest_classes->component_tags.emplace_back(tag_info);
+  read_xml_node(manifest, [&](const aapt::pb::XmlNode& pb_node) {
+    std::unordered_map<std::string, ComponentTag> string_to_tag{
+        {"activity", ComponentTag::Activity},
+        {"activity-alias", ComponentTag::ActivityAlias},
+        {"provider", ComponentTag::Provider},
+        {"receiver", ComponentTag::Receiver},
+        {"service", ComponentTag::Service},
+    };
+    if (pb_node.has_element() && pb_node.element().name() == "manifest") {
+      const auto& manifest_element = pb_node.element();
+      auto package_name =
+          get_string_attribute_value(manifest_element, "package");
+      traverse_element_and_children(
+          manifest_element, [&](const aapt::pb::XmlElement& element) {
+            const auto& tag = element.name();
+            if (tag == "application") {
+              auto classname = get_string_attribute_value(element, "name");
+              if (!classname.empty()) {
+                manifest_classes->application_classes.emplace(
+                    fully_qualified_external(package_name, classname));
+              }
+              auto app_factory_cls = get_string_attribute_value(
+                  element, "appComponentFactory");
+              if (!app_factory_cls.empty()) {
+                manifest_classes->application_classes.emplace(
+                    fully_qualified_external(package_name,
+                                             app_factory_cls));
+              }
+            } else if (tag == "instrumentation") {
+              auto classname = get_string_attribute_value(element, "name");
+              always_assert(classname.size());
+              manifest_classes->instrumentation_classes.emplace(
+                  fully_qualified_external(package_name, classname));
+            } else if (string_to_tag.count(tag)) {
+              std::string classname = get_string_attribute_value(
+                  element,
+                  tag != "activity-alias" ? "name" : "targetActivity");
+              always_assert(classname.size());
+
+              bool has_exported_attribute = has_primitive_attribute(
+                  element, "exported", aapt::pb::Primitive::kBooleanValue);
+              bool has_permission_attribute =
+                  has_attribute(element, "permission");
+              bool has_protection_level_attribute =
+                  has_attribute(element, "protectionLevel");
+              bool is_exported =
+                  get_bool_attribute_value(element, "exported",
+                                           /* default_value */ false);
+
+              BooleanXMLAttribute export_attribute;
+              if (has_exported_attribute) {
+                if (is_exported) {
+                  export_attribute = BooleanXMLAttribute::True;
+                } else {
+                  export_attribute = BooleanXMLAttribute::False;
                 }
-                return true;
-              });
-        }
-      });
+              } else {
+                export_attribute = BooleanXMLAttribute::Undefined;
+              }
+              // NOTE: This logic is analogous to the APK manifest reading
+              // code, which is wrong. This should be a bitmask, not a
+              // string. Returning the same messed up values here to at
+              // least be consistent for now.
+              std::string permission_attribute;
+              std::string protection_level_attribute;
+              if (has_permission_attribute) {
+                permission_attribute =
+                    get_string_attribute_value(element, "permission");
+              }
+              if (has_protection_level_attribute) {
+                protection_level_attribute =
+                    get_string_attribute_value(element, "protectionLevel");
+              }
+
+              ComponentTagInfo tag_info(
+                  string_to_tag.at(tag),
+                  fully_qualified_external(package_name, classname),
+                  export_attribute,
+                  permission_attribute,
+                  protection_level_attribute);
+              if (tag == "provider") {
+                auto text =
+                    get_string_attribute_value(element, "authorities");
+                parse_authorities(text, &tag_info.authority_classes);
+              } else {
+                tag_info.has_intent_filters =
+                    find_nested_tag("intent-filter", element);
+              }
+              manifest_classes->component_tags.emplace_back(tag_info);
+            }
+            return true;
+          });
+    }
+  });
 }
 
 //
@@ -711,32 +932,26 @@ boost::optional<int32_t> BundleResources::get_min_sdk() {
     return result;
   }
   TRACE(RES, 1, "Reading proto xml at %s", base_manifest.c_str());
-  read_protobuf_file_contents(
-      base_manifest,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          base_manifest.c_str());
-        if (pb_node.has_element()) {
-          const auto& manifest_element = pb_node.element();
-          for (const aapt::pb::XmlNode& pb_child : manifest_element.child()) {
-            if (pb_child.node_case() == aapt::pb::XmlNode::NodeCase::kElement) {
-              const auto& pb_element = pb_child.element();
-              if (pb_element.name() == "uses-sdk") {
-                if (has_primitive_attribute(
-                        pb_element,
-                        "minSdkVersion",
-                        aapt::pb::Primitive::kIntDecimalValue)) {
-                  result = boost::optional<int32_t>(
-                      get_int_attribute_value(pb_element, "minSdkVersion"));
-                  return;
-                }
-              }
+  read_xml_node(base_manifest, [&](const aapt::pb::XmlNode& pb_node) {
+    if (pb_node.has_element()) {
+      const auto& manifest_element = pb_node.element();
+      for (const aapt::pb::XmlNode& pb_child : manifest_element.child()) {
+        if (pb_child.node_case() == aapt::pb::XmlNode::NodeCase::kElement) {
+          const auto& pb_element = pb_child.element();
+          if (pb_element.name() == "uses-sdk") {
+            if (has_primitive_attribute(
+                    pb_element,
+                    "minSdkVersion",
+                    aapt::pb::Primitive::kIntDecimalValue)) {
+              result = boost::optional<int32_t>(
+                  get_int_attribute_value(pb_element, "minSdkVersion"));
+              return;
             }
           }
         }
-      });
+      }
+    }
+  });
   return result;
 }
 
@@ -762,23 +977,17 @@ boost::optional<std::string> BundleResources::get_manifest_package_name() {
     return result;
   }
   TRACE(RES, 1, "Reading proto xml at %s", base_manifest.c_str());
-  read_protobuf_file_contents(
-      base_manifest,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          base_manifest.c_str());
-        if (pb_node.has_element()) {
-          const auto& manifest_element = pb_node.element();
-          for (const aapt::pb::XmlAttribute& pb_attr :
-               manifest_element.attribute()) {
-            if (pb_attr.name() == "package") {
-              result = pb_attr.value();
-            }
-          }
+  read_xml_node(base_manifest, [&](const aapt::pb::XmlNode& pb_node) {
+    if (pb_node.has_element()) {
+      const auto& manifest_element = pb_node.element();
+      for (const aapt::pb::XmlAttribute& pb_attr :
+           manifest_element.attribute()) {
+        if (pb_attr.name() == "package") {
+          result = pb_attr.value();
         }
-      });
+      }
+    }
+  });
   return result;
 }
 
@@ -866,49 +1075,29 @@ bool BundleResources::rename_classes_in_layout(
     const std::string& file_path,
     const std::map<std::string, std::string>& rename_map,
     size_t* out_num_renamed) {
-  bool write_failed = false;
-  read_protobuf_file_contents(
-      file_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          file_path.c_str());
-        size_t num_renamed = 0;
-        apply_rename_map(rename_map, &pb_node, &num_renamed);
-        if (num_renamed > 0) {
-          std::ofstream out(file_path, std::ofstream::binary);
-          if (pb_node.SerializeToOstream(&out)) {
-            *out_num_renamed = num_renamed;
-          } else {
-            write_failed = true;
-          }
-        }
-      });
-  return !write_failed;
+  size_t num_renamed = 0;
+  bool written = update_xml_node(file_path, [&](aapt::pb::XmlNode* pb_node) {
+    apply_rename_map(rename_map, pb_node, &num_renamed);
+    return num_renamed > 0;
+  });
+  if (written) {
+    *out_num_renamed = num_renamed;
+  }
+  return written;
 }
 
 void BundleResources::fully_qualify_layout(
     const std::unordered_map<std::string, std::string>& element_to_class_name,
     const std::string& file_path,
     size_t* changes) {
-  read_protobuf_file_contents(
-      file_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        always_assert_log(pb_node.ParseFromCodedStream(&input),
-                          "BundleResoource failed to read %s",
-                          file_path.c_str());
-        size_t elements_changed = 0;
-        fully_qualify_element(element_to_class_name, &pb_node,
-                              &elements_changed);
-        if (elements_changed > 0) {
-          std::ofstream out(file_path, std::ofstream::binary);
-          if (pb_node.SerializeToOstream(&out)) {
-            *changes = elements_changed;
-          }
-        }
-      });
+  size_t elements_changed = 0;
+  bool written = update_xml_node(file_path, [&](aapt::pb::XmlNode* pb_node) {
+    fully_qualify_element(element_to_class_name, pb_node, &elements_changed);
+    return elements_changed > 0;
+  });
+  if (written) {
+    *changes = elements_changed;
+  }
 }
 
 namespace {
@@ -1227,30 +1416,24 @@ void BundleResources::collect_layout_classes_and_attributes_for_file(
         9,
         "BundleResources collecting classes and attributes for file: %s",
         file_path.c_str());
-  read_protobuf_file_contents(
-      file_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          file_path.c_str());
-        if (pb_node.has_element()) {
-          const auto& root = pb_node.element();
-          std::unordered_map<std::string, std::string> ns_uri_to_prefix;
-          for (const auto& ns_decl : root.namespace_declaration()) {
-            if (!ns_decl.uri().empty() && !ns_decl.prefix().empty()) {
-              ns_uri_to_prefix.emplace(ns_decl.uri(), ns_decl.prefix());
-            }
-          }
-          traverse_element_and_children(
-              root, [&](const aapt::pb::XmlElement& element) {
-                collect_layout_classes_and_attributes_for_element(
-                    element, ns_uri_to_prefix, attributes_to_read, out_classes,
-                    out_attributes);
-                return true;
-              });
+  read_xml_node(file_path, [&](const aapt::pb::XmlNode& pb_node) {
+    if (pb_node.has_element()) {
+      const auto& root = pb_node.element();
+      std::unordered_map<std::string, std::string> ns_uri_to_prefix;
+      for (const auto& ns_decl : root.namespace_declaration()) {
+        if (!ns_decl.uri().empty() && !ns_decl.prefix().empty()) {
+          ns_uri_to_prefix.emplace(ns_decl.uri(), ns_decl.prefix());
         }
-      });
+      }
+      traverse_element_and_children(
+          root, [&](const aapt::pb::XmlElement& element) {
+            collect_layout_classes_and_attributes_for_element(
+                element, ns_uri_to_prefix, attributes_to_read, out_classes,
+                out_attributes);
+            return true;
+          });
+    }
+  });
 }
 
 void BundleResources::collect_xml_attribute_string_values_for_file(
@@ -1262,38 +1445,32 @@ void BundleResources::collect_xml_attribute_string_values_for_file(
         9,
         "BundleResources collecting xml attribute string values for file: %s",
         file_path.c_str());
-  read_protobuf_file_contents(
-      file_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        always_assert_log(pb_node.ParseFromCodedStream(&input),
-                          "BundleResoource failed to read %s",
-                          file_path.c_str());
-        if (pb_node.has_element()) {
-          const auto& root = pb_node.element();
-          traverse_element_and_children(
-              root, [&](const aapt::pb::XmlElement& element) {
-                for (const auto& pb_attr : element.attribute()) {
-                  if (pb_attr.has_compiled_item()) {
-                    const auto& pb_item = pb_attr.compiled_item();
-                    if (pb_item.has_str()) {
-                      const auto& val = pb_item.str().value();
-                      if (!val.empty()) {
-                        out->emplace(val);
-                      }
-                    } else if (pb_item.has_raw_str()) {
-                      TRACE(RES, 9,
-                            "Not considering %s as a possible string value",
-                            pb_item.raw_str().value().c_str());
-                    }
-                  } else {
-                    out->emplace(pb_attr.value());
+  read_xml_node(file_path, [&](const aapt::pb::XmlNode& pb_node) {
+    if (pb_node.has_element()) {
+      const auto& root = pb_node.element();
+      traverse_element_and_children(
+          root, [&](const aapt::pb::XmlElement& element) {
+            for (const auto& pb_attr : element.attribute()) {
+              if (pb_attr.has_compiled_item()) {
+                const auto& pb_item = pb_attr.compiled_item();
+                if (pb_item.has_str()) {
+                  const auto& val = pb_item.str().value();
+                  if (!val.empty()) {
+                    out->emplace(val);
                   }
+                } else if (pb_item.has_raw_str()) {
+                  TRACE(RES, 9,
+                        "Not considering %s as a possible string value",
+                        pb_item.raw_str().value().c_str());
                 }
-                return true;
-              });
-        }
-      });
+              } else {
+                out->emplace(pb_attr.value());
+              }
+            }
+            return true;
+          });
+    }
+  });
 }
 
 size_t BundleResources::remap_xml_reference_attributes(
@@ -1307,20 +1484,12 @@ size_t BundleResources::remap_xml_reference_attributes(
         "BundleResources changing resource id for xml file: %s",
         filename.c_str());
   size_t num_changed = 0;
-  read_protobuf_file_contents(
-      filename,
-      [&](google::protobuf::io::CodedInputStream& input, size_t /* unused */) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          filename.c_str());
-        change_resource_id_in_xml_references(kept_to_remapped_ids, &pb_node,
-                                             &num_changed);
-        if (num_changed > 0) {
-          std::ofstream out(filename, std::ofstream::binary);
-          always_assert(pb_node.SerializeToOstream(&out));
-        }
-      });
+  bool written = update_xml_node(filename, [&](aapt::pb::XmlNode* pb_node) {
+    change_resource_id_in_xml_references(kept_to_remapped_ids, pb_node,
+                                         &num_changed);
+    return num_changed > 0;
+  });
+  always_assert(written);
   return num_changed;
 }
 
@@ -1361,22 +1530,16 @@ std::unordered_set<uint32_t> BundleResources::get_xml_reference_attributes(
     return result;
   }
 
-  read_protobuf_file_contents(
-      filename,
-      [&](google::protobuf::io::CodedInputStream& input, size_t size) {
-        aapt::pb::XmlNode pb_node;
-        bool read_finish = pb_node.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResource failed to read %s",
-                          filename.c_str());
-        if (pb_node.has_element()) {
-          const auto& start = pb_node.element();
-          traverse_element_and_children(
-              start, [&](const aapt::pb::XmlElement& element) {
-                collect_rids_for_element(element, result);
-                return true;
-              });
-        }
-      });
+  read_xml_node(filename, [&](const aapt::pb::XmlNode& pb_node) {
+    if (pb_node.has_element()) {
+      const auto& start = pb_node.element();
+      traverse_element_and_children(
+          start, [&](const aapt::pb::XmlElement& element) {
+            collect_rids_for_element(element, result);
+            return true;
+          });
+    }
+  });
   return result;
 }
 
@@ -1388,18 +1551,11 @@ void ResourcesPbFile::remap_res_ids_and_serialize(
           9,
           "BundleResources changing resource data for file: %s",
           resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
+    bool written = update_resource_table(
+        resources_pb_path, [&](aapt::pb::ResourceTable* pb_restable) {
+          int package_size = pb_restable->package_size();
           for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
+            auto package = pb_restable->mutable_package(i);
             auto current_package_id = package->package_id().id();
             int original_type_size = package->type_size();
             // Apply newly added types. Source res ids must have their data
@@ -1453,9 +1609,9 @@ void ResourcesPbFile::remap_res_ids_and_serialize(
                                             current_package_id, type);
             }
           }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
+          return true;
         });
+    always_assert(written);
   }
 }
 
@@ -1466,18 +1622,11 @@ void ResourcesPbFile::nullify_res_ids_and_serialize(
           9,
           "BundleResources changing resource data for file: %s",
           resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
+    bool written = update_resource_table(
+        resources_pb_path, [&](aapt::pb::ResourceTable* pb_restable) {
+          int package_size = pb_restable->package_size();
           for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
+            auto package = pb_restable->mutable_package(i);
             auto current_package_id = package->package_id().id();
             int type_size = package->type_size();
             for (int j = 0; j < type_size; j++) {
@@ -1485,9 +1634,9 @@ void ResourcesPbFile::nullify_res_ids_and_serialize(
               nullify_resource_ids(m_ids_to_remove, current_package_id, type);
             }
           }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
+          return true;
         });
+    always_assert(written);
   }
 }
 
@@ -1520,13 +1669,15 @@ void remap_entry_file_paths(const std::function<void(aapt::pb::FileReference*,
 void ResourcesPbFile::remap_file_paths_and_serialize(
     const std::vector<std::string>& resource_files,
     const std::unordered_map<std::string, std::string>& old_to_new) {
-  auto remap_filepaths = [&old_to_new](aapt::pb::FileReference* file,
-                                       uint32_t res_id) {
+  bool modified = false;
+  auto remap_filepaths = [&old_to_new, &modified](aapt::pb::FileReference* file,
+                                                  uint32_t res_id) {
     auto search = old_to_new.find(file->path());
     if (search != old_to_new.end()) {
       TRACE(RES, 8, "Writing file path %s to ID 0x%x", search->second.c_str(),
             res_id);
       file->set_path(search->second);
+      modified = true;
     }
   };
   for (const auto& resources_pb_path : resource_files) {
@@ -1534,18 +1685,12 @@ void ResourcesPbFile::remap_file_paths_and_serialize(
           9,
           "BundleResources changing file paths for file: %s",
           resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
+    modified = false;
+    bool written = update_resource_table(
+        resources_pb_path, [&](aapt::pb::ResourceTable* pb_restable) {
+          int package_size = pb_restable->package_size();
           for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
+            auto package = pb_restable->mutable_package(i);
             auto current_package_id = package->package_id().id();
             int type_size = package->type_size();
             for (int j = 0; j < type_size; j++) {
@@ -1561,9 +1706,9 @@ void ResourcesPbFile::remap_file_paths_and_serialize(
               }
             }
           }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
+          return modified;
         });
+    always_assert(written);
   }
 }
 
@@ -1591,24 +1736,18 @@ size_t ResourcesPbFile::obfuscate_resource_and_serialize(
           9,
           "BundleResources changing resource data for file: %s",
           resources_pb_path.c_str());
-    read_protobuf_file_contents(
-        resources_pb_path,
-        [&](google::protobuf::io::CodedInputStream& input,
-            size_t /* unused */) {
-          aapt::pb::ResourceTable pb_restable;
-          bool read_finish = pb_restable.ParseFromCodedStream(&input);
-          always_assert_log(read_finish,
-                            "BundleResoource failed to read %s",
-                            resources_pb_path.c_str());
-          int package_size = pb_restable.package_size();
+    bool written = update_resource_table(
+        resources_pb_path, [&](aapt::pb::ResourceTable* pb_restable) {
+          bool modified = false;
+          int package_size = pb_restable->package_size();
           for (int i = 0; i < package_size; i++) {
-            auto package = pb_restable.mutable_package(i);
+            auto package = pb_restable->mutable_package(i);
             auto current_package_id = package->package_id().id();
             auto cur_module_name =
                 resolve_module_name_for_package_id(current_package_id) + "/";
-            auto remap_filepaths = [&filepath_old_to_new, &cur_module_name](
-                                       aapt::pb::FileReference* file,
-                                       uint32_t res_id) {
+            auto remap_filepaths = [&filepath_old_to_new, &cur_module_name,
+                                    &modified](aapt::pb::FileReference* file,
+                                               uint32_t res_id) {
               auto search_path = cur_module_name + file->path();
               auto search = filepath_old_to_new.find(search_path);
               if (search != filepath_old_to_new.end()) {
@@ -1617,6 +1756,7 @@ size_t ResourcesPbFile::obfuscate_resource_and_serialize(
                 TRACE(RES, 8, "Writing file path %s to ID 0x%x",
                       new_path.c_str(), res_id);
                 file->set_path(new_path);
+                modified = true;
               }
             };
             int type_size = package->type_size();
@@ -1650,12 +1790,13 @@ size_t ResourcesPbFile::obfuscate_resource_and_serialize(
                 }
                 ++num_changed;
                 entry->set_name(RESOURCE_NAME_REMOVED);
+                modified = true;
               }
             }
           }
-          std::ofstream out(resources_pb_path, std::ofstream::binary);
-          always_assert(pb_restable.SerializeToOstream(&out));
+          return modified;
         });
+    always_assert(written);
   }
   return num_changed;
 }
@@ -1766,25 +1907,15 @@ void reorder_style(aapt::pb::Style* style) {
       });
 }
 
-void reorder_config_value_repeated_field(aapt::pb::ResourceTable* pb_restable) {
-  for (int package_idx = 0; package_idx < pb_restable->package_size();
-       package_idx++) {
-    auto package = pb_restable->mutable_package(package_idx);
-    for (int type_idx = 0; type_idx < package->type_size(); type_idx++) {
-      auto type = package->mutable_type(type_idx);
-      for (int entry_idx = 0; entry_idx < type->entry_size(); entry_idx++) {
-        auto entry = type->mutable_entry(entry_idx);
-        for (int cv_idx = 0; cv_idx < entry->config_value_size(); cv_idx++) {
-          auto config_value = entry->mutable_config_value(cv_idx);
-          if (config_value->has_value()) {
-            auto value = config_value->mutable_value();
-            if (value->has_compound_value()) {
-              auto compound_value = value->mutable_compound_value();
-              if (compound_value->has_style()) {
-                reorder_style(compound_value->mutable_style());
-              }
-            }
-          }
+void reorder_config_value_repeated_field(aapt::pb::Entry* entry) {
+  for (int cv_idx = 0; cv_idx < entry->config_value_size(); cv_idx++) {
+    auto config_value = entry->mutable_config_value(cv_idx);
+    if (config_value->has_value()) {
+      auto value = config_value->mutable_value();
+      if (value->has_compound_value()) {
+        auto compound_value = value->mutable_compound_value();
+        if (compound_value->has_style()) {
+          reorder_style(compound_value->mutable_style());
         }
       }
     }
@@ -1800,25 +1931,8 @@ void ResourcesPbFile::collect_resource_data_for_file(
         9,
         "BundleResources collecting resource data for file: %s",
         resources_pb_path.c_str());
-  read_protobuf_file_contents(
-      resources_pb_path,
-      [&](google::protobuf::io::CodedInputStream& input, size_t /* unused */) {
-        aapt::pb::ResourceTable pb_restable;
-        bool read_finish = pb_restable.ParseFromCodedStream(&input);
-        always_assert_log(read_finish, "BundleResoource failed to read %s",
-                          resources_pb_path.c_str());
-        if (pb_restable.has_source_pool()) {
-          // Source positions refer to ResStringPool entries which are file
-          // paths from the perspective of the build machine. Not relevant for
-          // further operations, set them to a predictable value.
-          // NOTE: Not all input .aab files will have this data; release style
-          // bundles should omit this data.
-          reset_pb_source(&pb_restable);
-        }
-        // Repeated fields might not be comming in ordered, to make following
-        // config_value comparison work with different order, reorder repeated
-        // fields in config_value's value
-        reorder_config_value_repeated_field(&pb_restable);
+  read_resource_table(
+      resources_pb_path, [&](const aapt::pb::ResourceTable& pb_restable) {
         for (const aapt::pb::Package& pb_package : pb_restable.package()) {
           auto current_package_id = pb_package.package_id().id();
           if (result == 0) {
@@ -1854,9 +1968,28 @@ void ResourcesPbFile::collect_resource_data_for_file(
               m_existed_res_ids.emplace(current_resource_id);
               id_to_name.emplace(current_resource_id, name_string);
               name_to_ids[name_string].push_back(current_resource_id);
-              m_res_id_to_entry.emplace(current_resource_id, pb_entry);
+              // The table is shared with the other operations on this file,
+              // so normalize a copy of the entry rather than the table.
+              aapt::pb::Entry entry(pb_entry);
+              if (pb_restable.has_source_pool()) {
+                // Source positions refer to ResStringPool entries which are
+                // file paths from the perspective of the build machine. Not
+                // relevant for further operations, set them to a predictable
+                // value.
+                // NOTE: Not all input .aab files will have this data; release
+                // style bundles should omit this data.
+                reset_pb_source(&entry);
+              }
+              // Repeated fields might not be comming in ordered, to make
+              // following config_value comparison work with different order,
+              // reorder repeated fields in config_value's value
+              reorder_config_value_repeated_field(&entry);
+              const auto& stored_entry =
+                  m_res_id_to_entry.emplace(current_resource_id,
+                                            std::move(entry))
+                      .first->second;
               m_res_id_to_configvalue.emplace(current_resource_id,
-                                              pb_entry.config_value());
+                                              stored_entry.config_value());
             }
           }
         }
@@ -2247,24 +2380,16 @@ void maybe_obfuscate_element(
 void obfuscate_xml_attributes(
     const std::string& filename,
     const std::unordered_set<std::string>& do_not_obfuscate_elements) {
-  read_protobuf_file_contents(
-      filename,
-      [&](google::protobuf::io::CodedInputStream& input, size_t /* unused */) {
-        aapt::pb::XmlNode pb_node;
-        always_assert_log(pb_node.ParseFromCodedStream(&input),
-                          "BundleResource failed to read %s",
-                          filename.c_str());
-        size_t change_count = 0;
-        if (pb_node.has_element()) {
-          auto pb_element = pb_node.mutable_element();
-          maybe_obfuscate_element(do_not_obfuscate_elements, pb_element,
-                                  &change_count);
-        }
-        if (change_count > 0) {
-          std::ofstream out(filename, std::ofstream::binary);
-          always_assert(pb_node.SerializeToOstream(&out));
-        }
-      });
+  bool written = update_xml_node(filename, [&](aapt::pb::XmlNode* pb_node) {
+    size_t change_count = 0;
+    if (pb_node->has_element()) {
+      auto pb_element = pb_node->mutable_element();
+      maybe_obfuscate_element(do_not_obfuscate_elements, pb_element,
+                              &change_count);
+    }
+    return change_count > 0;
+  });
+  always_assert(written);
 }
 } // namespace
 
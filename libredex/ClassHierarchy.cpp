@@ -8,6 +8,7 @@
 #include "ClassHierarchy.h"
 
 #include "DexUtil.h"
+#include "HierarchyCache.h"
 #include "RedexContext.h"
 #include "Resolver.h"
 #include "Show.h"
@@ -118,6 +119,11 @@ ClassHierarchy build_type_hierarchy(const Scope& scope) {
   return hierarchy;
 }
 
+std::shared_ptr<const ClassHierarchy> get_or_build_type_hierarchy(
+    const Scope& scope) {
+  return g_redex->get_hierarchy_cache()->get_class_hierarchy(scope);
+}
+
 InterfaceMap build_interface_map(const ClassHierarchy& hierarchy) {
   InterfaceMap interfaces;
   // build the type hierarchy
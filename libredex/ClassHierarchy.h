@@ -27,6 +27,14 @@ using ClassHierarchy = std::unordered_map<const DexType*, TypeSet>;
  */
 ClassHierarchy build_type_hierarchy(const Scope& scope);
 
+/**
+ * Like build_type_hierarchy, but the result is shared with other users through
+ * the RedexContext's HierarchyCache, and only rebuilt when classes have been
+ * added, removed or re-parented since the last request.
+ */
+std::shared_ptr<const ClassHierarchy> get_or_build_type_hierarchy(
+    const Scope& scope);
+
 /**
  * Return the direct children of a type.
  */
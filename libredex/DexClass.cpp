@@ -22,6 +22,7 @@
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "RedexContext.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "StringBuilder.h"
 #include "Util.h"
@@ -29,6 +30,7 @@
 #include "Warning.h"
 
 #include <algorithm>
+#include <array>
 #include <boost/functional/hash.hpp>
 #include <boost/optional.hpp>
 #include <memory>
@@ -201,6 +203,10 @@ DexField::DexField(DexType* container, const DexString* name, DexType* type)
       m_value(nullptr) {}
 DexField::~DexField() = default; // For forwarding.
 
+void DexField::operator delete(void* storage) {
+  g_redex->release_field_storage(storage);
+}
+
 DexField* DexFieldRef::make_concrete(DexAccessFlags access_flags) {
   return make_concrete(access_flags, nullptr);
 }
@@ -221,6 +227,7 @@ DexField* DexFieldRef::make_concrete(DexAccessFlags access_flags,
 
 void DexFieldRef::change(const DexFieldSpec& ref, bool rename_on_collision) {
   g_redex->mutate_field(this, ref, rename_on_collision);
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 void DexFieldRef::erase_field(DexFieldRef* f) {
@@ -755,6 +762,10 @@ DexMethod::DexMethod(DexType* type, const DexString* name, DexProto* proto)
 
 DexMethod::~DexMethod() = default;
 
+void DexMethod::operator delete(void* storage) {
+  g_redex->release_method_storage(storage);
+}
+
 void DexMethod::delete_method(DexMethod* m) { m->make_non_concrete(); }
 
 std::string DexMethod::get_fully_deobfuscated_name() const {
@@ -766,16 +777,80 @@ std::string DexMethod::get_fully_deobfuscated_name() const {
 }
 
 void DexMethod::set_code(std::unique_ptr<IRCode> code) {
+  if (m_balloon_state.exchange(kNotPending) != kNotPending) {
+    // The pending DexCode is superseded by the given code.
+    m_dex_code.reset();
+  }
   m_code = std::move(code);
 }
 
-void DexMethod::balloon() {
+void DexMethod::balloon() { lift(); }
+
+void DexMethod::lift() const {
   redex_assert(m_code == nullptr);
-  m_code = std::make_unique<IRCode>(this);
+  m_code = std::make_unique<IRCode>(this, m_dex_code.get());
   m_dex_code.reset();
+  m_balloon_state.store(kNotPending, std::memory_order_release);
+}
+
+namespace {
+
+// Lazy ballooning is rare enough per method that a small set of striped locks
+// suffices, instead of paying for a mutex in every DexMethod.
+constexpr size_t kBalloonLockStripes = 64;
+std::array<std::mutex, kBalloonLockStripes> s_balloon_locks;
+
+std::mutex& balloon_lock_for(const DexMethod* m) {
+  // Methods are allocated at a fixed stride, which std::hash, the identity,
+  // maps to only a few stripes. Mix all the bits of the address first.
+  uint64_t key = reinterpret_cast<uintptr_t>(m);
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return s_balloon_locks[key % kBalloonLockStripes];
+}
+
+} // namespace
+
+void DexMethod::mark_balloon_pending(bool throw_on_error) {
+  redex_assert(m_code == nullptr);
+  if (m_dex_code == nullptr) {
+    return;
+  }
+  m_balloon_state.store(throw_on_error ? kPending : kPendingNoThrow,
+                        std::memory_order_release);
+}
+
+bool DexMethod::balloon_pending() const {
+  std::lock_guard<std::mutex> lock(balloon_lock_for(this));
+  auto state = m_balloon_state.load(std::memory_order_acquire);
+  if (state == kNotPending) {
+    return true;
+  }
+  try {
+    lift();
+  } catch (RedexException& re) {
+    // Leave the DexCode in place, just like eager ballooning does.
+    m_balloon_state.store(kNotPending, std::memory_order_release);
+    always_assert_log(state != kPending,
+                      "Error lifting DexCode to IRCode for %s: %s",
+                      SHOW(this), re.what());
+    TRACE(MAIN, 1, "Error lifting DexCode to IRCode for %s: %s", SHOW(this),
+          re.what());
+    return false;
+  }
+  return true;
 }
 
 void DexMethod::sync() {
+  // A method that was never touched still needs to go through IRCode, which
+  // takes care of e.g. register and debug info normalization. If lifting
+  // failed, the DexCode is left as it was loaded.
+  if (!balloon_pending()) {
+    return;
+  }
   redex_assert(m_dex_code == nullptr);
   m_dex_code = m_code->sync(this);
   m_code.reset();
@@ -1031,6 +1106,20 @@ void DexClass::set_deobfuscated_name(const DexString& name) {
   set_deobfuscated_name(&name);
 }
 
+void DexClass::set_super_class(DexType* super_class) {
+  always_assert_log(!m_external, "Unexpected external class %s\n",
+                    self_show().c_str());
+  m_super_class = super_class;
+  g_redex->get_resolver_cache()->invalidate();
+}
+
+void DexClass::set_interfaces(DexTypeList* intfs) {
+  always_assert_log(!m_external, "Unexpected external class %s\n",
+                    self_show().c_str());
+  m_interfaces = intfs;
+  g_redex->get_resolver_cache()->invalidate();
+}
+
 void DexClass::set_external() {
   m_deobfuscated_name = DexString::make_string(self_show());
   m_external = true;
@@ -1045,6 +1134,7 @@ void DexClass::remove_method(const DexMethod* m) {
     meths.erase(it);
   }
   redex_assert(erased);
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 void DexMethod::become_virtual() {
@@ -1055,6 +1145,7 @@ void DexMethod::become_virtual() {
   m_virtual = true;
   auto& vmethods = cls->get_vmethods();
   insert_sorted(vmethods, this, compare_dexmethods);
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 DexMethod* DexMethodRef::make_concrete(DexAccessFlags access,
@@ -1085,11 +1176,15 @@ DexMethod* DexMethodRef::make_concrete(DexAccessFlags access, bool is_virtual) {
 
 void DexMethodRef::change(const DexMethodSpec& ref, bool rename_on_collision) {
   g_redex->mutate_method(this, ref, rename_on_collision);
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 void DexMethod::make_non_concrete() {
   m_access = static_cast<DexAccessFlags>(0);
   m_concrete = false;
+  if (m_balloon_state.exchange(kNotPending) != kNotPending) {
+    m_dex_code.reset();
+  }
   m_code.reset();
   m_virtual = false;
   m_param_anno.reset();
@@ -1216,7 +1311,10 @@ void DexClass::load_class_data_item(
   }
 }
 
-std::unique_ptr<IRCode> DexMethod::release_code() { return std::move(m_code); }
+std::unique_ptr<IRCode> DexMethod::release_code() {
+  balloon_pending();
+  return std::move(m_code);
+}
 
 std::vector<DexMethod*> DexClass::get_all_methods() const {
   std::vector<DexMethod*> all_methods(m_vmethods.begin(), m_vmethods.end());
@@ -1234,6 +1332,7 @@ void DexClass::add_method(DexMethod* m) {
   } else {
     insert_sorted(m_dmethods, m, compare_dexmethods);
   }
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 std::vector<DexField*> DexClass::get_all_fields() const {
@@ -1253,6 +1352,7 @@ void DexClass::add_field(DexField* f) {
   } else {
     insert_sorted(m_ifields, f, compare_dexfields);
   }
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 void DexClass::remove_field(const DexField* f) {
@@ -1265,6 +1365,7 @@ void DexClass::remove_field(const DexField* f) {
     fields.erase(it);
   }
   redex_assert(erase);
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 void DexClass::remove_field_definition(DexField* f) {
@@ -1941,7 +2042,7 @@ template <typename C>
 void DexMethod::gather_types(C& ltype) const {
   gather_types_shallow(ltype); // Handle DexMethodRef parts.
   std::vector<DexType*> type_vec; // Simplify refactor.
-  if (m_code) m_code->gather_types(type_vec);
+  if (auto* code = get_code()) code->gather_types(type_vec);
   if (m_anno) m_anno->gather_types(type_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -1955,15 +2056,15 @@ void DexMethod::gather_types(C& ltype) const {
 INSTANTIATE(DexMethod::gather_types, DexType*)
 
 void DexMethod::gather_init_classes(std::vector<DexType*>& ltype) const {
-  if (m_code) m_code->gather_init_classes(ltype);
+  if (auto* code = get_code()) code->gather_init_classes(ltype);
 }
 
 template <typename C>
 void DexMethod::gather_callsites(C& lcallsite) const {
   // We handle m_spec.cls and proto in the first-layer gather.
-  if (m_code) {
+  if (auto* code = get_code()) {
     std::vector<DexCallSite*> callsite_vec; // Simplify refactor.
-    m_code->gather_callsites(callsite_vec);
+    code->gather_callsites(callsite_vec);
     c_append_all(lcallsite, callsite_vec.begin(), callsite_vec.end());
   }
 }
@@ -1973,7 +2074,7 @@ template <typename C>
 void DexMethod::gather_methodhandles(C& lmethodhandle) const {
   // We handle m_spec.cls and proto in the first-layer gather.
   std::vector<DexMethodHandle*> mhandles_vec; // Simplify refactor.
-  if (m_code) m_code->gather_methodhandles(mhandles_vec);
+  if (auto* code = get_code()) code->gather_methodhandles(mhandles_vec);
   c_append_all(lmethodhandle, mhandles_vec.begin(), mhandles_vec.end());
 }
 INSTANTIATE(DexMethod::gather_methodhandles, DexMethodHandle*)
@@ -1981,7 +2082,9 @@ template <typename C>
 void DexMethod::gather_strings_internal(C& lstring, bool exclude_loads) const {
   // We handle m_name and proto in the first-layer gather.
   std::vector<const DexString*> strings_vec; // Simplify refactor.
-  if (m_code && !exclude_loads) m_code->gather_strings(strings_vec);
+  if (!exclude_loads) {
+    if (auto* code = get_code()) code->gather_strings(strings_vec);
+  }
   if (m_anno) m_anno->gather_strings(strings_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -2004,7 +2107,7 @@ void DexMethod::gather_strings(std::unordered_set<const DexString*>& lstring,
 template <typename C>
 void DexMethod::gather_fields(C& lfield) const {
   std::vector<DexFieldRef*> fields_vec; // Simplify refactor.
-  if (m_code) m_code->gather_fields(fields_vec);
+  if (auto* code = get_code()) code->gather_fields(fields_vec);
   if (m_anno) m_anno->gather_fields(fields_vec);
   auto param_anno = get_param_anno();
   if (param_anno) {
@@ -2019,9 +2122,9 @@ INSTANTIATE(DexMethod::gather_fields, DexFieldRef*)
 
 template <typename C>
 void DexMethod::gather_methods(C& lmethod) const {
-  if (m_code) {
+  if (auto* code = get_code()) {
     std::vector<DexMethodRef*> method_vec; // Simplify refactor.
-    m_code->gather_methods(method_vec);
+    code->gather_methods(method_vec);
     c_append_all(lmethod, method_vec.begin(), method_vec.end());
   }
   gather_methods_from_annos(lmethod);
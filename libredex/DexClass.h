@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
@@ -73,6 +74,10 @@ class DexString;
 class DexType;
 class PositionMapper;
 
+namespace reachability {
+class ReachableObjects;
+} // namespace reachability
+
 // Must be same as in DexAnnotations.h!
 using ParamAnnotations = std::map<int, std::unique_ptr<DexAnnotationSet>>;
 
@@ -263,12 +268,19 @@ struct dextypes_comparator {
 class DexFieldRef {
   friend struct RedexContext;
   friend class DexClass;
+  friend class reachability::ReachableObjects;
 
  protected:
   DexFieldSpec m_spec;
   bool m_concrete;
   bool m_external;
 
+ private:
+  // The epoch of the last reachability marking that reached this field.
+  mutable std::atomic<uint32_t> m_reachability_mark{0};
+
+ protected:
+
   virtual ~DexFieldRef() {}
   DexFieldRef(DexType* container, const DexString* name, DexType* type) {
     m_spec.cls = container;
@@ -328,7 +340,14 @@ class DexField : public DexFieldRef {
   friend class DexFieldRef;
 
   /* Concrete method members */
+  // Hot members come first, right after the spec; see the layout note on
+  // DexMethod.
   DexAccessFlags m_access;
+
+ public:
+  ReferencedState rstate; // Tracks whether this field can be deleted or renamed
+
+ private:
   std::unique_ptr<DexAnnotationSet> m_anno;
   std::unique_ptr<DexEncodedValue> m_value; /* Static Only */
   std::string m_deobfuscated_name;
@@ -344,7 +363,11 @@ class DexField : public DexFieldRef {
   DexField(const DexField&) = delete;
   ~DexField();
 
-  ReferencedState rstate; // Tracks whether this field can be deleted or renamed
+  // Storage is owned by RedexContext, which reuses the slots of deleted fields
+  // and releases all of it at once, see the LAYOUT note on DexMethod.
+  static void* operator new(size_t, void* storage) { return storage; }
+  static void operator delete(void*, void*) {}
+  static void operator delete(void* storage);
 
   // DexField retrieval/creation
 
@@ -800,12 +823,19 @@ class DexCode {
 class DexMethodRef {
   friend struct RedexContext;
   friend class DexClass;
+  friend class reachability::ReachableObjects;
 
  protected:
   DexMethodSpec m_spec;
   bool m_concrete;
   bool m_external;
 
+ private:
+  // The epoch of the last reachability marking that reached this method.
+  mutable std::atomic<uint32_t> m_reachability_mark{0};
+
+ protected:
+
   ~DexMethodRef() {}
   DexMethodRef(DexType* type, const DexString* name, DexProto* proto)
       : m_spec(type, name, proto) {
@@ -864,14 +894,43 @@ class DexMethod : public DexMethodRef {
 
   // Place these first to avoid/fill padding from DexMethodRef.
   bool m_virtual{false};
+  // Set when the method was loaded with lazy ballooning, and `m_dex_code` has
+  // not yet been converted into `m_code`. See `get_code()`. The state and both
+  // code members are mutable, as a pending method is lifted on first access,
+  // also through the const accessors.
+  enum BalloonState : uint8_t {
+    kNotPending,
+    kPending,
+    kPendingNoThrow,
+  };
+  mutable std::atomic<uint8_t> m_balloon_state{kNotPending};
   DexAccessFlags m_access;
 
+  // LAYOUT: Whole-program scans (walk::code, reachability, most passes) touch
+  // the spec, the flags, `m_code` and `rstate` of every method, and little
+  // else. Those are laid out first, in the first 64 bytes of the object;
+  // members only needed when loading, writing or printing a method come last.
+  // Objects are packed at their size (96 bytes here, 112 for DexField) and
+  // not aligned to cache lines, so the hot part still spans two lines for
+  // most objects. The main win is that storage for methods and fields is
+  // handed out by RedexContext from per-thread buffers, so the members of a
+  // class, which are created together while it is loaded, end up next to
+  // each other instead of being scattered over the heap.
+  mutable std::unique_ptr<IRCode> m_code;
+
+ public:
+  // Tracks whether this method can be deleted or renamed
+  ReferencedState rstate;
+
+ private:
   std::unique_ptr<DexAnnotationSet> m_anno;
-  std::unique_ptr<DexCode> m_dex_code;
-  std::unique_ptr<IRCode> m_code;
+  mutable std::unique_ptr<DexCode> m_dex_code;
   std::unique_ptr<ParamAnnotations> m_param_anno;
   const DexString* m_deobfuscated_name{nullptr};
 
+  // Converts `m_dex_code` into `m_code`.
+  void lift() const;
+
   // See UNIQUENESS above for the rationale for the private constructor pattern.
   DexMethod(DexType* type, const DexString* name, DexProto* proto);
   ~DexMethod();
@@ -881,6 +940,12 @@ class DexMethod : public DexMethodRef {
     void operator()(DexMethod* m) { delete m; }
   };
 
+  // Storage is owned by RedexContext, which reuses the slots of deleted
+  // methods and releases all of it at once, see LAYOUT.
+  static void* operator new(size_t, void* storage) { return storage; }
+  static void operator delete(void*, void*) {}
+  static void operator delete(void* storage);
+
   std::string self_show() const; // To avoid "Show.h" in the header.
 
  public:
@@ -888,9 +953,6 @@ class DexMethod : public DexMethodRef {
   DexMethod(DexMethodRef&&) = delete;
   DexMethod(const DexMethodRef&) = delete;
 
-  // Tracks whether this method can be deleted or renamed
-  ReferencedState rstate;
-
   // DexMethod retrieval/creation
 
   // If the DexMethod exists, return it, otherwise create it and return it.
@@ -979,8 +1041,18 @@ class DexMethod : public DexMethodRef {
   DexAnnotationSet* get_anno_set() { return m_anno.get(); }
   const DexCode* get_dex_code() const { return m_dex_code.get(); }
   DexCode* get_dex_code() { return m_dex_code.get(); }
-  IRCode* get_code() { return m_code.get(); }
-  const IRCode* get_code() const { return m_code.get(); }
+  IRCode* get_code() {
+    if (m_balloon_state.load(std::memory_order_acquire) != kNotPending) {
+      balloon_pending();
+    }
+    return m_code.get();
+  }
+  const IRCode* get_code() const {
+    if (m_balloon_state.load(std::memory_order_acquire) != kNotPending) {
+      balloon_pending();
+    }
+    return m_code.get();
+  }
   std::unique_ptr<IRCode> release_code();
   bool is_virtual() const { return m_virtual; }
   DexAccessFlags get_access() const {
@@ -1088,6 +1160,21 @@ class DexMethod : public DexMethodRef {
   void balloon();
   void sync();
 
+  /*
+   * Lazy ballooning: instead of eagerly converting the DexCode, the loader may
+   * mark a method so that the first call to `get_code()` performs the
+   * conversion. This is thread-safe; concurrent callers block until the
+   * IRCode is available. If `throw_on_error` is false, a method whose DexCode
+   * cannot be lifted is left without IRCode, as with eager ballooning.
+   */
+  void mark_balloon_pending(bool throw_on_error = true);
+  bool is_balloon_pending() const {
+    return m_balloon_state.load(std::memory_order_acquire) != kNotPending;
+  }
+  // Balloons now if the method is still pending, no-op otherwise. Returns
+  // false if lifting failed and errors were configured as non-fatal.
+  bool balloon_pending() const;
+
   // This method frees the given `DexMethod` - different from `erase_method`,
   // which removes the method from the `RedexContext`.
   //
@@ -1147,6 +1234,8 @@ class DexClass {
   DexAccessFlags m_access_flags;
   bool m_external;
   PerfSensitiveGroup m_perf_sensitive;
+  // The epoch of the last reachability marking that reached this class.
+  mutable std::atomic<uint32_t> m_reachability_mark{0};
 
   explicit DexClass(const DexLocation* location);
   void load_class_annotations(DexIdx* idx, uint32_t anno_off);
@@ -1155,6 +1244,7 @@ class DexClass {
                             std::unique_ptr<DexEncodedValueArray> svalues);
 
   friend struct ClassCreator;
+  friend class reachability::ReachableObjects;
 
   // This constructor is private on purpose, use DexClass::create instead
   DexClass(DexIdx* idx, const dex_class_def* cdef, const DexLocation* location);
@@ -1171,6 +1261,9 @@ class DexClass {
                           const dex_class_def* cdef,
                           const DexLocation* location);
 
+  // Adding or removing members through the mutable lists bypasses the
+  // ResolverCache; prefer add_method/remove_method and add_field/remove_field,
+  // or invalidate the cache after the edit.
   const std::vector<DexMethod*>& get_dmethods() const { return m_dmethods; }
   std::vector<DexMethod*>& get_dmethods() {
     always_assert_log(!m_external, "Unexpected external class %s\n",
@@ -1296,19 +1389,11 @@ class DexClass {
 
   void set_external();
 
-  void set_super_class(DexType* super_class) {
-    always_assert_log(!m_external, "Unexpected external class %s\n",
-                      self_show().c_str());
-    m_super_class = super_class;
-  }
+  void set_super_class(DexType* super_class);
 
   void combine_annotations_with(DexClass* other);
 
-  void set_interfaces(DexTypeList* intfs) {
-    always_assert_log(!m_external, "Unexpected external class %s\n",
-                      self_show().c_str());
-    m_interfaces = intfs;
-  }
+  void set_interfaces(DexTypeList* intfs);
 
   void clear_annotations();
   /* Encodes class_data_item, returns size in bytes.  No
@@ -19,6 +19,7 @@
 #include "Walkers.h"
 #include "WorkQueue.h"
 
+#include <atomic>
 #include <exception>
 #include <stdexcept>
 #include <vector>
@@ -622,7 +623,18 @@ DexClasses DexLoader::load_dex(const dex_header* dh, dex_stats_t* stats) {
   return classes;
 }
 
-static void balloon_all(const Scope& scope, bool throw_on_error) {
+static void balloon_all(const Scope& scope, bool throw_on_error, bool lazy) {
+  if (lazy) {
+    // Only mark the methods; the conversion happens on the first `get_code()`
+    // call, or in `balloon_all_pending()`.
+    walk::parallel::methods(scope, [&](DexMethod* m) {
+      if (m->get_dex_code()) {
+        m->mark_balloon_pending(throw_on_error);
+      }
+    });
+    return;
+  }
+
   ConcurrentMap<DexMethod*, std::string> ir_balloon_errors;
   walk::parallel::methods(scope, [&](DexMethod* m) {
     if (m->get_dex_code()) {
@@ -653,24 +665,27 @@ static void balloon_all(const Scope& scope, bool throw_on_error) {
 DexClasses load_classes_from_dex(const DexLocation* location,
                                  bool balloon,
                                  bool throw_on_balloon_error,
-                                 int support_dex_version) {
+                                 int support_dex_version,
+                                 bool lazy_balloon) {
   dex_stats_t stats;
   return load_classes_from_dex(location, &stats, balloon,
-                               throw_on_balloon_error, support_dex_version);
+                               throw_on_balloon_error, support_dex_version,
+                               lazy_balloon);
 }
 
 DexClasses load_classes_from_dex(const DexLocation* location,
                                  dex_stats_t* stats,
                                  bool balloon,
                                  bool throw_on_balloon_error,
-                                 int support_dex_version) {
+                                 int support_dex_version,
+                                 bool lazy_balloon) {
   TRACE(MAIN, 1, "Loading classes from dex from %s",
         location->get_file_name().c_str());
   DexLoader dl(location);
   auto classes = dl.load_dex(location->get_file_name().c_str(), stats,
                              support_dex_version);
   if (balloon) {
-    balloon_all(classes, throw_on_balloon_error);
+    balloon_all(classes, throw_on_balloon_error, lazy_balloon);
   }
   return classes;
 }
@@ -682,15 +697,28 @@ DexClasses load_classes_from_dex(const dex_header* dh,
   DexLoader dl(location);
   auto classes = dl.load_dex(dh, nullptr);
   if (balloon) {
-    balloon_all(classes, throw_on_balloon_error);
+    balloon_all(classes, throw_on_balloon_error, /* lazy */ false);
   }
   return classes;
 }
 
+size_t balloon_all_pending(const Scope& scope) {
+  std::atomic<size_t> ballooned{0};
+  walk::parallel::methods(scope, [&](DexMethod* m) {
+    if (m->is_balloon_pending()) {
+      m->balloon_pending();
+      ballooned.fetch_add(1, std::memory_order_relaxed);
+    }
+  });
+  return ballooned.load();
+}
+
 std::string load_dex_magic_from_dex(const DexLocation* location) {
   DexLoader dl(location);
   auto dh = dl.get_dex_header(location->get_file_name().c_str());
   return dh->magic;
 }
 
-void balloon_for_test(const Scope& scope) { balloon_all(scope, true); }
+void balloon_for_test(const Scope& scope) {
+  balloon_all(scope, true, /* lazy */ false);
+}
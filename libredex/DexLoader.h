@@ -35,15 +35,21 @@ class DexLoader {
   DexIdx* get_idx() { return m_idx.get(); }
 };
 
+/*
+ * When `lazy_balloon` is set, methods are only marked for ballooning, and their
+ * IRCode gets created on first access through `DexMethod::get_code()`.
+ */
 DexClasses load_classes_from_dex(const DexLocation* location,
                                  bool balloon = true,
                                  bool throw_on_balloon_error = true,
-                                 int support_dex_version = 35);
+                                 int support_dex_version = 35,
+                                 bool lazy_balloon = false);
 DexClasses load_classes_from_dex(const DexLocation* location,
                                  dex_stats_t* stats,
                                  bool balloon = true,
                                  bool throw_on_balloon_error = true,
-                                 int support_dex_version = 35);
+                                 int support_dex_version = 35,
+                                 bool lazy_balloon = false);
 DexClasses load_classes_from_dex(const dex_header* dh,
                                  const DexLocation* location,
                                  bool balloon = true,
@@ -51,6 +57,12 @@ DexClasses load_classes_from_dex(const dex_header* dh,
 std::string load_dex_magic_from_dex(const DexLocation* location);
 void balloon_for_test(const Scope& scope);
 
+/*
+ * Barrier for lazily loaded methods: balloons every method in the scope that
+ * has not been accessed yet. Returns the number of methods ballooned.
+ */
+size_t balloon_all_pending(const Scope& scope);
+
 static inline const uint8_t* align_ptr(const uint8_t* const ptr,
                                        const size_t alignment) {
   const size_t alignment_error = ((size_t)ptr) % alignment;
@@ -22,6 +22,10 @@
 #include <sys/stat.h>
 #include <unordered_set>
 
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
 #ifdef _MSC_VER
 // TODO: Rewrite open/write/close with C/C++ standards. But it works for now.
 #include <io.h>
@@ -35,6 +39,7 @@
 #define O_WRONLY _O_WRONLY
 #endif
 
+#include "Adler32.h"
 #include "Debug.h"
 #include "DexCallSite.h"
 #include "DexClass.h"
@@ -524,6 +529,30 @@ uint32_t get_dex_output_size(const ConfigFiles& conf) {
 
 } // namespace
 
+DexOutputBuffer::DexOutputBuffer(size_t capacity) : m_capacity(capacity) {
+#ifdef __linux__
+  // Anonymous mappings are zero-filled, and pages are only committed on first
+  // write. MAP_NORESERVE keeps the untouched part from counting against the
+  // overcommit limit.
+  void* data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  always_assert_log(data != MAP_FAILED, "Cannot map %zu bytes: %s", capacity,
+                    strerror(errno));
+  m_data = static_cast<uint8_t*>(data);
+#else
+  m_data = static_cast<uint8_t*>(calloc(capacity, 1));
+  always_assert_log(m_data != nullptr, "Cannot allocate %zu bytes", capacity);
+#endif
+}
+
+DexOutputBuffer::~DexOutputBuffer() {
+#ifdef __linux__
+  munmap(m_data, m_capacity);
+#else
+  free(m_data);
+#endif
+}
+
 CodeItemEmit::CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci)
     : method(meth), code(c), code_item(ci) {}
 
@@ -561,15 +590,12 @@ DexOutput::DexOutput(
                          ? get_dex_output_size(config_files) * 2
                          : get_dex_output_size(config_files)) +
                     k_output_red_zone),
-      m_output(std::make_unique<uint8_t[]>(m_output_size)),
+      m_output(m_output_size),
       m_offset(0),
       m_iodi_metadata(iodi_metadata),
       m_config_files(config_files),
       m_min_sdk(min_sdk),
       m_dex_output_config(dex_output_config) {
-  // Ensure a clean slate.
-  memset(m_output.get(), 0, m_output_size);
-
   m_dodx = std::make_unique<DexOutputIdx>(*m_gtypes->get_dodx(m_output.get()));
 
   always_assert_log(
@@ -1043,6 +1069,70 @@ static void sync_all(const Scope& scope) {
   }
 }
 
+namespace {
+
+/*
+ * Encodes items [0, n) in parallel into scratch buffers, and then hands the
+ * encoded bytes to `emit` sequentially, in index order. `bound(i)` must be an
+ * upper bound of the number of bytes `encode(i, out)` writes, and `encode`
+ * returns the number of bytes it actually wrote. Items are processed in chunks,
+ * so that only a bounded amount of scratch memory is live at any time.
+ */
+template <typename Bound, typename Encode, typename Emit>
+void encode_chunked_in_parallel(size_t n,
+                                const Bound& bound,
+                                const Encode& encode,
+                                const Emit& emit) {
+  constexpr size_t kChunkSize = 4096;
+  std::vector<size_t> offsets;
+  std::vector<size_t> sizes;
+  std::vector<uint8_t> scratch;
+  for (size_t chunk_start = 0; chunk_start < n; chunk_start += kChunkSize) {
+    size_t chunk_end = std::min(n, chunk_start + kChunkSize);
+    size_t chunk_size = chunk_end - chunk_start;
+    offsets.assign(chunk_size + 1, 0);
+    for (size_t j = 0; j < chunk_size; ++j) {
+      // Keep every buffer 4-byte aligned; code items are written as words.
+      offsets[j + 1] = (offsets[j] + bound(chunk_start + j) + 3) & ~size_t(3);
+    }
+    // Encoders skip over padding, so the buffers must start out zeroed, just
+    // like the output buffer.
+    scratch.assign(offsets[chunk_size], 0);
+    sizes.assign(chunk_size, 0);
+    workqueue_run_for<size_t>(chunk_start, chunk_end, [&](size_t i) {
+      auto j = i - chunk_start;
+      sizes[j] = encode(i, scratch.data() + offsets[j]);
+      always_assert(sizes[j] <= offsets[j + 1] - offsets[j]);
+    });
+    for (size_t j = 0; j < chunk_size; ++j) {
+      emit(chunk_start + j, scratch.data() + offsets[j], sizes[j]);
+    }
+  }
+}
+
+// An upper bound of the number of bytes DexCode::encode writes.
+size_t code_item_size_bound(const DexCode* code) {
+  // Instructions (including payloads), plus the padding before the tries.
+  size_t insns_size = 1;
+  for (const auto* insn : code->get_instructions()) {
+    insns_size += insn->size();
+  }
+  size_t bound = sizeof(dex_code_item) + insns_size * sizeof(uint16_t);
+  const auto& tries = code->get_tries();
+  if (tries.empty()) {
+    return bound;
+  }
+  // Each handler list has a sleb128 size, and a uleb128 type index and
+  // address per catch. The handler lists are preceded by their uleb128 count.
+  bound += tries.size() * sizeof(dex_tries_item) + 5;
+  for (const auto& dextry : tries) {
+    bound += 5 + dextry->m_catches.size() * 10;
+  }
+  return bound;
+}
+
+} // namespace
+
 void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
   TRACE(MAIN, 2, "generate_code_items");
   /*
@@ -1086,31 +1176,44 @@ void DexOutput::generate_code_items(const std::vector<SortMode>& mode) {
       break;
     }
   }
+  std::vector<std::pair<DexMethod*, DexCode*>> code_methods;
+  code_methods.reserve(lmeth.size());
   for (DexMethod* meth : lmeth) {
     if (meth->get_access() & (ACC_ABSTRACT | ACC_NATIVE)) {
       // There is no code item for ABSTRACT or NATIVE methods.
       continue;
     }
-    TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
-          SHOW(meth));
     DexCode* code = meth->get_dex_code();
     always_assert_log(
         meth->is_concrete() && code != nullptr,
         "Undefined method in generate_code_items()\n\t prototype: %s\n",
         SHOW(meth));
-    align_output();
-    int size =
-        code->encode(m_dodx.get(), (uint32_t*)(m_output.get() + m_offset));
-    check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
-    m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(), m_offset);
-    m_code_item_emits.emplace_back(meth, code,
-                                   (dex_code_item*)(m_output.get() + m_offset));
-    auto insns_size =
-        ((const dex_code_item*)(m_output.get() + m_offset))->insns_size;
-    inc_offset(size);
-    m_stats.num_instructions += code->get_instructions().size();
-    m_stats.instruction_bytes += insns_size * 2;
-  }
+    code_methods.emplace_back(meth, code);
+  }
+  // Code items only contain method-relative offsets, so we encode them in
+  // parallel and then copy them to their final (aligned) offsets in emit
+  // order.
+  encode_chunked_in_parallel(
+      code_methods.size(),
+      [&](size_t i) { return code_item_size_bound(code_methods[i].second); },
+      [&](size_t i, uint8_t* out) -> size_t {
+        return code_methods[i].second->encode(m_dodx.get(), (uint32_t*)out);
+      },
+      [&](size_t i, const uint8_t* data, size_t size) {
+        auto [meth, code] = code_methods[i];
+        TRACE(CUSTOMSORT, 3, "method emit %s %s", SHOW(meth->get_class()),
+              SHOW(meth));
+        align_output();
+        memcpy(m_output.get() + m_offset, data, size);
+        check_method_instruction_size_limit(m_config_files, size, SHOW(meth));
+        m_method_bytecode_offsets.emplace_back(meth->get_name()->c_str(),
+                                               m_offset);
+        auto* dci = (dex_code_item*)(m_output.get() + m_offset);
+        m_code_item_emits.emplace_back(meth, code, dci);
+        inc_offset(size);
+        m_stats.num_instructions += code->get_instructions().size();
+        m_stats.instruction_bytes += dci->insns_size * 2;
+      });
   /// insert_map_item returns early if m_code_item_emits is empty
   insert_map_item(TYPE_CODE_ITEM, (uint32_t)m_code_item_emits.size(), ci_start,
                   m_offset - ci_start);
@@ -1432,6 +1535,15 @@ DebugMetadata calculate_debug_metadata(
   return metadata;
 }
 
+// An upper bound of the number of bytes DexDebugItem::encode writes.
+size_t debug_item_size_bound(const DebugMetadata& metadata) {
+  // The line start, the parameter count, a (no-index) name per parameter, and
+  // the end-of-sequence opcode. Each instruction is an opcode followed by at
+  // most four leb128 values (DBG_START_LOCAL_EXTENDED).
+  return 5 + 5 * (1 + metadata.num_params) + 1 +
+         metadata.dbgops.size() * (1 + 4 * 5);
+}
+
 int emit_debug_info_for_metadata(DexOutputIdx* dodx,
                                  const DebugMetadata& metadata,
                                  uint8_t* output,
@@ -1445,25 +1557,6 @@ int emit_debug_info_for_metadata(DexOutputIdx* dodx,
   return size;
 }
 
-int emit_debug_info(
-    DexOutputIdx* dodx,
-    bool emit_positions,
-    DexDebugItem* dbg,
-    DexCode* dc,
-    dex_code_item* dci,
-    PositionMapper* pos_mapper,
-    uint8_t* output,
-    uint32_t offset,
-    uint32_t num_params,
-    std::unordered_map<DexCode*, std::vector<DebugLineItem>>* dbg_lines) {
-  // No align requirement for debug items.
-  DebugMetadata metadata = calculate_debug_metadata(
-      dbg, dc, dci, pos_mapper, num_params, dbg_lines, /*line_addin=*/0);
-  return emit_positions
-             ? emit_debug_info_for_metadata(dodx, metadata, output, offset)
-             : 0;
-}
-
 struct MethodKey {
   const DexMethod* method;
   uint32_t size;
@@ -2352,16 +2445,43 @@ void DexOutput::generate_debug_items() {
               "[IODI] WARNING: Not using IODI because no iodi metadata file was"
               " specified.\n");
     }
-    for (auto& it : m_code_item_emits) {
-      DexCode* dc = it.code;
-      dex_code_item* dci = it.code_item;
-      auto dbg = dc->get_debug_item();
-      if (dbg == nullptr) continue;
-      dbgcount++;
-      size_t num_params = it.method->get_proto()->get_args()->size();
-      inc_offset(emit_debug_info(m_dodx.get(), emit_positions, dbg, dc, dci,
-                                 m_pos_mapper, m_output.get(), m_offset,
-                                 num_params, m_code_debug_lines));
+    // The position mapper assigns line numbers in emit order, so the debug
+    // instructions are generated sequentially. Only their encoding, which is
+    // position-independent, runs in parallel.
+    constexpr size_t kChunkSize = 4096;
+    std::vector<DebugMetadata> metadata;
+    for (size_t chunk_start = 0; chunk_start < m_code_item_emits.size();
+         chunk_start += kChunkSize) {
+      size_t chunk_end =
+          std::min(m_code_item_emits.size(), chunk_start + kChunkSize);
+      metadata.clear();
+      for (size_t i = chunk_start; i < chunk_end; ++i) {
+        auto& it = m_code_item_emits[i];
+        DexCode* dc = it.code;
+        auto dbg = dc->get_debug_item();
+        if (dbg == nullptr) continue;
+        dbgcount++;
+        size_t num_params = it.method->get_proto()->get_args()->size();
+        metadata.push_back(calculate_debug_metadata(
+            dbg, dc, it.code_item, m_pos_mapper, num_params,
+            m_code_debug_lines, /*line_addin=*/0));
+      }
+      if (!emit_positions) {
+        continue;
+      }
+      // No align requirement for debug items.
+      encode_chunked_in_parallel(
+          metadata.size(),
+          [&](size_t i) { return debug_item_size_bound(metadata[i]); },
+          [&](size_t i, uint8_t* out) -> size_t {
+            return emit_debug_info_for_metadata(m_dodx.get(), metadata[i], out,
+                                                0, /*set_dci_offset=*/false);
+          },
+          [&](size_t i, const uint8_t* data, size_t size) {
+            memcpy(m_output.get() + m_offset, data, size);
+            metadata[i].dci->debug_info_off = m_offset;
+            inc_offset(size);
+          });
     }
   }
   if (emit_positions) {
@@ -2498,19 +2618,29 @@ void DexOutput::init_header_offsets(const std::string& dex_magic) {
 void DexOutput::finalize_header() {
   hdr.data_size = m_offset - hdr.data_off;
   hdr.file_size = m_offset;
-  int skip;
-  skip = sizeof(hdr.magic) + sizeof(hdr.checksum) + sizeof(hdr.signature);
   memcpy(m_output.get(), &hdr, sizeof(hdr));
+  // The signature covers everything after itself, and the checksum everything
+  // after itself, i.e. the signature and the same data. So both are computed
+  // in a single pass over the data, one chunk at a time while it is still in
+  // cache, and the checksum of the signature is combined in at the end.
+  const auto* output = (const uint8_t*)m_output.get();
+  uint32_t data_start =
+      sizeof(hdr.magic) + sizeof(hdr.checksum) + sizeof(hdr.signature);
+  uint32_t data_size = hdr.file_size - data_start;
+  constexpr uint32_t kChunkSize = 64 * 1024;
   Sha1Context context;
   sha1_init(&context);
-  sha1_update(&context, m_output.get() + skip, hdr.file_size - skip);
+  uint32_t data_adler = (uint32_t)adler32(0L, Z_NULL, 0);
+  for (uint32_t offset = data_start; offset < hdr.file_size;
+       offset += kChunkSize) {
+    uint32_t size = std::min(kChunkSize, hdr.file_size - offset);
+    sha1_update(&context, output + offset, size);
+    data_adler = adler32_update(data_adler, output + offset, size);
+  }
   sha1_final(hdr.signature, &context);
-  memcpy(m_output.get(), &hdr, sizeof(hdr));
-  uint32_t adler = (uint32_t)adler32(0L, Z_NULL, 0);
-  skip = sizeof(hdr.magic) + sizeof(hdr.checksum);
-  adler = (uint32_t)adler32(adler, (const Bytef*)(m_output.get() + skip),
-                            hdr.file_size - skip);
-  hdr.checksum = adler;
+  uint32_t adler = adler32_update((uint32_t)adler32(0L, Z_NULL, 0),
+                                  hdr.signature, sizeof(hdr.signature));
+  hdr.checksum = (uint32_t)adler32_combine(adler, data_adler, data_size);
   memcpy(m_output.get(), &hdr, sizeof(hdr));
 }
 
@@ -2560,30 +2690,64 @@ void compute_method_to_id_map(
   }
 }
 
+/*
+ * Renders entries [0, n) in parallel and appends them to `out` in index order.
+ * Entries are processed in chunks, so that only a bounded number of rendered
+ * entries is held in memory at any time.
+ */
+template <typename Fn>
+void write_chunked_in_parallel(std::ostream& out, size_t n, const Fn& render) {
+  constexpr size_t kChunkSize = 4096;
+  std::vector<std::string> buffers;
+  for (size_t chunk_start = 0; chunk_start < n; chunk_start += kChunkSize) {
+    size_t chunk_end = std::min(n, chunk_start + kChunkSize);
+    buffers.assign(chunk_end - chunk_start, std::string());
+    workqueue_run_for<size_t>(chunk_start, chunk_end, [&](size_t i) {
+      render(i, buffers[i - chunk_start]);
+    });
+    for (const auto& buffer : buffers) {
+      out << buffer;
+    }
+  }
+}
+
 void write_method_mapping(const std::string& filename,
                           const DexOutputIdx* dodx,
                           const DexClasses* classes,
                           uint8_t* dex_signature) {
   always_assert(!filename.empty());
-  FILE* fd = fopen(filename.c_str(), "a");
-  assert_log(fd, "Can't open method mapping file %s: %s\n", filename.c_str(),
+  std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
+  assert_log(ofs, "Can't open method mapping file %s: %s\n", filename.c_str(),
              strerror(errno));
   std::unordered_set<DexClass*> classes_in_dex(classes->begin(),
                                                classes->end());
+
+  // We only want to emit IDs for the methods that are defined in this dex,
+  // and not for references to methods in other dexes. Emit them in index order
+  // so that the output does not depend on hashing.
+  std::vector<std::pair<uint32_t, DexMethodRef*>> methods;
   for (auto& it : dodx->method_to_idx()) {
-    auto method = it.first;
-    auto idx = it.second;
+    if (classes_in_dex.count(type_class(it.first->get_class())) != 0) {
+      methods.emplace_back(it.second, it.first);
+    }
+  }
+  std::sort(methods.begin(), methods.end());
+
+  // Turns out, the checksum can change on-device. (damn you dexopt)
+  // The signature, however, is never recomputed. Let's log the top 4 bytes,
+  // in little-endian (since that's faster to compute on-device).
+  uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
+
+  write_chunked_in_parallel(ofs, methods.size(), [&](size_t i,
+                                                      std::string& out) {
+    auto idx = methods[i].first;
+    auto method = methods[i].second;
 
     // Types (and methods) internal to our app have a cached deobfuscated name
     // that comes from the proguard map.  If we don't have one, it's a
     // system/framework class, so we can just return the name.
     auto const& typecls = method->get_class();
     auto const& cls = type_class(typecls);
-    if (classes_in_dex.count(cls) == 0) {
-      // We only want to emit IDs for the methods that are defined in this dex,
-      // and not for references to methods in other dexes.
-      continue;
-    }
     auto deobf_class = [&] {
       if (cls) {
         auto deobname = cls->get_deobfuscated_name_or_empty();
@@ -2621,17 +2785,16 @@ void write_method_mapping(const std::string& filename,
     // We only want the name here.
     auto begin = deobf_method.find('.') + 1;
     auto end = deobf_method.rfind(':');
-    auto deobf_method_name = deobf_method.substr(begin, end - begin);
 
-    // Turns out, the checksum can change on-device. (damn you dexopt)
-    // The signature, however, is never recomputed. Let's log the top 4 bytes,
-    // in little-endian (since that's faster to compute on-device).
-    uint32_t signature = *reinterpret_cast<uint32_t*>(dex_signature);
-
-    fprintf(fd, "%u %u %s %s\n", idx, signature, deobf_method_name.c_str(),
-            deobf_class.c_str());
-  }
-  fclose(fd);
+    out.append(std::to_string(idx))
+        .append(" ")
+        .append(std::to_string(signature))
+        .append(" ")
+        .append(deobf_method, begin, end - begin)
+        .append(" ")
+        .append(deobf_class)
+        .append("\n");
+  });
 }
 
 void write_class_mapping(const std::string& filename,
@@ -2796,28 +2959,32 @@ void write_pg_mapping(const std::string& filename, DexClasses* classes) {
 
   std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
 
-  for (auto cls : *classes) {
+  write_chunked_in_parallel(ofs, classes->size(), [&](size_t i,
+                                                       std::string& buffer) {
+    auto cls = classes->at(i);
+    std::ostringstream out;
     auto deobf_cls = deobf_class(cls);
-    ofs << java_names::internal_to_external(deobf_cls) << " -> "
+    out << java_names::internal_to_external(deobf_cls) << " -> "
         << java_names::internal_to_external(cls->get_type()->str()) << ":"
         << "\n";
     for (auto field : cls->get_ifields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << "\n";
+      out << "    " << deobf << " -> " << field->c_str() << "\n";
     }
     for (auto field : cls->get_sfields()) {
       auto deobf = deobf_field(field);
-      ofs << "    " << deobf << " -> " << field->c_str() << "\n";
+      out << "    " << deobf << " -> " << field->c_str() << "\n";
     }
     for (auto meth : cls->get_dmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << "\n";
+      out << "    " << deobf << " -> " << meth->c_str() << "\n";
     }
     for (auto meth : cls->get_vmethods()) {
       auto deobf = deobf_meth(meth);
-      ofs << "    " << deobf << " -> " << meth->c_str() << "\n";
+      out << "    " << deobf << " -> " << meth->c_str() << "\n";
     }
-  }
+    buffer = out.str();
+  });
 }
 
 void write_full_mapping(const std::string& filename,
@@ -2826,7 +2993,10 @@ void write_full_mapping(const std::string& filename,
   if (filename.empty()) return;
 
   std::ofstream ofs(filename.c_str(), std::ofstream::out | std::ofstream::app);
-  for (auto cls : *classes) {
+  write_chunked_in_parallel(ofs, classes->size(), [&](size_t i,
+                                                       std::string& buffer) {
+    auto cls = classes->at(i);
+    std::ostringstream ofs;
     ofs << "type " << cls->get_deobfuscated_name_or_empty() << " -> "
         << show(cls) << "\n";
     if (store_name) {
@@ -2850,7 +3020,8 @@ void write_full_mapping(const std::string& filename,
       ofs << "vmethod " << method->get_deobfuscated_name_or_empty() << " -> "
           << show(method) << "\n";
     }
-  }
+    buffer = ofs.str();
+  });
 }
 
 void write_bytecode_offset_mapping(
@@ -2874,6 +3045,8 @@ void write_bytecode_offset_mapping(
 } // namespace
 
 void DexOutput::write_symbol_files() {
+  // The writers run one after another; the larger ones render their entries
+  // in parallel, which keeps the work queue to one pool at a time.
   if (m_debug_info_kind != DebugInfoKind::NoCustomSymbolication) {
     write_method_mapping(m_method_mapping_filename, m_dodx.get(), m_classes,
                          hdr.signature);
@@ -308,6 +308,29 @@ struct CodeItemEmit {
   CodeItemEmit(DexMethod* meth, DexCode* c, dex_code_item* ci);
 };
 
+/*
+ * The buffer a dex is assembled in. Its whole capacity is reserved upfront, so
+ * that pointers into it stay valid, but as zero-filled anonymous memory: pages
+ * only take up memory once they are written to, so the buffer effectively
+ * grows with the dex instead of costing its maximum size. Hosts other than
+ * Linux get a plain zeroed heap allocation.
+ */
+class DexOutputBuffer {
+ public:
+  explicit DexOutputBuffer(size_t capacity);
+  ~DexOutputBuffer();
+
+  DexOutputBuffer(const DexOutputBuffer&) = delete;
+  DexOutputBuffer& operator=(const DexOutputBuffer&) = delete;
+
+  uint8_t* get() const { return m_data; }
+  size_t capacity() const { return m_capacity; }
+
+ private:
+  uint8_t* m_data;
+  size_t m_capacity;
+};
+
 struct DexOutputTestHelper;
 
 class DexOutput {
@@ -329,7 +352,7 @@ class DexOutput {
   std::unique_ptr<DexOutputIdx> m_dodx;
   std::shared_ptr<GatheredTypes> m_gtypes;
   const size_t m_output_size;
-  std::unique_ptr<uint8_t[]> m_output;
+  DexOutputBuffer m_output;
   uint32_t m_offset;
   const char* m_filename;
   size_t m_store_number;
@@ -6,7 +6,6 @@
  */
 
 #include <fstream>
-#include <sstream>
 
 #include "DexClass.h"
 #include "DexPosition.h"
@@ -308,7 +307,6 @@ void RealPositionMapper::write_map_v2() {
    * string_length (4 bytes)
    * char[string_length]
    */
-  std::ostringstream pos_out;
   std::unordered_map<std::string_view, uint32_t> string_ids;
   std::vector<std::unique_ptr<std::string>> string_pool;
 
@@ -322,41 +320,36 @@ void RealPositionMapper::write_map_v2() {
     return it->second;
   };
 
-  size_t unregistered_parent_positions{0};
+  // The same method and file strings are shared by very many positions, so we
+  // split and intern each of them only once. As ids are handed out in order of
+  // first occurrence either way, this does not change the string pool.
+  struct MethodIds {
+    uint32_t class_id;
+    uint32_t method_id;
+  };
+  std::unordered_map<const DexString*, MethodIds> method_ids;
+  std::unordered_map<const DexString*, uint32_t> file_ids;
 
+  // The string pool precedes the positions in the file, so all strings are
+  // interned first.
   for (auto pos : m_positions) {
-    uint32_t parent_line = 0;
-    try {
-      parent_line = pos->parent == nullptr ? 0 : get_line(pos->parent);
-    } catch (std::out_of_range& e) {
-      ++unregistered_parent_positions;
-      TRACE(OPUT, 1, "Parent position %s of %s was not registered",
-            SHOW(pos->parent), SHOW(pos));
+    if (method_ids.count(pos->method) == 0) {
+      // of the form "class_name.method_name:(arg_types)return_type"
+      const auto full_method_name = pos->method->str();
+      // strip out the args and return type
+      const auto qualified_method_name =
+          full_method_name.substr(0, full_method_name.find(':'));
+      auto class_name = java_names::internal_to_external(
+          qualified_method_name.substr(0, qualified_method_name.rfind('.')));
+      auto method_name =
+          qualified_method_name.substr(qualified_method_name.rfind('.') + 1);
+      auto class_id = id_of_string(class_name);
+      auto method_id = id_of_string(method_name);
+      method_ids.emplace(pos->method, MethodIds{class_id, method_id});
+    }
+    if (file_ids.count(pos->file) == 0) {
+      file_ids.emplace(pos->file, id_of_string(pos->file->str()));
     }
-    // of the form "class_name.method_name:(arg_types)return_type"
-    const auto full_method_name = pos->method->str();
-    // strip out the args and return type
-    const auto qualified_method_name =
-        full_method_name.substr(0, full_method_name.find(':'));
-    auto class_name = java_names::internal_to_external(
-        qualified_method_name.substr(0, qualified_method_name.rfind('.')));
-    auto method_name =
-        qualified_method_name.substr(qualified_method_name.rfind('.') + 1);
-    auto class_id = id_of_string(class_name);
-    auto method_id = id_of_string(method_name);
-    auto file_id = id_of_string(pos->file->str());
-    pos_out.write((const char*)&class_id, sizeof(class_id));
-    pos_out.write((const char*)&method_id, sizeof(method_id));
-    pos_out.write((const char*)&file_id, sizeof(file_id));
-    pos_out.write((const char*)&pos->line, sizeof(pos->line));
-    pos_out.write((const char*)&parent_line, sizeof(parent_line));
-  }
-
-  if (unregistered_parent_positions > 0 && !traceEnabled(OPUT, 1)) {
-    TRACE(OPUT, 0,
-          "%zu parent positions had not been registered. Run with TRACE=OPUT:1 "
-          "to list them.",
-          unregistered_parent_positions);
   }
 
   std::ofstream ofs(m_filename_v2.c_str(),
@@ -374,7 +367,46 @@ void RealPositionMapper::write_map_v2() {
   }
   uint32_t pos_count = m_positions.size();
   ofs.write((const char*)&pos_count, sizeof(pos_count));
-  ofs << pos_out.str();
+
+  // The positions table is streamed out as fixed-size records, a chunk at a
+  // time, so that it never has to be held in memory as a whole.
+  constexpr size_t kRecordSize = 5;
+  constexpr size_t kChunkRecords = 4096;
+  std::vector<uint32_t> records;
+  records.reserve(kChunkRecords * kRecordSize);
+  auto flush = [&]() {
+    ofs.write((const char*)records.data(), records.size() * sizeof(uint32_t));
+    records.clear();
+  };
+
+  size_t unregistered_parent_positions{0};
+  for (auto pos : m_positions) {
+    uint32_t parent_line = 0;
+    try {
+      parent_line = pos->parent == nullptr ? 0 : get_line(pos->parent);
+    } catch (std::out_of_range& e) {
+      ++unregistered_parent_positions;
+      TRACE(OPUT, 1, "Parent position %s of %s was not registered",
+            SHOW(pos->parent), SHOW(pos));
+    }
+    const auto& ids = method_ids.at(pos->method);
+    records.push_back(ids.class_id);
+    records.push_back(ids.method_id);
+    records.push_back(file_ids.at(pos->file));
+    records.push_back(pos->line);
+    records.push_back(parent_line);
+    if (records.size() == kChunkRecords * kRecordSize) {
+      flush();
+    }
+  }
+  flush();
+
+  if (unregistered_parent_positions > 0 && !traceEnabled(OPUT, 1)) {
+    TRACE(OPUT, 0,
+          "%zu parent positions had not been registered. Run with TRACE=OPUT:1 "
+          "to list them.",
+          unregistered_parent_positions);
+  }
 }
 
 PositionMapper* PositionMapper::make(const std::string& map_filename_v2) {
@@ -0,0 +1,526 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexSizeEstimator.h"
+
+#include <set>
+
+#include "ControlFlow.h"
+#include "Debug.h"
+#include "DexAnnotation.h"
+#include "DexEncoding.h"
+#include "DexUtil.h"
+#include "IRCode.h"
+#include "Show.h"
+
+namespace {
+
+constexpr size_t kHeaderBytes = 0x70;
+// The map list has an item for each section; a typical dex has 15 sections.
+constexpr size_t kMapListBytes = 4 + 15 * 12;
+constexpr size_t kStringIdBytes = 4;
+constexpr size_t kTypeIdBytes = 4;
+constexpr size_t kProtoIdBytes = 12;
+constexpr size_t kFieldIdBytes = 8;
+constexpr size_t kMethodIdBytes = 8;
+constexpr size_t kClassDefBytes = 32;
+constexpr size_t kCodeItemHeaderBytes = 16;
+constexpr size_t kTryItemBytes = 8;
+constexpr size_t kAnnotationsDirectoryHeaderBytes = 16;
+constexpr size_t kAnnotationsDirectoryEntryBytes = 8;
+
+// Indices into the id tables and offsets of data items are uleb128 encoded in
+// most places; these are their typical encoded sizes in large dexes.
+constexpr size_t kAverageIndexBytes = 2;
+constexpr size_t kAverageMemberIndexDiffBytes = 1;
+constexpr size_t kAverageOffsetBytes = 3;
+
+// Typical ratios of compressed to uncompressed bytes per section.
+constexpr double kIdsCompression = 0.55;
+constexpr double kStringDataCompression = 0.45;
+constexpr double kCodeCompression = 0.5;
+constexpr double kOtherCompression = 0.35;
+
+size_t align4(size_t size) { return (size + 3) & ~size_t(3); }
+
+size_t type_list_bytes(const DexTypeList* type_list) {
+  return align4(4 + 2 * type_list->size());
+}
+
+// Bytes of an integral value encoded with the minimal number of bytes that
+// preserve its value after sign or zero extension.
+size_t integral_value_bytes(uint64_t value, bool is_signed) {
+  if (is_signed && static_cast<int64_t>(value) < 0) {
+    value = ~value;
+  }
+  size_t bytes = 1;
+  // A signed value needs room for its sign bit.
+  while ((is_signed ? value >> 7 : value >> 8) != 0) {
+    value >>= 8;
+    bytes++;
+  }
+  return std::min<size_t>(bytes, 8);
+}
+
+// Bytes of a floating point value encoded without its trailing zero bytes.
+size_t floating_value_bytes(uint64_t value, size_t width) {
+  size_t bytes = width;
+  while (bytes > 1 && (value & 0xff) == 0) {
+    value >>= 8;
+    bytes--;
+  }
+  return bytes;
+}
+
+size_t encoded_annotation_bytes(const EncodedAnnotations& elements);
+
+size_t encoded_value_bytes(const DexEncodedValue* value) {
+  switch (value->evtype()) {
+  case DEVT_NULL:
+  case DEVT_BOOLEAN:
+    return 1;
+  case DEVT_BYTE:
+    return 2;
+  case DEVT_SHORT:
+  case DEVT_INT:
+  case DEVT_LONG:
+    return 1 + integral_value_bytes(value->value(), /* is_signed */ true);
+  case DEVT_CHAR:
+    return 1 + integral_value_bytes(value->value(), /* is_signed */ false);
+  case DEVT_FLOAT:
+    return 1 + floating_value_bytes(value->value(), 4);
+  case DEVT_DOUBLE:
+    return 1 + floating_value_bytes(value->value(), 8);
+  case DEVT_METHOD_TYPE:
+  case DEVT_METHOD_HANDLE:
+  case DEVT_STRING:
+  case DEVT_TYPE:
+  case DEVT_FIELD:
+  case DEVT_METHOD:
+  case DEVT_ENUM:
+    return 1 + kAverageIndexBytes;
+  case DEVT_ARRAY: {
+    auto* values = static_cast<const DexEncodedValueArray*>(value)->evalues();
+    size_t bytes = 1 + uleb128_encoding_size(values->size());
+    for (const auto& element : *values) {
+      bytes += encoded_value_bytes(element.get());
+    }
+    return bytes;
+  }
+  case DEVT_ANNOTATION:
+    return 1 + encoded_annotation_bytes(
+                   static_cast<const DexEncodedValueAnnotation*>(value)
+                       ->annotations());
+  }
+  not_reached_log("Unexpected encoded value type %d", value->evtype());
+}
+
+size_t encoded_annotation_bytes(const EncodedAnnotations& elements) {
+  size_t bytes = kAverageIndexBytes + uleb128_encoding_size(elements.size());
+  for (const auto& element : elements) {
+    bytes +=
+        kAverageIndexBytes + encoded_value_bytes(element.encoded_value.get());
+  }
+  return bytes;
+}
+
+// Bytes of an annotation_set_item and the annotation_items it refers to.
+size_t annotation_set_bytes(const DexAnnotationSet* anno_set) {
+  size_t bytes = 4 + 4 * anno_set->get_annotations().size();
+  for (const auto& anno : anno_set->get_annotations()) {
+    // One byte for the visibility.
+    bytes += 1 + encoded_annotation_bytes(anno->anno_elems());
+  }
+  return bytes;
+}
+
+size_t static_values_bytes(const DexClass* cls) {
+  // The encoded array holds the values of all static fields up to the last
+  // one with a non-default value.
+  const auto& sfields = cls->get_sfields();
+  size_t count = 0;
+  for (size_t i = 0; i < sfields.size(); ++i) {
+    auto* value = sfields[i]->get_static_value();
+    if (value != nullptr && !value->is_zero()) {
+      count = i + 1;
+    }
+  }
+  if (count == 0) {
+    return 0;
+  }
+  size_t bytes = uleb128_encoding_size(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto* value = sfields[i]->get_static_value();
+    bytes += value != nullptr ? encoded_value_bytes(value) : 2;
+  }
+  return bytes;
+}
+
+struct CodeShape {
+  size_t code_units{0};
+  size_t tries{0};
+  size_t handlers_bytes{0};
+  size_t positions{0};
+};
+
+CodeShape get_code_shape(const IRCode* code) {
+  CodeShape shape;
+  shape.code_units = code->estimate_code_units();
+  // The encoded catch handler lists, by their catch types.
+  std::set<std::vector<DexType*>> handlers;
+  if (code->editable_cfg_built()) {
+    const auto& cfg = code->cfg();
+    for (auto* block : cfg.blocks()) {
+      for (const auto& mie : *block) {
+        if (mie.type == MFLOW_POSITION) {
+          shape.positions++;
+        }
+      }
+      auto throws = cfg.get_succ_edges_of_type(block, cfg::EDGE_THROW);
+      if (throws.empty()) {
+        continue;
+      }
+      shape.tries++;
+      std::vector<DexType*> catch_types;
+      catch_types.reserve(throws.size());
+      for (auto* edge : throws) {
+        catch_types.push_back(edge->throw_info()->catch_type);
+      }
+      handlers.insert(std::move(catch_types));
+    }
+  } else {
+    for (const auto& mie : *code) {
+      if (mie.type == MFLOW_POSITION) {
+        shape.positions++;
+      } else if (mie.type == MFLOW_TRY && mie.tentry->type == TRY_START) {
+        shape.tries++;
+        std::vector<DexType*> catch_types;
+        for (auto* catch_mie = mie.tentry->catch_start; catch_mie != nullptr;
+             catch_mie = catch_mie->centry->next) {
+          catch_types.push_back(catch_mie->centry->catch_type);
+        }
+        handlers.insert(std::move(catch_types));
+      }
+    }
+  }
+  if (!handlers.empty()) {
+    shape.handlers_bytes = uleb128_encoding_size(handlers.size());
+    for (const auto& catch_types : handlers) {
+      // The handler size, and a type index and an address for each catch; a
+      // catch-all only has an address.
+      shape.handlers_bytes +=
+          1 + catch_types.size() * (kAverageIndexBytes + 2);
+    }
+  }
+  return shape;
+}
+
+size_t code_item_bytes(size_t code_units, size_t tries, size_t handlers_bytes) {
+  size_t bytes = kCodeItemHeaderBytes + 2 * code_units;
+  if (tries > 0) {
+    bytes = align4(bytes) + tries * kTryItemBytes + handlers_bytes;
+  }
+  return align4(bytes);
+}
+
+// Bytes of the debug_info_item of a method with the given number of positions.
+size_t debug_info_bytes(const DexMethod* method, size_t positions) {
+  if (positions == 0) {
+    return 0;
+  }
+  // The starting line, the parameter count and a name index for each
+  // parameter, then mostly one special opcode per position, and the end.
+  return 2 + uleb128_encoding_size(method->get_proto()->get_args()->size()) +
+         method->get_proto()->get_args()->size() + (positions * 3 + 1) / 2 + 1;
+}
+
+} // namespace
+
+size_t DexSizeBreakdown::compressed() const {
+  return static_cast<size_t>(
+      kIdsCompression * (header + ids) + kStringDataCompression * string_data +
+      kCodeCompression * code +
+      kOtherCompression *
+          (type_lists + classes + debug_info + annotations + static_values));
+}
+
+DexSizeBreakdown& DexSizeBreakdown::operator+=(const DexSizeBreakdown& that) {
+  header += that.header;
+  ids += that.ids;
+  string_data += that.string_data;
+  type_lists += that.type_lists;
+  classes += that.classes;
+  code += that.code;
+  debug_info += that.debug_info;
+  annotations += that.annotations;
+  static_values += that.static_values;
+  return *this;
+}
+
+DexSizeBreakdown& DexSizeBreakdown::operator-=(const DexSizeBreakdown& that) {
+  header -= that.header;
+  ids -= that.ids;
+  string_data -= that.string_data;
+  type_lists -= that.type_lists;
+  classes -= that.classes;
+  code -= that.code;
+  debug_info -= that.debug_info;
+  annotations -= that.annotations;
+  static_values -= that.static_values;
+  return *this;
+}
+
+const DexSizeEstimator::ClassFootprint& DexSizeEstimator::get_footprint(
+    const DexClass* cls) const {
+  auto& footprint = m_footprints[cls];
+  if (footprint) {
+    return *footprint;
+  }
+  footprint = std::make_unique<ClassFootprint>();
+  auto& own = footprint->own;
+
+  // Gather the shared items just like gather_components does for a whole dex.
+  cls->gather_strings(footprint->strings);
+  cls->gather_types(footprint->types);
+  cls->gather_fields(footprint->fields);
+  cls->gather_methods(footprint->methods);
+  sort_unique(footprint->fields);
+  sort_unique(footprint->methods);
+  for (auto* method : footprint->methods) {
+    method->gather_types_shallow(footprint->types);
+    method->gather_strings_shallow(footprint->strings);
+    footprint->protos.push_back(method->get_proto());
+  }
+  for (auto* field : footprint->fields) {
+    field->gather_types_shallow(footprint->types);
+    field->gather_strings_shallow(footprint->strings);
+  }
+  sort_unique(footprint->types);
+  for (auto* type : footprint->types) {
+    footprint->strings.push_back(type->get_name());
+  }
+  sort_unique(footprint->strings);
+  sort_unique(footprint->protos);
+  for (auto* proto : footprint->protos) {
+    if (!proto->get_args()->empty()) {
+      footprint->type_lists.push_back(proto->get_args());
+    }
+  }
+  if (cls->get_interfaces() && !cls->get_interfaces()->empty()) {
+    footprint->type_lists.push_back(cls->get_interfaces());
+  }
+  sort_unique(footprint->type_lists);
+
+  // The class_def, and the class_data with an entry for each member.
+  own.classes = kClassDefBytes;
+  const auto& sfields = cls->get_sfields();
+  const auto& ifields = cls->get_ifields();
+  const auto& dmethods = cls->get_dmethods();
+  const auto& vmethods = cls->get_vmethods();
+  if (!sfields.empty() || !ifields.empty() || !dmethods.empty() ||
+      !vmethods.empty()) {
+    own.classes += uleb128_encoding_size(sfields.size()) +
+                   uleb128_encoding_size(ifields.size()) +
+                   uleb128_encoding_size(dmethods.size()) +
+                   uleb128_encoding_size(vmethods.size());
+  }
+
+  size_t annotated_members = 0;
+  auto add_field = [&](const DexField* field) {
+    own.classes += kAverageMemberIndexDiffBytes +
+                   uleb128_encoding_size(field->get_access());
+    if (field->get_anno_set() && field->get_anno_set()->size() > 0) {
+      annotated_members++;
+      own.annotations += annotation_set_bytes(field->get_anno_set());
+    }
+  };
+  for (auto* field : sfields) {
+    add_field(field);
+  }
+  for (auto* field : ifields) {
+    add_field(field);
+  }
+
+  auto add_method = [&](const DexMethod* method) {
+    own.classes += kAverageMemberIndexDiffBytes +
+                   uleb128_encoding_size(method->get_access());
+    if (method->get_code()) {
+      auto shape = get_code_shape(method->get_code());
+      own.classes += kAverageOffsetBytes;
+      own.code +=
+          code_item_bytes(shape.code_units, shape.tries, shape.handlers_bytes);
+      own.debug_info += debug_info_bytes(method, shape.positions);
+    } else if (method->get_dex_code()) {
+      auto* dex_code = method->get_dex_code();
+      own.classes += kAverageOffsetBytes;
+      // Assume a handler list with a single catch per try item.
+      auto tries = dex_code->get_tries().size();
+      own.code += code_item_bytes(dex_code->size(), tries,
+                                  tries * (2 + kAverageIndexBytes + 2));
+      if (dex_code->get_debug_item()) {
+        own.debug_info += dex_code->get_debug_item()->get_on_disk_size();
+      }
+    } else {
+      own.classes += 1;
+    }
+    if (method->get_anno_set() && method->get_anno_set()->size() > 0) {
+      annotated_members++;
+      own.annotations += annotation_set_bytes(method->get_anno_set());
+    }
+    if (method->get_param_anno() && !method->get_param_anno()->empty()) {
+      annotated_members++;
+      // An annotation_set_ref_list with an entry for each parameter.
+      own.annotations += 4 + 4 * method->get_proto()->get_args()->size();
+      for (const auto& [_, anno_set] : *method->get_param_anno()) {
+        own.annotations += annotation_set_bytes(anno_set.get());
+      }
+    }
+  };
+  for (auto* method : dmethods) {
+    add_method(method);
+  }
+  for (auto* method : vmethods) {
+    add_method(method);
+  }
+
+  bool class_annotated = cls->get_anno_set() && cls->get_anno_set()->size() > 0;
+  if (class_annotated) {
+    own.annotations += annotation_set_bytes(cls->get_anno_set());
+  }
+  if (class_annotated || annotated_members > 0) {
+    own.annotations += kAnnotationsDirectoryHeaderBytes +
+                       annotated_members * kAnnotationsDirectoryEntryBytes;
+  }
+
+  own.static_values = static_values_bytes(cls);
+  return *footprint;
+}
+
+DexSizeBreakdown DexSizeEstimator::get_new_shared_bytes(
+    const ClassFootprint& footprint) const {
+  DexSizeBreakdown bytes;
+  for (auto* string : footprint.strings) {
+    if (!m_strings.count(string)) {
+      bytes.ids += kStringIdBytes;
+      bytes.string_data += string->get_entry_size();
+    }
+  }
+  for (auto* type : footprint.types) {
+    if (!m_types.count(type)) {
+      bytes.ids += kTypeIdBytes;
+    }
+  }
+  for (auto* proto : footprint.protos) {
+    if (!m_protos.count(proto)) {
+      bytes.ids += kProtoIdBytes;
+    }
+  }
+  for (auto* type_list : footprint.type_lists) {
+    if (!m_type_lists.count(type_list)) {
+      bytes.type_lists += type_list_bytes(type_list);
+    }
+  }
+  for (auto* field : footprint.fields) {
+    if (!m_fields.count(field)) {
+      bytes.ids += kFieldIdBytes;
+    }
+  }
+  for (auto* method : footprint.methods) {
+    if (!m_methods.count(method)) {
+      bytes.ids += kMethodIdBytes;
+    }
+  }
+  return bytes;
+}
+
+size_t DexSizeEstimator::get_added_bytes(const DexClass* cls) const {
+  const auto& footprint = get_footprint(cls);
+  auto bytes = get_new_shared_bytes(footprint);
+  bytes += footprint.own;
+  if (m_num_classes == 0) {
+    bytes.header = kHeaderBytes + kMapListBytes;
+  }
+  return bytes.total();
+}
+
+size_t DexSizeEstimator::add_class(const DexClass* cls) {
+  auto size_before = get_size();
+  const auto& footprint = get_footprint(cls);
+  m_breakdown += get_new_shared_bytes(footprint);
+  m_breakdown += footprint.own;
+  for (auto* string : footprint.strings) {
+    m_strings[string]++;
+  }
+  for (auto* type : footprint.types) {
+    m_types[type]++;
+  }
+  for (auto* proto : footprint.protos) {
+    m_protos[proto]++;
+  }
+  for (auto* type_list : footprint.type_lists) {
+    m_type_lists[type_list]++;
+  }
+  for (auto* field : footprint.fields) {
+    m_fields[field]++;
+  }
+  for (auto* method : footprint.methods) {
+    m_methods[method]++;
+  }
+  if (m_num_classes++ == 0) {
+    m_breakdown.header = kHeaderBytes + kMapListBytes;
+  }
+  return get_size() - size_before;
+}
+
+void DexSizeEstimator::remove_class(const DexClass* cls) {
+  always_assert_log(m_num_classes > 0, "No classes to remove: %s", SHOW(cls));
+  const auto& footprint = get_footprint(cls);
+  m_breakdown -= footprint.own;
+  auto release = [](auto& counts, auto* item) {
+    auto it = counts.find(item);
+    always_assert(it != counts.end());
+    if (--it->second > 0) {
+      return false;
+    }
+    counts.erase(it);
+    return true;
+  };
+  for (auto* string : footprint.strings) {
+    if (release(m_strings, string)) {
+      m_breakdown.ids -= kStringIdBytes;
+      m_breakdown.string_data -= string->get_entry_size();
+    }
+  }
+  for (auto* type : footprint.types) {
+    if (release(m_types, type)) {
+      m_breakdown.ids -= kTypeIdBytes;
+    }
+  }
+  for (auto* proto : footprint.protos) {
+    if (release(m_protos, proto)) {
+      m_breakdown.ids -= kProtoIdBytes;
+    }
+  }
+  for (auto* type_list : footprint.type_lists) {
+    if (release(m_type_lists, type_list)) {
+      m_breakdown.type_lists -= type_list_bytes(type_list);
+    }
+  }
+  for (auto* field : footprint.fields) {
+    if (release(m_fields, field)) {
+      m_breakdown.ids -= kFieldIdBytes;
+    }
+  }
+  for (auto* method : footprint.methods) {
+    if (release(m_methods, method)) {
+      m_breakdown.ids -= kMethodIdBytes;
+    }
+  }
+  if (--m_num_classes == 0) {
+    m_breakdown.header = 0;
+  }
+}
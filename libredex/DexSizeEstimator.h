@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "DexClass.h"
+
+/*
+ * Sizes in bytes of the sections of a dex file, as laid out by DexOutput.
+ */
+struct DexSizeBreakdown {
+  // Header and map list.
+  size_t header{0};
+  // string_ids, type_ids, proto_ids, field_ids and method_ids.
+  size_t ids{0};
+  size_t string_data{0};
+  size_t type_lists{0};
+  // class_defs and class_data.
+  size_t classes{0};
+  size_t code{0};
+  size_t debug_info{0};
+  size_t annotations{0};
+  size_t static_values{0};
+
+  size_t total() const {
+    return header + ids + string_data + type_lists + classes + code +
+           debug_info + annotations + static_values;
+  }
+
+  // A rough estimate of the size of the section data after zip compression,
+  // based on typical per-section compression ratios.
+  size_t compressed() const;
+
+  DexSizeBreakdown& operator+=(const DexSizeBreakdown& that);
+  DexSizeBreakdown& operator-=(const DexSizeBreakdown& that);
+};
+
+/*
+ * An incremental model of the size of a dex file, for decisions that would
+ * otherwise need to emit a dex to learn its size. It tracks the classes added
+ * to one dex, and the strings, types, protos, type lists and field and method
+ * refs they share, so that the cost of adding a class can be queried without
+ * adding it.
+ *
+ * The estimate works on classes in IR form. Instruction sizes come from
+ * IRCode::estimate_code_units(), and index and offset encodings are averaged,
+ * so the estimate is approximate. The only evidence for its accuracy is
+ * DexSizeEstimatorTest, which checks that it is within 10% of the size of the
+ * dex that DexOutput writes for one synthetic dex of 50 small classes; it has
+ * not been measured against real apps. Call sites and method handles are not
+ * accounted for.
+ *
+ * The footprint of each class is computed once, when it is first queried, and
+ * is not updated if the class changes afterwards. Since even the const queries
+ * cache footprints, an estimator must not be used by several threads at once.
+ */
+class DexSizeEstimator {
+ public:
+  // The number of bytes that adding `cls` would add to the dex. Not safe to
+  // call concurrently, see above.
+  size_t get_added_bytes(const DexClass* cls) const;
+
+  // Adds `cls` to the dex. Returns the number of bytes added.
+  size_t add_class(const DexClass* cls);
+
+  // Removes a class previously added.
+  void remove_class(const DexClass* cls);
+
+  size_t get_num_classes() const { return m_num_classes; }
+
+  const DexSizeBreakdown& get_breakdown() const { return m_breakdown; }
+
+  // Estimated size of the dex file, in bytes.
+  size_t get_size() const { return m_breakdown.total(); }
+
+  // Estimated size of the dex file in a compressed archive, in bytes.
+  size_t get_compressed_size() const { return m_breakdown.compressed(); }
+
+ private:
+  struct ClassFootprint {
+    // The bytes of the items owned by the class.
+    DexSizeBreakdown own;
+    // The items shared with other classes of the same dex.
+    std::vector<const DexString*> strings;
+    std::vector<DexType*> types;
+    std::vector<DexProto*> protos;
+    std::vector<DexTypeList*> type_lists;
+    std::vector<DexFieldRef*> fields;
+    std::vector<DexMethodRef*> methods;
+  };
+
+  const ClassFootprint& get_footprint(const DexClass* cls) const;
+
+  // The bytes of the shared items of `footprint` not in the dex yet.
+  DexSizeBreakdown get_new_shared_bytes(const ClassFootprint& footprint) const;
+
+  // Filled in lazily by get_footprint(), without synchronization.
+  mutable std::unordered_map<const DexClass*, std::unique_ptr<ClassFootprint>>
+      m_footprints;
+
+  std::unordered_map<const DexString*, size_t> m_strings;
+  std::unordered_map<DexType*, size_t> m_types;
+  std::unordered_map<DexProto*, size_t> m_protos;
+  std::unordered_map<DexTypeList*, size_t> m_type_lists;
+  std::unordered_map<DexFieldRef*, size_t> m_fields;
+  std::unordered_map<DexMethodRef*, size_t> m_methods;
+
+  size_t m_num_classes{0};
+  DexSizeBreakdown m_breakdown;
+};
@@ -109,6 +109,7 @@ void PassManagerConfig::bind_config() {
   bind("check_pass_order_properties", check_pass_order_properties,
        check_pass_order_properties);
   bind("check_properties_deep", check_properties_deep, check_properties_deep);
+  bind("fuse_method_passes", fuse_method_passes, fuse_method_passes);
 }
 
 void ResourceConfig::bind_config() {
@@ -163,6 +164,7 @@ void GlobalConfig::bind_config() {
   bind("keep_all_annotation_classes", true, bool_param);
   bind("keep_methods", {}, string_vector_param);
   bind("keep_packages", {}, string_vector_param);
+  bind("lazy_balloon", false, bool_param);
   bind("legacy_reflection_reachability", false, bool_param);
   bind("lower_with_cfg", {}, bool_param);
   bind("no_optimizations_annotations", {}, string_vector_param);
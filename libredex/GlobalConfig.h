@@ -158,6 +158,8 @@ struct PassManagerConfig : public Configurable {
   bool violations_tracking{false};
   bool check_pass_order_properties{false};
   bool check_properties_deep{false};
+  // Run adjacent MethodPasses in one traversal, see MethodPass.h.
+  bool fuse_method_passes{false};
 };
 
 struct ResourceConfig : public Configurable {
@@ -105,6 +105,9 @@ class Classes {
 
   void write() const;
 
+  // Whether no class is, or will be once it exists, dumped.
+  bool empty() const { return m_class_cfgs.empty() && m_not_found.empty(); }
+
  private:
   std::vector<visualizer::ClassCFGStream> m_class_cfgs;
   std::vector<std::string> m_not_found;
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HierarchyCache.h"
+
+#include <chrono>
+
+#include "MethodOverrideGraph.h"
+#include "WorkQueue.h"
+
+bool HierarchyCache::ClassState::operator==(const ClassState& other) const {
+  return cls == other.cls && type == other.type &&
+         super_class == other.super_class && interfaces == other.interfaces &&
+         access == other.access && num_vmethods == other.num_vmethods &&
+         num_dmethods == other.num_dmethods;
+}
+
+bool HierarchyCache::MethodState::operator==(const MethodState& other) const {
+  return method == other.method && cls == other.cls && name == other.name &&
+         proto == other.proto && access == other.access &&
+         is_virtual == other.is_virtual;
+}
+
+HierarchyCache::Snapshot HierarchyCache::take_snapshot(const Scope& scope,
+                                                       bool with_methods) {
+  Snapshot snapshot;
+  snapshot.classes.resize(scope.size());
+  // Where the methods of each class start in the snapshot.
+  std::vector<size_t> method_offsets;
+  if (with_methods) {
+    method_offsets.reserve(scope.size());
+    size_t num_methods = 0;
+    for (auto* cls : scope) {
+      method_offsets.push_back(num_methods);
+      num_methods += cls->get_vmethods().size() + cls->get_dmethods().size();
+    }
+    snapshot.methods.resize(num_methods);
+  }
+  workqueue_run_for<size_t>(0, scope.size(), [&](size_t i) {
+    const DexClass* cls = scope[i];
+    auto& class_state = snapshot.classes[i];
+    class_state = {cls,
+                   cls->get_type(),
+                   cls->get_super_class(),
+                   cls->get_interfaces(),
+                   static_cast<uint32_t>(cls->get_access()),
+                   0,
+                   0};
+    if (!with_methods) {
+      return;
+    }
+    class_state.num_vmethods = cls->get_vmethods().size();
+    class_state.num_dmethods = cls->get_dmethods().size();
+    auto* method_state = &snapshot.methods[method_offsets[i]];
+    for (const auto* methods : {&cls->get_vmethods(), &cls->get_dmethods()}) {
+      for (const DexMethod* method : *methods) {
+        *method_state++ = {method,
+                           method->get_class(),
+                           method->get_name(),
+                           method->get_proto(),
+                           static_cast<uint32_t>(method->get_access()),
+                           method->is_virtual()};
+      }
+    }
+  });
+  return snapshot;
+}
+
+std::shared_ptr<const method_override_graph::Graph>
+HierarchyCache::get_method_override_graph(const Scope& scope) {
+  auto snapshot = take_snapshot(scope, /* with_methods */ true);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_method_override_graph;
+  if (entry.value && entry.snapshot == snapshot) {
+    m_stats.hits++;
+    return entry.value;
+  }
+  m_stats.misses++;
+  auto start = std::chrono::steady_clock::now();
+  entry.value = method_override_graph::build_graph(scope);
+  entry.snapshot = std::move(snapshot);
+  m_stats.build_seconds += std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+  return entry.value;
+}
+
+std::shared_ptr<const ClassHierarchy> HierarchyCache::get_class_hierarchy(
+    const Scope& scope) {
+  auto snapshot = take_snapshot(scope, /* with_methods */ false);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto& entry = m_class_hierarchy;
+  if (entry.value && entry.snapshot == snapshot) {
+    m_stats.hits++;
+    return entry.value;
+  }
+  m_stats.misses++;
+  auto start = std::chrono::steady_clock::now();
+  entry.value = std::make_shared<const ClassHierarchy>(
+      build_type_hierarchy(scope));
+  entry.snapshot = std::move(snapshot);
+  m_stats.build_seconds += std::chrono::duration<double>(
+                               std::chrono::steady_clock::now() - start)
+                               .count();
+  return entry.value;
+}
+
+HierarchyCache::Stats HierarchyCache::get_stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
+
+void HierarchyCache::clear() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_method_override_graph = {};
+  m_class_hierarchy = {};
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ClassHierarchy.h"
+#include "DexClass.h"
+
+namespace method_override_graph {
+class Graph;
+} // namespace method_override_graph
+
+/*
+ * Caches the class hierarchy and the method override graph across passes. It
+ * is owned by the RedexContext, see `g_redex->get_hierarchy_cache()`.
+ *
+ * Each entry keeps a snapshot of the hierarchy-relevant state of the scope it
+ * was built for: the classes with their super classes, interfaces and access
+ * flags, and (for the override graph) the class, name, proto, access flags and
+ * virtuality of their methods. A lookup takes a new snapshot in parallel,
+ * which is much cheaper than a rebuild, compares it exactly to the stored one
+ * and only rebuilds on a difference. Passes that add, remove, rename or
+ * re-parent classes or methods thus invalidate the cache without having to
+ * report their changes. An object allocated at the address of a deleted one
+ * only matches if it is equivalent for the purpose of the cached result.
+ *
+ * The PassManager clears the cache once all passes have run. Results are
+ * shared and must not be mutated.
+ */
+class HierarchyCache {
+ public:
+  struct Stats {
+    size_t hits{0};
+    size_t misses{0};
+    // Accumulated time spent building results on a miss.
+    double build_seconds{0};
+  };
+
+  std::shared_ptr<const method_override_graph::Graph> get_method_override_graph(
+      const Scope& scope);
+
+  std::shared_ptr<const ClassHierarchy> get_class_hierarchy(
+      const Scope& scope);
+
+  Stats get_stats() const;
+
+  void clear();
+
+ private:
+  struct ClassState {
+    const DexClass* cls;
+    const DexType* type;
+    const DexType* super_class;
+    const DexTypeList* interfaces;
+    uint32_t access;
+    // Only for the override graph.
+    uint32_t num_vmethods;
+    uint32_t num_dmethods;
+
+    bool operator==(const ClassState& other) const;
+  };
+
+  struct MethodState {
+    const DexMethod* method;
+    const DexType* cls;
+    const DexString* name;
+    const DexProto* proto;
+    uint32_t access;
+    bool is_virtual;
+
+    bool operator==(const MethodState& other) const;
+  };
+
+  struct Snapshot {
+    std::vector<ClassState> classes;
+    std::vector<MethodState> methods;
+
+    bool operator==(const Snapshot& other) const {
+      return classes == other.classes && methods == other.methods;
+    }
+  };
+
+  static Snapshot take_snapshot(const Scope& scope, bool with_methods);
+
+  template <typename T>
+  struct Entry {
+    Snapshot snapshot;
+    std::shared_ptr<const T> value;
+  };
+
+  mutable std::mutex m_mutex;
+  Entry<method_override_graph::Graph> m_method_override_graph;
+  Entry<ClassHierarchy> m_class_hierarchy;
+  Stats m_stats;
+};
@@ -435,8 +435,7 @@ void translate_dex_to_ir(
   }
 }
 
-void balloon(DexMethod* method, IRList* ir_list) {
-  auto dex_code = method->get_dex_code();
+void balloon(DexCode* dex_code, IRList* ir_list) {
   auto instructions = dex_code->release_instructions();
   // This is a 1-to-1 map between MethodItemEntries of type MFLOW_OPCODE and
   // address offsets.
@@ -600,11 +599,13 @@ IRCode::~IRCode() {
   delete m_ir_list;
 }
 
-IRCode::IRCode(DexMethod* method) : m_ir_list(new IRList()) {
-  auto* dc = method->get_dex_code();
+IRCode::IRCode(DexMethod* method) : IRCode(method, method->get_dex_code()) {}
+
+IRCode::IRCode(const DexMethod* method, DexCode* dc)
+    : m_ir_list(new IRList()) {
   generate_load_params(method, dc->get_registers_size() - dc->get_ins_size(),
                        this);
-  balloon(const_cast<DexMethod*>(method), m_ir_list);
+  balloon(dc, m_ir_list);
   m_dbg = dc->release_debug_item();
 }
 
@@ -84,6 +84,10 @@ class IRCode {
 
   explicit IRCode(DexMethod*);
 
+  // Lifts `dex_code`, the DexCode of `method`, taking its instructions and
+  // debug info.
+  IRCode(const DexMethod* method, DexCode* dex_code);
+
   explicit IRCode(std::unique_ptr<cfg::ControlFlowGraph>);
 
   /*
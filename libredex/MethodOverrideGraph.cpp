@@ -13,6 +13,8 @@
 #include <sparta/PatriciaTreeSet.h>
 
 #include "BinarySerialization.h"
+#include "HierarchyCache.h"
+#include "RedexContext.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Walkers.h"
@@ -358,6 +360,10 @@ std::unique_ptr<const Graph> build_graph(const Scope& scope) {
   return GraphBuilder(scope).run();
 }
 
+std::shared_ptr<const Graph> get_or_build_graph(const Scope& scope) {
+  return g_redex->get_hierarchy_cache()->get_method_override_graph(scope);
+}
+
 std::vector<const DexMethod*> get_overriding_methods(const Graph& graph,
                                                      const DexMethod* method,
                                                      bool include_interfaces,
@@ -25,6 +25,13 @@ class Graph;
  */
 std::unique_ptr<const Graph> build_graph(const Scope&);
 
+/*
+ * Returns a graph for the scope that is shared with other users through the
+ * RedexContext's HierarchyCache. It is only rebuilt when classes or methods
+ * have been added, removed, renamed or re-parented since the last request.
+ */
+std::shared_ptr<const Graph> get_or_build_graph(const Scope&);
+
 /*
  * Returns all the methods that override :method. The set does *not* include
  * :method itself.
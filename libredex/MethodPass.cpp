@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "MethodPass.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "ScopedCFG.h"
+#include "Show.h"
+#include "Trace.h"
+#include "WorkQueue.h"
+
+void MethodPass::run_pass(DexStoresVector& stores,
+                          ConfigFiles& conf,
+                          PassManager& mgr) {
+  prepare(stores, conf, mgr);
+  run_on_methods({this}, build_class_scope(stores));
+  finish(mgr);
+}
+
+void MethodPass::run_on_methods(const std::vector<MethodPass*>& passes,
+                                const Scope& scope,
+                                std::vector<double>* visit_seconds) {
+  const size_t num_threads = redex_parallel::default_num_threads();
+  for (auto* pass : passes) {
+    pass->begin_methods(num_threads);
+  }
+  std::vector<CacheAligned<std::vector<double>>> worker_seconds;
+  if (visit_seconds != nullptr) {
+    worker_seconds = std::vector<CacheAligned<std::vector<double>>>(
+        num_threads, std::vector<double>(passes.size()));
+  }
+  auto visit = [&](size_t worker_id, DexMethod* method) {
+    auto* code = method->get_code();
+    if (code == nullptr ||
+        std::none_of(passes.begin(), passes.end(), [method](auto* pass) {
+          return pass->should_visit(method);
+        })) {
+      return;
+    }
+    TraceContext context(method);
+    // Leaves the CFG in place if there already was one, as for passes that
+    // are not cfg-legacy, and clears it otherwise.
+    cfg::ScopedCFG cfg(code);
+    for (size_t i = 0; i < passes.size(); ++i) {
+      if (!passes[i]->should_visit(method)) {
+        continue;
+      }
+      if (visit_seconds == nullptr) {
+        passes[i]->visit_method(worker_id, method, *cfg);
+        continue;
+      }
+      std::vector<double>& seconds = worker_seconds[worker_id];
+      auto start = std::chrono::steady_clock::now();
+      passes[i]->visit_method(worker_id, method, *cfg);
+      seconds[i] += std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    }
+  };
+  workqueue_run<DexClass*>(
+      [&](sparta::WorkerState<DexClass*>* state, DexClass* cls) {
+        for (auto* dmethod : cls->get_dmethods()) {
+          visit(state->worker_id(), dmethod);
+        }
+        for (auto* vmethod : cls->get_vmethods()) {
+          visit(state->worker_id(), vmethod);
+        }
+      },
+      scope, num_threads);
+  if (visit_seconds != nullptr) {
+    visit_seconds->assign(passes.size(), 0);
+    for (std::vector<double>& seconds : worker_seconds) {
+      for (size_t i = 0; i < passes.size(); ++i) {
+        (*visit_seconds)[i] += seconds[i];
+      }
+    }
+  }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "Pass.h"
+#include "Walkers.h"
+
+namespace cfg {
+class ControlFlowGraph;
+} // namespace cfg
+
+/**
+ * A transformation that, apart from whole-program setup and the reporting of
+ * metrics, looks at one method at a time.
+ *
+ * Run on its own, a MethodPass prepares, visits every method with code in
+ * parallel and finishes. When `fuse_method_passes` is set in the pass manager
+ * config, PassManager instead runs each maximal sequence of adjacent fusible
+ * method passes in a single traversal: all passes prepare, then for each
+ * method the editable CFG is built once and every pass visits it in order, and
+ * then each pass finishes. Methods that no pass should_visit() keep their
+ * code as it is, without a CFG being built. A group also ends after any pass
+ * whose output is inspected, e.g. by the IR type checker's
+ * run_after_each_pass, which is on by default, and a profiled pass runs on its
+ * own. The time of the traversal is
+ * split between the passes of a group by how long each spent visiting
+ * methods. Since the preparation of a fused pass happens before the passes
+ * preceding it have transformed any code, it must only compute facts that
+ * those transformations preserve. Metrics are reported by finish(), while the
+ * pass is the current one, and so stay attributed to it.
+ *
+ * Most implementations derive from MethodPassWithStats below.
+ */
+class MethodPass : public Pass {
+ public:
+  explicit MethodPass(const std::string& name) : Pass(name) {}
+
+  // Whether this pass can share a traversal with its neighbours.
+  virtual bool is_fusible() const { return true; }
+
+  // Whole-program setup, e.g. computing analyses the methods are visited with.
+  virtual void prepare(DexStoresVector& /* stores */,
+                       ConfigFiles& /* conf */,
+                       PassManager& /* mgr */) {}
+
+  // Whether to visit `method`. Checked before its CFG is built, so a method
+  // that no pass of a traversal visits is left untouched.
+  virtual bool should_visit(const DexMethod* /* method */) const {
+    return true;
+  }
+
+  // Sets up per-worker state for a traversal with `num_threads` workers.
+  virtual void begin_methods(size_t num_threads) = 0;
+
+  // Called concurrently, at most once per worker at a time.
+  virtual void visit_method(size_t worker_id,
+                            DexMethod* method,
+                            cfg::ControlFlowGraph& cfg) = 0;
+
+  // Reports metrics and releases whatever prepare() computed.
+  virtual void finish(PassManager& mgr) = 0;
+
+  void run_pass(DexStoresVector& stores,
+                ConfigFiles& conf,
+                PassManager& mgr) override;
+
+  // Visits every method with code in `scope` with all of `passes`, in order,
+  // building each editable CFG at most once. If `visit_seconds` is given, it
+  // receives the time spent in the visits of each pass, summed over workers.
+  static void run_on_methods(const std::vector<MethodPass*>& passes,
+                             const Scope& scope,
+                             std::vector<double>* visit_seconds = nullptr);
+};
+
+/**
+ * A MethodPass whose visits each return a `Stats` value; those are summed up
+ * per worker, like walk::parallel::methods does, and handed to report().
+ */
+template <typename Stats>
+class MethodPassWithStats : public MethodPass {
+ public:
+  explicit MethodPassWithStats(const std::string& name) : MethodPass(name) {}
+
+  virtual Stats process_method(DexMethod* method,
+                               cfg::ControlFlowGraph& cfg) = 0;
+
+  // Reports the summed up stats. This is also where to release whatever
+  // prepare() computed.
+  virtual void report(const Stats& stats, PassManager& mgr) = 0;
+
+  void begin_methods(size_t num_threads) override {
+    m_stats = std::vector<CacheAligned<Stats>>(num_threads, Stats());
+  }
+
+  void visit_method(size_t worker_id,
+                    DexMethod* method,
+                    cfg::ControlFlowGraph& cfg) override {
+    static_cast<Stats&>(m_stats[worker_id]) += process_method(method, cfg);
+  }
+
+  void finish(PassManager& mgr) override {
+    Stats stats{};
+    for (Stats& worker_stats : m_stats) {
+      stats += worker_stats;
+    }
+    m_stats.clear();
+    report(stats, mgr);
+  }
+
+ private:
+  std::vector<CacheAligned<Stats>> m_stats;
+};
@@ -39,6 +39,12 @@ class Pass : public Configurable {
   // \returns True means this pass is NOT guaranteed to fully use editable cfg.
   virtual bool is_cfg_legacy() { return false; }
 
+  // \returns True if this pass records every method whose references it
+  // changes in the ReferenceJournal, and invalidates the purity summaries of
+  // every method whose code it changes, or all of them if it removes classes
+  // or members.
+  virtual bool records_reference_changes() const { return false; }
+
   virtual void destroy_analysis_result() {
     always_assert_log(m_kind != ANALYSIS,
                       "destroy_analysis_result not implemented for %s",
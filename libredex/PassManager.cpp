@@ -14,6 +14,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <json/json.h>
 #include <limits>
@@ -44,10 +45,12 @@
 #include "DexUtil.h"
 #include "GlobalConfig.h"
 #include "GraphVisualizer.h"
+#include "HierarchyCache.h"
 #include "IRCode.h"
 #include "IRTypeChecker.h"
 #include "InstructionLowering.h"
 #include "JemallocUtil.h"
+#include "MethodPass.h"
 #include "MethodProfiles.h"
 #include "Native.h"
 #include "OptData.h"
@@ -56,8 +59,11 @@
 #include "ProguardPrintConfiguration.h"
 #include "ProguardReporting.h"
 #include "Purity.h"
+#include "PuritySummaryStore.h"
 #include "ReachableClasses.h"
 #include "RedexPropertiesManager.h"
+#include "ReferenceJournal.h"
+#include "ResolverCache.h"
 #include "Sanitizers.h"
 #include "ScopedCFG.h"
 #include "ScopedMemStats.h"
@@ -383,6 +389,8 @@ class VisualizerHelper {
         VISUALIZER_PASS_OPTIONS);
   }
 
+  bool enabled() const { return !m_class_cfgs.empty(); }
+
   void finalize() {
     m_class_cfgs.add_pass("After all passes");
     m_class_cfgs.write();
@@ -525,6 +533,19 @@ void process_secondary_method_profiles(PassManager& mgr, ConfigFiles& conf) {
                  conf.get_secondary_method_profiles().unresolved_size());
 }
 
+// Whether processing the method profiles after a pass may still match lines
+// against methods that the pass created.
+bool has_unresolved_method_profiles(ConfigFiles& conf) {
+  if (conf.get_method_profiles().unresolved_size() != 0) {
+    return true;
+  }
+  // The secondary profiles are only loaded after the first pass.
+  std::vector<std::string> secondary_files;
+  conf.get_json_config().get("secondary_method_stats_files", {},
+                             secondary_files);
+  return !secondary_files.empty();
+}
+
 void maybe_write_hashes_incoming(const ConfigFiles& conf, const Scope& scope) {
   if (conf.emit_incoming_hashes()) {
     TRACE(PM, 1, "Writing incoming hashes...");
@@ -644,6 +665,8 @@ class AfterPassSizes {
     json.get("after_pass_size_queue", m_max_jobs, m_max_jobs);
   }
 
+  bool enabled() const { return m_enabled; }
+
   bool handle(PassManager::PassInfo* pass_info,
               DexStoresVector* stores,
               ConfigFiles* conf) {
@@ -876,6 +899,8 @@ class TraceClassAfterEachPass {
     }
   }
 
+  bool enabled() const { return trace_class_name != nullptr; }
+
   void dump(const std::string& pass_name) {
     if (trace_class_name) {
       fprintf(fd, "After Pass  %s\n", pass_name.c_str());
@@ -974,6 +999,49 @@ struct ViolationsTracking {
   }
 };
 
+// Attributes the hierarchy cache activity during a pass to that pass.
+void report_hierarchy_cache_stats(PassManager& mgr,
+                                  const HierarchyCache::Stats& start) {
+  auto end = g_redex->get_hierarchy_cache()->get_stats();
+  auto hits = end.hits - start.hits;
+  auto misses = end.misses - start.misses;
+  if (hits == 0 && misses == 0) {
+    return;
+  }
+  mgr.set_metric("hierarchy_cache.hits", hits);
+  mgr.set_metric("hierarchy_cache.misses", misses);
+  mgr.set_metric("hierarchy_cache.build_time.100",
+                 (int64_t)((end.build_seconds - start.build_seconds) * 100));
+}
+
+// Attributes the resolver cache activity during a pass to that pass.
+void report_resolver_cache_stats(PassManager& mgr,
+                                 const ResolverCache::Stats& start) {
+  auto end = g_redex->get_resolver_cache()->get_stats();
+  auto hits = end.hits - start.hits;
+  auto misses = end.misses - start.misses;
+  if (hits == 0 && misses == 0) {
+    return;
+  }
+  mgr.set_metric("resolver_cache.hits", hits);
+  mgr.set_metric("resolver_cache.misses", misses);
+}
+
+// Attributes the reuse of purity summaries during a pass to that pass.
+void report_purity_summary_stats(PassManager& mgr,
+                                 const PuritySummaryStore::Stats& start) {
+  auto end = g_redex->get_purity_summaries()->get_stats();
+  auto reused = end.reused - start.reused;
+  auto computed = end.computed - start.computed;
+  if (reused == 0 && computed == 0) {
+    return;
+  }
+  mgr.set_metric("purity_summaries.reused", reused);
+  mgr.set_metric("purity_summaries.computed", computed);
+  mgr.set_metric("purity_summaries.closures_reused",
+                 end.closures_reused - start.closures_reused);
+}
+
 } // namespace
 
 std::unique_ptr<keep_rules::ProguardConfiguration> empty_pg_config() {
@@ -1103,6 +1171,56 @@ void PassManager::eval_passes(DexStoresVector& stores, ConfigFiles& conf) {
   }
 }
 
+std::vector<PassManager::PassTime> PassManager::run_fused_method_passes(
+    size_t begin, size_t end, DexStoresVector& stores, ConfigFiles& conf) {
+  auto* current_pass_info = m_current_pass_info;
+  std::vector<PassTime> times(end - begin);
+  auto timed = [](PassTime* time, const std::function<void()>& f) {
+    double cpu_time_start = ((double)std::clock()) / CLOCKS_PER_SEC;
+    auto wall_time_start = std::chrono::steady_clock::now();
+    f();
+    time->cpu += ((double)std::clock()) / CLOCKS_PER_SEC - cpu_time_start;
+    time->wall += std::chrono::steady_clock::now() - wall_time_start;
+  };
+  std::vector<MethodPass*> passes;
+  passes.reserve(end - begin);
+  for (size_t i = begin; i < end; ++i) {
+    auto* pass = static_cast<MethodPass*>(m_activated_passes[i]);
+    m_current_pass_info = &m_pass_info[i];
+    timed(&times[i - begin], [&]() { pass->prepare(stores, conf, *this); });
+    passes.push_back(pass);
+  }
+  PassTime traversal;
+  std::vector<double> visit_seconds;
+  {
+    Timer t("Fused method passes");
+    timed(&traversal, [&]() {
+      MethodPass::run_on_methods(passes, build_class_scope(stores),
+                                 &visit_seconds);
+    });
+  }
+  // Building the CFGs is shared; split all of the traversal by the time each
+  // pass spent visiting methods.
+  double total_visit_seconds = 0;
+  for (double seconds : visit_seconds) {
+    total_visit_seconds += seconds;
+  }
+  for (size_t i = 0; i < passes.size(); ++i) {
+    double share = total_visit_seconds > 0
+                       ? visit_seconds[i] / total_visit_seconds
+                       : 1.0 / passes.size();
+    times[i].cpu += traversal.cpu * share;
+    times[i].wall += traversal.wall * share;
+  }
+  for (size_t i = begin; i < end; ++i) {
+    m_current_pass_info = &m_pass_info[i];
+    timed(&times[i - begin], [&]() { passes[i - begin]->finish(*this); });
+    set_metric("fused_method_passes", end - begin);
+  }
+  m_current_pass_info = current_pass_info;
+  return times;
+}
+
 void PassManager::init_property_interactions(ConfigFiles& conf) {
   for (size_t i = 0; i < m_activated_passes.size(); ++i) {
     Pass* pass = m_activated_passes[i];
@@ -1316,7 +1434,52 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
   JemallocStats jemalloc_stats{this, conf};
 
+  // The range of passes that run in one traversal with pass i; see
+  // MethodPass.h. Something that inspects the program after a pass ends its
+  // group, as it would otherwise only see the program after the whole group.
+  std::vector<std::pair<size_t, size_t>> fused_groups;
+  fused_groups.reserve(m_activated_passes.size());
+  const bool method_profiles_unresolved = has_unresolved_method_profiles(conf);
+  auto inspected_after = [&](Pass* pass) {
+    return run_hasher_after_each_pass || assessor_config->run_after_each_pass ||
+           check_unique_deobfuscated.m_after_each_pass ||
+           pm_config->check_properties_deep ||
+           checker_conf.run_after_pass(pass) || trace_cls.enabled() ||
+           graph_visualizer.enabled() || after_pass_size.enabled() ||
+           violatios_tracking.enabled || method_profiles_unresolved;
+  };
+  // A pass that is profiled on its own does not share its traversal.
+  auto profiled = [&](Pass* pass) {
+    return profiler_all_info || pass == profiler_info_pass ||
+           pass == m_malloc_profile_pass;
+  };
+  for (size_t begin = 0; begin < m_activated_passes.size();) {
+    size_t end = begin + 1;
+    auto* first = dynamic_cast<MethodPass*>(m_activated_passes[begin]);
+    if (pm_config->fuse_method_passes && first != nullptr &&
+        first->is_fusible()) {
+      // A pass object keeps its preparation state, so it can only run once in
+      // each group.
+      std::unordered_set<Pass*> group{first};
+      while (end < m_activated_passes.size() &&
+             !inspected_after(m_activated_passes[end - 1]) &&
+             !profiled(m_activated_passes[end - 1])) {
+        auto* next = dynamic_cast<MethodPass*>(m_activated_passes[end]);
+        if (next == nullptr || !next->is_fusible() || profiled(next) ||
+            next->is_cfg_legacy() != first->is_cfg_legacy() ||
+            !group.insert(next).second) {
+          break;
+        }
+        ++end;
+      }
+    }
+    fused_groups.resize(end, {begin, end});
+    begin = end;
+  }
+
   std::unordered_map<const Pass*, size_t> runs;
+  // The time of each pass of the current fused group.
+  std::vector<PassTime> fused_times;
 
   /////////////////////
   // MAIN PASS LOOP. //
@@ -1347,9 +1510,22 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
       jemalloc_util::ScopedProfiling malloc_prof(m_malloc_profile_pass == pass);
       auto maybe_track_violations =
           violatios_tracking.maybe_track(this, stores);
+      auto hierarchy_cache_stats_start =
+          g_redex->get_hierarchy_cache()->get_stats();
+      // Passes may edit the member lists of classes directly, which the
+      // resolver cache does not see; start every pass from a new epoch.
+      g_redex->get_resolver_cache()->invalidate();
+      auto resolver_cache_stats_start =
+          g_redex->get_resolver_cache()->get_stats();
+      auto purity_summary_stats_start =
+          g_redex->get_purity_summaries()->get_stats();
       double cpu_time_start = ((double)std::clock()) / CLOCKS_PER_SEC;
       auto wall_time_start = std::chrono::steady_clock::now();
-      if (pass->is_cfg_legacy()) {
+      const auto [group_begin, group_end] = fused_groups[i];
+      if (i > group_begin) {
+        TRACE(PM, 2, "%s Pass ran fused with %s.\n", SHOW(pass->name()),
+              SHOW(m_activated_passes[group_begin]->name()));
+      } else if (pass->is_cfg_legacy()) {
         // if this pass hasn't been updated to editable_cfg yet, clear_cfg. In
         // the future, once all editable cfg updates are done, this branch will
         // be removed.
@@ -1365,12 +1541,26 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
         ensure_editable_cfg(stores);
         TRACE(PM, 2, "%s Pass uses editable cfg.\n", SHOW(pass->name()));
       }
-      pass->run_pass(stores, conf, *this);
+      if (group_end > group_begin + 1) {
+        if (i == group_begin) {
+          fused_times =
+              run_fused_method_passes(group_begin, group_end, stores, conf);
+        }
+      } else {
+        pass->run_pass(stores, conf, *this);
+      }
+      if (!pass->records_reference_changes()) {
+        g_redex->get_reference_journal()->record_untracked();
+        g_redex->get_purity_summaries()->invalidate_all();
+      }
       auto wall_time_end = std::chrono::steady_clock::now();
       double cpu_time_end = ((double)std::clock()) / CLOCKS_PER_SEC;
+      report_hierarchy_cache_stats(*this, hierarchy_cache_stats_start);
+      report_resolver_cache_stats(*this, resolver_cache_stats_start);
+      report_purity_summary_stats(*this, purity_summary_stats_start);
 
       // Ensure the CFG is clean, e.g., no unreachable blocks.
-      if (!pass->is_cfg_legacy()) {
+      if (!pass->is_cfg_legacy() && i == group_begin) {
         auto temp_scope = build_class_scope(stores);
         walk::parallel::code(temp_scope, [&](DexMethod* method, IRCode& code) {
           always_assert_log(code.editable_cfg_built(),
@@ -1384,6 +1574,19 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
 
       cpu_time = cpu_time_end - cpu_time_start;
       wall_time = wall_time_end - wall_time_start;
+      if (group_end > group_begin + 1) {
+        // The whole group ran while its first pass was the current one; move
+        // the time of every other pass over to that pass.
+        if (i == group_begin) {
+          for (size_t j = group_begin + 1; j < group_end; ++j) {
+            cpu_time -= fused_times[j - group_begin].cpu;
+            wall_time -= fused_times[j - group_begin].wall;
+          }
+        } else {
+          cpu_time += fused_times[i - group_begin].cpu;
+          wall_time += fused_times[i - group_begin].wall;
+        }
+      }
     }
 
     scoped_mem_stats.trace_log(this, pass);
@@ -1440,6 +1643,9 @@ void PassManager::run_passes(DexStoresVector& stores, ConfigFiles& conf) {
   maybe_print_seeds_outgoing(conf, it);
   maybe_write_hashes_outgoing(conf, scope);
 
+  // Nothing after the passes reuses the cached hierarchies.
+  g_redex->get_hierarchy_cache()->clear();
+
   sanitizers::lsan_do_recoverable_leak_check();
 
   Timer::add_timer("PassManager.Hashers", m_hashers_timer.get_seconds());
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <boost/optional.hpp>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <typeinfo>
@@ -149,6 +150,19 @@ class PassManager {
 
   void eval_passes(DexStoresVector&, ConfigFiles&);
 
+  struct PassTime {
+    double cpu{0};
+    std::chrono::duration<double> wall{0};
+  };
+
+  // Runs passes [begin, end), which are all MethodPasses, in one traversal.
+  // Returns the time of each pass: its preparation and finishing, and its
+  // share of the traversal.
+  std::vector<PassTime> run_fused_method_passes(size_t begin,
+                                                size_t end,
+                                                DexStoresVector& stores,
+                                                ConfigFiles& conf);
+
   void init_property_interactions(ConfigFiles& conf);
 
   AssetManager m_asset_mgr;
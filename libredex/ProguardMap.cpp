@@ -8,10 +8,12 @@
 #include "ProguardMap.h"
 
 #include <fstream>
+#include <sstream>
 
 #include "DexPosition.h"
 #include "DexUtil.h"
 #include "IRCode.h"
+#include "ReadMaybeMapped.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -214,23 +216,109 @@ bool is_maybe_proguard_generated_member(const std::string& s) {
   }
   return false;
 }
+
+// Chunks smaller than this are not worth parsing in parallel.
+constexpr size_t kMinChunkBytes = 1 << 20;
+
+// Class lines start a new class section; member lines are indented.
+bool is_class_line_start(char c) {
+  return !isspace(static_cast<unsigned char>(c)) && c != '#';
+}
+
+/*
+ * Splits a ProGuard map into about `num_chunks` ranges of lines. Every range
+ * but the first starts at a class line, so that all members of a class are in
+ * the same range as the class itself.
+ */
+std::vector<std::string_view> split_at_classes(std::string_view map,
+                                               size_t num_chunks) {
+  std::vector<std::string_view> chunks;
+  size_t chunk_size = std::max(map.size() / num_chunks, kMinChunkBytes);
+  size_t begin = 0;
+  while (begin < map.size()) {
+    size_t end = std::min(begin + chunk_size, map.size());
+    while (end < map.size()) {
+      auto eol = map.find('\n', end);
+      if (eol == std::string_view::npos) {
+        end = map.size();
+        break;
+      }
+      end = eol + 1;
+      if (end < map.size() && is_class_line_start(map[end])) {
+        break;
+      }
+    }
+    chunks.push_back(map.substr(begin, end - begin));
+    begin = end;
+  }
+  return chunks;
+}
+
+// Calls `fn` on each line of `text`, like std::getline would produce them.
+template <typename Fn>
+void for_each_line(std::string_view text, const Fn& fn) {
+  std::string line;
+  while (!text.empty()) {
+    auto eol = text.find('\n');
+    if (eol == std::string_view::npos) {
+      eol = text.size();
+    }
+    line.assign(text.data(), eol);
+    text.remove_prefix(std::min(eol + 1, text.size()));
+    fn(line);
+  }
+}
 } // namespace
 
+struct ProguardMap::ChunkMappings {
+  struct Field {
+    std::string pgold;
+    std::string pgnew;
+    std::string pgnew_notype;
+  };
+
+  struct Method {
+    std::string pgold;
+    std::string pgnew;
+    std::string pgnew_no_rtype;
+    std::string lines_key;
+    std::unique_ptr<ProguardLineRange> lines;
+  };
+
+  std::string_view text;
+  std::string curr_class;
+  std::string curr_new_class;
+  // Unobfuscated and obfuscated class names, in the order of the map.
+  std::vector<std::pair<std::string, std::string>> classes;
+  std::vector<Field> fields;
+  std::vector<Method> methods;
+  // Types that are (most likely) coalesced by Proguard, and the field
+  // where they were found.
+  std::vector<std::pair<std::string, std::string>> coalesced_interfaces;
+};
+
 ProguardMap::ProguardMap(const std::string& filename, bool use_new_rename_map) {
   if (filename.empty()) {
     return;
   }
   Timer t("Parsing proguard map");
-  std::ifstream fp(filename);
-  always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
-
   if (use_new_rename_map) {
+    std::ifstream fp(filename);
+    always_assert_log(fp, "Can't open proguard map: %s\n", filename.c_str());
     parse_full_map(fp);
   } else {
-    parse_proguard_map(fp);
+    redex::read_file_with_contents(filename, [&](const char* data, size_t s) {
+      parse_proguard_map(std::string_view(data, s));
+    });
   }
 }
 
+ProguardMap::ProguardMap(std::istream& is) {
+  std::stringstream buffer;
+  buffer << is.rdbuf();
+  parse_proguard_map(buffer.str());
+}
+
 std::string ProguardMap::translate_class(const std::string& cls) const {
   return find_or_same(cls, m_classMap);
 }
@@ -289,29 +377,126 @@ ProguardLineRangeVector& ProguardMap::method_lines(
       str_copy(pg_impl::lines_key(obfuscated_method)));
 }
 
-void ProguardMap::parse_proguard_map(std::istream& fp) {
-  std::string line;
-  while (std::getline(fp, line)) {
-    parse_class(line);
+/*
+ * The map is parsed in chunks that each start at a class line. Member lines
+ * refer to the obfuscated names of classes anywhere in the map, so all class
+ * lines are parsed in a first round. The chunks are then merged in the order
+ * of the map, so that the result does not depend on the chunking.
+ */
+void ProguardMap::parse_proguard_map(std::string_view map) {
+  auto texts =
+      split_at_classes(map, redex_parallel::default_num_threads() * 4);
+  std::vector<ChunkMappings> chunks(texts.size());
+  std::vector<ChunkMappings*> chunk_ptrs;
+  chunk_ptrs.reserve(chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    chunks[i].text = texts[i];
+    chunk_ptrs.push_back(&chunks[i]);
+  }
+
+  workqueue_run<ChunkMappings*>(
+      [&](ChunkMappings* chunk) {
+        for_each_line(chunk->text, [&](const std::string& line) {
+          if (parse_class(line, *chunk)) {
+            chunk->classes.emplace_back(chunk->curr_class,
+                                        chunk->curr_new_class);
+          }
+        });
+      },
+      chunk_ptrs);
+  for (const auto& chunk : chunks) {
+    for (const auto& [cls, new_cls] : chunk.classes) {
+      m_classMap[cls] = new_cls;
+      m_obfClassMap[new_cls] = cls;
+    }
   }
-  fp.clear();
-  fp.seekg(0);
-  assert_log(!fp.fail(), "Can't use ProguardMap with non-seekable stream");
-  while (std::getline(fp, line)) {
-    if (parse_class(line)) {
-      continue;
+
+  workqueue_run<ChunkMappings*>(
+      [&](ChunkMappings* chunk) {
+        chunk->curr_class.clear();
+        chunk->curr_new_class.clear();
+        for_each_line(chunk->text, [&](const std::string& line) {
+          if (parse_class(line, *chunk)) {
+            return;
+          }
+          if (parse_field(line, *chunk)) {
+            return;
+          }
+          if (parse_method(line, *chunk)) {
+            return;
+          }
+          if (comment(line)) {
+            return;
+          }
+          not_reached_log("Bogus line encountered in proguard map: %s\n",
+                          line.c_str());
+        });
+      },
+      chunk_ptrs);
+
+  // Each map is filled in by its own task.
+  std::vector<std::function<void()>> mergers;
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& field : chunk.fields) {
+        m_fieldMap[field.pgold] = field.pgnew;
+      }
     }
-    if (parse_field(line)) {
-      continue;
+  });
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& field : chunk.fields) {
+        m_obfFieldMap[field.pgnew] = field.pgold;
+      }
     }
-    if (parse_method(line)) {
-      continue;
+  });
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& field : chunk.fields) {
+        m_obfUntypedFieldMap[field.pgnew_notype] = field.pgold;
+      }
     }
-    if (comment(line)) {
-      continue;
+  });
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& method : chunk.methods) {
+        m_methodMap[method.pgold] = method.pgnew;
+      }
+    }
+  });
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& method : chunk.methods) {
+        m_obfMethodMap[method.pgnew] = method.pgold;
+      }
+    }
+  });
+  mergers.emplace_back([&] {
+    for (const auto& chunk : chunks) {
+      for (const auto& method : chunk.methods) {
+        m_obfUntypedMethodMap[method.pgnew_no_rtype] = method.pgold;
+      }
+    }
+  });
+  mergers.emplace_back([&] {
+    for (auto& chunk : chunks) {
+      for (auto& method : chunk.methods) {
+        m_obfMethodLinesMap[method.lines_key].push_back(
+            std::move(method.lines));
+      }
+    }
+  });
+  workqueue_run<std::function<void()>>(
+      [](const std::function<void()>& fn) { fn(); }, mergers);
+
+  for (const auto& chunk : chunks) {
+    for (const auto& [type, field] : chunk.coalesced_interfaces) {
+      fprintf(stderr,
+              "Type '%s' is touched by Proguard in '%s'\n",
+              type.c_str(),
+              field.c_str());
+      m_pg_coalesced_interfaces.insert(type);
     }
-    not_reached_log("Bogus line encountered in proguard map: %s\n",
-                    line.c_str());
   }
 }
 
@@ -428,21 +613,21 @@ bool ProguardMap::parse_method_full_format(const std::string& line) {
   return true;
 }
 
-bool ProguardMap::parse_class(const std::string& line) {
+bool ProguardMap::parse_class(const std::string& line,
+                              ChunkMappings& chunk) const {
   std::string classname;
   std::string newname;
   auto p = line.c_str();
   if (!id(p, classname)) return false;
   if (!literal(p, " -> ")) return false;
   if (!id(p, newname)) return false;
-  m_currClass = convert_type(classname);
-  m_currNewClass = convert_type(newname);
-  m_classMap[m_currClass] = m_currNewClass;
-  m_obfClassMap[m_currNewClass] = m_currClass;
+  chunk.curr_class = convert_type(classname);
+  chunk.curr_new_class = convert_type(newname);
   return true;
 }
 
-bool ProguardMap::parse_field(const std::string& line) {
+bool ProguardMap::parse_field(const std::string& line,
+                              ChunkMappings& chunk) const {
   std::string type;
   std::string fieldname;
   std::string newname;
@@ -457,27 +642,23 @@ bool ProguardMap::parse_field(const std::string& line) {
 
   auto ctype = convert_type(type);
   auto xtype = translate_type(ctype, *this);
-  auto pgnew = convert_field(m_currNewClass, xtype, newname);
-  auto pgnew_notype = convert_field(m_currNewClass, "", newname);
-  auto pgold = convert_field(m_currClass, ctype, fieldname);
+  auto pgnew = convert_field(chunk.curr_new_class, xtype, newname);
+  auto pgnew_notype = convert_field(chunk.curr_new_class, "", newname);
+  auto pgold = convert_field(chunk.curr_class, ctype, fieldname);
   // Record interfaces that are coalesced by Proguard.
   if (ctype[0] == 'L' && is_maybe_proguard_generated_member(fieldname)) {
-    fprintf(stderr,
-            "Type '%s' is touched by Proguard in '%s'\n",
-            ctype.c_str(),
-            pgold.c_str());
-    m_pg_coalesced_interfaces.insert(ctype);
+    chunk.coalesced_interfaces.emplace_back(ctype, pgold);
   }
-  m_fieldMap[pgold] = pgnew;
-  m_obfFieldMap[pgnew] = pgold;
-  m_obfUntypedFieldMap[pgnew_notype] = pgold;
+  chunk.fields.push_back(ChunkMappings::Field{
+      std::move(pgold), std::move(pgnew), std::move(pgnew_notype)});
   return true;
 }
 
-bool ProguardMap::parse_method(const std::string& line) {
+bool ProguardMap::parse_method(const std::string& line,
+                               ChunkMappings& chunk) const {
   std::string type;
   std::string methodname;
-  std::string classname = m_currClass;
+  std::string classname = chunk.curr_class;
   std::string old_args;
   std::string new_args;
   std::string newname;
@@ -518,14 +699,17 @@ bool ProguardMap::parse_method(const std::string& line) {
   auto old_rtype = convert_type(type);
   auto new_rtype = translate_type(old_rtype, *this);
   auto pgold = convert_method(classname, old_rtype, methodname, old_args);
-  auto pgnew = convert_method(m_currNewClass, new_rtype, newname, new_args);
-  auto pgnew_no_rtype = convert_method(m_currNewClass, "", newname, new_args);
-  m_methodMap[pgold] = pgnew;
-  m_obfMethodMap[pgnew] = pgold;
-  m_obfUntypedMethodMap[pgnew_no_rtype] = pgold;
+  auto pgnew =
+      convert_method(chunk.curr_new_class, new_rtype, newname, new_args);
+  auto pgnew_no_rtype =
+      convert_method(chunk.curr_new_class, "", newname, new_args);
   lines->original_name = pgold;
-  m_obfMethodLinesMap[str_copy(pg_impl::lines_key(pgnew))].push_back(
-      std::move(lines));
+  auto lines_key = str_copy(pg_impl::lines_key(pgnew));
+  chunk.methods.push_back(ChunkMappings::Method{std::move(pgold),
+                                                std::move(pgnew),
+                                                std::move(pgnew_no_rtype),
+                                                std::move(lines_key),
+                                                std::move(lines)});
   return true;
 }
 
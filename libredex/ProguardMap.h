@@ -10,6 +10,7 @@
 #include <cstddef>
 #include <iosfwd>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -53,7 +54,7 @@ struct ProguardMap {
   /**
    * Construct map from a given stream.
    */
-  explicit ProguardMap(std::istream& is) { parse_proguard_map(is); }
+  explicit ProguardMap(std::istream& is);
 
   /**
    * Translate un-obfuscated class name to obfuscated name.
@@ -112,12 +113,15 @@ struct ProguardMap {
   }
 
  private:
-  void parse_proguard_map(std::istream& fp);
+  // The mappings parsed from a range of lines of a ProGuard map.
+  struct ChunkMappings;
+
+  void parse_proguard_map(std::string_view map);
   void parse_full_map(std::istream& fp);
 
-  bool parse_class(const std::string& line);
-  bool parse_field(const std::string& line);
-  bool parse_method(const std::string& line);
+  bool parse_class(const std::string& line, ChunkMappings& chunk) const;
+  bool parse_field(const std::string& line, ChunkMappings& chunk) const;
+  bool parse_method(const std::string& line, ChunkMappings& chunk) const;
 
   bool parse_class_full_format(const std::string& line);
   bool parse_store_full_format(const std::string& line);
@@ -148,6 +152,7 @@ struct ProguardMap {
   // Interfaces that are (most likely) coalesced by Proguard.
   std::unordered_set<std::string> m_pg_coalesced_interfaces;
 
+  // The current class when parsing the full map.
   std::string m_currClass;
   std::string m_currNewClass;
 };
@@ -7,6 +7,8 @@
 
 #include "Purity.h"
 
+#include <atomic>
+#include <boost/functional/hash.hpp>
 #include <sstream>
 
 #include <sparta/WeakTopologicalOrdering.h>
@@ -15,6 +17,8 @@
 #include "ControlFlow.h"
 #include "EditableCfgAdapter.h"
 #include "IRInstruction.h"
+#include "PuritySummaryStore.h"
+#include "RedexContext.h"
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
@@ -513,20 +517,67 @@ size_t compute_locations_closure(
     const method_override_graph::Graph* method_override_graph,
     std::function<boost::optional<LocationsAndDependencies>(DexMethod*)>
         init_func,
-    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result) {
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result,
+    const PuritySummaryKey* summary_key) {
+  PuritySummaryStore* store = nullptr;
+  boost::optional<PuritySummaryStore::Summaries> cached;
+  if (summary_key) {
+    store = g_redex->get_purity_summaries();
+    cached = store->take(*summary_key);
+  }
+
   // 1. Let's initialize known method read locations and dependencies by
-  //    scanning method bodies
-  ConcurrentMap<const DexMethod*, LocationsAndDependencies>
-      concurrent_method_lads;
+  //    scanning method bodies, unless they are known from an earlier run
+  ConcurrentMap<const DexMethod*, boost::optional<LocationsAndDependencies>>
+      concurrent_initial;
+  std::atomic<size_t> reused{0};
+  std::atomic<size_t> computed{0};
   walk::parallel::methods(scope, [&](DexMethod* method) {
-    auto lads = init_func(method);
-    if (lads) {
-      concurrent_method_lads.emplace(method, std::move(*lads));
+    if (cached && !cached->edited.count(method)) {
+      auto it = cached->initial.find(method);
+      if (it != cached->initial.end()) {
+        concurrent_initial.emplace(method, it->second);
+        reused.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
     }
+    concurrent_initial.emplace(method, init_func(method));
+    computed.fetch_add(1, std::memory_order_relaxed);
   });
 
-  std::unordered_map<const DexMethod*, LocationsAndDependencies> method_lads =
-      concurrent_method_lads.move_to_container();
+  PuritySummaryStore::Stats stats;
+  stats.reused = reused.load();
+  stats.computed = computed.load();
+  if (cached && stats.computed == 0 &&
+      stats.reused == cached->initial.size()) {
+    // Nothing was edited, added or removed since the summaries were stored.
+    stats.closures_reused = 1;
+    store->add_stats(stats);
+    result->insert(cached->closure.begin(), cached->closure.end());
+    store->put(*summary_key, std::move(*cached));
+    return 0;
+  }
+  if (summary_key) {
+    store->add_stats(stats);
+    TRACE(CSE, 2, "[purity] %s: %zu summaries reused, %zu computed",
+          summary_key->name.c_str(), stats.reused, stats.computed);
+  }
+
+  std::unordered_map<const DexMethod*,
+                     boost::optional<LocationsAndDependencies>>
+      initial = concurrent_initial.move_to_container();
+  std::unordered_map<const DexMethod*, LocationsAndDependencies> method_lads;
+  for (auto&& [method, lads] : initial) {
+    if (!lads) {
+      continue;
+    }
+    // The initial summaries are only kept when they are going to be stored.
+    if (summary_key) {
+      method_lads.emplace(method, *lads);
+    } else {
+      method_lads.emplace(method, std::move(*lads));
+    }
+  }
 
   // 2. Compute inverse dependencies so that we know what needs to be recomputed
   // during the fixpoint computation, and determine set of methods that are
@@ -626,6 +677,21 @@ size_t compute_locations_closure(
 
   // For all methods which have a known set of locations at this point,
   // persist that information
+  if (summary_key) {
+    PuritySummaryStore::Summaries summaries;
+    for (auto&& [method, lads] : initial) {
+      if (lads) {
+        for (auto d : lads->dependencies) {
+          summaries.dependents[d].push_back(method);
+        }
+      }
+    }
+    for (auto&& [method, lads] : method_lads) {
+      summaries.closure.emplace(method, lads.locations);
+    }
+    summaries.initial = std::move(initial);
+    store->put(*summary_key, std::move(summaries));
+  }
   for (auto&& [method, lads] : method_lads) {
     result->emplace(method, std::move(lads.locations));
   }
@@ -654,7 +720,18 @@ static size_t analyze_read_locations(
     bool ignore_methods_with_assumenosideeffects,
     bool for_conditional_purity,
     bool compute_locations,
-    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result) {
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result,
+    const PuritySummaryKey* summary_key = nullptr) {
+  boost::optional<PuritySummaryKey> read_locations_key;
+  if (summary_key) {
+    read_locations_key = *summary_key;
+    read_locations_key->add_methods(pure_methods);
+    read_locations_key->flags.insert(read_locations_key->flags.end(),
+                                     {ignore_methods_with_assumenosideeffects,
+                                      for_conditional_purity,
+                                      compute_locations});
+  }
+
   std::unordered_set<const DexMethod*> pure_methods_closure;
   for (auto pure_method_ref : pure_methods) {
     auto pure_method = pure_method_ref->as_def();
@@ -783,7 +860,7 @@ static size_t analyze_read_locations(
 
         return lads;
       },
-      result);
+      result, read_locations_key.get_ptr());
 }
 
 size_t compute_conditionally_pure_methods(
@@ -791,13 +868,14 @@ size_t compute_conditionally_pure_methods(
     const method_override_graph::Graph* method_override_graph,
     const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
     const std::unordered_set<DexMethodRef*>& pure_methods,
-    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result) {
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result,
+    const PuritySummaryKey* summary_key) {
   Timer t("compute_conditionally_pure_methods");
   auto iterations = analyze_read_locations(
       scope, method_override_graph, clinit_has_no_side_effects, pure_methods,
       /* ignore_methods_with_assumenosideeffects */ false,
       /* for_conditional_purity */ true,
-      /* compute_locations */ true, result);
+      /* compute_locations */ true, result, summary_key);
   for (auto& p : *result) {
     TRACE(CSE, 4, "[CSE] conditionally pure method %s: %s", SHOW(p.first),
           SHOW(&p.second));
@@ -810,7 +888,8 @@ size_t compute_no_side_effects_methods(
     const method_override_graph::Graph* method_override_graph,
     const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
     const std::unordered_set<DexMethodRef*>& pure_methods,
-    std::unordered_set<const DexMethod*>* result) {
+    std::unordered_set<const DexMethod*>* result,
+    const PuritySummaryKey* summary_key) {
   Timer t("compute_no_side_effects_methods");
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       method_locations;
@@ -818,7 +897,7 @@ size_t compute_no_side_effects_methods(
       scope, method_override_graph, clinit_has_no_side_effects, pure_methods,
       /* ignore_methods_with_assumenosideeffects */ true,
       /* for_conditional_purity */ false,
-      /* compute_locations */ false, &method_locations);
+      /* compute_locations */ false, &method_locations, summary_key);
   for (auto& p : method_locations) {
     TRACE(CSE, 4, "[CSE] no side effects method %s", SHOW(p.first));
     result->insert(p.first);
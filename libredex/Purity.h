@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
 #include "DexClass.h"
 #include "MethodOverrideGraph.h"
 #include "MethodUtil.h"
@@ -142,6 +147,28 @@ bool process_base_and_overriding_methods(
     bool ignore_methods_with_assumenosideeffects,
     const std::function<bool(DexMethod*)>& handler_func);
 
+// Identifies a compute_locations_closure computation by a name and everything
+// besides the code of the analyzed methods that its initialization function
+// depends on, so that its summaries can be kept in the PuritySummaryStore and
+// reused by later computations with an equal key. Keys are compared exactly.
+struct PuritySummaryKey {
+  std::string name;
+  std::vector<size_t> flags;
+  // Sorted.
+  std::vector<const DexMethodRef*> methods;
+
+  template <typename Methods>
+  void add_methods(const Methods& more_methods) {
+    methods.insert(methods.end(), more_methods.begin(), more_methods.end());
+    std::sort(methods.begin(), methods.end());
+  }
+
+  bool operator<(const PuritySummaryKey& other) const {
+    return std::tie(name, flags, methods) <
+           std::tie(other.name, other.flags, other.methods);
+  }
+};
+
 // Accumulated time of all internal wto computations of
 // compute_locations_closure.
 double get_compute_locations_closure_wto_seconds();
@@ -153,12 +180,17 @@ double get_compute_locations_closure_wto_seconds();
 // no entry for the relevant (base) methods.
 // The return value indicates how many iterations the fixed-point computation
 // required.
+// Given a summary key, the initial locations and dependencies of methods that
+// were not edited since an earlier computation with the same key are taken
+// from the PuritySummaryStore instead of calling init_func, and the whole
+// computation is skipped if nothing changed.
 size_t compute_locations_closure(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
     std::function<boost::optional<LocationsAndDependencies>(DexMethod*)>
         init_func,
-    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result);
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result,
+    const PuritySummaryKey* summary_key = nullptr);
 
 // Compute all "conditionally pure" methods, i.e. methods which are pure except
 // that they may read from a set of well-known locations (not including
@@ -166,12 +198,14 @@ size_t compute_locations_closure(
 // map indicates the set of read locations.
 // The return value indicates how many iterations the fixed-point computation
 // required.
+// The summary key, if any, must identify the clinit predicate.
 size_t compute_conditionally_pure_methods(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
     const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
     const std::unordered_set<DexMethodRef*>& pure_methods,
-    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result);
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet>* result,
+    const PuritySummaryKey* summary_key = nullptr);
 
 // Compute all methods with no side effects, i.e. methods which do not mutate
 // state and only call other methods which do not have side effects.
@@ -179,12 +213,14 @@ size_t compute_conditionally_pure_methods(
 // required.
 // The return value indicates how many iterations the fixed-point computation
 // required.
+// The summary key, if any, must identify the clinit predicate.
 size_t compute_no_side_effects_methods(
     const Scope& scope,
     const method_override_graph::Graph* method_override_graph,
     const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
     const std::unordered_set<DexMethodRef*>& pure_methods,
-    std::unordered_set<const DexMethod*>* result);
+    std::unordered_set<const DexMethod*>* result,
+    const PuritySummaryKey* summary_key = nullptr);
 
 // Determines whether for a given (possibly abstract) method, there may be a
 // method that effectively implements it. (If not, then that implies that no
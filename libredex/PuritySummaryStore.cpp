@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "PuritySummaryStore.h"
+
+#include "MethodUtil.h"
+
+void PuritySummaryStore::invalidate_locked(const DexMethod* method) {
+  if (method::is_clinit(method)) {
+    // Whether a static initializer has side effects is not tracked as a
+    // dependency, so any summary might be affected.
+    m_summaries.clear();
+    return;
+  }
+  for (auto& [_, summaries] : m_summaries) {
+    if (!summaries.initial.count(method) ||
+        !summaries.edited.insert(method).second) {
+      continue;
+    }
+    std::vector<const DexMethod*> work_list{method};
+    while (!work_list.empty()) {
+      auto m = work_list.back();
+      work_list.pop_back();
+      if (!summaries.impacted.insert(m).second) {
+        continue;
+      }
+      auto it = summaries.dependents.find(m);
+      if (it != summaries.dependents.end()) {
+        work_list.insert(work_list.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+}
+
+void PuritySummaryStore::invalidate_all() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_summaries.clear();
+}
+
+boost::optional<PuritySummaryStore::Summaries> PuritySummaryStore::take(
+    const PuritySummaryKey& key) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto it = m_summaries.find(key);
+  if (it == m_summaries.end()) {
+    return boost::none;
+  }
+  auto summaries = std::move(it->second);
+  m_summaries.erase(it);
+  return summaries;
+}
+
+void PuritySummaryStore::put(const PuritySummaryKey& key,
+                             Summaries summaries) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_summaries[key] = std::move(summaries);
+}
+
+void PuritySummaryStore::add_stats(const Stats& stats) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_stats.reused += stats.reused;
+  m_stats.computed += stats.computed;
+  m_stats.closures_reused += stats.closures_reused;
+}
+
+PuritySummaryStore::Stats PuritySummaryStore::get_stats() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_stats;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <boost/optional.hpp>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "Purity.h"
+
+/*
+ * Keeps the per-method summaries computed by compute_locations_closure, so
+ * that later computations with the same PuritySummaryKey can reuse them
+ * instead of rescanning every method and rerunning the fixpoint. It is owned
+ * by the RedexContext, see `g_redex->get_purity_summaries()`.
+ *
+ * Editing the code of a method invalidates its own summary and the closure of
+ * all methods that transitively depend on it. Passes that declare, via
+ * Pass::records_reference_changes(), that they record all their changes must
+ * call invalidate() with every method they edit, once they are done editing,
+ * and invalidate_all() if they remove classes or members; after any other
+ * pass, the PassManager drops all summaries.
+ */
+class PuritySummaryStore {
+ public:
+  struct Summaries {
+    // The initial locations and dependencies of every analyzed method, or
+    // none if its behavior is unknown.
+    std::unordered_map<const DexMethod*,
+                       boost::optional<LocationsAndDependencies>>
+        initial;
+    // The inverse of the dependencies in `initial`.
+    std::unordered_map<const DexMethod*, std::vector<const DexMethod*>>
+        dependents;
+    // The methods edited since their initial summary was computed.
+    std::unordered_set<const DexMethod*> edited;
+    // The methods whose closure is out of date: the edited ones, and all
+    // methods that transitively depend on them.
+    std::unordered_set<const DexMethod*> impacted;
+    // The result of the last closure computation.
+    std::unordered_map<const DexMethod*, CseUnorderedLocationSet> closure;
+  };
+
+  struct Stats {
+    // Number of initial method summaries taken from the store.
+    size_t reused{0};
+    // Number of initial method summaries that had to be (re)computed.
+    size_t computed{0};
+    // Number of closure computations answered entirely from the store.
+    size_t closures_reused{0};
+  };
+
+  // Records that the code of `methods` changed. This walks the dependents of
+  // all stored summaries under one lock, so call it once with all edited
+  // methods rather than from parallel workers.
+  template <typename Methods>
+  void invalidate(const Methods& methods) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const DexMethod* method : methods) {
+      invalidate_locked(method);
+    }
+  }
+
+  // Drops all summaries.
+  void invalidate_all();
+
+  // Removes and returns the summaries stored for `key`, if any.
+  boost::optional<Summaries> take(const PuritySummaryKey& key);
+
+  // Stores the summaries of a finished closure computation for `key`.
+  void put(const PuritySummaryKey& key, Summaries summaries);
+
+  void add_stats(const Stats& stats);
+
+  Stats get_stats() const;
+
+ private:
+  void invalidate_locked(const DexMethod* method);
+
+  mutable std::mutex m_mutex;
+  std::map<PuritySummaryKey, Summaries> m_summaries;
+  Stats m_stats;
+};
@@ -18,7 +18,9 @@
 #include "DexUtil.h"
 #include "ProguardConfiguration.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "Resolver.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -34,6 +36,10 @@ namespace {
 
 static ReachableObject SEED_SINGLETON{};
 
+// The epoch of the most recent marking. Objects start out with epoch 0, i.e.
+// unmarked.
+std::atomic<uint32_t> s_reachability_epoch{0};
+
 } // namespace
 
 namespace reachability {
@@ -872,28 +878,8 @@ bool TransitiveClosureMarkerWorker::has_class_forName(const DexMethod* meth) {
   return false;
 }
 
-void TransitiveClosureMarkerWorker::gather_and_push(
-    std::shared_ptr<MethodReferencesGatherer> method_references_gatherer,
-    const MethodReferencesGatherer::Advance& advance) {
-  always_assert(method_references_gatherer);
-  References refs;
-  method_references_gatherer->advance(advance, &refs);
-  auto* meth = method_references_gatherer->get_method();
-  if (refs.method_references_gatherer_dependency_if_instance_method_callable &&
-      (!m_shared_state->cfg_gathering_check_instantiable ||
-       !m_shared_state->cfg_gathering_check_instance_callable ||
-       meth->rstate.no_optimizations() || is_static(meth) ||
-       m_shared_state->reachable_aspects->callable_instance_methods.count(
-           meth))) {
-    always_assert(advance.kind() ==
-                  MethodReferencesGatherer::AdvanceKind::Initial);
-    refs.method_references_gatherer_dependency_if_instance_method_callable =
-        false;
-    method_references_gatherer->advance(
-        MethodReferencesGatherer::Advance::callable(), &refs);
-    always_assert(
-        !refs.method_references_gatherer_dependency_if_instance_method_callable);
-  }
+void TransitiveClosureMarkerWorker::push_method_references(
+    const DexMethod* meth, const References& refs) {
   auto* type = meth->get_class();
   auto* cls = type_class(type);
   bool check_strings = m_shared_state->ignore_sets->keep_class_in_string;
@@ -926,6 +912,31 @@ void TransitiveClosureMarkerWorker::gather_and_push(
   dynamically_referenced(refs.classes_dynamically_referenced);
   directly_instantiable(refs.new_instances);
   instance_callable(refs.called_super_methods);
+}
+
+void TransitiveClosureMarkerWorker::gather_and_push(
+    std::shared_ptr<MethodReferencesGatherer> method_references_gatherer,
+    const MethodReferencesGatherer::Advance& advance) {
+  always_assert(method_references_gatherer);
+  References refs;
+  method_references_gatherer->advance(advance, &refs);
+  auto* meth = method_references_gatherer->get_method();
+  if (refs.method_references_gatherer_dependency_if_instance_method_callable &&
+      (!m_shared_state->cfg_gathering_check_instantiable ||
+       !m_shared_state->cfg_gathering_check_instance_callable ||
+       meth->rstate.no_optimizations() || is_static(meth) ||
+       m_shared_state->reachable_aspects->callable_instance_methods.count(
+           meth))) {
+    always_assert(advance.kind() ==
+                  MethodReferencesGatherer::AdvanceKind::Initial);
+    refs.method_references_gatherer_dependency_if_instance_method_callable =
+        false;
+    method_references_gatherer->advance(
+        MethodReferencesGatherer::Advance::callable(), &refs);
+    always_assert(
+        !refs.method_references_gatherer_dependency_if_instance_method_callable);
+  }
+  push_method_references(meth, refs);
   if (refs.method_references_gatherer_dependency_if_instance_method_callable) {
     push_if_instance_method_callable(method_references_gatherer);
     always_assert(
@@ -945,8 +956,34 @@ void TransitiveClosureMarkerWorker::gather_and_push(
 }
 
 void TransitiveClosureMarkerWorker::gather_and_push(const DexMethod* meth) {
-  gather_and_push(create_method_references_gatherer(meth),
-                  MethodReferencesGatherer::Advance::initial());
+  auto* cache = m_shared_state->method_references_cache;
+  if (cache == nullptr) {
+    gather_and_push(create_method_references_gatherer(meth),
+                    MethodReferencesGatherer::Advance::initial());
+    return;
+  }
+  auto refs = cache->get(meth);
+  if (!refs) {
+    // Without cfg-gathering checks, all references are gathered right away.
+    auto gathered = std::make_shared<References>();
+    auto method_references_gatherer = create_method_references_gatherer(meth);
+    method_references_gatherer->advance(
+        MethodReferencesGatherer::Advance::initial(), gathered.get());
+    gathered->method_references_gatherer_dependency_if_instance_method_callable =
+        false;
+    method_references_gatherer->advance(
+        MethodReferencesGatherer::Advance::callable(), gathered.get());
+    always_assert(
+        !gathered
+             ->method_references_gatherer_dependency_if_instance_method_callable);
+    always_assert(
+        gathered->method_references_gatherer_dependencies_if_class_instantiable
+            .empty());
+    refs = std::move(gathered);
+    cache->put(meth, refs);
+  }
+  // The ignore sets apply here, so hits count ignored string checks as well.
+  push_method_references(meth, *refs);
 }
 
 std::shared_ptr<MethodReferencesGatherer>
@@ -1317,8 +1354,14 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool cfg_gathering_check_instance_callable,
     bool should_mark_all_as_seed,
     std::unique_ptr<const mog::Graph>* out_method_override_graph,
-    bool remove_no_argument_constructors) {
+    bool remove_no_argument_constructors,
+    MethodReferencesCache* method_references_cache) {
   Timer t("Marking");
+  always_assert_log(method_references_cache == nullptr ||
+                        (!cfg_gathering_check_instantiable &&
+                         !cfg_gathering_check_instance_callable),
+                    "Method references cannot be cached with cfg-gathering "
+                    "checks");
   auto scope = build_class_scope(stores);
   auto reachable_objects = std::make_unique<ReachableObjects>();
   ConditionallyMarked cond_marked;
@@ -1348,7 +1391,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
       &cond_marked,
       reachable_objects.get(),
       reachable_aspects,
-      &stats};
+      &stats,
+      method_references_cache};
   workqueue_run<ReachableObject>(
       [&](TransitiveClosureMarkerWorkerState* worker_state,
           const ReachableObject& obj) {
@@ -1373,6 +1417,46 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
   return reachable_objects;
 }
 
+void MethodReferencesCache::sync(ReferenceJournal* journal,
+                                 bool relaxed_keep_class_members,
+                                 const IgnoreSets& ignore_sets) {
+  std::unordered_set<const DexMethod*> changed;
+  bool complete = journal->take(&changed);
+  if (!complete ||
+      relaxed_keep_class_members != m_relaxed_keep_class_members ||
+      !(ignore_sets == m_ignore_sets)) {
+    m_references.clear();
+    m_relaxed_keep_class_members = relaxed_keep_class_members;
+    m_ignore_sets = ignore_sets;
+  } else {
+    for (auto* method : changed) {
+      m_references.erase(method);
+    }
+  }
+  m_hits = 0;
+  m_misses = 0;
+}
+
+std::shared_ptr<const References> MethodReferencesCache::get(
+    const DexMethod* method) const {
+  auto refs = m_references.get(method, nullptr);
+  ++(refs ? m_hits : m_misses);
+  return refs;
+}
+
+void MethodReferencesCache::put(const DexMethod* method,
+                                std::shared_ptr<const References> refs) {
+  m_references.emplace(method, std::move(refs));
+}
+
+ReachableObjects::ReachableObjects() : m_epoch(++s_reachability_epoch) {
+  always_assert_log(m_epoch != 0, "Ran out of reachability epochs");
+}
+
+bool ReachableObjects::is_current() const {
+  return m_epoch == s_reachability_epoch.load();
+}
+
 void ReachableObjects::record_reachability(const DexMethodRef* member,
                                            const DexClass* cls) {
   // Each class member trivially retains its containing class; let's filter out
@@ -1507,6 +1591,7 @@ void sweep(DexStoresVector& stores,
     sweep_if_unmarked(reachables, sweep_method, &cls->get_vmethods(),
                       removed_symbols);
   });
+  g_redex->get_resolver_cache()->invalidate();
 }
 
 remove_uninstantiables_impl::Stats sweep_code(
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -19,6 +21,7 @@
 #include "MethodOverrideGraph.h"
 #include "MethodUtil.h"
 #include "Pass.h"
+#include "ReferenceJournal.h"
 #include "RemoveUninstantiablesImpl.h"
 #include "Thread.h"
 
@@ -84,6 +87,13 @@ struct IgnoreSets {
   std::unordered_set<const DexType*> string_literal_annos;
   std::unordered_set<const DexType*> system_annos;
   bool keep_class_in_string{true};
+
+  bool operator==(const IgnoreSets& other) const {
+    return string_literals == other.string_literals &&
+           string_literal_annos == other.string_literal_annos &&
+           system_annos == other.system_annos &&
+           keep_class_in_string == other.keep_class_in_string;
+  }
 };
 
 // The ReachableObjectSet does not need to be a ConcurrentSet since it is nested
@@ -95,47 +105,83 @@ using ReachableObjectSet =
 using ReachableObjectGraph =
     ConcurrentMap<ReachableObject, ReachableObjectSet, ReachableObjectHash>;
 
+/*
+ * The result of a reachability marking. Marks are kept on the classes, fields
+ * and methods themselves, as the epoch of the marking that reached them, so
+ * that marking an object is a single atomic exchange and checking a mark is
+ * a load. This means that only the most recently created ReachableObjects
+ * holds valid marks; its marks become stale as soon as another marking
+ * starts.
+ */
 class ReachableObjects {
  public:
+  ReachableObjects();
+
   const ReachableObjectGraph& retainers_of() const { return m_retainers_of; }
 
-  bool mark(const DexClass* cls) { return m_marked_classes.insert(cls); }
+  bool mark(const DexClass* cls) {
+    return mark(cls->m_reachability_mark, m_num_marked_classes);
+  }
 
   bool mark(const DexMethodRef* method) {
-    return m_marked_methods.insert(method);
+    return mark(method->m_reachability_mark, m_num_marked_methods);
   }
 
-  bool mark(const DexFieldRef* field) { return m_marked_fields.insert(field); }
+  bool mark(const DexFieldRef* field) {
+    return mark(field->m_reachability_mark, m_num_marked_fields);
+  }
 
-  bool marked(const DexClass* cls) const { return m_marked_classes.count(cls); }
+  bool marked(const DexClass* cls) const {
+    return marked(cls->m_reachability_mark);
+  }
 
   bool marked(const DexMethodRef* method) const {
-    return m_marked_methods.count(method);
+    return marked(method->m_reachability_mark);
   }
 
   bool marked(const DexFieldRef* field) const {
-    return m_marked_fields.count(field);
+    return marked(field->m_reachability_mark);
   }
 
+  // For use once marking has finished.
   bool marked_unsafe(const DexClass* cls) const {
-    return m_marked_classes.count_unsafe(cls);
+    return marked_unsafe(cls->m_reachability_mark);
   }
 
   bool marked_unsafe(const DexMethodRef* method) const {
-    return m_marked_methods.count_unsafe(method);
+    return marked_unsafe(method->m_reachability_mark);
   }
 
   bool marked_unsafe(const DexFieldRef* field) const {
-    return m_marked_fields.count_unsafe(field);
+    return marked_unsafe(field->m_reachability_mark);
   }
 
-  size_t num_marked_classes() const { return m_marked_classes.size(); }
+  size_t num_marked_classes() const { return m_num_marked_classes.load(); }
 
-  size_t num_marked_fields() const { return m_marked_fields.size(); }
+  size_t num_marked_fields() const { return m_num_marked_fields.load(); }
 
-  size_t num_marked_methods() const { return m_marked_methods.size(); }
+  size_t num_marked_methods() const { return m_num_marked_methods.load(); }
 
  private:
+  bool mark(std::atomic<uint32_t>& mark_word, std::atomic<size_t>& count) {
+    if (mark_word.exchange(m_epoch, std::memory_order_acq_rel) == m_epoch) {
+      return false;
+    }
+    count.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  bool marked(const std::atomic<uint32_t>& mark_word) const {
+    return mark_word.load(std::memory_order_acquire) == m_epoch;
+  }
+
+  bool marked_unsafe(const std::atomic<uint32_t>& mark_word) const {
+    redex_assert(is_current());
+    return mark_word.load(std::memory_order_relaxed) == m_epoch;
+  }
+
+  bool is_current() const;
+
   template <class Seed>
   void record_is_seed(Seed* seed);
 
@@ -149,23 +195,10 @@ class ReachableObjects {
 
   void record_reachability(const DexMethodRef* member, const DexClass* cls);
 
-  static constexpr size_t MARK_SLOTS = 127;
-
-  ConcurrentSet<const DexClass*,
-                std::hash<const DexClass*>,
-                std::equal_to<const DexClass*>,
-                MARK_SLOTS>
-      m_marked_classes;
-  ConcurrentSet<const DexFieldRef*,
-                std::hash<const DexFieldRef*>,
-                std::equal_to<const DexFieldRef*>,
-                MARK_SLOTS>
-      m_marked_fields;
-  ConcurrentSet<const DexMethodRef*,
-                std::hash<const DexMethodRef*>,
-                std::equal_to<const DexMethodRef*>,
-                MARK_SLOTS>
-      m_marked_methods;
+  const uint32_t m_epoch;
+  std::atomic<size_t> m_num_marked_classes{0};
+  std::atomic<size_t> m_num_marked_fields{0};
+  std::atomic<size_t> m_num_marked_methods{0};
   ReachableObjectGraph m_retainers_of;
 
   friend class RootSetMarker;
@@ -328,6 +361,42 @@ struct Stats {
   std::atomic<int> num_ignore_check_strings{0};
 };
 
+/*
+ * The references gathered from the code and annotations of each method by
+ * earlier reachability runs, for reuse by later ones. This is only sound when
+ * the references of a method do not depend on what else is reachable, i.e.
+ * without cfg-gathering checks, and when every change to the references of a
+ * method since is recorded in the ReferenceJournal.
+ */
+class MethodReferencesCache {
+ public:
+  /*
+   * Drops the entries of the methods recorded in the journal, or all entries
+   * if the journal is incomplete or the entries were gathered under another
+   * configuration, and resets the stats.
+   */
+  void sync(ReferenceJournal* journal,
+            bool relaxed_keep_class_members,
+            const IgnoreSets& ignore_sets);
+
+  std::shared_ptr<const References> get(const DexMethod* method) const;
+
+  void put(const DexMethod* method, std::shared_ptr<const References> refs);
+
+  size_t hits() const { return m_hits.load(); }
+
+  size_t misses() const { return m_misses.load(); }
+
+ private:
+  ConcurrentMap<const DexMethod*, std::shared_ptr<const References>>
+      m_references;
+  // The configuration under which the entries were gathered.
+  bool m_relaxed_keep_class_members{false};
+  IgnoreSets m_ignore_sets;
+  mutable std::atomic<size_t> m_hits{0};
+  mutable std::atomic<size_t> m_misses{0};
+};
+
 /*
  * These helper classes compute reachable objects by a DFS+marking algorithm.
  *
@@ -423,6 +492,7 @@ struct TransitiveClosureMarkerSharedState {
   ReachableObjects* reachable_objects;
   ReachableAspects* reachable_aspects;
   Stats* stats;
+  MethodReferencesCache* method_references_cache{nullptr};
 };
 
 using TransitiveClosureMarkerWorkerState = sparta::WorkerState<ReachableObject>;
@@ -499,6 +569,8 @@ class TransitiveClosureMarkerWorker {
 
   bool has_class_forName(const DexMethod* meth);
 
+  void push_method_references(const DexMethod* meth, const References& refs);
+
   void gather_and_push(
       std::shared_ptr<MethodReferencesGatherer> method_references_gatherer,
       const MethodReferencesGatherer::Advance& advance);
@@ -564,7 +636,8 @@ std::unique_ptr<ReachableObjects> compute_reachable_objects(
     bool should_mark_all_as_seed = false,
     std::unique_ptr<const method_override_graph::Graph>*
         out_method_override_graph = nullptr,
-    bool remove_no_argument_constructors = false);
+    bool remove_no_argument_constructors = false,
+    MethodReferencesCache* method_references_cache = nullptr);
 
 void sweep(DexStoresVector& stores,
            const ReachableObjects& reachables,
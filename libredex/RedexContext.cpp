@@ -19,8 +19,12 @@
 #include "DexClass.h"
 #include "DexPosition.h"
 #include "DuplicateClasses.h"
+#include "HierarchyCache.h"
 #include "KeepReason.h"
 #include "ProguardConfiguration.h"
+#include "PuritySummaryStore.h"
+#include "ReferenceJournal.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "Timer.h"
 #include "Trace.h"
@@ -37,9 +41,24 @@ RedexContext::RedexContext(bool allow_class_duplicates)
       s_medium_string_storage{65536, 2000,
                               boost::thread::hardware_concurrency() / 4},
       s_large_string_storage{0, 0, boost::thread::hardware_concurrency()},
+      s_field_storage{sizeof(DexField), boost::thread::hardware_concurrency()},
+      s_method_storage{sizeof(DexMethod),
+                       boost::thread::hardware_concurrency()},
+      m_hierarchy_cache(std::make_unique<HierarchyCache>()),
+      m_reference_journal(std::make_unique<ReferenceJournal>()),
+      m_resolver_cache(std::make_unique<ResolverCache>()),
+      m_purity_summaries(std::make_unique<PuritySummaryStore>()),
       m_allow_class_duplicates(allow_class_duplicates) {}
 
 RedexContext::~RedexContext() {
+  // Cached graphs refer to classes and methods, so they go first.
+  m_hierarchy_cache.reset();
+
+  // All storage is released at the end; do not collect the slots of the
+  // members deleted below.
+  s_field_storage.recycle = false;
+  s_method_storage.recycle = false;
+
   // We parallelize destruction for efficiency.
   auto parallel_run = [](const std::vector<std::function<void()>>& fns,
                          const char* timer_name) {
@@ -201,7 +220,14 @@ RedexContext::~RedexContext() {
   log_stats("small", s_small_string_storage);
   log_stats("medium", s_medium_string_storage);
   log_stats("large", s_large_string_storage);
-  TRACE(PM, 1, "String storage @ %u hardware concurrency:%s",
+  auto log_object_stats = [&](auto* name, ObjectStorage& storage) {
+    log_stats(name, storage.buffers);
+    oss << ", " << storage.reused << " slots reused, " << storage.free_slots
+        << " free";
+  };
+  log_object_stats("fields", s_field_storage);
+  log_object_stats("methods", s_method_storage);
+  TRACE(PM, 1, "String and member storage @ %u hardware concurrency:%s",
         boost::thread::hardware_concurrency(), oss.str().c_str());
 }
 
@@ -350,6 +376,32 @@ RedexContext::ConcurrentStringStorage::Context::~Context() {
   }
 }
 
+void* RedexContext::ObjectStorage::allocate() {
+  if (free_slots.load() != 0) {
+    std::lock_guard<std::mutex> lock(free_lock);
+    if (free_list != nullptr) {
+      void* slot = free_list;
+      free_list = *static_cast<void**>(slot);
+      free_slots--;
+      reused++;
+      return slot;
+    }
+  }
+  auto storage_context = buffers.get_context();
+  return storage_context.container->allocate(object_size);
+}
+
+bool RedexContext::ObjectStorage::release(void* slot) {
+  if (!recycle) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(free_lock);
+  *static_cast<void**>(slot) = free_list;
+  free_list = slot;
+  free_slots++;
+  return true;
+}
+
 const DexString* RedexContext::make_string(std::string_view str) {
   // We are creating a DexString key that is just "defined enough" to be used as
   // a key into our string set. The provided string does not have to be zero
@@ -463,7 +515,8 @@ DexFieldRef* RedexContext::make_field(const DexType* container,
   if (rv != nullptr) {
     return rv;
   }
-  std::unique_ptr<DexField> field(new DexField(
+  void* storage = s_field_storage.allocate();
+  std::unique_ptr<DexField> field(new (storage) DexField(
       const_cast<DexType*>(container), name, const_cast<DexType*>(type)));
   return try_insert<DexField, DexFieldRef>(r, std::move(field), &s_field_map);
 }
@@ -489,6 +542,14 @@ void RedexContext::alias_field_name(DexFieldRef* field,
   s_field_map.emplace(r, field);
 }
 
+void RedexContext::release_field_storage(void* storage) {
+  if (s_field_storage.release(storage)) {
+    // The next field may get the same address; it must not find the cached
+    // resolutions of the deleted one.
+    m_resolver_cache->invalidate();
+  }
+}
+
 void RedexContext::erase_field(DexFieldRef* field) {
   s_field_map.erase(field->m_spec);
 }
@@ -592,8 +653,9 @@ DexMethodRef* RedexContext::make_method(const DexType* type_,
   if (rv != nullptr) {
     return rv;
   }
+  void* storage = s_method_storage.allocate();
   std::unique_ptr<DexMethod, DexMethod::Deleter> method(
-      new DexMethod(type, name, proto));
+      new (storage) DexMethod(type, name, proto));
   return try_insert<DexMethod, DexMethodRef>(r, std::move(method),
                                              &s_method_map);
 }
@@ -619,6 +681,13 @@ void RedexContext::alias_method_name(DexMethodRef* method,
   s_method_map.emplace(r, method);
 }
 
+void RedexContext::release_method_storage(void* storage) {
+  if (s_method_storage.release(storage)) {
+    // See release_field_storage.
+    m_resolver_cache->invalidate();
+  }
+}
+
 void RedexContext::erase_method(DexMethodRef* method) {
   s_method_map.erase(method->m_spec);
   // Also remove the alias from the map
@@ -802,6 +871,7 @@ void RedexContext::publish_class(DexClass* cls) {
   if (cls->is_external()) {
     m_external_classes.emplace_back(cls);
   }
+  m_resolver_cache->invalidate();
 }
 
 DexClass* RedexContext::type_class(const DexType* t) {
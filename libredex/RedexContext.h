@@ -16,6 +16,7 @@
 #include <limits>
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <set>
 #include <sstream>
@@ -41,6 +42,10 @@ class DexProto;
 class DexString;
 class DexType;
 class DexTypeList;
+class HierarchyCache;
+class PuritySummaryStore;
+class ResolverCache;
+class ReferenceJournal;
 class PositionPatternSwitchManager;
 struct DexDebugEntry;
 struct DexFieldSpec;
@@ -96,6 +101,8 @@ struct RedexContext {
   void erase_field(const DexType* container,
                    const DexString* name,
                    const DexType* type);
+  // Takes back the storage of a deleted DexField for reuse.
+  void release_field_storage(void* storage);
   void mutate_field(DexFieldRef* field,
                     const DexFieldSpec& ref,
                     bool rename_on_collision);
@@ -130,6 +137,8 @@ struct RedexContext {
   void erase_method(const DexType* type,
                     const DexString* name,
                     const DexProto* proto);
+  // Takes back the storage of a deleted DexMethod for reuse.
+  void release_method_storage(void* storage);
   void mutate_method(DexMethodRef* method,
                      const DexMethodSpec& new_spec,
                      bool rename_on_collision);
@@ -141,6 +150,22 @@ struct RedexContext {
 
   PositionPatternSwitchManager* get_position_pattern_switch_manager();
 
+  // Class hierarchy and method override graph shared across passes.
+  HierarchyCache* get_hierarchy_cache() { return m_hierarchy_cache.get(); }
+
+  // Methods whose references changed since they were last looked at.
+  ReferenceJournal* get_reference_journal() {
+    return m_reference_journal.get();
+  }
+
+  // Method and field resolutions shared by all callers.
+  ResolverCache* get_resolver_cache() { return m_resolver_cache.get(); }
+
+  // Side-effect summaries of methods, shared across passes.
+  PuritySummaryStore* get_purity_summaries() {
+    return m_purity_summaries.get();
+  }
+
   // Return false on unique classes
   // Return true on benign duplicate classes
   // Throw RedexException on problematic duplicate classes
@@ -296,6 +321,26 @@ struct RedexContext {
     }
   };
 
+  // Raw storage for objects of one size, carved out of ConcurrentStringStorage
+  // buffers. The slots of deleted objects are linked into a free list through
+  // their first word and handed out again before the buffers grow.
+  struct ObjectStorage {
+    const size_t object_size;
+    ConcurrentStringStorage buffers;
+    std::mutex free_lock;
+    void* free_list{nullptr};
+    std::atomic<size_t> free_slots{0};
+    std::atomic<size_t> reused{0};
+    // Cleared while the context is torn down, when slots are not reused.
+    bool recycle{true};
+    ObjectStorage(size_t object_size, size_t max_containers)
+        : object_size(object_size),
+          buffers{1 << 20, object_size, max_containers} {}
+    void* allocate();
+    // Returns whether the slot will be reused.
+    bool release(void* slot);
+  };
+
   // Hashing is expensive on large strings (long Java type names, string
   // literals), so we avoid using `std::unordered_map` directly.
   //
@@ -372,6 +417,10 @@ struct RedexContext {
   ConcurrentStringStorage s_medium_string_storage;
   ConcurrentStringStorage s_large_string_storage;
 
+  // Raw storage for DexField and DexMethod objects, see LAYOUT in DexClass.h
+  ObjectStorage s_field_storage;
+  ObjectStorage s_method_storage;
+
   // DexType
   ConcurrentMap<const DexString*, DexType*> s_type_map;
 
@@ -424,6 +473,11 @@ struct RedexContext {
   // DexPositionSwitch and DexPositionPattern
   PositionPatternSwitchManager* m_position_pattern_switch_manager{nullptr};
 
+  std::unique_ptr<HierarchyCache> m_hierarchy_cache;
+  std::unique_ptr<ReferenceJournal> m_reference_journal;
+  std::unique_ptr<ResolverCache> m_resolver_cache;
+  std::unique_ptr<PuritySummaryStore> m_purity_summaries;
+
   // Type-to-class map
   std::mutex m_type_system_mutex;
   std::unordered_map<const DexType*, DexClass*> m_type_to_class;
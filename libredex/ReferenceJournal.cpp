@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ReferenceJournal.h"
+
+bool ReferenceJournal::take(std::unordered_set<const DexMethod*>* changed) {
+  changed->clear();
+  bool complete = m_complete.exchange(true);
+  if (complete) {
+    changed->insert(m_changed.begin(), m_changed.end());
+  }
+  m_changed.clear();
+  return complete;
+}
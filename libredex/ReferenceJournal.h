@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <unordered_set>
+
+#include "ConcurrentContainers.h"
+
+class DexMethod;
+
+/*
+ * Records the methods whose references passes have added or removed, by
+ * editing their code or annotations, so that per-method facts computed by one
+ * pass can be reused by a later one for all other methods. It is owned by the
+ * RedexContext, see `g_redex->get_reference_journal()`. See the incremental
+ * mode of RemoveUnreachablePass for a consumer.
+ *
+ * Recording is opt-in: after each pass that does not declare, via
+ * Pass::records_reference_changes(), that it records all the methods it
+ * changes, PassManager marks the journal as incomplete, and consumers then
+ * start from scratch. Adding or removing whole classes and members does not
+ * need to be recorded, only changes to the references of existing methods.
+ */
+class ReferenceJournal {
+ public:
+  // Records that the references made by `method` may have changed.
+  void record(const DexMethod* method) { m_changed.insert(method); }
+
+  // Records that references may have changed in ways that were not recorded.
+  void record_untracked() { m_complete = false; }
+
+  /*
+   * Moves the recorded methods into `changed` and starts a new, complete
+   * journal. Returns false if the journal was incomplete, in which case
+   * `changed` is left empty.
+   */
+  bool take(std::unordered_set<const DexMethod*>* changed);
+
+ private:
+  ConcurrentSet<const DexMethod*> m_changed;
+  // Nothing is known about what happened before the first consumer ran.
+  std::atomic<bool> m_complete{false};
+};
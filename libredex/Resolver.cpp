@@ -7,6 +7,8 @@
 
 #include "Resolver.h"
 #include "DexUtil.h"
+#include "RedexContext.h"
+#include "ResolverCache.h"
 
 namespace {
 
@@ -117,6 +119,21 @@ DexMethod* resolve_method_ref(const DexClass* cls,
   return nullptr;
 }
 
+DexMethod* resolve_method_ref(DexMethodRef* method, MethodSearch search) {
+  auto* cache = g_redex->get_resolver_cache();
+  DexMethod* def;
+  if (cache->get(method, search, &def)) {
+    return def;
+  }
+  auto epoch = cache->epoch();
+  auto cls = type_class(method->get_class());
+  def = cls == nullptr ? nullptr
+                       : resolve_method_ref(cls, method->get_name(),
+                                            method->get_proto(), search);
+  cache->put(method, search, epoch, def);
+  return def;
+}
+
 DexField* resolve_field(const DexType* owner,
                         const DexString* name,
                         const DexType* type,
@@ -178,3 +195,16 @@ DexMethod* find_top_intf_impl(const DexClass* cls,
   }
   return top_impl;
 }
+
+DexField* resolve_field_ref(const DexFieldRef* field, FieldSearch search) {
+  auto* cache = g_redex->get_resolver_cache();
+  DexField* def;
+  if (cache->get(field, search, &def)) {
+    return def;
+  }
+  auto epoch = cache->epoch();
+  def = resolve_field(field->get_class(), field->get_name(), field->get_type(),
+                      search);
+  cache->put(field, search, epoch, def);
+  return def;
+}
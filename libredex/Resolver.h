@@ -180,6 +180,13 @@ DexMethod* resolve_method_ref(const DexClass* cls,
                               const DexProto* proto,
                               MethodSearch search);
 
+/**
+ * Resolve a method ref that is not a definition, starting from the super of
+ * its class as above. Results are cached in the RedexContext's ResolverCache.
+ * The search must not be MethodSearch::Super.
+ */
+DexMethod* resolve_method_ref(DexMethodRef* method, MethodSearch search);
+
 /**
  * Resolve a method to its definition. When searching for a definition of a
  * virtual callsite, we return one of the possible callees.
@@ -216,10 +223,7 @@ inline DexMethod* resolve_method(DexMethodRef* method,
   if (m) {
     return m;
   }
-  auto cls = type_class(method->get_class());
-  if (cls == nullptr) return nullptr;
-  return resolve_method_ref(cls, method->get_name(), method->get_proto(),
-                            search);
+  return resolve_method_ref(method, search);
 }
 
 /**
@@ -317,6 +321,12 @@ DexField* resolve_field(const DexType*,
                         const DexType*,
                         FieldSearch = FieldSearch::Any);
 
+/**
+ * Resolve a field ref that is not a definition. Results are cached in the
+ * RedexContext's ResolverCache.
+ */
+DexField* resolve_field_ref(const DexFieldRef* field, FieldSearch search);
+
 /**
  * Given a field, search its class hierarchy for the definition.
  * If the field is a definition already the field is returned otherwise a
@@ -327,8 +337,7 @@ inline DexField* resolve_field(const DexFieldRef* field,
   if (field->is_def()) {
     return const_cast<DexField*>(static_cast<const DexField*>(field));
   }
-  return resolve_field(field->get_class(), field->get_name(), field->get_type(),
-                       search);
+  return resolve_field_ref(field, search);
 }
 
 struct ConcurrentMethodResolver {
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "ResolverCache.h"
+
+void ResolverCache::count(size_t hash, bool hit) const {
+  auto& counters = m_counters[hash % kNumCounters];
+  (hit ? counters.hits : counters.misses)
+      .fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ResolverCache::get(DexMethodRef* method,
+                        MethodSearch search,
+                        DexMethod** def) const {
+  MethodRefCacheKey key{method, search};
+  auto entry = m_methods.get(key, Entry<DexMethod>());
+  bool hit = entry.epoch == epoch();
+  count(MethodRefCacheKeyHash()(key), hit);
+  if (hit) {
+    *def = entry.def;
+  }
+  return hit;
+}
+
+void ResolverCache::put(DexMethodRef* method,
+                        MethodSearch search,
+                        uint64_t epoch,
+                        DexMethod* def) {
+  m_methods.insert_or_assign(
+      std::make_pair(MethodRefCacheKey{method, search},
+                     Entry<DexMethod>{epoch, def}));
+}
+
+bool ResolverCache::get(const DexFieldRef* field,
+                        FieldSearch search,
+                        DexField** def) const {
+  FieldKey key{field, search};
+  auto entry = m_fields.get(key, Entry<DexField>());
+  bool hit = entry.epoch == epoch();
+  count(FieldKeyHash()(key), hit);
+  if (hit) {
+    *def = entry.def;
+  }
+  return hit;
+}
+
+void ResolverCache::put(const DexFieldRef* field,
+                        FieldSearch search,
+                        uint64_t epoch,
+                        DexField* def) {
+  m_fields.insert_or_assign(
+      std::make_pair(FieldKey{field, search}, Entry<DexField>{epoch, def}));
+}
+
+ResolverCache::Stats ResolverCache::get_stats() const {
+  Stats stats;
+  for (const auto& counters : m_counters) {
+    stats.hits += counters.hits.load(std::memory_order_relaxed);
+    stats.misses += counters.misses.load(std::memory_order_relaxed);
+  }
+  return stats;
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "ConcurrentContainers.h"
+#include "Resolver.h"
+
+/*
+ * Caches the results of resolve_method and resolve_field for refs that are not
+ * definitions, across all callers and passes. It is owned by the RedexContext,
+ * see `g_redex->get_resolver_cache()`.
+ *
+ * Every entry is tagged with the hierarchy epoch it was computed in, and only
+ * used while that epoch is current. The epoch is bumped, via invalidate(), by
+ * everything that can change a resolution: publishing classes, re-parenting
+ * them, adding or removing their members, changing member refs, deleting
+ * refs, whose addresses are reused, and by the PassManager after every pass. Code that adds or removes members through the
+ * mutable member lists of a class must call invalidate() itself, as the
+ * reachability sweep, DelInit, FinalInline and the enum transformer do.
+ */
+class ResolverCache {
+ public:
+  struct Stats {
+    size_t hits{0};
+    size_t misses{0};
+  };
+
+  // Starts a new hierarchy epoch, invalidating all cached resolutions.
+  void invalidate() { m_epoch.fetch_add(1, std::memory_order_acq_rel); }
+
+  // The epoch to tag a resolution with; must be read before resolving.
+  uint64_t epoch() const { return m_epoch.load(std::memory_order_acquire); }
+
+  bool get(DexMethodRef* method, MethodSearch search, DexMethod** def) const;
+  void put(DexMethodRef* method,
+           MethodSearch search,
+           uint64_t epoch,
+           DexMethod* def);
+
+  bool get(const DexFieldRef* field, FieldSearch search, DexField** def) const;
+  void put(const DexFieldRef* field,
+           FieldSearch search,
+           uint64_t epoch,
+           DexField* def);
+
+  Stats get_stats() const;
+
+ private:
+  template <typename Def>
+  struct Entry {
+    uint64_t epoch{0};
+    Def* def{nullptr};
+  };
+
+  struct FieldKey {
+    const DexFieldRef* field;
+    FieldSearch search;
+
+    bool operator==(const FieldKey& other) const {
+      return field == other.field && search == other.search;
+    }
+  };
+
+  struct FieldKeyHash {
+    size_t operator()(const FieldKey& key) const {
+      size_t seed = 0;
+      boost::hash_combine(seed, key.field);
+      boost::hash_combine(seed, key.search);
+      return seed;
+    }
+  };
+
+  // Hit and miss counts are striped by key so that concurrent lookups do not
+  // all contend on the same cache line.
+  struct alignas(64) Counters {
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+  };
+  static constexpr size_t kNumCounters = 16;
+
+  void count(size_t hash, bool hit) const;
+
+  ConcurrentMap<MethodRefCacheKey, Entry<DexMethod>, MethodRefCacheKeyHash>
+      m_methods;
+  ConcurrentMap<FieldKey, Entry<DexField>, FieldKeyHash> m_fields;
+  // Entries default to epoch 0, which is never current.
+  std::atomic<uint64_t> m_epoch{1};
+  mutable std::array<Counters, kNumCounters> m_counters;
+};
@@ -28,7 +28,8 @@ namespace mog = method_override_graph;
 namespace {
 
 size_t mark_classes_final(const Scope& scope) {
-  ClassHierarchy ch = build_type_hierarchy(scope);
+  auto ch_ptr = get_or_build_type_hierarchy(scope);
+  const auto& ch = *ch_ptr;
   size_t n_classes_finalized = 0;
   for (auto const& cls : scope) {
     if (!can_rename(cls) || is_abstract(cls) || is_final(cls)) {
@@ -190,7 +191,7 @@ void AccessMarkingPass::run_pass(DexStoresVector& stores,
                                  ConfigFiles& /* conf */,
                                  PassManager& pm) {
   auto scope = build_class_scope(stores);
-  auto override_graph = mog::build_graph(scope);
+  auto override_graph = mog::get_or_build_graph(scope);
   if (m_finalize_classes) {
     auto n_classes_final = mark_classes_final(scope);
     pm.incr_metric("finalized_classes", n_classes_final);
@@ -7,13 +7,17 @@
 
 #include "ClassMergingPass.h"
 
+#include <memory>
+
 #include "ClassAssemblingUtils.h"
 #include "ClassMerging.h"
 #include "ConfigFiles.h"
 #include "ConfigUtils.h"
 #include "DexUtil.h"
+#include "MergeabilityCheck.h"
 #include "MergingStrategies.h"
 #include "Show.h"
+#include "Timer.h"
 #include "Trace.h"
 
 using namespace class_merging;
@@ -126,6 +130,9 @@ void ClassMergingPass::bind_config() {
   bind("process_method_meta", false, process_method_meta);
   int64_t max_num_dispatch_target;
   bind("max_num_dispatch_target", 0, max_num_dispatch_target);
+  bind("share_mergeability_scan", false, m_share_mergeability_scan,
+       "Scan the code for the bytecode non-mergeables of all models once, "
+       "instead of once per model.");
   trait(Traits::Pass::unique, true);
 
   // load model specifications
@@ -288,6 +295,11 @@ void ClassMergingPass::run_pass(DexStoresVector& stores,
   }
 
   auto scope = build_class_scope(stores);
+  std::unique_ptr<MergeabilityFacts> facts;
+  if (m_share_mergeability_scan) {
+    Timer t("collect_mergeability_facts");
+    facts = std::make_unique<MergeabilityFacts>(scope);
+  }
   ModelStats total_stats;
   for (ModelSpec& model_spec : m_model_specs) {
     if (!model_spec.enabled) {
@@ -300,7 +312,8 @@ void ClassMergingPass::run_pass(DexStoresVector& stores,
       model_spec.include_primary_dex = true;
     }
     total_stats +=
-        class_merging::merge_model(scope, conf, mgr, stores, model_spec);
+        class_merging::merge_model(scope, conf, mgr, stores, model_spec,
+                                   facts.get());
   }
   post_dexen_changes(scope, stores);
   total_stats.update_redex_stats(" total", mgr);
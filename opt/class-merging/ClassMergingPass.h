@@ -45,6 +45,7 @@ class ClassMergingPass : public Pass {
   std::string m_merged_type_mapping_file;
   std::vector<ModelSpec> m_model_specs;
   boost::optional<size_t> m_max_num_dispatch_target = boost::none;
+  bool m_share_mergeability_scan{false};
 };
 
 } // namespace class_merging
@@ -128,7 +128,7 @@ std::unique_ptr<FixpointIterator> PassImpl::analyze(
     const Scope& scope,
     const ImmutableAttributeAnalyzerState* immut_analyzer_state,
     const ApiLevelAnalyzerState* api_level_analyzer_state) {
-  auto method_override_graph = mog::build_graph(scope);
+  auto method_override_graph = mog::get_or_build_graph(scope);
   std::shared_ptr<call_graph::Graph> cg;
   {
     cg = m_config.use_multiple_callee_callgraph
@@ -15,10 +15,20 @@
 using namespace copy_propagation_impl;
 
 void CopyPropagationPass::run_pass(DexStoresVector& stores,
-                                   ConfigFiles& /* unused */,
+                                   ConfigFiles& conf,
                                    PassManager& mgr) {
-  auto scope = build_class_scope(stores);
+  if (!m_config.debug) {
+    MethodPassWithStats::run_pass(stores, conf, mgr);
+    return;
+  }
+  // Runs single-threaded and type-checks every method.
+  prepare(stores, conf, mgr);
+  report(m_impl->run(build_class_scope(stores)), mgr);
+}
 
+void CopyPropagationPass::prepare(DexStoresVector& /* stores */,
+                                  ConfigFiles& /* unused */,
+                                  PassManager& mgr) {
   if (m_config.eliminate_const_literals &&
       !mgr.get_redex_options().verify_none_enabled) {
     // This option is not safe with the verifier
@@ -30,8 +40,16 @@ void CopyPropagationPass::run_pass(DexStoresVector& stores,
   }
   m_config.regalloc_has_run = mgr.regalloc_has_run();
 
-  CopyPropagation impl(m_config);
-  auto stats = impl.run(scope);
+  m_impl = std::make_unique<CopyPropagation>(m_config);
+}
+
+Stats CopyPropagationPass::process_method(DexMethod* method,
+                                          cfg::ControlFlowGraph& /* cfg */) {
+  return m_impl->run(method->get_code(), method);
+}
+
+void CopyPropagationPass::report(const Stats& stats, PassManager& mgr) {
+  m_impl.reset();
   mgr.incr_metric("redundant_moves_eliminated", stats.moves_eliminated);
   mgr.incr_metric("source_regs_replaced_with_representative",
                   stats.replaced_sources);
@@ -7,12 +7,15 @@
 
 #pragma once
 
+#include <memory>
+
 #include "CopyPropagation.h"
-#include "Pass.h"
+#include "MethodPass.h"
 
-class CopyPropagationPass : public Pass {
+class CopyPropagationPass
+    : public MethodPassWithStats<copy_propagation_impl::Stats> {
  public:
-  CopyPropagationPass() : Pass("CopyPropagationPass") {}
+  CopyPropagationPass() : MethodPassWithStats("CopyPropagationPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -28,7 +31,13 @@ class CopyPropagationPass : public Pass {
   }
 
   bool is_cfg_legacy() override { return true; }
+  // In debug mode, methods are processed one at a time, see run_pass().
+  bool is_fusible() const override { return !m_config.debug; }
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void prepare(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  copy_propagation_impl::Stats process_method(DexMethod*,
+                                              cfg::ControlFlowGraph&) override;
+  void report(const copy_propagation_impl::Stats&, PassManager&) override;
 
   void bind_config() override {
     // This option can only be safely enabled in verify-none. `run_pass` will
@@ -58,4 +67,7 @@ class CopyPropagationPass : public Pass {
   }
 
   copy_propagation_impl::Config m_config;
+
+ private:
+  std::unique_ptr<copy_propagation_impl::CopyPropagation> m_impl;
 };
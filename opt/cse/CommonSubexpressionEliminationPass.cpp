@@ -8,11 +8,15 @@
 #include "CommonSubexpressionEliminationPass.h"
 
 #include "CommonSubexpressionElimination.h"
+#include "ConcurrentContainers.h"
 #include "ConfigFiles.h"
 #include "CopyPropagation.h"
 #include "DexUtil.h"
 #include "LocalDce.h"
 #include "Purity.h"
+#include "PuritySummaryStore.h"
+#include "RedexContext.h"
+#include "ReferenceJournal.h"
 #include "Show.h"
 #include "Walkers.h"
 
@@ -72,7 +76,8 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
       [&](const DexType* type) {
         return !init_classes_with_side_effects.refine(type);
       };
-  shared_state.init_scope(scope, clinit_has_no_side_effects);
+  PuritySummaryKey summary_key{name()};
+  shared_state.init_scope(scope, clinit_has_no_side_effects, &summary_key);
 
   // The following default 'features' of copy propagation would only
   // interfere with what CSE is trying to do.
@@ -80,6 +85,7 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
   copy_prop_config.eliminate_const_classes = false;
   copy_prop_config.eliminate_const_strings = false;
   copy_prop_config.static_finals = false;
+  ConcurrentSet<const DexMethod*> edited_methods;
   const auto stats = walk::parallel::methods<Stats>(
       scope,
       [&](DexMethod* method) {
@@ -109,6 +115,8 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
             code->clear_cfg();
             return stats;
           }
+          g_redex->get_reference_journal()->record(method);
+          edited_methods.insert(method);
 
           copy_propagation_impl::CopyPropagation copy_propagation(
               copy_prop_config);
@@ -127,6 +135,7 @@ void CommonSubexpressionEliminationPass::run_pass(DexStoresVector& stores,
         }
       },
       m_debug ? 1 : redex_parallel::default_num_threads());
+  g_redex->get_purity_summaries()->invalidate(edited_methods);
   mgr.incr_metric(METRIC_RESULTS_CAPTURED, stats.results_captured);
   mgr.incr_metric(METRIC_STORES_CAPTURED, stats.stores_captured);
   mgr.incr_metric(METRIC_ARRAY_LENGTHS_CAPTURED, stats.array_lengths_captured);
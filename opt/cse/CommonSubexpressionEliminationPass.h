@@ -29,6 +29,7 @@ class CommonSubexpressionEliminationPass : public Pass {
   void bind_config() override;
 
   bool is_cfg_legacy() override { return true; }
+  bool records_reference_changes() const override { return true; }
 
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
@@ -20,7 +20,9 @@
 #include "IRInstruction.h"
 #include "PassManager.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "Resolver.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -553,6 +555,8 @@ int DeadRefs::remove_unreachable(Scope& scope) {
       local_stats.emplace(cls, stats);
     }
   });
+  // Virtual methods and fields were erased directly from their classes.
+  g_redex->get_resolver_cache()->invalidate();
   LocalStats acc;
   for (auto& p : local_stats) {
     acc.vmethodcnt += p.second.vmethodcnt;
@@ -24,7 +24,9 @@
 #include "IRCode.h"
 #include "PassManager.h"
 #include "ReachableClasses.h"
+#include "RedexContext.h"
 #include "Resolver.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "Walkers.h"
 
@@ -152,6 +154,8 @@ class FinalInlineImpl {
                                    }),
                     sfields.end());
     }
+    // The fields were erased directly from their classes.
+    g_redex->get_resolver_cache()->invalidate();
     return smallscope.size();
   }
 
@@ -204,7 +204,7 @@ class InitClassFields {
     auto field = DexField::make_field(type, m_field_name, type)
                      ->make_concrete(ACC_PUBLIC | ACC_STATIC | ACC_FINAL);
     field->rstate.set_root();
-    insert_sorted(cls->get_sfields(), field, compare_dexfields);
+    cls->add_field(field);
     field->set_deobfuscated_name(show_deobfuscated(field));
     m_fields_added++;
     return field;
@@ -9,6 +9,7 @@
 
 #include "ConfigFiles.h"
 #include "DexClass.h"
+#include "DexSizeEstimator.h"
 #include "DexUtil.h"
 #include "PassManager.h"
 #include "Show.h"
@@ -175,6 +176,13 @@ void InterDexPass::run_pass(
     mgr.set_metric(key_prefix + "scroll", info.scroll);
     mgr.set_metric(key_prefix + "background", info.background);
     mgr.set_metric(key_prefix + "betamap_ordered", info.betamap_ordered);
+    DexSizeEstimator size_estimator;
+    for (auto* cls : dexen[i]) {
+      size_estimator.add_class(cls);
+    }
+    mgr.set_metric(key_prefix + "estimated_bytes", size_estimator.get_size());
+    mgr.set_metric(key_prefix + "estimated_compressed_bytes",
+                   size_estimator.get_compressed_size());
   }
 
   auto final_scope = build_class_scope(stores);
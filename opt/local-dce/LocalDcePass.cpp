@@ -24,6 +24,9 @@
 #include "MethodOverrideGraph.h"
 #include "PassManager.h"
 #include "Purity.h"
+#include "PuritySummaryStore.h"
+#include "RedexContext.h"
+#include "ReferenceJournal.h"
 #include "Resolver.h"
 #include "StlUtil.h"
 #include "Trace.h"
@@ -56,45 +59,46 @@ constexpr const char* METRIC_INIT_CLASS_INSTRUCTIONS_REFINED =
 
 } // namespace
 
-void LocalDcePass::run_pass(DexStoresVector& stores,
-                            ConfigFiles& conf,
-                            PassManager& mgr) {
+void LocalDcePass::prepare(DexStoresVector& stores,
+                           ConfigFiles& conf,
+                           PassManager& mgr) {
   auto scope = build_class_scope(stores);
 
-  auto pure_methods = get_pure_methods();
+  m_pure_methods = get_pure_methods();
   auto configured_pure_methods = conf.get_pure_methods();
-  pure_methods.insert(configured_pure_methods.begin(),
-                      configured_pure_methods.end());
+  m_pure_methods.insert(configured_pure_methods.begin(),
+                        configured_pure_methods.end());
   auto immutable_getters = get_immutable_getters(scope);
-  pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
-  std::unique_ptr<const method_override_graph::Graph> override_graph;
+  m_pure_methods.insert(immutable_getters.begin(), immutable_getters.end());
   if (!mgr.unreliable_virtual_scopes()) {
-    override_graph = method_override_graph::build_graph(scope);
+    m_override_graph = method_override_graph::get_or_build_graph(scope);
   }
-  std::unique_ptr<init_classes::InitClassesWithSideEffects>
-      init_classes_with_side_effects;
   if (!mgr.init_class_lowering_has_run()) {
-    init_classes_with_side_effects =
+    m_init_classes_with_side_effects =
         std::make_unique<init_classes::InitClassesWithSideEffects>(
-            scope, conf.create_init_class_insns(), override_graph.get());
+            scope, conf.create_init_class_insns(), m_override_graph.get());
   }
 
   std::unordered_set<const DexMethod*> computed_no_side_effects_methods;
-  size_t computed_no_side_effects_methods_iterations = 0;
+  m_computed_no_side_effects_methods_iterations = 0;
   if (!mgr.unreliable_virtual_scopes()) {
     method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
         [&](const DexType* type) {
-          return !init_classes_with_side_effects ||
-                 !init_classes_with_side_effects->refine(type);
+          return !m_init_classes_with_side_effects ||
+                 !m_init_classes_with_side_effects->refine(type);
         };
-    computed_no_side_effects_methods_iterations =
+    // The clinit predicate only depends on whether init-classes are tracked.
+    PuritySummaryKey summary_key{
+        "LocalDcePass", {m_init_classes_with_side_effects != nullptr}};
+    m_computed_no_side_effects_methods_iterations =
         compute_no_side_effects_methods(
-            scope, override_graph.get(), clinit_has_no_side_effects,
-            pure_methods, &computed_no_side_effects_methods);
+            scope, m_override_graph.get(), clinit_has_no_side_effects,
+            m_pure_methods, &computed_no_side_effects_methods, &summary_key);
     for (auto m : computed_no_side_effects_methods) {
-      pure_methods.insert(const_cast<DexMethod*>(m));
+      m_pure_methods.insert(const_cast<DexMethod*>(m));
     }
   }
+  m_computed_no_side_effects_methods = computed_no_side_effects_methods.size();
 
   if (mgr.materialize_nullchecks_has_run()) {
     // If MaterializeNullchecksPass is run,
@@ -104,32 +108,42 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
     DexMethodRef* getClassRef = DexMethod::get_method(
         "Ljava/lang/Object;.getClass:()Ljava/lang/Class;");
     if (getClassRef != nullptr) {
-      pure_methods.erase(getClassRef);
+      m_pure_methods.erase(getClassRef);
     }
   }
 
-  bool may_allocate_registers = !mgr.regalloc_has_run();
-  if (!may_allocate_registers) {
+  m_may_allocate_registers = !mgr.regalloc_has_run();
+  if (!m_may_allocate_registers) {
     // compute_no_side_effects_methods might have found methods that have no
     // implementors. Let's not silently remove invocations to those in LocalDce,
     // as invoking them *will* unconditionally cause an exception.
-    std20::erase_if(pure_methods, [&](auto* m) {
-      return m->is_def() && !has_implementor(override_graph.get(), m->as_def());
+    std20::erase_if(m_pure_methods, [&](auto* m) {
+      return m->is_def() &&
+             !has_implementor(m_override_graph.get(), m->as_def());
     });
   }
+}
 
-  auto stats =
-      walk::parallel::methods<LocalDce::Stats>(scope, [&](DexMethod* m) {
-        auto* code = m->get_code();
-        if (code == nullptr || m->rstate.no_optimizations()) {
-          return LocalDce::Stats();
-        }
-
-        LocalDce ldce(init_classes_with_side_effects.get(), pure_methods,
-                      override_graph.get(), may_allocate_registers);
-        ldce.dce(code, /* normalize_new_instances */ true, m->get_class());
-        return ldce.get_stats();
-      });
+LocalDce::Stats LocalDcePass::process_method(DexMethod* method,
+                                             cfg::ControlFlowGraph& cfg) {
+  LocalDce ldce(m_init_classes_with_side_effects.get(), m_pure_methods,
+                m_override_graph.get(), m_may_allocate_registers);
+  ldce.dce(cfg, /* normalize_new_instances */ true, method->get_class());
+  const auto& stats = ldce.get_stats();
+  if (stats.npe_instruction_count || stats.init_class_instructions_added ||
+      stats.dead_instruction_count || stats.unreachable_instruction_count ||
+      stats.aliased_new_instances || stats.normalized_new_instances ||
+      stats.init_classes.init_class_instructions_removed ||
+      stats.init_classes.init_class_instructions_refined) {
+    g_redex->get_reference_journal()->record(method);
+    m_edited_methods.insert(method);
+  }
+  return stats;
+}
+
+void LocalDcePass::report(const LocalDce::Stats& stats, PassManager& mgr) {
+  g_redex->get_purity_summaries()->invalidate(m_edited_methods);
+  m_edited_methods.clear();
   mgr.incr_metric(METRIC_NPE_INSTRUCTIONS, stats.npe_instruction_count);
   mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_ADDED,
                   stats.init_class_instructions_added);
@@ -140,9 +154,9 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
                   stats.normalized_new_instances);
   mgr.incr_metric(METRIC_ALIASED_NEW_INSTANCES, stats.aliased_new_instances);
   mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS,
-                  computed_no_side_effects_methods.size());
+                  m_computed_no_side_effects_methods);
   mgr.incr_metric(METRIC_COMPUTED_NO_SIDE_EFFECTS_METHODS_ITERATIONS,
-                  computed_no_side_effects_methods_iterations);
+                  m_computed_no_side_effects_methods_iterations);
   mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS,
                   stats.init_classes.init_class_instructions);
   mgr.incr_metric(METRIC_INIT_CLASS_INSTRUCTIONS_REMOVED,
@@ -157,6 +171,10 @@ void LocalDcePass::run_pass(DexStoresVector& stores,
         stats.init_class_instructions_added,
         stats.unreachable_instruction_count, stats.normalized_new_instances,
         stats.aliased_new_instances);
+
+  m_pure_methods.clear();
+  m_override_graph.reset();
+  m_init_classes_with_side_effects.reset();
 }
 
 static LocalDcePass s_pass;
@@ -7,12 +7,16 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_set>
+
+#include "ConcurrentContainers.h"
 #include "LocalDce.h"
-#include "Pass.h"
+#include "MethodPass.h"
 
-class LocalDcePass : public Pass {
+class LocalDcePass : public MethodPassWithStats<LocalDce::Stats> {
  public:
-  LocalDcePass() : Pass("LocalDcePass") {}
+  LocalDcePass() : MethodPassWithStats("LocalDcePass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -26,5 +30,24 @@ class LocalDcePass : public Pass {
   }
 
   bool is_cfg_legacy() override { return true; }
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  bool records_reference_changes() const override { return true; }
+  void prepare(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  bool should_visit(const DexMethod* method) const override {
+    return !method->rstate.no_optimizations();
+  }
+  LocalDce::Stats process_method(DexMethod*, cfg::ControlFlowGraph&) override;
+  void report(const LocalDce::Stats&, PassManager&) override;
+
+ private:
+  // Computed by prepare() for process_method().
+  std::unordered_set<DexMethodRef*> m_pure_methods;
+  std::shared_ptr<const method_override_graph::Graph> m_override_graph;
+  std::unique_ptr<init_classes::InitClassesWithSideEffects>
+      m_init_classes_with_side_effects;
+  bool m_may_allocate_registers{true};
+  size_t m_computed_no_side_effects_methods{0};
+  size_t m_computed_no_side_effects_methods_iterations{0};
+  // The methods changed by process_method(), whose purity summaries report()
+  // invalidates all at once.
+  ConcurrentSet<const DexMethod*> m_edited_methods;
 };
@@ -14,7 +14,9 @@
 #include "EnumUpcastAnalysis.h"
 #include "Mutators.h"
 #include "OptData.h"
+#include "RedexContext.h"
 #include "Resolver.h"
+#include "ResolverCache.h"
 #include "Show.h"
 #include "StlUtil.h"
 #include "TypeReference.h"
@@ -1475,6 +1477,7 @@ class EnumTransformer final {
       }
       return this->is_generated_enum_method(method);
     });
+    g_redex->get_resolver_cache()->invalidate();
   }
 
   /**
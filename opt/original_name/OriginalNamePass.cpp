@@ -139,7 +139,7 @@ void OriginalNamePass::run_pass(DexStoresVector& stores,
         // These fields are accessed reflectively, so make sure we do not remove
         // them.
         f->rstate.set_root();
-        insert_sorted(cls->get_sfields(), f, compare_dexfields);
+        cls->add_field(f);
         f->set_deobfuscated_name(show_deobfuscated(f));
 
         if (!dex_limits.update_refs_by_adding_class(cls)) {
@@ -12,20 +12,15 @@
  *
  * At its core is a rather naive approach: check if any subsequence of
  * instructions in a block occurs sufficiently often. The average complexity is
- * held down by filtering out instruction sequences where adjacent sequences of
- * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
+ * held down by only exploring instruction sequences whose abstracted
+ * instructions ("cores") occur at least twice anywhere in the scope; a suffix
+ * array over the cores of all outlinable instructions gives, for each
+ * instruction, the length of the longest such sequence starting there.
  *
  * When reaching a conditional branch or switch instruction, different control-
  * paths are explored as well, as long as they eventually all arrive at a common
  * block. Thus, outline candidates are in fact instruction sequence trees.
  *
- * At its core is a rather naive approach: check if any subsequence of
- * instructions in a block occurs sufficiently often. The average complexity is
- * held down by filtering out instruction sequences where adjacent sequences of
- * abstracted instructions ("cores") of fixed lengths never occur twice anywhere
- * in the scope (seems good enough, even without a suffix tree).
- *
  * We gather existing method/type references in a dex and make sure that we
  * don't go beyond the limits when adding methods/types, effectively filling up
  * the available ref space created by IntraDexInline (minus other reservations).
@@ -65,6 +60,7 @@
 #include "InstructionSequenceOutliner.h"
 
 #include <algorithm>
+#include <limits>
 #include <list>
 #include <map>
 #include <memory>
@@ -107,6 +103,7 @@
 #include "Resolver.h"
 #include "Show.h"
 #include "StlUtil.h"
+#include "SuffixArray.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -136,7 +133,7 @@ const size_t COST_INVOKE_WITHOUT_RESULT = 3;
 const size_t MAX_ARGS = 5;
 
 // Minimum number of instructions to be outlined in a sequence, used in
-// definition of cores
+// pruning non-recurring sequences
 const size_t MIN_INSNS_SIZE = 3;
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -349,41 +346,11 @@ static CandidateInstructionCore to_core(IRInstruction* insn) {
   return core;
 }
 
-using CandidateInstructionCores =
-    std::array<CandidateInstructionCore, MIN_INSNS_SIZE>;
-using CandidateInstructionCoresHasher = boost::hash<CandidateInstructionCores>;
-using CandidateInstructionCoresSet =
-    std::unordered_set<CandidateInstructionCores,
-                       CandidateInstructionCoresHasher>;
-
-// The cores builder efficiently keeps track of the last MIN_INSNS_SIZE many
-// instructions.
-class CandidateInstructionCoresBuilder {
- public:
-  void push_back(IRInstruction* insn) {
-    m_buffer[m_start] = to_core(insn);
-    m_start = (m_start + 1) % MIN_INSNS_SIZE;
-    m_size = m_size < MIN_INSNS_SIZE ? m_size + 1 : MIN_INSNS_SIZE;
-  }
-
-  void clear() { m_size = 0; }
-
-  bool has_value() const { return m_size == MIN_INSNS_SIZE; }
-
-  CandidateInstructionCores get_value() {
-    always_assert(m_size == MIN_INSNS_SIZE);
-    CandidateInstructionCores res;
-    for (size_t i = 0; i < MIN_INSNS_SIZE; i++) {
-      res[i] = m_buffer.at((m_start + i) % MIN_INSNS_SIZE);
-    }
-    return res;
-  }
-
- private:
-  std::array<CandidateInstructionCore, MIN_INSNS_SIZE> m_buffer;
-  size_t m_start{0};
-  size_t m_size{0};
-};
+// For each outlinable instruction, the length of the longest sequence of
+// instruction cores starting at it that also occurs elsewhere, if that length
+// is at least MIN_INSNS_SIZE. Any recurring candidate sequence must be
+// comprised of such a recurring sequence of cores.
+using RecurringLengths = std::unordered_map<const IRInstruction*, size_t>;
 
 ////////////////////////////////////////////////////////////////////////////////
 // Normalization of partial candidate sequence to candidate sequence
@@ -811,14 +778,21 @@ static bool explore_candidates_from(
         reaching_initialized_init_first_param,
     const Config& config,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringLengths& recurring_lengths,
     PartialCandidate* pc,
     PartialCandidateNode* pcn,
     big_blocks::InstructionIterator it,
     const big_blocks::InstructionIterator& end,
     const ExploredCallback* explored_callback = nullptr) {
   boost::optional<IROpcode> prev_opcode;
-  CandidateInstructionCoresBuilder cores_builder;
+  size_t recurring_length = 0;
+  if (it != end) {
+    auto recurring_length_it = recurring_lengths.find(it->insn);
+    if (recurring_length_it != recurring_lengths.end()) {
+      recurring_length = recurring_length_it->second;
+    }
+  }
+  size_t explored_insns = 0;
   auto first_block = it.block();
   auto& cfg = first_block->cfg();
   for (; it != end; prev_opcode = it->insn->opcode(), it++) {
@@ -831,9 +805,8 @@ static bool explore_candidates_from(
                           insn, config.outline_control_flow)) {
       return false;
     }
-    cores_builder.push_back(insn);
-    if (cores_builder.has_value() &&
-        !recurring_cores.count(cores_builder.get_value())) {
+    if (++explored_insns >= MIN_INSNS_SIZE &&
+        explored_insns > recurring_length) {
       return false;
     }
     if (!append_to_partial_candidate(reaching_initialized_new_instances, insn,
@@ -873,8 +846,8 @@ static bool explore_candidates_from(
           auto succ_ii = big_blocks::InstructionIterable(*succ_big_block);
           if (!explore_candidates_from(reaching_initialized_new_instances,
                                        reaching_initialized_init_first_param,
-                                       config, ref_checker, recurring_cores, pc,
-                                       succ_pcn.get(), succ_ii.begin(),
+                                       config, ref_checker, recurring_lengths,
+                                       pc, succ_pcn.get(), succ_ii.begin(),
                                        succ_ii.end())) {
             return false;
           }
@@ -948,7 +921,7 @@ static MethodCandidates find_method_candidates(
     const CanOutlineBlockDecider& block_decider,
     DexMethod* method,
     cfg::ControlFlowGraph& cfg,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringLengths& recurring_lengths,
     FindCandidatesStats* stats) {
   MethodCandidates candidates;
   Lazy<LivenessFixpointIterator> liveness_fp_iter([&cfg] {
@@ -1172,7 +1145,7 @@ static MethodCandidates find_method_candidates(
       PartialCandidate pc;
       explore_candidates_from(reaching_initialized_new_instances,
                               reaching_initialized_init_first_param, config,
-                              ref_checker, recurring_cores, &pc, &pc.root, it,
+                              ref_checker, recurring_lengths, &pc, &pc.root, it,
                               end, &explored_callback);
     }
   }
@@ -1185,7 +1158,7 @@ static MethodCandidates find_method_candidates(
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// get_recurring_cores
+// get_recurring_lengths
 ////////////////////////////////////////////////////////////////////////////////
 
 static bool can_outline_from_method(DexMethod* method) {
@@ -1196,24 +1169,27 @@ static bool can_outline_from_method(DexMethod* method) {
   return true;
 }
 
-// Gather set of recurring small (MIN_INSNS_SIZE) adjacent instruction
-// sequences that are outlinable. Note that all longer recurring outlinable
-// instruction sequences must be comprised of shorter recurring ones.
-static void get_recurring_cores(
+// Find the longest recurring sequence of instruction cores starting at each
+// outlinable instruction. The cores of all maximal runs of outlinable
+// instructions in big blocks, and of the reusable candidates outlined earlier,
+// are numbered and concatenated into one text, with a unique separator after
+// each run, and indexed with a suffix array. This takes time near-linear in
+// the number of instructions, independent of the maximum candidate size.
+static void get_recurring_lengths(
     const Config& config,
     PassManager& mgr,
     const Scope& scope,
     const std::unordered_set<DexMethod*>& sufficiently_warm_methods,
     const std::unordered_set<DexMethod*>& sufficiently_hot_methods,
     const RefChecker& ref_checker,
-    CandidateInstructionCoresSet* recurring_cores,
+    const std::vector<Candidate>* reusable_candidates /* nullable */,
+    RecurringLengths* recurring_lengths,
     ConcurrentMap<DexMethod*, CanOutlineBlockDecider>* block_deciders) {
-  ConcurrentMap<CandidateInstructionCores, size_t,
-                CandidateInstructionCoresHasher>
-      concurrent_cores;
+  using Run = std::vector<IRInstruction*>;
+  ConcurrentMap<DexMethod*, std::vector<Run>> method_runs;
   walk::parallel::code(
       scope, [&config, &ref_checker, &sufficiently_warm_methods,
-              &sufficiently_hot_methods, &concurrent_cores,
+              &sufficiently_hot_methods, &method_runs,
               block_deciders](DexMethod* method, IRCode& code) {
         if (!can_outline_from_method(method)) {
           return;
@@ -1231,46 +1207,102 @@ static void get_recurring_cores(
               reaching_initializeds::get_reaching_initializeds(
                   cfg, reaching_initializeds::Mode::FirstLoadParam);
         }
+        std::vector<Run> runs;
+        Run run;
+        auto end_run = [&runs, &run]() {
+          // Shorter runs cannot contain a recurring sequence of interest.
+          if (run.size() >= MIN_INSNS_SIZE) {
+            runs.push_back(std::move(run));
+          }
+          run.clear();
+        };
         for (auto& big_block : big_blocks::get_big_blocks(cfg)) {
           if (block_decider.can_outline_from_big_block(big_block) !=
               CanOutlineBlockDecider::Result::CanOutline) {
             continue;
           }
-          CandidateInstructionCoresBuilder cores_builder;
           for (auto& mie : big_blocks::InstructionIterable(big_block)) {
             auto insn = mie.insn;
             if (!can_outline_insn(ref_checker,
                                   reaching_initialized_init_first_param, insn,
                                   config.outline_control_flow)) {
-              cores_builder.clear();
+              end_run();
               continue;
             }
-            cores_builder.push_back(insn);
-            if (cores_builder.has_value()) {
-              concurrent_cores.update(cores_builder.get_value(),
-                                      [](const CandidateInstructionCores&,
-                                         size_t& occurrences,
-                                         bool /* exists */) { occurrences++; });
-            }
+            run.push_back(insn);
           }
+          end_run();
+        }
+        if (!runs.empty()) {
+          method_runs.emplace(method, std::move(runs));
         }
         block_deciders->emplace(method, std::move(block_decider));
       });
-  size_t singleton_cores{0};
-  for (auto& p : concurrent_cores) {
-    always_assert(p.second > 0);
-    if (p.second > 1) {
-      recurring_cores->insert(p.first);
-    } else {
-      singleton_cores++;
+
+  std::unordered_map<CandidateInstructionCore, uint32_t,
+                     CandidateInstructionCoreHasher>
+      core_ids;
+  std::vector<uint32_t> text;
+  // The instruction at each position of the text, if any.
+  std::vector<const IRInstruction*> text_insns;
+  uint32_t next_separator = std::numeric_limits<uint32_t>::max();
+  auto append = [&](const CandidateInstructionCore& core,
+                    const IRInstruction* insn) {
+    auto id = core_ids.emplace(core, core_ids.size()).first->second;
+    text.push_back(id);
+    text_insns.push_back(insn);
+  };
+  auto append_separator = [&]() {
+    text.push_back(next_separator--);
+    text_insns.push_back(nullptr);
+  };
+  size_t outlinable_insns{0};
+  walk::code(scope, [&](DexMethod* method, IRCode&) {
+    auto it = method_runs.find(method);
+    if (it == method_runs.end()) {
+      return;
+    }
+    for (const auto& run : it->second) {
+      for (auto insn : run) {
+        append(to_core(insn), insn);
+      }
+      append_separator();
+      outlinable_insns += run.size();
+    }
+  });
+  std::function<void(const CandidateNode&)> append_node;
+  append_node = [&](const CandidateNode& cn) {
+    for (const auto& ci : cn.insns) {
+      append(ci.core, nullptr);
+    }
+    append_separator();
+    for (const auto& p : cn.succs) {
+      append_node(*p.second);
+    }
+  };
+  if (reusable_candidates) {
+    for (const auto& c : *reusable_candidates) {
+      append_node(c.root);
+    }
+  }
+  always_assert(core_ids.size() <= next_separator);
+
+  auto lengths = outliner_impl::get_recurring_lengths(text);
+  size_t max_recurring_length{0};
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text_insns[i] != nullptr && lengths[i] >= MIN_INSNS_SIZE) {
+      recurring_lengths->emplace(text_insns[i], lengths[i]);
+      max_recurring_length =
+          std::max(max_recurring_length, static_cast<size_t>(lengths[i]));
     }
   }
-  mgr.incr_metric("num_singleton_cores", singleton_cores);
-  mgr.incr_metric("num_recurring_cores", recurring_cores->size());
+  mgr.incr_metric("num_outlinable_insns", outlinable_insns);
+  mgr.incr_metric("num_recurring_sequence_starts", recurring_lengths->size());
+  mgr.incr_metric("max_recurring_sequence_length", max_recurring_length);
   TRACE(ISO, 2,
-        "[invoke sequence outliner] %zu singleton cores, %zu recurring "
-        "cores",
-        singleton_cores, recurring_cores->size());
+        "[invoke sequence outliner] %zu outlinable instructions, %zu "
+        "recurring sequence starts, longest recurring sequence: %zu",
+        outlinable_insns, recurring_lengths->size(), max_recurring_length);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1479,7 +1511,7 @@ static void get_beneficial_candidates(
     PassManager& mgr,
     const Scope& scope,
     const RefChecker& ref_checker,
-    const CandidateInstructionCoresSet& recurring_cores,
+    const RecurringLengths& recurring_lengths,
     const ConcurrentMap<DexMethod*, CanOutlineBlockDecider>& block_deciders,
     const ReusableOutlinedMethods* outlined_methods,
     std::vector<CandidateWithInfo>* candidates_with_infos,
@@ -1488,7 +1520,7 @@ static void get_beneficial_candidates(
   ConcurrentMap<Candidate, CandidateInfo, CandidateHasher>
       concurrent_candidates;
   FindCandidatesStats stats;
-  walk::parallel::code(scope, [&config, &ref_checker, &recurring_cores,
+  walk::parallel::code(scope, [&config, &ref_checker, &recurring_lengths,
                                &concurrent_candidates, &block_deciders,
                                &stats](DexMethod* method, IRCode& code) {
     if (!can_outline_from_method(method)) {
@@ -1496,7 +1528,7 @@ static void get_beneficial_candidates(
     }
     for (auto& p : find_method_candidates(
              config, ref_checker, block_deciders.at_unsafe(method), method,
-             code.cfg(), recurring_cores, &stats)) {
+             code.cfg(), recurring_lengths, &stats)) {
       std::vector<CandidateMethodLocation>& cmls = p.second;
       concurrent_candidates.update(p.first,
                                    [method, &cmls](const Candidate&,
@@ -3189,16 +3221,19 @@ void InstructionSequenceOutliner::run_pass(DexStoresVector& stores,
       }
       last_store_idx = store_idx;
       RefChecker ref_checker{&xstores, store_idx, min_sdk_api};
-      CandidateInstructionCoresSet recurring_cores;
+      RecurringLengths recurring_lengths;
       ConcurrentMap<DexMethod*, CanOutlineBlockDecider> block_deciders;
-      get_recurring_cores(m_config, mgr, dex, sufficiently_warm_methods,
-                          sufficiently_hot_methods, ref_checker,
-                          &recurring_cores, &block_deciders);
+      get_recurring_lengths(
+          m_config, mgr, dex, sufficiently_warm_methods,
+          sufficiently_hot_methods, ref_checker,
+          m_config.reuse_outlined_methods_across_dexes ? &outlined_methods.order
+                                                       : nullptr,
+          &recurring_lengths, &block_deciders);
       std::vector<CandidateWithInfo> candidates_with_infos;
       std::unordered_map<DexMethod*, std::unordered_set<CandidateId>>
           candidate_ids_by_methods;
       get_beneficial_candidates(
-          m_config, mgr, dex, ref_checker, recurring_cores, block_deciders,
+          m_config, mgr, dex, ref_checker, recurring_lengths, block_deciders,
           &outlined_methods, &candidates_with_infos, &candidate_ids_by_methods);
 
       // TODO: Merge candidates that are equivalent except that one returns
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "SuffixArray.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "Debug.h"
+
+namespace outliner_impl {
+
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& text) {
+  always_assert(text.size() < UINT32_MAX);
+  uint32_t n = text.size();
+  std::vector<uint32_t> sa(n);
+  if (n == 0) {
+    return sa;
+  }
+  std::iota(sa.begin(), sa.end(), 0);
+  std::sort(sa.begin(), sa.end(), [&text](uint32_t a, uint32_t b) {
+    return text[a] != text[b] ? text[a] < text[b] : a < b;
+  });
+  // The rank of each suffix by its first k symbols.
+  std::vector<uint32_t> rank(n);
+  for (uint32_t i = 1; i < n; i++) {
+    rank[sa[i]] = rank[sa[i - 1]] + (text[sa[i]] != text[sa[i - 1]]);
+  }
+  std::vector<uint32_t> by_second(n);
+  std::vector<uint32_t> counts;
+  std::vector<uint32_t> new_rank(n);
+  for (uint32_t k = 1; rank[sa[n - 1]] < n - 1 && k < n; k <<= 1) {
+    // Order the suffixes by their rank at offset k; suffixes shorter than
+    // that come first.
+    uint32_t j = 0;
+    for (uint32_t i = n - k; i < n; i++) {
+      by_second[j++] = i;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+      if (sa[i] >= k) {
+        by_second[j++] = sa[i] - k;
+      }
+    }
+    // Then stably by their own rank.
+    counts.assign(rank[sa[n - 1]] + 2, 0);
+    for (uint32_t i = 0; i < n; i++) {
+      counts[rank[i] + 1]++;
+    }
+    std::partial_sum(counts.begin(), counts.end(), counts.begin());
+    for (auto i : by_second) {
+      sa[counts[rank[i]]++] = i;
+    }
+    auto second = [&](uint32_t i) {
+      return i + k < n ? rank[i + k] + 1 : 0;
+    };
+    new_rank[sa[0]] = 0;
+    for (uint32_t i = 1; i < n; i++) {
+      auto a = sa[i - 1];
+      auto b = sa[i];
+      new_rank[b] = new_rank[a] +
+                    (rank[a] != rank[b] || second(a) != second(b) ? 1 : 0);
+    }
+    rank.swap(new_rank);
+  }
+  return sa;
+}
+
+std::vector<uint32_t> build_lcp_array(
+    const std::vector<uint32_t>& text,
+    const std::vector<uint32_t>& suffix_array) {
+  uint32_t n = text.size();
+  always_assert(suffix_array.size() == n);
+  std::vector<uint32_t> rank(n);
+  for (uint32_t i = 0; i < n; i++) {
+    rank[suffix_array[i]] = i;
+  }
+  std::vector<uint32_t> lcp(n);
+  uint32_t h = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (rank[i] == 0) {
+      h = 0;
+      continue;
+    }
+    auto j = suffix_array[rank[i] - 1];
+    while (i + h < n && j + h < n && text[i + h] == text[j + h]) {
+      h++;
+    }
+    lcp[rank[i]] = h;
+    if (h > 0) {
+      h--;
+    }
+  }
+  return lcp;
+}
+
+std::vector<uint32_t> get_recurring_lengths(const std::vector<uint32_t>& text) {
+  auto sa = build_suffix_array(text);
+  auto lcp = build_lcp_array(text, sa);
+  uint32_t n = text.size();
+  std::vector<uint32_t> lengths(n);
+  for (uint32_t i = 0; i < n; i++) {
+    // The longest prefix shared with any other suffix is shared with one of
+    // the neighbors in the suffix array.
+    lengths[sa[i]] = std::max(lcp[i], i + 1 < n ? lcp[i + 1] : 0);
+  }
+  return lengths;
+}
+
+} // namespace outliner_impl
@@ -0,0 +1,29 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace outliner_impl {
+
+// The suffix array of `text`: the start positions of all suffixes, in
+// lexicographic order. Built by prefix doubling in O(n log n).
+std::vector<uint32_t> build_suffix_array(const std::vector<uint32_t>& text);
+
+// The longest common prefix of each suffix in `suffix_array` and the one
+// before it; the first entry is 0. Built with Kasai's algorithm in O(n).
+std::vector<uint32_t> build_lcp_array(
+    const std::vector<uint32_t>& text,
+    const std::vector<uint32_t>& suffix_array);
+
+// For each position of `text`, the length of the longest sequence starting
+// there that also starts at some other position.
+std::vector<uint32_t> get_recurring_lengths(const std::vector<uint32_t>& text);
+
+} // namespace outliner_impl
@@ -8,6 +8,8 @@
 #include "Peephole.h"
 
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cinttypes>
 #include <cmath>
 #include <iostream>
@@ -153,6 +155,64 @@ enum class Field {
   B,
 };
 
+// IR opcodes are numbered densely from zero.
+constexpr size_t kNumIROpcodes = 0
+#define OP(...) +1
+#define IOP(...) +1
+#define OPRANGE(...)
+#include "IROpcodes.def"
+    ;
+
+using OpcodeSet = std::bitset<kNumIROpcodes>;
+
+// Binding table from the identifiers above to the values they matched. The
+// identifiers are small enums, so the table is a fixed-size array plus a bit
+// mask of bound entries, and resetting it after a failed match is a single
+// store.
+template <typename Key, typename Value, size_t N>
+class Bindings {
+  static_assert(N <= 32, "Too many identifiers");
+
+ public:
+  // Binds `key` to `value` if it is unbound. Otherwise, returns whether it is
+  // already bound to `value`.
+  bool bind(Key key, Value value) {
+    auto i = index(key);
+    if (m_bound & (1u << i)) {
+      return m_values[i] == value;
+    }
+    m_bound |= 1u << i;
+    m_values[i] = value;
+    return true;
+  }
+
+  bool contains(Key key) const { return m_bound & (1u << index(key)); }
+
+  const Value& at(Key key) const {
+    always_assert(contains(key));
+    return m_values[index(key)];
+  }
+
+  void clear() { m_bound = 0; }
+
+ private:
+  static size_t index(Key key) {
+    auto i = static_cast<size_t>(key);
+    redex_assert(i < N);
+    return i;
+  }
+
+  uint32_t m_bound{0};
+  std::array<Value, N> m_values{};
+};
+
+constexpr size_t kNumRegisters = static_cast<size_t>(Register::E) + 1;
+constexpr size_t kNumLiterals = static_cast<size_t>(Literal::Zero) + 1;
+constexpr size_t kNumStrings =
+    static_cast<size_t>(String::Type_A_get_simple_name) + 1;
+constexpr size_t kNumTypes = static_cast<size_t>(Type::B) + 1;
+constexpr size_t kNumFields = static_cast<size_t>(Field::B) + 1;
+
 // Just a minimal refactor for long string constants.
 static const char* LjavaString = "Ljava/lang/String;";
 static const char* LjavaStringBuilder = "Ljava/lang/StringBuilder;";
@@ -272,16 +332,35 @@ struct Pattern {
 // Matcher holds the matching state for the given pattern.
 struct Matcher {
   const Pattern& pattern;
+  // The opcodes accepted by each step of the 'match' pattern, indexed by
+  // opcode.
+  std::vector<OpcodeSet> step_opcodes;
   size_t match_index;
   std::vector<IRInstruction*> matched_instructions;
 
-  std::unordered_map<Register, reg_t, EnumClassHash> matched_regs;
-  std::unordered_map<String, const DexString*, EnumClassHash> matched_strings;
-  std::unordered_map<Literal, int64_t, EnumClassHash> matched_literals;
-  std::unordered_map<Type, DexType*, EnumClassHash> matched_types;
-  std::unordered_map<Field, DexFieldRef*, EnumClassHash> matched_fields;
+  Bindings<Register, reg_t, kNumRegisters> matched_regs;
+  Bindings<String, const DexString*, kNumStrings> matched_strings;
+  Bindings<Literal, int64_t, kNumLiterals> matched_literals;
+  Bindings<Type, DexType*, kNumTypes> matched_types;
+  Bindings<Field, DexFieldRef*, kNumFields> matched_fields;
+
+  explicit Matcher(const Pattern& pattern) : pattern(pattern), match_index(0) {
+    step_opcodes.reserve(pattern.match.size());
+    for (const auto& dex_pattern : pattern.match) {
+      auto& opcodes = step_opcodes.emplace_back();
+      for (auto op : dex_pattern.opcodes) {
+        opcodes.set(op);
+      }
+    }
+  }
 
-  explicit Matcher(const Pattern& pattern) : pattern(pattern), match_index(0) {}
+  // Whether the pattern can possibly match code that only contains opcodes in
+  // `present`, i.e., whether each step accepts at least one of them.
+  bool may_match(const OpcodeSet& present) const {
+    return std::all_of(
+        step_opcodes.begin(), step_opcodes.end(),
+        [&](const OpcodeSet& opcodes) { return (opcodes & present).any(); });
+  }
 
   void reset() {
     match_index = 0;
@@ -296,54 +375,17 @@ struct Matcher {
   // It updates the matching state for the given instruction. Returns true if
   // insn matches to the last 'match' pattern.
   bool try_match(IRInstruction* insn) {
-    auto match_reg = [&](Register pattern_reg, reg_t insn_reg) {
-      // This register has been observed already. Check whether they are same.
-      if (matched_regs.find(pattern_reg) != end(matched_regs)) {
-        return matched_regs.at(pattern_reg) == insn_reg;
-      }
-
-      // Newly observed. Remember it.
-      matched_regs.emplace(pattern_reg, insn_reg);
-      return true;
-    };
-
-    auto match_literal = [&](Literal lit_pattern, int64_t insn_literal_val) {
-      if (matched_literals.find(lit_pattern) != end(matched_literals)) {
-        return matched_literals.at(lit_pattern) == insn_literal_val;
-      }
-      matched_literals.emplace(lit_pattern, insn_literal_val);
-      return true;
-    };
-
     auto match_string = [&](String str_pattern, const DexString* insn_str) {
       if (str_pattern == String::empty) {
         return (insn_str->is_simple() && insn_str->size() == 0);
       }
-      if (matched_strings.find(str_pattern) != end(matched_strings)) {
-        return matched_strings.at(str_pattern) == insn_str;
-      }
-      matched_strings.emplace(str_pattern, insn_str);
-      return true;
-    };
-
-    auto match_type = [&](Type type_pattern, DexType* insn_type) {
-      if (matched_types.find(type_pattern) != end(matched_types)) {
-        return matched_types.at(type_pattern) == insn_type;
-      }
-      matched_types.emplace(type_pattern, insn_type);
-      return true;
-    };
-
-    auto match_field = [&](Field field_pattern, DexFieldRef* insn_field) {
-      auto result = matched_fields.emplace(field_pattern, insn_field);
-      bool newly_inserted = result.second;
-      return newly_inserted ? true : result.first->second == insn_field;
+      return matched_strings.bind(str_pattern, insn_str);
     };
 
     // Does 'insn' match to the given DexPattern?
-    auto match_instruction = [&](const DexPattern& dex_pattern) {
-      if (dex_pattern.opcodes.find(insn->opcode()) ==
-              end(dex_pattern.opcodes) ||
+    auto match_instruction = [&](size_t index) {
+      const DexPattern& dex_pattern = pattern.match[index];
+      if (!step_opcodes[index].test(insn->opcode()) ||
           dex_pattern.srcs.size() != insn->srcs_size() ||
           dex_pattern.dests.size() != insn->has_dest()) {
         return false;
@@ -351,13 +393,13 @@ struct Matcher {
 
       if (!dex_pattern.dests.empty()) {
         redex_assert(dex_pattern.dests.size() == 1);
-        if (!match_reg(dex_pattern.dests[0], insn->dest())) {
+        if (!matched_regs.bind(dex_pattern.dests[0], insn->dest())) {
           return false;
         }
       }
 
       for (size_t i = 0; i < dex_pattern.srcs.size(); ++i) {
-        if (!match_reg(dex_pattern.srcs[i], insn->src(i))) {
+        if (!matched_regs.bind(dex_pattern.srcs[i], insn->src(i))) {
           return false;
         }
       }
@@ -367,13 +409,13 @@ struct Matcher {
       case DexPattern::Kind::string:
         return match_string(dex_pattern.string, insn->get_string());
       case DexPattern::Kind::literal:
-        return match_literal(dex_pattern.literal, insn->get_literal());
+        return matched_literals.bind(dex_pattern.literal, insn->get_literal());
       case DexPattern::Kind::method:
         return dex_pattern.method == insn->get_method();
       case DexPattern::Kind::type:
-        return match_type(dex_pattern.type, insn->get_type());
+        return matched_types.bind(dex_pattern.type, insn->get_type());
       case DexPattern::Kind::field:
-        return match_field(dex_pattern.field, insn->get_field());
+        return matched_fields.bind(dex_pattern.field, insn->get_field());
       case DexPattern::Kind::copy:
         not_reached_log(
             "Kind::copy can only be used in replacements. Not matches");
@@ -382,7 +424,7 @@ struct Matcher {
     };
 
     redex_assert(match_index < pattern.match.size());
-    if (!match_instruction(pattern.match[match_index])) {
+    if (!match_instruction(match_index)) {
       // Okay, this is the PG's heuristic. Retry only if the failure occurs on
       // the second opcode of the pattern.
       bool retry = (match_index == 1);
@@ -395,7 +437,7 @@ struct Matcher {
       reset();
       if (retry) {
         redex_assert(match_index == 0);
-        if (!match_instruction(pattern.match[match_index])) {
+        if (!match_instruction(match_index)) {
           return false;
         }
       } else {
@@ -533,13 +575,13 @@ struct Matcher {
       if (!replace_info.dests.empty()) {
         redex_assert(replace_info.dests.size() == 1);
         const Register dest = replace_info.dests[0];
-        always_assert(matched_regs.find(dest) != end(matched_regs));
+        always_assert(matched_regs.contains(dest));
         replace->set_dest(matched_regs.at(dest));
       }
 
       for (size_t i = 0; i < replace_info.srcs.size(); ++i) {
         const Register reg = replace_info.srcs[i];
-        always_assert(matched_regs.find(reg) != end(matched_regs));
+        always_assert(matched_regs.contains(reg));
         replace->set_src(i, matched_regs.at(reg));
       }
 
@@ -1736,10 +1778,21 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
     code->build_cfg(/* editable */ true);
     auto& cfg = code->cfg();
 
+    // The opcodes occurring in the method. Patterns with a step that none of
+    // them can match are skipped without scanning the code. Replacements only
+    // ever add opcodes to the set, so it stays conservative.
+    OpcodeSet present;
+    for (const auto& mie : cfg::InstructionIterable(cfg)) {
+      present.set(mie.insn->opcode());
+    }
+
     // do optimizations one at a time
     // so they can match on the same pattern without interfering
     for (size_t i = 0; i < m_matchers.size(); ++i) {
       auto& matcher = m_matchers[i];
+      if (!matcher.may_match(present)) {
+        continue;
+      }
 
       const auto& blocks = cfg.blocks();
       cfg::CFGMutation mutator(cfg);
@@ -1775,6 +1828,7 @@ class alignas(CACHE_LINE_SIZE) PeepholeOptimizer {
             auto replace = matcher.get_replacements();
             for (const auto& r : replace) {
               TRACE(PEEPHOLE, 8, "-- %s", SHOW(r));
+              present.set(r->opcode());
             }
             mutator.insert_before(it, replace);
 
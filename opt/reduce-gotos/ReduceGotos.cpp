@@ -90,7 +90,7 @@ void ReduceGotosPass::process_code_switches(cfg::ControlFlowGraph& cfg,
     return;
   }
 
-  std::unique_ptr<LivenessFixpointIterator> liveness_iter;
+  std::unique_ptr<DenseLivenessFixpointIterator> liveness_iter;
 
   boost::optional<reg_t> const_reg;
 
@@ -135,8 +135,8 @@ void ReduceGotosPass::process_code_switches(cfg::ControlFlowGraph& cfg,
       // We have exactly one relevant branch (that isn't effectively falling
       // through)
       if (!liveness_iter) {
-        liveness_iter.reset(new LivenessFixpointIterator(cfg));
-        liveness_iter->run(LivenessDomain(cfg.get_registers_size()));
+        liveness_iter.reset(new DenseLivenessFixpointIterator(cfg));
+        liveness_iter->run(DenseLivenessDomain(cfg.get_registers_size()));
       }
       const auto& live_out_vars = liveness_iter->get_live_out_vars_at(b);
       auto single_non_fallthrough_edge_it = std::find_if(
@@ -491,30 +491,28 @@ ReduceGotosPass::Stats ReduceGotosPass::process_code(IRCode* code) {
   return stats;
 }
 
-void ReduceGotosPass::run_pass(DexStoresVector& stores,
-                               ConfigFiles& /* unused */,
-                               PassManager& mgr) {
-  auto scope = build_class_scope(stores);
-
-  Stats stats = walk::parallel::methods<Stats>(scope, [](DexMethod* method) {
-    const auto code = method->get_code();
-    if (!code) {
-      return Stats{};
-    }
-
-    Stats stats = ReduceGotosPass::process_code(code);
-    if (stats.replaced_gotos_with_returns ||
-        stats.inverted_conditional_branches) {
-      TRACE(RG, 3,
-            "[reduce gotos] Replaced %zu gotos with returns, "
-            "removed %zu trailing moves, "
-            "inverted %zu conditional branches in {%s}",
-            stats.replaced_gotos_with_returns, stats.removed_trailing_moves,
-            stats.inverted_conditional_branches, SHOW(method));
-    }
-    return stats;
-  });
+ReduceGotosPass::Stats ReduceGotosPass::process_method(
+    DexMethod* method, cfg::ControlFlowGraph& cfg) {
+  Stats stats;
+  cfg.calculate_exit_block();
+  process_code_switches(cfg, stats);
+  process_code_ifs(cfg, stats);
+  // The CFG outlives this pass when it runs fused with others; do not leave
+  // the ghost exit block behind for them.
+  cfg.reset_exit_block();
+  if (stats.replaced_gotos_with_returns ||
+      stats.inverted_conditional_branches) {
+    TRACE(RG, 3,
+          "[reduce gotos] Replaced %zu gotos with returns, "
+          "removed %zu trailing moves, "
+          "inverted %zu conditional branches in {%s}",
+          stats.replaced_gotos_with_returns, stats.removed_trailing_moves,
+          stats.inverted_conditional_branches, SHOW(method));
+  }
+  return stats;
+}
 
+void ReduceGotosPass::report(const Stats& stats, PassManager& mgr) {
   mgr.incr_metric(METRIC_REMOVED_SWITCHES, stats.removed_switches);
   mgr.incr_metric(METRIC_REDUCED_SWITCHES, stats.reduced_switches);
   mgr.incr_metric(METRIC_REMAINING_TRIVIAL_SWITCHES,
@@ -541,8 +539,7 @@ void ReduceGotosPass::run_pass(DexStoresVector& stores,
         stats.replaced_gotos_with_returns, stats.inverted_conditional_branches);
 }
 
-ReduceGotosPass::Stats& ReduceGotosPass::Stats::operator+=(
-    const ReduceGotosPass::Stats& that) {
+ReduceGotosStats& ReduceGotosStats::operator+=(const ReduceGotosStats& that) {
   removed_switches += that.removed_switches;
   reduced_switches += that.reduced_switches;
   replaced_trivial_switches += that.replaced_trivial_switches;
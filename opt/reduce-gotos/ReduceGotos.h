@@ -7,32 +7,34 @@
 
 #pragma once
 
-#include "Pass.h"
+#include "MethodPass.h"
 
 namespace cfg {
 class ControlFlowGraph;
 } // namespace cfg
 
-class ReduceGotosPass : public Pass {
+struct ReduceGotosStats {
+  size_t removed_switches{0};
+  size_t reduced_switches{0};
+  size_t replaced_trivial_switches{0};
+  size_t remaining_trivial_switches{0};
+  size_t remaining_two_case_switches{0};
+  size_t remaining_range_switches{0};
+  size_t remaining_range_switch_cases{0};
+  size_t removed_switch_cases{0};
+  size_t replaced_gotos_with_returns{0};
+  size_t removed_trailing_moves{0};
+  size_t inverted_conditional_branches{0};
+  size_t replaced_gotos_with_throws{0};
+
+  ReduceGotosStats& operator+=(const ReduceGotosStats&);
+};
+
+class ReduceGotosPass : public MethodPassWithStats<ReduceGotosStats> {
  public:
-  struct Stats {
-    size_t removed_switches{0};
-    size_t reduced_switches{0};
-    size_t replaced_trivial_switches{0};
-    size_t remaining_trivial_switches{0};
-    size_t remaining_two_case_switches{0};
-    size_t remaining_range_switches{0};
-    size_t remaining_range_switch_cases{0};
-    size_t removed_switch_cases{0};
-    size_t replaced_gotos_with_returns{0};
-    size_t removed_trailing_moves{0};
-    size_t inverted_conditional_branches{0};
-    size_t replaced_gotos_with_throws{0};
-
-    Stats& operator+=(const Stats&);
-  };
-
-  ReduceGotosPass() : Pass("ReduceGotosPass") {}
+  using Stats = ReduceGotosStats;
+
+  ReduceGotosPass() : MethodPassWithStats("ReduceGotosPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -46,7 +48,8 @@ class ReduceGotosPass : public Pass {
     };
   }
   bool is_cfg_legacy() override { return true; }
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  Stats process_method(DexMethod*, cfg::ControlFlowGraph&) override;
+  void report(const Stats&, PassManager&) override;
 
   static Stats process_code(IRCode*);
   static void process_code_switches(cfg::ControlFlowGraph&, Stats&);
@@ -7,11 +7,17 @@
 
 #include "RegAlloc.h"
 
+#include <unordered_set>
+
+#include "ConfigFiles.h"
 #include "Debug.h"
 #include "DexUtil.h"
 #include "GraphColoring.h"
+#include "LinearScan.h"
+#include "MethodProfiles.h"
 #include "PassManager.h"
 #include "RegisterAllocation.h"
+#include "SourceBlocks.h"
 #include "Trace.h"
 #include "Walkers.h"
 
@@ -19,12 +25,53 @@ namespace regalloc {
 
 using Stats = graph_coloring::Allocator::Stats;
 
+namespace {
+
+struct TieredStats {
+  Stats graph_coloring;
+  // Why methods went to graph coloring in tiered mode.
+  size_t hot_methods{0};
+  size_t large_methods{0};
+  // Linear scan does not dedicate a register to `this`.
+  size_t no_overwrite_this_methods{0};
+  size_t linear_scan_fallbacks{0};
+  size_t linear_scan_methods{0};
+  size_t linear_scan_param_moves{0};
+
+  TieredStats& operator+=(const TieredStats& that) {
+    graph_coloring += that.graph_coloring;
+    hot_methods += that.hot_methods;
+    large_methods += that.large_methods;
+    no_overwrite_this_methods += that.no_overwrite_this_methods;
+    linear_scan_fallbacks += that.linear_scan_fallbacks;
+    linear_scan_methods += that.linear_scan_methods;
+    linear_scan_param_moves += that.linear_scan_param_moves;
+    return *this;
+  }
+};
+
+// Whether the method's entry was hit in any interaction.
+bool is_entry_hot(const cfg::ControlFlowGraph& cfg) {
+  const auto* sb = source_blocks::get_first_source_block(cfg.entry_block());
+  if (sb == nullptr) {
+    return false;
+  }
+  bool is_hot = false;
+  sb->foreach_val_early([&is_hot](const auto& val) {
+    is_hot = val && val->val > 0.0f;
+    return is_hot;
+  });
+  return is_hot;
+}
+
+} // namespace
+
 void RegAllocPass::eval_pass(DexStoresVector&, ConfigFiles&, PassManager&) {
   ++m_eval;
 }
 
 void RegAllocPass::run_pass(DexStoresVector& stores,
-                            ConfigFiles&,
+                            ConfigFiles& conf,
                             PassManager& mgr) {
   graph_coloring::Allocator::Config allocator_config;
   const auto& jw = mgr.get_current_pass_info()->config;
@@ -32,10 +79,46 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   allocator_config.no_overwrite_this =
       mgr.get_redex_options().no_overwrite_this();
 
+  std::unordered_set<const DexMethodRef*> profiled_hot_methods;
+  if (m_tiered) {
+    const auto& method_profiles = conf.get_method_profiles();
+    for (const auto& [_, method_stats] : method_profiles.all_interactions()) {
+      for (const auto& [method, stat] : method_stats) {
+        if (stat.appear_percent >= m_tiered_hot_appear_percent) {
+          profiled_hot_methods.insert(method);
+        }
+      }
+    }
+  }
+
   auto scope = build_class_scope(stores);
-  auto stats = walk::parallel::methods<Stats>(scope, [&](DexMethod* m) {
-    return graph_coloring::allocate(allocator_config, m);
-  });
+  auto tiered_stats =
+      walk::parallel::methods<TieredStats>(scope, [&](DexMethod* m) {
+        TieredStats method_stats;
+        auto* code = m->get_code();
+        if (m_tiered && code != nullptr) {
+          auto& cfg = code->cfg();
+          if (profiled_hot_methods.count(m) || is_entry_hot(cfg)) {
+            ++method_stats.hot_methods;
+          } else if (cfg.num_opcodes() > m_tiered_max_cold_instructions) {
+            ++method_stats.large_methods;
+          } else if (allocator_config.no_overwrite_this && !is_static(m)) {
+            ++method_stats.no_overwrite_this_methods;
+          } else {
+            fastregalloc::LinearScanAllocator allocator(m);
+            allocator.allocate();
+            if (allocator.legalize(&method_stats.linear_scan_param_moves)) {
+              ++method_stats.linear_scan_methods;
+              return method_stats;
+            }
+            ++method_stats.linear_scan_fallbacks;
+          }
+        }
+        method_stats.graph_coloring =
+            graph_coloring::allocate(allocator_config, m);
+        return method_stats;
+      });
+  const auto& stats = tiered_stats.graph_coloring;
 
   TRACE(REG, 1, "Total reiteration count: %zu", stats.reiteration_count);
   TRACE(REG, 1, "Total Params spilled early: %zu", stats.params_spill_early);
@@ -53,6 +136,22 @@ void RegAllocPass::run_pass(DexStoresVector& stores,
   mgr.incr_metric("coalesce_count", stats.moves_coalesced);
   mgr.incr_metric("net_moves", stats.net_moves());
 
+  if (m_tiered) {
+    TRACE(REG, 1, "Tiered: %zu methods by linear scan, %zu hot, %zu large",
+          tiered_stats.linear_scan_methods, tiered_stats.hot_methods,
+          tiered_stats.large_methods);
+    mgr.incr_metric("tiered_linear_scan_methods",
+                    tiered_stats.linear_scan_methods);
+    mgr.incr_metric("tiered_linear_scan_param_moves",
+                    tiered_stats.linear_scan_param_moves);
+    mgr.incr_metric("tiered_linear_scan_fallbacks",
+                    tiered_stats.linear_scan_fallbacks);
+    mgr.incr_metric("tiered_hot_methods", tiered_stats.hot_methods);
+    mgr.incr_metric("tiered_large_methods", tiered_stats.large_methods);
+    mgr.incr_metric("tiered_no_overwrite_this_methods",
+                    tiered_stats.no_overwrite_this_methods);
+  }
+
   ++m_run;
   // For the last invocation, record that final register allocation has been
   // done.
@@ -33,6 +33,18 @@ class RegAllocPass : public Pass {
   void bind_config() override {
     bool unused;
     bind("live_range_splitting", false, unused);
+    bind("tiered", false, m_tiered,
+         "Allocate cold methods with the faster linear-scan allocator, and "
+         "only hot and large ones by graph coloring. This trades dex size "
+         "for build time. With no_overwrite_this, instance methods are "
+         "always allocated by graph coloring.");
+    bind("tiered_max_cold_instructions", size_t(200),
+         m_tiered_max_cold_instructions,
+         "Methods with more instructions are allocated by graph coloring even "
+         "when cold.");
+    bind("tiered_hot_appear_percent", 1.0f, m_tiered_hot_appear_percent,
+         "Methods that appear in at least this percentage of the traces of "
+         "some interaction in the method profiles are hot.");
     trait(Traits::Pass::atleast, 1);
   }
 
@@ -44,6 +56,9 @@ class RegAllocPass : public Pass {
  private:
   size_t m_run{0}; // Which iteration of `run_pass`.
   size_t m_eval{0}; // How many `eval_pass` iterations.
+  bool m_tiered;
+  size_t m_tiered_max_cold_instructions;
+  float m_tiered_hot_appear_percent;
 };
 
 } // namespace regalloc
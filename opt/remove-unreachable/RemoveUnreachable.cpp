@@ -9,6 +9,7 @@
 
 #include <atomic>
 #include <fstream>
+#include <memory>
 #include <set>
 
 #include "ConfigFiles.h"
@@ -16,6 +17,9 @@
 #include "IOUtil.h"
 #include "MethodOverrideGraph.h"
 #include "PassManager.h"
+#include "PuritySummaryStore.h"
+#include "RedexContext.h"
+#include "ReferenceJournal.h"
 #include "Show.h"
 #include "Trace.h"
 #include "Walkers.h"
@@ -166,6 +170,58 @@ void write_out_removed_symbols_references(
   }
 }
 
+// Shared by all RemoveUnreachablePass runs, which take turns consuming the
+// ReferenceJournal. Runs with different configurations start over; see
+// MethodReferencesCache::sync. The cache is keyed by methods, so it is dropped
+// together with the RedexContext that owns them.
+reachability::MethodReferencesCache& method_references_cache() {
+  static std::unique_ptr<reachability::MethodReferencesCache> cache;
+  if (!cache) {
+    cache = std::make_unique<reachability::MethodReferencesCache>();
+    g_redex->add_destruction_task([]() { cache.reset(); });
+  }
+  return *cache;
+}
+
+// Calls `f` on each class and class member in `stores`, in a fixed order.
+template <typename Fn>
+void walk_marked_objects(const DexStoresVector& stores, const Fn& f) {
+  for (auto* cls : build_class_scope(stores)) {
+    f(cls);
+    for (auto* field : cls->get_all_fields()) {
+      f(field);
+    }
+    for (auto* method : cls->get_all_methods()) {
+      f(method);
+    }
+  }
+}
+
+std::vector<bool> snapshot_marks(
+    const DexStoresVector& stores,
+    const reachability::ReachableObjects& reachables) {
+  std::vector<bool> marks;
+  walk_marked_objects(stores, [&](const auto* obj) {
+    marks.push_back(reachables.marked_unsafe(obj));
+  });
+  return marks;
+}
+
+void verify_marks(const DexStoresVector& stores,
+                  const reachability::ReachableObjects& reachables,
+                  const std::vector<bool>& full_marks) {
+  size_t i = 0;
+  walk_marked_objects(stores, [&](const auto* obj) {
+    bool marked = reachables.marked_unsafe(obj);
+    always_assert_log(i < full_marks.size() && marked == full_marks[i],
+                      "Incremental and full marking disagree on %s: "
+                      "incrementally %s",
+                      SHOW(obj), marked ? "marked" : "unmarked");
+    ++i;
+  });
+  always_assert(i == full_marks.size());
+}
+
 } // namespace
 
 namespace mog = method_override_graph;
@@ -246,6 +302,13 @@ void RemoveUnreachablePassBase::run_pass(DexStoresVector& stores,
   pm.incr_metric("classes_removed", before.num_classes - after.num_classes);
   pm.incr_metric("fields_removed", before.num_fields - after.num_fields);
   pm.incr_metric("methods_removed", before.num_methods - after.num_methods);
+  if (after.num_classes != before.num_classes ||
+      after.num_fields != before.num_fields ||
+      after.num_methods != before.num_methods) {
+    // The summaries of the remaining methods may depend on removed ones, e.g.
+    // on the overriders of the methods they call.
+    g_redex->get_purity_summaries()->invalidate_all();
+  }
 
   if (output_unreachable_symbols) {
     std::string filepath = conf.metafile(UNREACHABLE_SYMBOLS_FILENAME);
@@ -301,7 +364,7 @@ void RemoveUnreachablePassBase::write_out_removed_symbols(
 std::unique_ptr<reachability::ReachableObjects>
 RemoveUnreachablePass::compute_reachable_objects(
     const DexStoresVector& stores,
-    PassManager& /* pm */,
+    PassManager& pm,
     int* num_ignore_check_strings,
     reachability::ReachableAspects* reachable_aspects,
     bool emit_graph_this_run,
@@ -309,11 +372,39 @@ RemoveUnreachablePass::compute_reachable_objects(
     bool cfg_gathering_check_instantiable,
     bool cfg_gathering_check_instance_callable,
     bool remove_no_argument_constructors) {
-  return reachability::compute_reachable_objects(
-      stores, m_ignore_sets, num_ignore_check_strings, reachable_aspects,
-      emit_graph_this_run, relaxed_keep_class_members,
-      cfg_gathering_check_instantiable, cfg_gathering_check_instance_callable,
-      false, nullptr, remove_no_argument_constructors);
+  auto compute = [&](int* num_ignore_check_strings,
+                     reachability::ReachableAspects* reachable_aspects,
+                     reachability::MethodReferencesCache* cache) {
+    return reachability::compute_reachable_objects(
+        stores, m_ignore_sets, num_ignore_check_strings, reachable_aspects,
+        emit_graph_this_run, relaxed_keep_class_members,
+        cfg_gathering_check_instantiable,
+        cfg_gathering_check_instance_callable, false, nullptr,
+        remove_no_argument_constructors, cache);
+  };
+  if (!m_incremental_marking || cfg_gathering_check_instantiable ||
+      cfg_gathering_check_instance_callable) {
+    return compute(num_ignore_check_strings, reachable_aspects, nullptr);
+  }
+
+  auto& cache = method_references_cache();
+  cache.sync(g_redex->get_reference_journal(), relaxed_keep_class_members,
+             m_ignore_sets);
+  std::vector<bool> full_marks;
+  if (m_verify_incremental_marking) {
+    // This has to come first: only the latest marking holds valid marks.
+    reachability::ReachableAspects full_reachable_aspects;
+    auto full = compute(nullptr, &full_reachable_aspects, nullptr);
+    full_marks = snapshot_marks(stores, *full);
+  }
+  auto reachables =
+      compute(num_ignore_check_strings, reachable_aspects, &cache);
+  pm.incr_metric("incremental_marking.methods_reused", cache.hits());
+  pm.incr_metric("incremental_marking.methods_gathered", cache.misses());
+  if (m_verify_incremental_marking) {
+    verify_marks(stores, *reachables, full_marks);
+  }
+  return reachables;
 }
 
 static RemoveUnreachablePass s_pass;
@@ -50,6 +50,18 @@ class RemoveUnreachablePassBase : public Pass {
     bind("prune_uncallable_virtual_methods",
          false,
          m_prune_uncallable_virtual_methods);
+    bind("incremental_marking",
+         false,
+         m_incremental_marking,
+         "Reuse the references gathered from each method by earlier runs, "
+         "except for the methods recorded in the reference journal since. "
+         "Nothing is reused unless every pass in between records its changes "
+         "in the journal. "
+         "Ignored when pruning uninstantiable or uncallable code.");
+    bind("verify_incremental_marking",
+         false,
+         m_verify_incremental_marking,
+         "Also do a full marking, and fail if the incremental one differs.");
     after_configuration([this] {
       // To keep the backward compatability of this code, ensure that the
       // "MemberClasses" annotation is always in system_annos.
@@ -58,6 +70,11 @@ class RemoveUnreachablePassBase : public Pass {
     });
   }
 
+  // Sweeping only removes whole classes and members, unless code is pruned.
+  bool records_reference_changes() const override {
+    return !m_prune_uninstantiable_insns && !m_prune_uncallable_virtual_methods;
+  }
+
   void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
 
   virtual std::unique_ptr<reachability::ReachableObjects>
@@ -86,6 +103,8 @@ class RemoveUnreachablePassBase : public Pass {
   bool m_prune_uninstantiable_insns = false;
   bool m_prune_uncallable_instance_method_bodies = false;
   bool m_prune_uncallable_virtual_methods = false;
+  bool m_incremental_marking = false;
+  bool m_verify_incremental_marking = false;
 };
 
 class RemoveUnreachablePass : public RemoveUnreachablePassBase {
@@ -59,7 +59,7 @@ constexpr const char* METRIC_ITERATIONS = "iterations";
 RemoveArgs::PassStats RemoveArgs::run(ConfigFiles& config) {
   RemoveArgs::PassStats pass_stats;
   gather_results_used();
-  auto override_graph = mog::build_graph(m_scope);
+  auto override_graph = mog::get_or_build_graph(m_scope);
   compute_reordered_protos(*override_graph);
   auto method_stats =
       update_method_protos(*override_graph, config.get_do_not_devirt_anon());
@@ -261,8 +261,8 @@ std::deque<uint16_t> compute_live_args(
   always_assert(code->editable_cfg_built());
   auto& cfg = code->cfg();
   cfg.calculate_exit_block();
-  LivenessFixpointIterator fixpoint_iter(cfg);
-  fixpoint_iter.run(LivenessDomain());
+  DenseLivenessFixpointIterator fixpoint_iter(cfg);
+  fixpoint_iter.run(DenseLivenessDomain());
   auto entry_block = cfg.entry_block();
 
   std::deque<uint16_t> live_arg_idxs;
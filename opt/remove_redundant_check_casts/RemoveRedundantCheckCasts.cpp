@@ -16,42 +16,29 @@
 
 namespace check_casts {
 
-impl::Stats remove_redundant_check_casts(const CheckCastConfig& config,
-                                         DexMethod* method,
-                                         const api::AndroidSDK& android_sdk) {
-  if (!method || !method->get_code() || method->rstate.no_optimizations()) {
-    return impl::Stats{};
-  }
-
-  auto* code = method->get_code();
-  code->build_cfg(/* editable */ true);
-  impl::CheckCastAnalysis analysis(config, method, android_sdk);
-  auto casts = analysis.collect_redundant_checks_replacement();
-  auto stats = impl::apply(method, casts);
-
-  code->clear_cfg();
-  return stats;
-}
-
 void RemoveRedundantCheckCastsPass::bind_config() {
   bind("weaken", m_config.weaken, m_config.weaken);
 }
 
-void RemoveRedundantCheckCastsPass::run_pass(DexStoresVector& stores,
-                                             ConfigFiles& conf,
-                                             PassManager& mgr) {
-  auto scope = build_class_scope(stores);
-  const auto& android_sdk =
-      conf.get_android_sdk_api(mgr.get_redex_options().min_sdk);
+void RemoveRedundantCheckCastsPass::prepare(DexStoresVector& /* stores */,
+                                            ConfigFiles& conf,
+                                            PassManager& mgr) {
+  m_android_sdk = &conf.get_android_sdk_api(mgr.get_redex_options().min_sdk);
+}
 
-  auto stats =
-      walk::parallel::methods<impl::Stats>(scope, [&](DexMethod* method) {
-        return remove_redundant_check_casts(m_config, method, android_sdk);
-      });
+impl::Stats RemoveRedundantCheckCastsPass::process_method(
+    DexMethod* method, cfg::ControlFlowGraph& /* cfg */) {
+  impl::CheckCastAnalysis analysis(m_config, method, *m_android_sdk);
+  auto casts = analysis.collect_redundant_checks_replacement();
+  return impl::apply(method, casts);
+}
 
+void RemoveRedundantCheckCastsPass::report(const impl::Stats& stats,
+                                           PassManager& mgr) {
   mgr.set_metric("num_removed_casts", stats.removed_casts);
   mgr.set_metric("num_replaced_casts", stats.replaced_casts);
   mgr.set_metric("num_weakened_casts", stats.weakened_casts);
+  m_android_sdk = nullptr;
 }
 
 static RemoveRedundantCheckCastsPass s_pass;
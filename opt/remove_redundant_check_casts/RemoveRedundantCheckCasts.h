@@ -8,13 +8,16 @@
 #pragma once
 
 #include "CheckCastConfig.h"
-#include "Pass.h"
+#include "CheckCastTransform.h"
+#include "MethodPass.h"
 
 namespace check_casts {
 
-class RemoveRedundantCheckCastsPass : public Pass {
+class RemoveRedundantCheckCastsPass
+    : public MethodPassWithStats<impl::Stats> {
  public:
-  RemoveRedundantCheckCastsPass() : Pass("RemoveRedundantCheckCastsPass") {}
+  RemoveRedundantCheckCastsPass()
+      : MethodPassWithStats("RemoveRedundantCheckCastsPass") {}
 
   redex_properties::PropertyInteractions get_property_interactions()
       const override {
@@ -32,10 +35,16 @@ class RemoveRedundantCheckCastsPass : public Pass {
 
   bool is_cfg_legacy() override { return true; }
 
-  void run_pass(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  void prepare(DexStoresVector&, ConfigFiles&, PassManager&) override;
+  bool should_visit(const DexMethod* method) const override {
+    return !method->rstate.no_optimizations();
+  }
+  impl::Stats process_method(DexMethod*, cfg::ControlFlowGraph&) override;
+  void report(const impl::Stats&, PassManager&) override;
 
  private:
   CheckCastConfig m_config;
+  const api::AndroidSDK* m_android_sdk{nullptr};
 };
 
 } // namespace check_casts
@@ -89,7 +89,7 @@ uint32_t remove_duplicated_vmethods(
     const Scope& scope,
     const ConcurrentSet<DexMethodRef*>& super_invoked_methods) {
   uint32_t ret = 0;
-  auto graph = method_override_graph::build_graph(scope);
+  auto graph = method_override_graph::get_or_build_graph(scope);
   std::unordered_map<DexMethodRef*, DexMethodRef*> removed_vmethods;
 
   walk::classes(scope, [&](DexClass* cls) {
@@ -118,7 +118,8 @@ ModelStats merge_model(Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec) {
+                       ModelSpec& spec,
+                       const MergeabilityFacts* facts) {
   always_assert(!spec.roots.empty());
   TypeSystem type_system(scope);
   if (spec.merging_targets.empty()) {
@@ -127,7 +128,7 @@ ModelStats merge_model(Scope& scope,
   if (spec.merging_targets.empty()) {
     return ModelStats();
   }
-  return merge_model(type_system, scope, conf, mgr, stores, spec);
+  return merge_model(type_system, scope, conf, mgr, stores, spec, facts);
 }
 
 ModelStats merge_model(const TypeSystem& type_system,
@@ -135,7 +136,8 @@ ModelStats merge_model(const TypeSystem& type_system,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec) {
+                       ModelSpec& spec,
+                       const MergeabilityFacts* facts) {
   set_up(conf);
   always_assert(s_is_initialized);
   TRACE(CLMG,
@@ -149,8 +151,8 @@ ModelStats merge_model(const TypeSystem& type_system,
   XStoreRefs xstores(stores);
   auto refchecker =
       create_ref_checker(spec.per_dex_grouping, &xstores, conf, min_sdk);
-  auto model =
-      Model::build_model(scope, stores, conf, spec, type_system, *refchecker);
+  auto model = Model::build_model(scope, stores, conf, spec, type_system,
+                                  *refchecker, facts);
   ModelStats stats = model.get_model_stats();
 
   ModelMerger mm;
@@ -15,13 +15,15 @@ ModelStats merge_model(Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec);
+                       ModelSpec& spec,
+                       const MergeabilityFacts* facts = nullptr);
 
 ModelStats merge_model(const TypeSystem&,
                        Scope& scope,
                        ConfigFiles& conf,
                        PassManager& mgr,
                        DexStoresVector& stores,
-                       ModelSpec& spec);
+                       ModelSpec& spec,
+                       const MergeabilityFacts* facts = nullptr);
 
 } // namespace class_merging
@@ -19,15 +19,63 @@
 
 using namespace class_merging;
 
+MergeabilityFacts::MergeabilityFacts(const Scope& scope) {
+  for (const auto* cls : scope) {
+    m_covered.insert(cls->get_type());
+  }
+  walk::parallel::code(scope, [this](DexMethod* method, IRCode& code) {
+    auto add = [&](Kind kind, const DexType* type) {
+      m_methods[kind].update(type,
+                             [method](const DexType*,
+                                      std::vector<DexMethod*>& methods,
+                                      bool /* exists */) {
+                               if (methods.empty() ||
+                                   methods.back() != method) {
+                                 methods.push_back(method);
+                               }
+                             });
+    };
+    for (const auto& mie : InstructionIterable(code)) {
+      auto insn = mie.insn;
+      auto op = insn->opcode();
+      if (insn->has_method()) {
+        if (!insn->get_method()->is_def()) {
+          add(PURE_METHOD_REF, insn->get_method()->get_class());
+        }
+      } else if (opcode::is_const_string(op)) {
+        std::string class_name =
+            java_names::external_to_internal(insn->get_string()->str());
+        DexType* maybe_type = DexType::get_type(class_name);
+        if (maybe_type) {
+          add(TYPE_LIKE_STRING, maybe_type);
+        }
+      } else if (opcode::is_const_class(op)) {
+        add(CONST_CLASS, type::get_element_type_if_array(insn->get_type()));
+      } else if (opcode::is_instance_of(op)) {
+        add(INSTANCE_OF, type::get_element_type_if_array(insn->get_type()));
+      }
+    }
+  });
+}
+
+const std::vector<DexMethod*>& MergeabilityFacts::get_methods(
+    Kind kind, const DexType* type) const {
+  static const std::vector<DexMethod*> empty;
+  auto it = m_methods[kind].find(type);
+  return it == m_methods[kind].end() ? empty : it->second;
+}
+
 MergeabilityChecker::MergeabilityChecker(const Scope& scope,
                                          const ModelSpec& spec,
                                          const RefChecker& ref_checker,
-                                         const TypeSet& generated)
+                                         const TypeSet& generated,
+                                         const MergeabilityFacts* facts)
     : m_scope(scope),
       m_spec(spec),
       m_ref_checker(ref_checker),
       m_generated(generated),
-      m_const_class_safe_types(spec.const_class_safe_types) {}
+      m_const_class_safe_types(spec.const_class_safe_types),
+      m_facts(facts) {}
 
 void MergeabilityChecker::exclude_unsupported_cls_property(
     TypeSet& non_mergeables) {
@@ -188,8 +236,56 @@ TypeSet MergeabilityChecker::exclude_unsupported_bytecode_refs_for(
   return non_mergeables;
 }
 
+bool MergeabilityChecker::can_use_facts() const {
+  if (m_facts == nullptr) {
+    return false;
+  }
+  // Verifying the uses of const classes needs a data-flow analysis of the
+  // method, which the facts do not capture.
+  if (m_spec.has_type_tag() && !m_const_class_safe_types.empty()) {
+    return false;
+  }
+  // Types created after the facts were collected (e.g. the mergers of an
+  // earlier model) may be referenced by code the facts have not seen.
+  return std::all_of(m_spec.merging_targets.begin(),
+                     m_spec.merging_targets.end(),
+                     [this](const DexType* type) {
+                       return m_facts->covers(type);
+                     });
+}
+
+void MergeabilityChecker::exclude_unsupported_bytecode_from_facts(
+    TypeSet& non_mergeables) {
+  auto referenced_by = [&](MergeabilityFacts::Kind kind, const DexType* type) {
+    for (auto* method : m_facts->get_methods(kind, type)) {
+      if (!m_generated.count(method->get_class())) {
+        TRACE(CLMG, 5, "[non mergeable] %s referenced (%d) in %s", SHOW(type),
+              kind, SHOW(method));
+        return true;
+      }
+    }
+    return false;
+  };
+  // This mirrors exclude_unsupported_bytecode_refs_for.
+  bool has_type_tag = m_spec.has_type_tag();
+  for (const auto* type : m_spec.merging_targets) {
+    if (referenced_by(MergeabilityFacts::PURE_METHOD_REF, type) ||
+        (m_spec.exclude_type_like_strings() &&
+         referenced_by(MergeabilityFacts::TYPE_LIKE_STRING, type)) ||
+        referenced_by(has_type_tag ? MergeabilityFacts::CONST_CLASS
+                                   : MergeabilityFacts::INSTANCE_OF,
+                      type)) {
+      non_mergeables.insert(type);
+    }
+  }
+}
+
 void MergeabilityChecker::exclude_unsupported_bytecode(
     TypeSet& non_mergeables) {
+  if (can_use_facts()) {
+    exclude_unsupported_bytecode_from_facts(non_mergeables);
+    return;
+  }
   TypeSet non_mergeables_opcode =
       walk::parallel::methods<TypeSet, MergeContainers<TypeSet>>(
           m_scope, [this](DexMethod* meth) {
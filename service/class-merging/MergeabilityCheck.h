@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <array>
+
+#include "ConcurrentContainers.h"
 #include "DexClass.h"
 
 class RefChecker;
@@ -17,12 +20,60 @@ using TypeSet = std::set<const DexType*, dextypes_comparator>;
 
 struct ModelSpec;
 
+/**
+ * The instruction-level facts that MergeabilityChecker derives bytecode
+ * non-mergeables from, collected for all types in a single traversal of the
+ * scope. This lets several model specs share one scan of the code instead of
+ * each rescanning every instruction.
+ *
+ * The facts are meant to be collected before any of the specs is merged.
+ * Merging a model only rewrites references to its own merging targets and
+ * moves existing code around, so the facts remain a conservative
+ * approximation for the other models' targets.
+ */
+class MergeabilityFacts {
+ public:
+  enum Kind : uint8_t {
+    // Pure (non-def) method refs on the type.
+    PURE_METHOD_REF,
+    // Const strings naming the type.
+    TYPE_LIKE_STRING,
+    // Const classes of the type, or of arrays of it.
+    CONST_CLASS,
+    // Instance-of checks on the type, or on arrays of it.
+    INSTANCE_OF,
+    NUM_KINDS,
+  };
+
+  explicit MergeabilityFacts(const Scope& scope);
+
+  /**
+   * Whether the facts cover `type`, i.e. whether it was defined in the scope
+   * the facts were collected from.
+   */
+  bool covers(const DexType* type) const { return m_covered.count(type); }
+
+  /**
+   * The methods that contained an instruction of the given kind referencing
+   * `type`.
+   */
+  const std::vector<DexMethod*>& get_methods(Kind kind,
+                                             const DexType* type) const;
+
+ private:
+  std::unordered_set<const DexType*> m_covered;
+  std::array<ConcurrentMap<const DexType*, std::vector<DexMethod*>>,
+             NUM_KINDS>
+      m_methods;
+};
+
 class MergeabilityChecker {
  public:
   MergeabilityChecker(const Scope& scope,
                       const ModelSpec& spec,
                       const RefChecker& ref_checker,
-                      const TypeSet& generated);
+                      const TypeSet& generated,
+                      const MergeabilityFacts* facts = nullptr);
   /**
    * Try to identify types referenced by operations that Class Merging does not
    * support. Such operations include reflections, instanceof checks on
@@ -40,9 +91,12 @@ class MergeabilityChecker {
   const RefChecker& m_ref_checker;
   const TypeSet& m_generated;
   const std::unordered_set<DexType*>& m_const_class_safe_types;
+  const MergeabilityFacts* m_facts;
 
   void exclude_unsupported_cls_property(TypeSet& non_mergeables);
   void exclude_unsupported_bytecode(TypeSet& non_mergeables);
+  bool can_use_facts() const;
+  void exclude_unsupported_bytecode_from_facts(TypeSet& non_mergeables);
   void exclude_static_fields(TypeSet& non_mergeables);
   void exclude_unsafe_sdk_and_store_refs(TypeSet& non_mergeables);
 
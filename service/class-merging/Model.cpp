@@ -171,19 +171,21 @@ Model::Model(const Scope& scope,
              const ConfigFiles& conf,
              const ModelSpec& spec,
              const TypeSystem& type_system,
-             const RefChecker& refchecker)
+             const RefChecker& refchecker,
+             const MergeabilityFacts* facts)
     : m_spec(spec),
       m_type_system(type_system),
       m_ref_checker(refchecker),
       m_scope(scope),
       m_conf(conf),
       m_x_dex(XDexRefs(stores)) {
-  init(scope, spec, type_system);
+  init(scope, spec, type_system, facts);
 }
 
 void Model::init(const Scope& scope,
                  const ModelSpec& spec,
-                 const TypeSystem& type_system) {
+                 const TypeSystem& type_system,
+                 const MergeabilityFacts* facts) {
   build_hierarchy(spec.roots);
   for (const auto root : spec.roots) {
     build_interface_map(root, {});
@@ -201,7 +203,7 @@ void Model::init(const Scope& scope,
                        generated);
   TRACE(CLMG, 4, "Generated types %zu", generated.size());
   exclude_types(spec.exclude_types);
-  MergeabilityChecker checker(scope, spec, m_ref_checker, generated);
+  MergeabilityChecker checker(scope, spec, m_ref_checker, generated, facts);
   m_non_mergeables = checker.get_non_mergeables();
   TRACE(CLMG, 3, "Non mergeables %zu", m_non_mergeables.size());
   m_stats.m_non_mergeables = m_non_mergeables.size();
@@ -1511,11 +1513,12 @@ Model Model::build_model(const Scope& scope,
                          const ConfigFiles& conf,
                          const ModelSpec& spec,
                          const TypeSystem& type_system,
-                         const RefChecker& refchecker) {
+                         const RefChecker& refchecker,
+                         const MergeabilityFacts* facts) {
   Timer t("build_model");
 
   TRACE(CLMG, 3, "Build Model for %s", to_string(spec).c_str());
-  Model model(scope, stores, conf, spec, type_system, refchecker);
+  Model model(scope, stores, conf, spec, type_system, refchecker, facts);
   TRACE(CLMG, 3, "Model:\n%s\nBuild Model done", model.print().c_str());
 
   TRACE(CLMG, 3, "Shape Model");
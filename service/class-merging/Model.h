@@ -27,6 +27,8 @@ using ConstTypeHashSet = std::unordered_set<const DexType*>;
 
 namespace class_merging {
 
+class MergeabilityFacts;
+
 using TypeToTypeSet = std::unordered_map<const DexType*, TypeSet>;
 using TypeGroupByDex = std::vector<std::pair<boost::optional<size_t>, TypeSet>>;
 
@@ -255,7 +257,8 @@ class Model {
                            const ConfigFiles& conf,
                            const ModelSpec& spec,
                            const TypeSystem& type_system,
-                           const RefChecker& refchecker);
+                           const RefChecker& refchecker,
+                           const MergeabilityFacts* facts = nullptr);
 
   const std::string& get_name() const { return m_spec.name; }
   std::vector<const DexType*> get_roots() const {
@@ -398,11 +401,13 @@ class Model {
         const ConfigFiles& conf,
         const ModelSpec& spec,
         const TypeSystem& type_system,
-        const RefChecker& refchecker);
+        const RefChecker& refchecker,
+        const MergeabilityFacts* facts);
 
   void init(const Scope& scope,
             const ModelSpec& spec,
-            const TypeSystem& type_system);
+            const TypeSystem& type_system,
+            const MergeabilityFacts* facts);
 
   void build_hierarchy(const TypeSet& roots);
   void build_interface_map(const DexType* type, TypeSet implemented);
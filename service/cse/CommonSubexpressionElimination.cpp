@@ -1041,8 +1041,15 @@ const method_override_graph::Graph* SharedState::get_method_override_graph()
   return m_method_override_graph.get();
 }
 
-void SharedState::init_method_barriers(const Scope& scope) {
+void SharedState::init_method_barriers(const Scope& scope,
+                                       const PuritySummaryKey* summary_key) {
   Timer t("init_method_barriers");
+  // Barriers do not depend on the clinit predicate, only on the safe methods.
+  boost::optional<PuritySummaryKey> barriers_key;
+  if (summary_key) {
+    barriers_key = PuritySummaryKey{summary_key->name + ".barriers"};
+    barriers_key->add_methods(m_safe_methods);
+  }
   auto iterations = compute_locations_closure(
       scope, m_method_override_graph.get(),
       [&](DexMethod* method) -> boost::optional<LocationsAndDependencies> {
@@ -1093,7 +1100,7 @@ void SharedState::init_method_barriers(const Scope& scope) {
 
         return lads;
       },
-      &m_method_written_locations);
+      &m_method_written_locations, barriers_key.get_ptr());
   m_stats.method_barriers_iterations = iterations;
   m_stats.method_barriers = m_method_written_locations.size();
 
@@ -1125,13 +1132,14 @@ void SharedState::init_finalizable_fields(const Scope& scope) {
 
 void SharedState::init_scope(
     const Scope& scope,
-    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects) {
+    const method::ClInitHasNoSideEffectsPredicate& clinit_has_no_side_effects,
+    const PuritySummaryKey* summary_key) {
   always_assert(!m_method_override_graph);
-  m_method_override_graph = method_override_graph::build_graph(scope);
+  m_method_override_graph = method_override_graph::get_or_build_graph(scope);
 
   auto iterations = compute_conditionally_pure_methods(
       scope, m_method_override_graph.get(), clinit_has_no_side_effects,
-      m_pure_methods, &m_conditionally_pure_methods);
+      m_pure_methods, &m_conditionally_pure_methods, summary_key);
   m_stats.conditionally_pure_methods = m_conditionally_pure_methods.size();
   m_stats.conditionally_pure_methods_iterations = iterations;
   for (const auto& p : m_conditionally_pure_methods) {
@@ -1145,7 +1153,7 @@ void SharedState::init_scope(
     }
   }
 
-  init_method_barriers(scope);
+  init_method_barriers(scope, summary_key);
   init_finalizable_fields(scope);
 }
 
@@ -74,9 +74,11 @@ class SharedState {
       const std::unordered_set<DexMethodRef*>& pure_methods,
       const std::unordered_set<const DexString*>& finalish_field_names,
       const std::unordered_set<const DexField*>& finalish_fields);
+  // The summary key, if any, must identify the clinit predicate.
   void init_scope(const Scope&,
                   const method::ClInitHasNoSideEffectsPredicate&
-                      clinit_has_no_side_effects);
+                      clinit_has_no_side_effects,
+                  const PuritySummaryKey* summary_key = nullptr);
   CseUnorderedLocationSet get_relevant_written_locations(
       const IRInstruction* insn,
       DexType* exact_virtual_scope,
@@ -109,7 +111,8 @@ class SharedState {
   }
 
  private:
-  void init_method_barriers(const Scope& scope);
+  void init_method_barriers(const Scope& scope,
+                            const PuritySummaryKey* summary_key);
   void init_finalizable_fields(const Scope& scope);
   bool may_be_barrier(const IRInstruction* insn, DexType* exact_virtual_scope);
   bool is_invoke_safe(const IRInstruction* insn, DexType* exact_virtual_scope);
@@ -129,7 +132,7 @@ class SharedState {
       m_method_written_locations;
   std::unordered_map<const DexMethod*, CseUnorderedLocationSet>
       m_conditionally_pure_methods;
-  std::unique_ptr<const method_override_graph::Graph> m_method_override_graph;
+  std::shared_ptr<const method_override_graph::Graph> m_method_override_graph;
   SharedStateStats m_stats;
   // boxing to unboxing mapping
   std::unordered_map<const DexMethodRef*, const DexMethodRef*> m_boxing_map;
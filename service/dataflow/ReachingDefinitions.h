@@ -8,9 +8,14 @@
 #pragma once
 
 #include <sparta/AbstractDomain.h>
+#include <sparta/BitVectorSetAbstractDomain.h>
+#include <sparta/GenKillFixpointIterator.h>
 #include <sparta/PatriciaTreeMapAbstractEnvironment.h>
 #include <sparta/PatriciaTreeSetAbstractDomain.h>
 
+#include <unordered_map>
+#include <vector>
+
 #include "BaseIRAnalyzer.h"
 #include "ControlFlow.h"
 #include "DexClass.h"
@@ -59,4 +64,81 @@ class MoveAwareFixpointIterator final
   }
 };
 
+// The definitions of a method, numbered in the order of its blocks.
+using DenseDomain = sparta::BitVectorSetAbstractDomain<uint32_t>;
+
+/*
+ * The same analysis as FixpointIterator, as a gen/kill problem over bit
+ * vectors of definitions rather than a map from registers to sets of
+ * instructions. This is the faster of the two on large methods.
+ *
+ * Unlike with FixpointIterator, a register that is not defined on some path
+ * does not get Top: get_definitions() just returns the definitions that reach
+ * along the other paths, if any.
+ */
+class DenseFixpointIterator final
+    : public sparta::GenKillFixpointIterator<cfg::GraphInterface, uint32_t> {
+ public:
+  using NodeId = cfg::Block*;
+
+  explicit DenseFixpointIterator(const cfg::ControlFlowGraph& cfg)
+      : GenKillFixpointIterator(cfg, cfg.num_blocks()),
+        m_defs_of_reg(cfg.get_registers_size()) {
+    for (auto* block : cfg.blocks()) {
+      for (auto& mie : ir_list::InstructionIterable(block)) {
+        auto* insn = mie.insn;
+        if (!insn->has_dest()) {
+          continue;
+        }
+        uint32_t id = m_defs.size();
+        m_defs.push_back(insn);
+        m_ids.emplace(insn, id);
+        if (insn->dest() >= m_defs_of_reg.size()) {
+          m_defs_of_reg.resize(insn->dest() + 1);
+        }
+        m_defs_of_reg[insn->dest()].insert(id);
+      }
+    }
+  }
+
+  void summarize_node(const NodeId& block,
+                      Transformer* transformer) const override {
+    for (auto& mie : ir_list::InstructionIterable(block)) {
+      analyze_instruction(mie.insn, transformer);
+    }
+  }
+
+  // Only instructions that were in the CFG when the iterator was built can be
+  // analyzed.
+  template <typename State>
+  void analyze_instruction(const IRInstruction* insn,
+                           State* current_state) const {
+    if (insn->has_dest()) {
+      const auto& defs = m_defs_of_reg[insn->dest()];
+      current_state->remove(defs.begin(), defs.end());
+      current_state->add(m_ids.at(insn));
+    }
+  }
+
+  std::vector<IRInstruction*> get_definitions(const DenseDomain& state,
+                                              reg_t reg) const {
+    std::vector<IRInstruction*> defs;
+    if (state.kind() != sparta::AbstractValueKind::Value ||
+        reg >= m_defs_of_reg.size()) {
+      return defs;
+    }
+    for (uint32_t id : m_defs_of_reg[reg]) {
+      if (state.contains(id)) {
+        defs.push_back(m_defs[id]);
+      }
+    }
+    return defs;
+  }
+
+ private:
+  std::vector<IRInstruction*> m_defs;
+  std::unordered_map<const IRInstruction*, uint32_t> m_ids;
+  std::vector<sparta::BitVectorSet<uint32_t>> m_defs_of_reg;
+};
+
 } // namespace reaching_defs
@@ -728,10 +728,10 @@ void run_inliner(DexStoresVector& stores,
 
   inliner_config.unique_inlined_registers = false;
 
-  std::unique_ptr<const mog::Graph> method_override_graph;
+  std::shared_ptr<const mog::Graph> method_override_graph;
   std::unique_ptr<const std::unordered_set<DexMethod*>> non_virtual;
   if (inliner_config.virtual_inline) {
-    method_override_graph = mog::build_graph(scope);
+    method_override_graph = mog::get_or_build_graph(scope);
     non_virtual = std::make_unique<const std::unordered_set<DexMethod*>>(
         mog::get_non_true_virtuals(*method_override_graph, scope));
   }
@@ -9,9 +9,11 @@
 
 #include "ControlFlow.h"
 #include "CppUtil.h"
+#include "DexInstruction.h"
 #include "IRCode.h"
 #include "IRInstruction.h"
 #include "IRList.h"
+#include "Interference.h"
 #include "LiveInterval.h"
 #include "Show.h"
 #include "Trace.h"
@@ -88,6 +90,92 @@ void LinearScanAllocator::allocate() {
   TRACE(FREG, 9, "FastRegAlloc pass complete! [Final Code]\n%s", SHOW(*m_cfg));
 }
 
+bool LinearScanAllocator::legalize(size_t* param_moves) {
+  if (!operands_fit()) {
+    return false;
+  }
+  auto& cfg = *m_cfg;
+  auto params = cfg.get_param_instructions();
+  std::vector<IRInstruction*> param_insns;
+  reg_t ins_size = 0;
+  for (auto& mie : InstructionIterable(params)) {
+    param_insns.push_back(mie.insn);
+    ins_size += mie.insn->dest_is_wide() ? 2 : 1;
+  }
+  reg_t regs_size = cfg.get_registers_size();
+  bool in_place = regs_size >= ins_size;
+  reg_t expected = in_place ? regs_size - ins_size : 0;
+  // All parameters are live at the method entry, but allocate() may give one
+  // that is never read the same register as another. We cannot tell which of
+  // the two the register then holds.
+  std::vector<bool> taken(regs_size);
+  for (auto* insn : param_insns) {
+    reg_t width = insn->dest_is_wide() ? 2 : 1;
+    in_place = in_place && insn->dest() == expected;
+    expected += width;
+    for (reg_t reg = insn->dest(); reg < insn->dest() + width; ++reg) {
+      if (reg >= taken.size()) {
+        taken.resize(reg + 1);
+      } else if (taken[reg]) {
+        return false;
+      }
+      taken[reg] = true;
+    }
+  }
+  if (in_place) {
+    return true;
+  }
+
+  std::vector<IRInstruction*> moves;
+  reg_t param_reg = std::max<reg_t>(regs_size, taken.size());
+  for (auto* insn : param_insns) {
+    auto* move = new IRInstruction(opcode::load_param_to_move(insn->opcode()));
+    move->set_dest(insn->dest());
+    move->set_src(0, param_reg);
+    moves.push_back(move);
+    insn->set_dest(param_reg);
+    param_reg += insn->dest_is_wide() ? 2 : 1;
+  }
+  auto* entry = cfg.entry_block();
+  cfg.insert_after(
+      entry->to_cfg_instruction_iterator(entry->get_last_param_loading_insn()),
+      moves);
+  cfg.set_registers_size(param_reg);
+  *param_moves += moves.size();
+  return true;
+}
+
+bool LinearScanAllocator::operands_fit() {
+  auto ii = cfg::InstructionIterable(*m_cfg);
+  for (auto it = ii.begin(); it != ii.end(); ++it) {
+    auto* insn = it->insn;
+    auto op = insn->opcode();
+    if (opcode::is_a_load_param(op)) {
+      continue;
+    }
+    if (insn->has_dest() &&
+        insn->dest() > regalloc::max_unsigned_value(
+                           regalloc::interference::dest_bit_width(it))) {
+      return false;
+    }
+    size_t src_sizes = 0;
+    for (src_index_t i = 0; i < insn->srcs_size(); ++i) {
+      src_sizes += insn->src_is_wide(i) ? 2 : 1;
+      if (insn->src(i) > regalloc::interference::max_value_for_src(
+                             insn, i, insn->src_is_wide(i))) {
+        return false;
+      }
+    }
+    // A range form needs contiguous registers, which allocate() does not try
+    // to provide.
+    if (opcode::has_range_form(op) && insn->srcs_size() > 1 &&
+        src_sizes > dex_opcode::NON_RANGE_MAX) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void LinearScanAllocator::init_vreg_occurences() {
   for (auto& mie : InstructionIterable(*m_cfg)) {
     auto insn = mie.insn;
@@ -213,6 +213,20 @@ class LinearScanAllocator final {
    */
   void allocate();
 
+  /*
+   * allocate() alone does not produce code that can always be encoded in the
+   * Dex format: the parameters must occupy the highest registers, and each
+   * operand must fit into the bits its opcode provides. This moves the
+   * parameters into fresh registers at the top of the frame, copying them to
+   * where allocate() put them, if they are not there already.
+   *
+   * Returns false, without changing the code, if some operand is out of range
+   * or the parameters' registers overlap. The code is then still valid IR
+   * that the graph-coloring allocator can take over. Otherwise adds the
+   * number of moves it inserted to `param_moves`.
+   */
+  bool legalize(size_t* param_moves);
+
  private:
   // Ensure that we have an editable CFG for the duration of the optimization
   cfg::ScopedCFG m_cfg;
@@ -285,6 +299,12 @@ class LinearScanAllocator final {
    * end-point. We might hand out a reused but since expired register.
    */
   reg_t allocate_register(reg_t for_vreg, uint32_t end_point);
+
+  /*
+   * Whether the operands of all but the load-param instructions fit into
+   * their encodings, without needing a range form.
+   */
+  bool operands_fit();
 };
 
 } // namespace fastregalloc
@@ -49,6 +49,47 @@ uint32_t edge_weight_helper(uint8_t u_width, uint8_t v_width) {
   return ((v_width - 1) >> (u_width - 1)) + 1;
 }
 
+void AdjacencyMatrix::reserve(reg_t num_regs) {
+  if (m_dense && num_regs > m_num_regs) {
+    grow(num_regs);
+  }
+}
+
+void AdjacencyMatrix::set(reg_t u, reg_t v, uint8_t flags) {
+  if (u == v) {
+    return;
+  }
+  if (u > v) {
+    std::swap(u, v);
+  }
+  if (m_dense && v >= m_num_regs) {
+    grow(static_cast<size_t>(v) + 1);
+  }
+  if (!m_dense) {
+    m_sparse[build_edge(u, v)] |= flags;
+    return;
+  }
+  auto idx = index(u, v);
+  m_dense_bits[idx / kPairsPerWord] |= static_cast<uint64_t>(flags)
+                                       << shift(idx);
+}
+
+void AdjacencyMatrix::grow(size_t num_regs) {
+  if (num_bits(num_regs) <= kMaxDenseBits) {
+    m_num_regs = num_regs;
+    m_dense_bits.resize((num_bits(num_regs) + 63) / 64, 0);
+    return;
+  }
+  std::unordered_map<reg_pair_t, uint8_t> sparse;
+  for_each([&sparse](reg_t lo, reg_t hi, uint8_t flags) {
+    sparse.emplace(build_edge(lo, hi), flags);
+  });
+  m_sparse = std::move(sparse);
+  m_dense = false;
+  m_num_regs = 0;
+  m_dense_bits = std::vector<uint64_t>();
+}
+
 } // namespace impl
 
 using namespace impl;
@@ -72,8 +113,8 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
     return;
   }
   if (!is_adjacent(u, v)) {
-    auto& u_node = m_nodes.at(u);
-    auto& v_node = m_nodes.at(v);
+    auto& u_node = node(u);
+    auto& v_node = node(v);
     u_node.m_adjacent.push_back(v);
     v_node.m_adjacent.push_back(u);
     u_node.m_weight += edge_weight(u_node, v_node);
@@ -88,8 +129,10 @@ void Graph::add_edge(reg_t u, reg_t v, bool can_coalesce) {
   //
   // then the final state of the edge between s0 and s1 must be
   // non-coalesceable.
-  m_adj_matrix[build_edge(u, v)] =
-      m_adj_matrix[build_edge(u, v)] || !can_coalesce;
+  m_adj_matrix.set(
+      u, v,
+      AdjacencyMatrix::ADJACENT |
+          (can_coalesce ? 0 : AdjacencyMatrix::NOT_COALESCEABLE));
 }
 
 uint32_t Node::colorable_limit() const {
@@ -98,13 +141,27 @@ uint32_t Node::colorable_limit() const {
 
 bool Node::definitely_colorable() const { return weight() < colorable_limit(); }
 
-const Node& Graph::get_node(reg_t v) const { return m_nodes.at(v); }
+const Node& Graph::get_node(reg_t v) const {
+  always_assert_log(v < m_node_index.size() && m_node_index[v] != nullptr,
+                    "No node for v%u", v);
+  return *m_node_index[v];
+}
+
+Node& Graph::get_or_create_node(reg_t r) {
+  if (r >= m_node_index.size()) {
+    m_node_index.resize(r + 1, nullptr);
+  }
+  if (m_node_index[r] == nullptr) {
+    m_node_index[r] = &m_nodes[r];
+  }
+  return *m_node_index[r];
+}
 
 void Graph::combine(reg_t u, reg_t v) {
-  auto& u_node = m_nodes.at(u);
-  auto& v_node = m_nodes.at(v);
+  auto& u_node = node(u);
+  auto& v_node = node(v);
   for (auto t : v_node.adjacent()) {
-    auto& t_node = m_nodes.at(t);
+    auto& t_node = node(t);
     if (!t_node.is_active()) {
       continue;
     }
@@ -116,7 +173,7 @@ void Graph::combine(reg_t u, reg_t v) {
   u_node.m_spill_cost += v_node.m_spill_cost;
   v_node.m_props.reset(Node::ACTIVE);
   for (auto t : v_node.adjacent()) {
-    auto& t_node = m_nodes.at(t);
+    auto& t_node = node(t);
     if (!t_node.is_active()) {
       continue;
     }
@@ -131,9 +188,9 @@ void Graph::combine(reg_t u, reg_t v) {
 }
 
 void Graph::remove_node(reg_t u) {
-  auto& u_node = m_nodes.at(u);
+  auto& u_node = node(u);
   for (auto v : u_node.adjacent()) {
-    auto& v_node = m_nodes.at(v);
+    auto& v_node = node(v);
     if (!v_node.is_active()) {
       continue;
     }
@@ -204,7 +261,7 @@ void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
   auto op = insn->opcode();
   if (insn->has_dest()) {
     auto dest = insn->dest();
-    auto& node = graph->m_nodes[dest];
+    auto& node = graph->get_or_create_node(dest);
     if (opcode::is_a_load_param(op)) {
       node.m_props.set(Node::PARAM);
     }
@@ -219,7 +276,7 @@ void GraphBuilder::update_node_constraints(const cfg::InstructionIterator& it,
 
   for (size_t i = 0; i < insn->srcs_size(); ++i) {
     auto src = insn->src(i);
-    auto& node = graph->m_nodes[src];
+    auto& node = graph->get_or_create_node(src);
     auto type = src_reg_type(insn, i);
     node.m_type_domain.meet_with(RegisterTypeDomain(type));
     vreg_t max_vreg;
@@ -285,6 +342,7 @@ Graph GraphBuilder::build(const LivenessFixpointIterator& fixpoint_iter,
                           const RangeSet& range_set,
                           bool containment_edges) {
   Graph graph;
+  graph.m_adj_matrix.reserve(cfg.get_registers_size());
   auto ii = cfg::InstructionIterable(cfg);
   for (auto it = ii.begin(); it != ii.end(); ++it) {
     GraphBuilder::update_node_constraints(it, range_set, &graph);
@@ -379,11 +437,14 @@ std::ostream& Graph::write_dot_format(std::ostream& o) const {
   o << "}\n";
 
   o << "containment graph {\n";
-  for (const auto& pair : m_containment_graph) {
-    reg_t reg1 = static_cast<reg_t>((pair & 0xFFFFFFFF00000000) >> 32);
-    reg_t reg2 = static_cast<reg_t>(pair & 0x00000000FFFFFFFF);
-    o << reg1 << " -- " << reg2 << "\n";
-  }
+  m_adj_matrix.for_each([&o](reg_t lo, reg_t hi, uint8_t flags) {
+    if (flags & AdjacencyMatrix::CONTAINS_LO_HI) {
+      o << lo << " -- " << hi << "\n";
+    }
+    if (flags & AdjacencyMatrix::CONTAINS_HI_LO) {
+      o << hi << " -- " << lo << "\n";
+    }
+  });
   o << "}\n";
   return o;
 }
@@ -393,9 +454,10 @@ void GraphBuilder::make_node(Graph* graph,
                              RegisterType type,
                              vreg_t max_vreg) {
   always_assert(graph->m_nodes.find(r) == graph->m_nodes.end());
-  graph->m_nodes[r].m_type_domain.meet_with(RegisterTypeDomain(type));
-  graph->m_nodes[r].m_width = type == RegisterType::WIDE ? 2 : 1;
-  graph->m_nodes[r].m_max_vreg = max_vreg;
+  auto& node = graph->get_or_create_node(r);
+  node.m_type_domain.meet_with(RegisterTypeDomain(type));
+  node.m_width = type == RegisterType::WIDE ? 2 : 1;
+  node.m_max_vreg = max_vreg;
 }
 
 void GraphBuilder::add_edge(Graph* graph, reg_t u, reg_t v) {
@@ -73,12 +73,6 @@ namespace impl {
 
 class GraphBuilder;
 
-inline reg_pair_t build_containment_edge(reg_t u, reg_t v) {
-  reg_pair_t hi = static_cast<reg_pair_t>(u);
-  reg_pair_t lo = static_cast<reg_pair_t>(v);
-  return (hi << (sizeof(reg_t) * 8)) | lo;
-}
-
 inline reg_pair_t build_edge(reg_t u, reg_t v) {
   reg_pair_t hi = static_cast<reg_pair_t>(u);
   reg_pair_t lo = static_cast<reg_pair_t>(v);
@@ -88,6 +82,115 @@ inline reg_pair_t build_edge(reg_t u, reg_t v) {
   return (hi << (sizeof(reg_t) * 8)) | lo;
 }
 
+/*
+ * Records, for each unordered pair of registers, whether they interfere,
+ * whether that interference rules out coalescing them, and the containment
+ * edges between them in either direction.
+ *
+ * Registers are dense after renumbering, so as long as it stays small enough
+ * the matrix is a triangular bit-matrix with four bits per pair. This keeps
+ * the adjacency checks in the inner loops of coalescing, simplification and
+ * selection down to a shift and a mask. If the matrix would grow past
+ * kMaxDenseBits -- only huge generated methods need that many registers -- it
+ * moves its flags into a hash map keyed by build_edge() instead.
+ */
+class AdjacencyMatrix {
+ public:
+  enum Flag : uint8_t {
+    ADJACENT = 1,
+    NOT_COALESCEABLE = 2,
+    // Containment edge from the lower to the higher numbered register.
+    CONTAINS_LO_HI = 4,
+    // Containment edge from the higher to the lower numbered register.
+    CONTAINS_HI_LO = 8,
+  };
+
+  // 16 MiB, or roughly 8000 registers.
+  static constexpr size_t kMaxDenseBits = size_t(1) << 27;
+
+  static uint8_t containment_flag(reg_t u, reg_t v) {
+    return u < v ? CONTAINS_LO_HI : CONTAINS_HI_LO;
+  }
+
+  /*
+   * Makes room for the registers below `num_regs` up front, so that building
+   * the graph does not repeatedly grow the matrix.
+   */
+  void reserve(reg_t num_regs);
+
+  uint8_t get(reg_t u, reg_t v) const {
+    if (u == v) {
+      return 0;
+    }
+    if (u > v) {
+      std::swap(u, v);
+    }
+    if (!m_dense) {
+      auto it = m_sparse.find(build_edge(u, v));
+      return it == m_sparse.end() ? 0 : it->second;
+    }
+    if (v >= m_num_regs) {
+      return 0;
+    }
+    auto idx = index(u, v);
+    return (m_dense_bits[idx / kPairsPerWord] >> shift(idx)) & kPairMask;
+  }
+
+  // Adds `flags` to the flags of the pair {u, v}.
+  void set(reg_t u, reg_t v, uint8_t flags);
+
+  bool is_dense() const { return m_dense; }
+
+  /*
+   * Calls `f(lo, hi, flags)` for every pair with any flags set, where lo < hi.
+   */
+  template <typename F>
+  void for_each(F&& f) const {
+    if (!m_dense) {
+      for (const auto& pair : m_sparse) {
+        f(static_cast<reg_t>(pair.first >> (sizeof(reg_t) * 8)),
+          static_cast<reg_t>(pair.first),
+          pair.second);
+      }
+      return;
+    }
+    for (size_t hi = 1; hi < m_num_regs; ++hi) {
+      for (size_t lo = 0; lo < hi; ++lo) {
+        auto idx = index(lo, hi);
+        uint8_t flags =
+            (m_dense_bits[idx / kPairsPerWord] >> shift(idx)) & kPairMask;
+        if (flags != 0) {
+          f(static_cast<reg_t>(lo), static_cast<reg_t>(hi), flags);
+        }
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kBitsPerPair = 4;
+  static constexpr size_t kPairsPerWord = 64 / kBitsPerPair;
+  static constexpr uint64_t kPairMask = (1 << kBitsPerPair) - 1;
+
+  // The pairs {lo, hi} are laid out row by row, with one row per `hi`. Adding
+  // registers thus only ever appends to the matrix.
+  static size_t index(size_t lo, size_t hi) { return hi * (hi - 1) / 2 + lo; }
+
+  static size_t shift(size_t idx) {
+    return (idx % kPairsPerWord) * kBitsPerPair;
+  }
+
+  static size_t num_bits(size_t num_regs) {
+    return num_regs * (num_regs - 1) / 2 * kBitsPerPair;
+  }
+
+  void grow(size_t num_regs);
+
+  bool m_dense{true};
+  size_t m_num_regs{0};
+  std::vector<uint64_t> m_dense_bits;
+  std::unordered_map<reg_pair_t, uint8_t> m_sparse;
+};
+
 } // namespace impl
 
 class Node {
@@ -191,16 +294,16 @@ class Graph {
   }
 
   bool is_adjacent(reg_t u, reg_t v) const {
-    return m_adj_matrix.find(impl::build_edge(u, v)) != m_adj_matrix.end();
+    return m_adj_matrix.get(u, v) & impl::AdjacencyMatrix::ADJACENT;
   }
 
   bool is_coalesceable(reg_t u, reg_t v) const {
-    return !is_adjacent(u, v) || !m_adj_matrix.at(impl::build_edge(u, v));
+    return !(m_adj_matrix.get(u, v) & impl::AdjacencyMatrix::NOT_COALESCEABLE);
   }
 
   bool has_containment_edge(reg_t u, reg_t v) const {
-    return m_containment_graph.find(impl::build_containment_edge(u, v)) !=
-           m_containment_graph.end();
+    return m_adj_matrix.get(u, v) &
+           impl::AdjacencyMatrix::containment_flag(u, v);
   }
 
   void remove_node(reg_t);
@@ -218,19 +321,38 @@ class Graph {
   uint32_t edge_weight(const Node&, const Node&) const;
 
   Graph() = default;
+  // m_node_index points into m_nodes, so the graph can be moved but not
+  // copied.
+  Graph(const Graph&) = delete;
+  Graph(Graph&&) = default;
+  Graph& operator=(const Graph&) = delete;
+  Graph& operator=(Graph&&) = default;
+
   void add_edge(reg_t, reg_t, bool can_coalesce = false);
   void add_coalesceable_edge(reg_t u, reg_t v) { add_edge(u, v, true); }
   void add_containment_edge(reg_t u, reg_t v) {
     if (u == v) {
       return;
     }
-    m_containment_graph.emplace(impl::build_containment_edge(u, v));
+    m_adj_matrix.set(u, v, impl::AdjacencyMatrix::containment_flag(u, v));
   }
 
  private:
+  Node& node(reg_t r) {
+    always_assert_log(r < m_node_index.size() && m_node_index[r] != nullptr,
+                      "No node for v%u", r);
+    return *m_node_index[r];
+  }
+
+  // Returns the node for `r`, creating it if there is none yet.
+  Node& get_or_create_node(reg_t r);
+
+  // Iterated in hash map order, which the allocator's choices depend on.
   std::unordered_map<reg_t, Node> m_nodes;
-  std::unordered_map<reg_pair_t, bool> m_adj_matrix;
-  std::unordered_set<reg_pair_t> m_containment_graph;
+  // Maps each register to its node in m_nodes, so that looking up a node is
+  // an array access. Registers without a node map to nullptr.
+  std::vector<Node*> m_node_index;
+  impl::AdjacencyMatrix m_adj_matrix;
 
   friend class impl::GraphBuilder;
 };
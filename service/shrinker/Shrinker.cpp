@@ -112,12 +112,12 @@ Shrinker::Shrinker(
           m_pure_methods, m_finalish_field_names, m_finalish_fields);
     }
     if (config.run_local_dce && config.compute_pure_methods) {
-      std::unique_ptr<const method_override_graph::Graph> owned_override_graph;
+      std::shared_ptr<const method_override_graph::Graph> owned_override_graph;
       const method_override_graph::Graph* override_graph;
       if (config.run_cse) {
         override_graph = m_cse_shared_state->get_method_override_graph();
       } else {
-        owned_override_graph = method_override_graph::build_graph(scope);
+        owned_override_graph = method_override_graph::get_or_build_graph(scope);
         override_graph = owned_override_graph.get();
       }
       std::unordered_set<const DexMethod*> computed_no_side_effects_methods;
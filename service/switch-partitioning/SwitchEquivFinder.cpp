@@ -483,16 +483,17 @@ void SwitchEquivFinder::normalize_extra_loads(
   }
 
   // Use ReachingDefinitions to find the loads that are used outside the if-else
-  // chain blocks
+  // chain blocks. Only which loads reach a use matters, so the dense analysis
+  // does.
   std::unordered_set<IRInstruction*> used_defs;
-  reaching_defs::FixpointIterator fixpoint_iter(*m_cfg);
-  fixpoint_iter.run(reaching_defs::Environment());
+  reaching_defs::DenseFixpointIterator fixpoint_iter(*m_cfg);
+  fixpoint_iter.run(reaching_defs::DenseDomain());
   for (cfg::Block* block : m_cfg->blocks()) {
     auto search = block_to_is_leaf.find(block);
     if (search != block_to_is_leaf.end() && !search->second) {
       continue;
     }
-    reaching_defs::Environment defs_in =
+    reaching_defs::DenseDomain defs_in =
         fixpoint_iter.get_entry_state_at(block);
     if (defs_in.is_bottom()) {
       continue;
@@ -501,9 +502,9 @@ void SwitchEquivFinder::normalize_extra_loads(
       auto insn = mie.insn;
       for (size_t i = 0; i < insn->srcs_size(); ++i) {
         auto src = insn->src(i);
-        const auto& defs = defs_in.get(src);
-        always_assert_log(!defs.is_top(), "Undefined register v%u", src);
-        for (IRInstruction* def : defs.elements()) {
+        auto defs = fixpoint_iter.get_definitions(defs_in, src);
+        always_assert_log(!defs.empty(), "Undefined register v%u", src);
+        for (IRInstruction* def : defs) {
           if (extra_loads.count(def)) {
             used_defs.insert(def);
           }
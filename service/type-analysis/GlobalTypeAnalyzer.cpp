@@ -410,7 +410,7 @@ void GlobalTypeAnalysis::find_any_init_reachables(
 
 std::unique_ptr<GlobalTypeAnalyzer> GlobalTypeAnalysis::analyze(
     const Scope& scope) {
-  auto method_override_graph = mog::build_graph(scope);
+  auto method_override_graph = mog::get_or_build_graph(scope);
   auto cg = std::make_shared<call_graph::Graph>(
       call_graph::single_callee_graph(*method_override_graph, scope));
   // Rebuild all CFGs here -- this should be more efficient than doing them
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+
+namespace sparta {
+
+/*
+ * A set of unsigned integers represented as a dense bit vector.
+ *
+ * This is the representation of choice when the elements are densely numbered
+ * from 0, e.g. the registers or the definitions in a method: membership tests
+ * and updates are a shift and a mask, and the set operations are loops over
+ * 64-bit words that compilers turn into SIMD code. The bit vector grows as
+ * needed; bits beyond its end are considered cleared, so that sets of
+ * different lengths can be combined. Iteration is in increasing order.
+ *
+ * Unlike Patricia-tree sets, bit-vector sets do not share structure, hence
+ * copying one takes time proportional to its largest element.
+ */
+template <typename Element>
+class BitVectorSet final {
+  static_assert(std::is_unsigned_v<Element>,
+                "Element is not an unsigned arithmetic type");
+
+  using Word = uint64_t;
+  static constexpr size_t kWordBits = 64;
+
+ public:
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Element*;
+    using reference = Element;
+
+    Element operator*() const { return static_cast<Element>(m_index); }
+
+    iterator& operator++() {
+      ++m_index;
+      skip_cleared();
+      return *this;
+    }
+
+    iterator operator++(int) {
+      iterator it = *this;
+      ++(*this);
+      return it;
+    }
+
+    bool operator==(const iterator& other) const {
+      return m_index == other.m_index;
+    }
+
+    bool operator!=(const iterator& other) const { return !(*this == other); }
+
+   private:
+    iterator(const std::vector<Word>* words, size_t index)
+        : m_words(words), m_index(index) {
+      skip_cleared();
+    }
+
+    // Advances to the next set bit, one word at a time.
+    void skip_cleared() {
+      size_t end = m_words->size() * kWordBits;
+      while (m_index < end) {
+        Word word = (*m_words)[m_index / kWordBits] >> (m_index % kWordBits);
+        if (word != 0) {
+          m_index += __builtin_ctzll(word);
+          return;
+        }
+        m_index = (m_index / kWordBits + 1) * kWordBits;
+      }
+      m_index = end;
+    }
+
+    const std::vector<Word>* m_words;
+    size_t m_index;
+
+    friend class BitVectorSet;
+  };
+
+  using value_type = Element;
+  using const_iterator = iterator;
+  using difference_type = std::ptrdiff_t;
+  using size_type = size_t;
+
+  BitVectorSet() = default;
+
+  explicit BitVectorSet(Element e) { insert(e); }
+
+  explicit BitVectorSet(std::initializer_list<Element> l) {
+    for (Element e : l) {
+      insert(e);
+    }
+  }
+
+  template <typename InputIterator>
+  BitVectorSet(InputIterator first, InputIterator last) {
+    for (auto it = first; it != last; ++it) {
+      insert(*it);
+    }
+  }
+
+  /*
+   * Makes room for the elements below `universe_size`, so that inserting them
+   * does not reallocate.
+   */
+  void reserve(size_t universe_size) {
+    size_t num_words = (universe_size + kWordBits - 1) / kWordBits;
+    if (num_words > m_words.size()) {
+      m_words.resize(num_words, 0);
+    }
+  }
+
+  bool empty() const {
+    return std::all_of(
+        m_words.begin(), m_words.end(), [](Word w) { return w == 0; });
+  }
+
+  size_t size() const {
+    size_t size = 0;
+    for (Word w : m_words) {
+      size += __builtin_popcountll(w);
+    }
+    return size;
+  }
+
+  iterator begin() const { return iterator(&m_words, 0); }
+
+  iterator end() const {
+    return iterator(&m_words, m_words.size() * kWordBits);
+  }
+
+  bool contains(Element e) const {
+    size_t idx = static_cast<size_t>(e) / kWordBits;
+    return idx < m_words.size() && ((m_words[idx] >> (e % kWordBits)) & 1);
+  }
+
+  BitVectorSet& insert(Element e) {
+    size_t idx = static_cast<size_t>(e) / kWordBits;
+    if (idx >= m_words.size()) {
+      m_words.resize(idx + 1, 0);
+    }
+    m_words[idx] |= Word(1) << (e % kWordBits);
+    return *this;
+  }
+
+  BitVectorSet& remove(Element e) {
+    size_t idx = static_cast<size_t>(e) / kWordBits;
+    if (idx < m_words.size()) {
+      m_words[idx] &= ~(Word(1) << (e % kWordBits));
+    }
+    return *this;
+  }
+
+  bool is_subset_of(const BitVectorSet& other) const {
+    size_t common = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < common; ++i) {
+      if ((m_words[i] & ~other.m_words[i]) != 0) {
+        return false;
+      }
+    }
+    return all_cleared_from(common);
+  }
+
+  bool equals(const BitVectorSet& other) const {
+    size_t common = std::min(m_words.size(), other.m_words.size());
+    for (size_t i = 0; i < common; ++i) {
+      if (m_words[i] != other.m_words[i]) {
+        return false;
+      }
+    }
+    return all_cleared_from(common) && other.all_cleared_from(common);
+  }
+
+  friend bool operator==(const BitVectorSet& s1, const BitVectorSet& s2) {
+    return s1.equals(s2);
+  }
+
+  friend bool operator!=(const BitVectorSet& s1, const BitVectorSet& s2) {
+    return !s1.equals(s2);
+  }
+
+  BitVectorSet& union_with(const BitVectorSet& other) {
+    if (other.m_words.size() > m_words.size()) {
+      m_words.resize(other.m_words.size(), 0);
+    }
+    Word* words = m_words.data();
+    const Word* other_words = other.m_words.data();
+    for (size_t i = 0, n = other.m_words.size(); i < n; ++i) {
+      words[i] |= other_words[i];
+    }
+    return *this;
+  }
+
+  BitVectorSet& intersection_with(const BitVectorSet& other) {
+    if (m_words.size() > other.m_words.size()) {
+      m_words.resize(other.m_words.size());
+    }
+    Word* words = m_words.data();
+    const Word* other_words = other.m_words.data();
+    for (size_t i = 0, n = m_words.size(); i < n; ++i) {
+      words[i] &= other_words[i];
+    }
+    return *this;
+  }
+
+  BitVectorSet& difference_with(const BitVectorSet& other) {
+    Word* words = m_words.data();
+    const Word* other_words = other.m_words.data();
+    for (size_t i = 0, n = std::min(m_words.size(), other.m_words.size());
+         i < n;
+         ++i) {
+      words[i] &= ~other_words[i];
+    }
+    return *this;
+  }
+
+  void clear() { m_words.clear(); }
+
+ private:
+  bool all_cleared_from(size_t word_idx) const {
+    return std::all_of(m_words.begin() + std::min(word_idx, m_words.size()),
+                       m_words.end(),
+                       [](Word w) { return w == 0; });
+  }
+
+  std::vector<Word> m_words;
+};
+
+template <typename Element>
+inline std::ostream& operator<<(std::ostream& o,
+                                const BitVectorSet<Element>& s) {
+  o << "{";
+  for (auto it = s.begin(); it != s.end();) {
+    o << *it++;
+    if (it != s.end()) {
+      o << ", ";
+    }
+  }
+  o << "}";
+  return o;
+}
+
+} // namespace sparta
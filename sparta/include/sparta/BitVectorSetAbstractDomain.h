@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+
+#include <sparta/BitVectorSet.h>
+#include <sparta/PowersetAbstractDomain.h>
+
+namespace sparta {
+
+namespace bvsad_impl {
+
+/*
+ * An abstract value from a powerset is implemented as a dense bit vector.
+ */
+template <typename Element>
+class SetValue final
+    : public PowersetImplementation<Element,
+                                    const BitVectorSet<Element>&,
+                                    SetValue<Element>> {
+ public:
+  SetValue() = default;
+
+  SetValue(Element e) : m_set(e) {}
+
+  SetValue(std::initializer_list<Element> l) : m_set(l.begin(), l.end()) {}
+
+  SetValue(BitVectorSet<Element> set) : m_set(std::move(set)) {}
+
+  const BitVectorSet<Element>& elements() const { return m_set; }
+
+  size_t size() const { return m_set.size(); }
+
+  bool contains(const Element& e) const { return m_set.contains(e); }
+
+  void add(const Element& e) { m_set.insert(e); }
+
+  void add(Element&& e) { m_set.insert(e); }
+
+  void remove(const Element& e) { m_set.remove(e); }
+
+  void clear() { m_set.clear(); }
+
+  AbstractValueKind kind() const { return AbstractValueKind::Value; }
+
+  bool leq(const SetValue& other) const {
+    return m_set.is_subset_of(other.m_set);
+  }
+
+  bool equals(const SetValue& other) const { return m_set.equals(other.m_set); }
+
+  AbstractValueKind join_with(const SetValue& other) {
+    m_set.union_with(other.m_set);
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind meet_with(const SetValue& other) {
+    m_set.intersection_with(other.m_set);
+    return AbstractValueKind::Value;
+  }
+
+  AbstractValueKind difference_with(const SetValue& other) {
+    m_set.difference_with(other.m_set);
+    return AbstractValueKind::Value;
+  }
+
+  friend std::ostream& operator<<(std::ostream& o, const SetValue& value) {
+    o << "[#" << value.size() << "]";
+    o << value.m_set;
+    return o;
+  }
+
+ private:
+  BitVectorSet<Element> m_set;
+};
+
+} // namespace bvsad_impl
+
+/*
+ * A powerset abstract domain over densely numbered unsigned integers, e.g.
+ * registers or the definitions in a method, represented as bit vectors.
+ *
+ * This has the same interface as PatriciaTreeSetAbstractDomain, but the
+ * lattice operations are word-wise loops rather than tree traversals. Use
+ * it for analyses over small, dense universes, where a set rarely has many
+ * fewer elements than the universe. See GenKillFixpointIterator for solving
+ * gen/kill problems over this domain.
+ */
+template <typename Element>
+class BitVectorSetAbstractDomain final
+    : public PowersetAbstractDomain<Element,
+                                    bvsad_impl::SetValue<Element>,
+                                    const BitVectorSet<Element>&,
+                                    BitVectorSetAbstractDomain<Element>> {
+ public:
+  using Value = bvsad_impl::SetValue<Element>;
+
+  BitVectorSetAbstractDomain()
+      : PowersetAbstractDomain<Element,
+                               Value,
+                               const BitVectorSet<Element>&,
+                               BitVectorSetAbstractDomain>() {}
+
+  BitVectorSetAbstractDomain(AbstractValueKind kind)
+      : PowersetAbstractDomain<Element,
+                               Value,
+                               const BitVectorSet<Element>&,
+                               BitVectorSetAbstractDomain>(kind) {}
+
+  explicit BitVectorSetAbstractDomain(Element e) {
+    this->set_to_value(Value(e));
+  }
+
+  explicit BitVectorSetAbstractDomain(std::initializer_list<Element> l) {
+    this->set_to_value(Value(l));
+  }
+
+  explicit BitVectorSetAbstractDomain(BitVectorSet<Element> set) {
+    this->set_to_value(Value(std::move(set)));
+  }
+
+  static BitVectorSetAbstractDomain bottom() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Bottom);
+  }
+
+  static BitVectorSetAbstractDomain top() {
+    return BitVectorSetAbstractDomain(AbstractValueKind::Top);
+  }
+};
+
+} // namespace sparta
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_map>
+
+#include <sparta/BitVectorSetAbstractDomain.h>
+#include <sparta/MonotonicFixpointIterator.h>
+
+namespace sparta {
+
+/*
+ * A transfer function of the form S -> (S \ kill) ∪ gen over a bit-vector
+ * domain. It is built up with the same add() and remove() operations as the
+ * domain itself, so that one description of the effect of a statement, when
+ * written as a template over the state type, serves both to summarize a
+ * whole node and to step through its statements one by one.
+ */
+template <typename Element>
+class GenKillTransformer final {
+ public:
+  using Domain = BitVectorSetAbstractDomain<Element>;
+
+  void add(const Element& e) { m_gen.add(e); }
+
+  template <typename InputIterator>
+  void add(InputIterator first, InputIterator last) {
+    m_gen.add(first, last);
+  }
+
+  void remove(const Element& e) {
+    m_gen.remove(e);
+    m_kill.add(e);
+  }
+
+  template <typename InputIterator>
+  void remove(InputIterator first, InputIterator last) {
+    m_gen.remove(first, last);
+    m_kill.add(first, last);
+  }
+
+  const Domain& gen() const { return m_gen; }
+
+  const Domain& kill() const { return m_kill; }
+
+  void apply(Domain* state) const {
+    // Nothing flows out of an unreachable node, and Top absorbs everything.
+    if (state->kind() != AbstractValueKind::Value) {
+      return;
+    }
+    state->difference_with(m_kill);
+    state->join_with(m_gen);
+  }
+
+ private:
+  Domain m_gen;
+  Domain m_kill;
+};
+
+/*
+ * A fixpoint iterator for bit-vector problems in the classical gen/kill form,
+ * like liveness or reaching definitions.
+ *
+ * Instead of going through the statements of a node each time the node is
+ * analyzed, the iterator summarizes each node once into a GenKillTransformer,
+ * via summarize_node(), and then only applies that. Summaries are computed
+ * lazily and dropped at the start of each run(), so that the iterator can be
+ * run again after the statements in the nodes change. Since the summaries are
+ * cached as the iteration proceeds, this iterator is sequential.
+ */
+template <typename GraphInterface,
+          typename Element,
+          typename NodeHash = std::hash<typename GraphInterface::NodeId>>
+class GenKillFixpointIterator
+    : public MonotonicFixpointIterator<GraphInterface,
+                                       BitVectorSetAbstractDomain<Element>,
+                                       NodeHash> {
+ public:
+  using Base = MonotonicFixpointIterator<GraphInterface,
+                                         BitVectorSetAbstractDomain<Element>,
+                                         NodeHash>;
+  using Graph = typename GraphInterface::Graph;
+  using NodeId = typename GraphInterface::NodeId;
+  using EdgeId = typename GraphInterface::EdgeId;
+  using Domain = BitVectorSetAbstractDomain<Element>;
+  using Transformer = GenKillTransformer<Element>;
+
+  GenKillFixpointIterator(const Graph& graph, size_t cfg_size_hint = 4)
+      : Base(graph, cfg_size_hint), m_transformers(cfg_size_hint) {}
+
+  /*
+   * Describes the effect of the node by applying the effects of its statements
+   * to `transformer`, in the order in which they are analyzed.
+   */
+  virtual void summarize_node(const NodeId& node,
+                              Transformer* transformer) const = 0;
+
+  void run(const Domain& init) {
+    m_transformers.clear();
+    Base::run(init);
+  }
+
+  void analyze_node(const NodeId& node, Domain* current_state) const override {
+    auto it = m_transformers.find(node);
+    if (it == m_transformers.end()) {
+      it = m_transformers.emplace(node, Transformer()).first;
+      summarize_node(node, &it->second);
+    }
+    it->second.apply(current_state);
+  }
+
+  Domain analyze_edge(const EdgeId&,
+                      const Domain& exit_state_at_source) const override {
+    return exit_state_at_source;
+  }
+
+ private:
+  mutable std::unordered_map<NodeId, Transformer, NodeHash> m_transformers;
+};
+
+} // namespace sparta
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+
+#include "IRAssembler.h"
+#include "Liveness.h"
+#include "ReachingDefinitions.h"
+#include "RedexTest.h"
+
+namespace {
+
+/*
+ * A method with `num_regs` registers that are all live around `num_loops`
+ * nested loops, each made of a few blocks of arithmetic.
+ */
+std::unique_ptr<IRCode> make_method(size_t num_regs, size_t num_loops) {
+  std::ostringstream ss;
+  ss << "(";
+  for (size_t r = 0; r < num_regs; ++r) {
+    ss << "(const v" << r << " " << r << ")";
+  }
+  for (size_t l = 0; l < num_loops; ++l) {
+    ss << "(:loop" << l << ")";
+    for (size_t r = 0; r + 1 < num_regs; ++r) {
+      ss << "(add-int v" << r << " v" << r << " v" << r + 1 << ")";
+      if (r % 16 == 15) {
+        ss << "(if-eqz v" << r << " :skip" << l << "_" << r << ")";
+        ss << "(const v" << r + 1 << " 0)";
+        ss << "(:skip" << l << "_" << r << ")";
+      }
+    }
+  }
+  for (size_t l = num_loops; l-- > 0;) {
+    ss << "(if-nez v" << l << " :loop" << l << ")";
+  }
+  ss << "(return v0))";
+  return assembler::ircode_from_string(ss.str());
+}
+
+template <typename Fn>
+double time_ms(const Fn& fn, int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         iterations;
+}
+
+class DenseDataflowPerfTest : public RedexTest {};
+
+} // namespace
+
+TEST_F(DenseDataflowPerfTest, liveness) {
+  constexpr int kIterations = 10;
+  auto code = make_method(/* num_regs */ 256, /* num_loops */ 8);
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+
+  double patricia_ms = time_ms(
+      [&] {
+        LivenessFixpointIterator fp_iter(cfg);
+        fp_iter.run(LivenessDomain());
+      },
+      kIterations);
+  double dense_ms = time_ms(
+      [&] {
+        DenseLivenessFixpointIterator fp_iter(cfg);
+        fp_iter.run(DenseLivenessDomain());
+      },
+      kIterations);
+  printf("Liveness over %zu blocks: patricia %.2f ms, dense %.2f ms\n",
+         cfg.num_blocks(), patricia_ms, dense_ms);
+
+  LivenessFixpointIterator fp_iter(cfg);
+  fp_iter.run(LivenessDomain());
+  DenseLivenessFixpointIterator dense_fp_iter(cfg);
+  dense_fp_iter.run(DenseLivenessDomain());
+  for (auto* block : cfg.blocks()) {
+    const auto& live_in = fp_iter.get_live_in_vars_at(block);
+    const auto& dense_live_in = dense_fp_iter.get_live_in_vars_at(block);
+    EXPECT_EQ(live_in.size(), dense_live_in.size());
+    for (reg_t reg : live_in.elements()) {
+      EXPECT_TRUE(dense_live_in.contains(reg));
+    }
+  }
+
+  code->clear_cfg();
+}
+
+TEST_F(DenseDataflowPerfTest, reachingDefinitions) {
+  constexpr int kIterations = 10;
+  auto code = make_method(/* num_regs */ 256, /* num_loops */ 8);
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+
+  double patricia_ms = time_ms(
+      [&] {
+        reaching_defs::FixpointIterator fp_iter(cfg);
+        fp_iter.run(reaching_defs::Environment());
+      },
+      kIterations);
+  double dense_ms = time_ms(
+      [&] {
+        reaching_defs::DenseFixpointIterator fp_iter(cfg);
+        fp_iter.run(reaching_defs::DenseDomain());
+      },
+      kIterations);
+  printf("Reaching definitions over %zu blocks: patricia %.2f ms, "
+         "dense %.2f ms\n",
+         cfg.num_blocks(), patricia_ms, dense_ms);
+
+  // Every register is defined at the top of the method, so the environment
+  // never has Top for it and both analyses must agree exactly.
+  reaching_defs::FixpointIterator fp_iter(cfg);
+  fp_iter.run(reaching_defs::Environment());
+  reaching_defs::DenseFixpointIterator dense_fp_iter(cfg);
+  dense_fp_iter.run(reaching_defs::DenseDomain());
+  const auto& env = fp_iter.get_exit_state_at(cfg.exit_block());
+  const auto& state = dense_fp_iter.get_exit_state_at(cfg.exit_block());
+  for (reg_t reg = 0; reg < cfg.get_registers_size(); ++reg) {
+    auto defs = env.get(reg);
+    ASSERT_FALSE(defs.is_top());
+    auto dense_defs = dense_fp_iter.get_definitions(state, reg);
+    EXPECT_EQ(defs.size(), dense_defs.size());
+    for (auto* def : dense_defs) {
+      EXPECT_TRUE(defs.contains(def));
+    }
+  }
+
+  code->clear_cfg();
+}
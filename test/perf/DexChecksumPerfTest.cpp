@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <zlib.h>
+
+#include "Adler32.h"
+#include "Sha1.h"
+
+namespace {
+
+struct Checksums {
+  uint8_t signature[20];
+  uint32_t checksum;
+};
+
+// What DexOutput::finalize_header used to do: two separate passes.
+Checksums separate_passes(const std::vector<uint8_t>& dex) {
+  Checksums res;
+  Sha1Context context;
+  sha1_init(&context);
+  sha1_update(&context, dex.data() + 32, dex.size() - 32);
+  sha1_final(res.signature, &context);
+  uint32_t adler = (uint32_t)adler32(0L, Z_NULL, 0);
+  adler = (uint32_t)adler32(adler, res.signature, sizeof(res.signature));
+  res.checksum = (uint32_t)adler32(adler, dex.data() + 32, dex.size() - 32);
+  return res;
+}
+
+// What DexOutput::finalize_header does now: one chunked pass.
+Checksums fused_pass(const std::vector<uint8_t>& dex) {
+  Checksums res;
+  constexpr size_t kChunkSize = 64 * 1024;
+  Sha1Context context;
+  sha1_init(&context);
+  uint32_t data_adler = (uint32_t)adler32(0L, Z_NULL, 0);
+  for (size_t offset = 32; offset < dex.size(); offset += kChunkSize) {
+    size_t size = std::min(kChunkSize, dex.size() - offset);
+    sha1_update(&context, dex.data() + offset, size);
+    data_adler = adler32_update(data_adler, dex.data() + offset, size);
+  }
+  sha1_final(res.signature, &context);
+  uint32_t adler = adler32_update((uint32_t)adler32(0L, Z_NULL, 0),
+                                  res.signature, sizeof(res.signature));
+  res.checksum =
+      (uint32_t)adler32_combine(adler, data_adler, dex.size() - 32);
+  return res;
+}
+
+template <typename Fn>
+double time_ms(const Fn& fn, int iterations) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    fn();
+  }
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(end - start).count() /
+         iterations;
+}
+
+} // namespace
+
+TEST(DexChecksumPerfTest, fusedHardwarePassVsSeparatePasses) {
+  constexpr size_t kDexSize = 12 * 1024 * 1024;
+  constexpr int kIterations = 10;
+  std::mt19937 rng(0);
+  std::vector<uint8_t> dex(kDexSize);
+  for (auto& b : dex) {
+    b = (uint8_t)rng();
+  }
+
+  bool hardware = sha1_use_hardware(false);
+  adler32_use_simd(false);
+  Checksums before = separate_passes(dex);
+  double before_ms =
+      time_ms([&] { before = separate_passes(dex); }, kIterations);
+
+  hardware = sha1_use_hardware(true);
+  bool simd = adler32_use_simd(true);
+  Checksums after = fused_pass(dex);
+  double after_ms = time_ms([&] { after = fused_pass(dex); }, kIterations);
+
+  printf("Per 12 MiB dex: separate passes %.2f ms, fused pass %.2f ms "
+         "(sha extensions: %d, simd adler32: %d)\n",
+         before_ms, after_ms, hardware, simd);
+  EXPECT_EQ(memcmp(before.signature, after.signature, 20), 0);
+  EXPECT_EQ(before.checksum, after.checksum);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+#include "DexCommon.h"
+#include "DexIndex.h"
+
+/*
+ * Compares dexgrep's linear scan against an index query. The input dex named
+ * by $dex_index_perf_dex is searched kNumCopies times, standing in for a
+ * large set of APKs.
+ */
+namespace {
+
+constexpr int kNumCopies = 200;
+constexpr int kNumQueries = 5;
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+size_t linear_scan(const char* dexfile, const std::regex& re) {
+  size_t matches = 0;
+  for (int copy = 0; copy < kNumCopies; copy++) {
+    ddump_data rd;
+    open_dex_file(dexfile, &rd);
+    for (uint32_t j = 0; j < rd.dexh->class_defs_size; j++) {
+      dex_class_def* cls_def = rd.dex_class_defs + j;
+      if (std::regex_search(dex_string_by_type_idx(&rd, cls_def->typeidx),
+                            re)) {
+        matches++;
+      }
+    }
+    munmap(rd.dexmmap, rd.dex_size);
+  }
+  return matches;
+}
+
+} // namespace
+
+TEST(DexIndexPerfTest, LinearScanVsIndex) {
+  const char* dexfile = std::getenv("dex_index_perf_dex");
+  if (dexfile == nullptr) {
+    GTEST_SKIP() << "set dex_index_perf_dex to a dex file";
+  }
+  char index_path[] = "/tmp/dex_index_perf_XXXXXX";
+  int fd = mkstemp(index_path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    dex_index::IndexWriter writer;
+    std::vector<std::string> names;
+    for (int copy = 0; copy < kNumCopies; copy++) {
+      names.push_back(std::string(dexfile) + "#" + std::to_string(copy));
+    }
+    for (const auto& name : names) {
+      ddump_data rd;
+      open_dex_file(dexfile, &rd);
+      rd.dex_filename = name.c_str();
+      writer.add_dex(&rd);
+      munmap(rd.dexmmap, rd.dex_size);
+    }
+    writer.write(index_path);
+  }
+  printf("build index: %.1f ms\n", elapsed_ms(start));
+
+  const char* patterns[] = {"Fragment", "pages/.*Factory",
+                            "Lcom/.*/[A-Z]+Model;", "N[0-9]a",
+                            "(Block|Schedule)"};
+  for (const char* pattern : patterns) {
+    std::regex re(pattern);
+
+    start = std::chrono::steady_clock::now();
+    size_t linear_matches = 0;
+    for (int i = 0; i < kNumQueries; i++) {
+      linear_matches = linear_scan(dexfile, re);
+    }
+    double linear_ms = elapsed_ms(start) / kNumQueries;
+
+    start = std::chrono::steady_clock::now();
+    size_t index_matches = 0;
+    for (int i = 0; i < kNumQueries; i++) {
+      // Include opening the index, as every dexgrep invocation does.
+      dex_index::Index index(index_path);
+      index_matches = 0;
+      index.search(re, dex_index::required_literals(pattern),
+                   dex_index::kind_bit(dex_index::EntryKind::CLASS),
+                   [&](const dex_index::Match&) { index_matches++; });
+    }
+    double index_ms = elapsed_ms(start) / kNumQueries;
+
+    EXPECT_EQ(linear_matches, index_matches) << pattern;
+    printf("%-24s %6zu matches  linear %8.2f ms  index %6.2f ms\n", pattern,
+           linear_matches, linear_ms, index_ms);
+  }
+  unlink(index_path);
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Creators.h"
+#include "DexClass.h"
+#include "RedexTest.h"
+#include "Walkers.h"
+
+namespace {
+
+constexpr size_t kNumClasses = 20000;
+constexpr size_t kMethodsPerClass = 50;
+constexpr int kIterations = 5;
+
+// Stands in for a DexMethod as it was allocated before RedexContext pooled
+// method storage: one heap allocation of the same size per method, holding
+// the members a scan reads.
+struct HeapMethodMembers {
+  std::atomic<uint8_t> balloon_state{0};
+  DexAccessFlags access;
+  const IRCode* code;
+  ReferencedState rstate;
+};
+struct HeapMethod {
+  HeapMethodMembers members;
+  char padding[sizeof(DexMethod) - sizeof(HeapMethodMembers)];
+};
+static_assert(sizeof(HeapMethod) == sizeof(DexMethod));
+
+// Creates classes the way the loader does: all methods of a class in a row,
+// interleaved with allocations of other objects of a similar size, like code
+// items, annotations and strings. Also heap allocates a HeapMethod for each
+// method alongside.
+Scope create_scope(std::vector<std::unique_ptr<char[]>>* other_objects,
+                   std::vector<std::unique_ptr<HeapMethod>>* heap_methods) {
+  Scope scope;
+  scope.reserve(kNumClasses);
+  for (size_t i = 0; i < kNumClasses; i++) {
+    auto cls_name = "LWalkerPerf" + std::to_string(i) + ";";
+    ClassCreator creator(DexType::make_type(cls_name));
+    creator.set_super(type::java_lang_Object());
+    for (size_t j = 0; j < kMethodsPerClass; j++) {
+      bool is_virtual = j % 2 == 1;
+      auto method =
+          DexMethod::make_method(cls_name, "m" + std::to_string(j), {}, "V")
+              ->make_concrete(is_virtual ? ACC_PUBLIC : ACC_PRIVATE,
+                              is_virtual);
+      creator.add_method(method);
+      auto heap_method = std::make_unique<HeapMethod>();
+      heap_method->members.access = method->get_access();
+      heap_method->members.code = method->get_code();
+      heap_method->members.rstate = method->rstate;
+      heap_methods->push_back(std::move(heap_method));
+      other_objects->push_back(std::make_unique<char[]>(96));
+    }
+    scope.push_back(creator.create());
+  }
+  return scope;
+}
+
+// Reads what most passes look at for every method.
+size_t scan(const DexMethod* method) {
+  return (method->get_access() & ACC_PUBLIC) +
+         (method->get_code() == nullptr) + method->rstate.can_rename();
+}
+
+// The same reads as above, including the check that get_code() makes.
+size_t scan(const HeapMethod* method) {
+  const auto& members = method->members;
+  if (members.balloon_state.load(std::memory_order_acquire) != 0) {
+    return 0;
+  }
+  return (members.access & ACC_PUBLIC) + (members.code == nullptr) +
+         members.rstate.can_rename();
+}
+
+template <typename Fn>
+double time_ms(const Fn& fn) {
+  double best = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+    best = i == 0 ? ms : std::min(best, ms);
+  }
+  return best;
+}
+
+} // namespace
+
+class WalkerPerfTest : public RedexTest {};
+
+/*
+ * Scans all methods in class order, as walk::methods visits them, and in a
+ * random order. DexMethod keeps the members such scans read in its first 64
+ * bytes, and RedexContext allocates the methods of a class next to each other,
+ * so the class-order scan should be faster than the random one, which misses
+ * the cache for nearly every method like a scan over scattered objects would.
+ * The class order is also compared against the same scan over individually
+ * heap allocated objects of the same size, the layout before methods were
+ * pooled.
+ */
+TEST_F(WalkerPerfTest, scanMethodsInClassOrderVsRandomOrder) {
+  std::vector<std::unique_ptr<char[]>> other_objects;
+  std::vector<std::unique_ptr<HeapMethod>> heap_methods;
+  Scope scope = create_scope(&other_objects, &heap_methods);
+
+  std::vector<DexMethod*> methods;
+  walk::methods(scope, [&](DexMethod* m) { methods.push_back(m); });
+  ASSERT_EQ(methods.size(), kNumClasses * kMethodsPerClass);
+
+  // Both orders are scanned the same way, so that they only differ in how
+  // the methods are laid out relative to the order in which they are read.
+  size_t in_order = 0;
+  double in_order_ms = time_ms([&] {
+    in_order = 0;
+    for (auto* m : methods) {
+      in_order += scan(m);
+    }
+  });
+
+  size_t heap_order = 0;
+  double heap_order_ms = time_ms([&] {
+    heap_order = 0;
+    for (auto& m : heap_methods) {
+      heap_order += scan(m.get());
+    }
+  });
+
+  std::shuffle(methods.begin(), methods.end(), std::mt19937(0));
+  size_t random_order = 0;
+  double random_order_ms = time_ms([&] {
+    random_order = 0;
+    for (auto* m : methods) {
+      random_order += scan(m);
+    }
+  });
+
+  std::atomic<size_t> parallel{0};
+  double parallel_ms = time_ms([&] {
+    parallel = 0;
+    walk::parallel::methods(scope, [&](DexMethod* m) { parallel += scan(m); });
+  });
+
+  auto per_method = [&](double ms) { return ms * 1e6 / methods.size(); };
+  printf("%zu methods: class order %.2f ms (%.1f ns/method), heap allocated "
+         "%.2f ms (%.1f ns/method), random order %.2f ms (%.1f ns/method), "
+         "walk::parallel %.2f ms\n",
+         methods.size(), in_order_ms, per_method(in_order_ms), heap_order_ms,
+         per_method(heap_order_ms), random_order_ms,
+         per_method(random_order_ms), parallel_ms);
+  EXPECT_EQ(in_order, heap_order);
+  EXPECT_EQ(in_order, random_order);
+  EXPECT_EQ(in_order, parallel.load());
+}
@@ -6,7 +6,9 @@
  */
 
 #include <boost/filesystem.hpp>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <unordered_set>
 
 #include "BundleResources.h"
@@ -236,6 +238,73 @@ TEST(BundleResources, RenameLayout) {
       });
 }
 
+TEST(BundleResources, RereadLayoutWrittenElsewhere) {
+  setup_resources_and_run(
+      [&](const std::string& extract_dir, BundleResources* resources) {
+        auto layout_path = extract_dir + "/base/res/layout/activity_main.xml";
+        auto collect_classes = [&]() {
+          std::unordered_set<std::string> layout_classes;
+          std::unordered_multimap<std::string, std::string> attribute_values;
+          resources->collect_layout_classes_and_attributes_for_file(
+              layout_path, {}, &layout_classes, &attribute_values);
+          return layout_classes;
+        };
+        std::map<std::string, std::string> rename_map;
+        rename_map.emplace("com.fb.bundles.WickedCoolButton", "X.001");
+        resources->rename_classes_in_layouts(rename_map);
+        EXPECT_EQ(collect_classes().count("LX/001;"), 1);
+
+        // A parse of the layout that is kept around must not hide changes
+        // that were made to the file by other means.
+        boost::filesystem::remove(layout_path);
+        redex::copy_file(std::getenv("test_layout_path"), layout_path);
+        auto layout_classes = collect_classes();
+        EXPECT_EQ(layout_classes.count("LX/001;"), 0);
+        EXPECT_EQ(layout_classes.count("Lcom/fb/bundles/WickedCoolButton;"),
+                  1);
+      });
+}
+
+TEST(BundleResources, RereadLayoutRewrittenInPlace) {
+  setup_resources_and_run(
+      [&](const std::string& extract_dir, BundleResources* resources) {
+        auto layout_path = extract_dir + "/base/res/layout/activity_main.xml";
+        auto collect_classes = [&]() {
+          std::unordered_set<std::string> layout_classes;
+          std::unordered_multimap<std::string, std::string> attribute_values;
+          resources->collect_layout_classes_and_attributes_for_file(
+              layout_path, {}, &layout_classes, &attribute_values);
+          return layout_classes;
+        };
+        // Keeps the size of the file.
+        std::map<std::string, std::string> rename_map;
+        rename_map.emplace("com.fb.bundles.WickedCoolButton",
+                           "com.fb.bundles.WickedCoolBatton");
+        resources->rename_classes_in_layouts(rename_map);
+        auto mtime = last_write_time(layout_path);
+        last_write_time(layout_path, mtime);
+        EXPECT_EQ(collect_classes().count("Lcom/fb/bundles/WickedCoolBatton;"),
+                  1);
+
+        // Same inode, size and mtime, but different contents.
+        std::string original;
+        {
+          std::ifstream in(std::getenv("test_layout_path"), std::ios::binary);
+          original.assign(std::istreambuf_iterator<char>(in),
+                          std::istreambuf_iterator<char>());
+        }
+        {
+          std::ofstream out(layout_path, std::ios::binary);
+          out.write(original.data(), original.size());
+        }
+        last_write_time(layout_path, mtime);
+        auto layout_classes = collect_classes();
+        EXPECT_EQ(layout_classes.count("Lcom/fb/bundles/WickedCoolBatton;"), 0);
+        EXPECT_EQ(layout_classes.count("Lcom/fb/bundles/WickedCoolButton;"),
+                  1);
+      });
+}
+
 TEST(BundleResources, ReadResource) {
   setup_resources_and_run([&](const std::string& /* extract_dir */,
                               BundleResources* resources) {
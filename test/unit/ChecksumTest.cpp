@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <zlib.h>
+
+#include "Adler32.h"
+#include "Sha1.h"
+
+namespace {
+
+std::vector<uint8_t> random_bytes(std::mt19937& rng, size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (auto& b : bytes) {
+    b = (uint8_t)rng();
+  }
+  return bytes;
+}
+
+std::vector<uint8_t> sha1(const std::vector<uint8_t>& data, size_t split) {
+  Sha1Context context;
+  sha1_init(&context);
+  sha1_update(&context, data.data(), split);
+  sha1_update(&context, data.data() + split, data.size() - split);
+  std::vector<uint8_t> digest(20);
+  sha1_final(digest.data(), &context);
+  return digest;
+}
+
+} // namespace
+
+class ChecksumTest : public ::testing::Test {
+ protected:
+  ~ChecksumTest() override {
+    sha1_use_hardware(true);
+    adler32_use_simd(true);
+  }
+};
+
+TEST_F(ChecksumTest, sha1KnownDigest) {
+  std::string abc = "abc";
+  std::vector<uint8_t> data(abc.begin(), abc.end());
+  std::vector<uint8_t> expected = {0xa9, 0x99, 0x3e, 0x36, 0x47, 0x06, 0x81,
+                                   0x6a, 0xba, 0x3e, 0x25, 0x71, 0x78, 0x50,
+                                   0xc2, 0x6c, 0x9c, 0xd0, 0xd8, 0x9d};
+  for (bool hardware : {false, true}) {
+    sha1_use_hardware(hardware);
+    EXPECT_EQ(sha1(data, 1), expected);
+  }
+}
+
+TEST_F(ChecksumTest, sha1ImplementationsAgree) {
+  std::mt19937 rng(0);
+  for (size_t size : {0, 1, 55, 56, 63, 64, 65, 127, 128, 1000, 100000}) {
+    auto data = random_bytes(rng, size);
+    size_t split = size == 0 ? 0 : rng() % size;
+    sha1_use_hardware(false);
+    auto portable = sha1(data, split);
+    sha1_use_hardware(true);
+    EXPECT_EQ(sha1(data, split), portable) << size;
+  }
+}
+
+TEST_F(ChecksumTest, adler32MatchesZlib) {
+  std::mt19937 rng(0);
+  for (size_t size : {0, 1, 31, 32, 33, 5552, 5553, 100000, 1000000}) {
+    auto data = random_bytes(rng, size);
+    std::vector<uint8_t> ones(size, 0xff);
+    for (const auto* bytes : {&data, &ones}) {
+      for (uint32_t start : {1u, 0x1234abcdu}) {
+        auto expected = (uint32_t)adler32(start, bytes->data(), bytes->size());
+        for (bool simd : {false, true}) {
+          adler32_use_simd(simd);
+          EXPECT_EQ(adler32_update(start, bytes->data(), bytes->size()),
+                    expected)
+              << size;
+        }
+      }
+    }
+  }
+}
@@ -10,6 +10,8 @@
 #include <boost/optional.hpp>
 
 #include "IRAssembler.h"
+#include "IRCode.h"
+#include "InstructionLowering.h"
 #include "RedexTest.h"
 #include "SimpleClassHierarchy.h"
 
@@ -172,3 +174,90 @@ TEST_F(DexClassTest, testObfuscatedNames) {
   EXPECT_EQ(field->get_deobfuscated_name_or_empty(), "Lbaz;.bar:I");
   EXPECT_EQ(field->get_simple_deobfuscated_name(), "bar");
 }
+
+TEST_F(DexClassTest, lazyBalloon) {
+  auto method = assembler::class_with_method("LLazy;",
+                                             R"(
+      (method (public static) "LLazy;.foo:(I)I"
+       (
+        (load-param v0)
+        (add-int/lit v0 v0 1)
+        (return v0)
+       )
+      )
+    )");
+  instruction_lowering::lower(method);
+  method->sync();
+  ASSERT_NE(method->get_dex_code(), nullptr);
+
+  method->mark_balloon_pending();
+  EXPECT_TRUE(method->is_balloon_pending());
+  EXPECT_NE(method->get_dex_code(), nullptr);
+
+  // The first access converts the DexCode.
+  auto code = method->get_code();
+  ASSERT_NE(code, nullptr);
+  EXPECT_FALSE(method->is_balloon_pending());
+  EXPECT_EQ(method->get_dex_code(), nullptr);
+  EXPECT_EQ(code->count_opcodes(), 2u);
+  EXPECT_EQ(method->get_code(), code);
+
+  // Replacing the code of a pending method drops the DexCode.
+  instruction_lowering::lower(method);
+  method->sync();
+  method->mark_balloon_pending();
+  method->set_code(assembler::ircode_from_string(R"(
+    (
+      (load-param v0)
+      (return v0)
+    )
+  )"));
+  EXPECT_FALSE(method->is_balloon_pending());
+  EXPECT_EQ(method->get_dex_code(), nullptr);
+  EXPECT_EQ(method->get_code()->count_opcodes(), 1u);
+}
+
+TEST_F(DexClassTest, lazyBalloonGather) {
+  auto method = assembler::class_with_method("LLazyGather;",
+                                             R"(
+      (method (public static) "LLazyGather;.foo:()V"
+       (
+        (const-string "lazy")
+        (move-result-pseudo-object v0)
+        (invoke-static (v0) "LLazyGather;.bar:(Ljava/lang/String;)V")
+        (return-void)
+       )
+      )
+    )");
+  instruction_lowering::lower(method);
+  method->sync();
+  method->mark_balloon_pending();
+
+  // Gathering the references of a pending method sees its code.
+  const DexMethod* const_method = method;
+  std::vector<DexMethodRef*> methods;
+  const_method->gather_methods(methods);
+  EXPECT_FALSE(method->is_balloon_pending());
+  EXPECT_EQ(std::count(methods.begin(), methods.end(),
+                       DexMethod::get_method(
+                           "LLazyGather;.bar:(Ljava/lang/String;)V")),
+            1);
+  std::vector<const DexString*> strings;
+  const_method->gather_strings(strings);
+  EXPECT_EQ(std::count(strings.begin(), strings.end(),
+                       DexString::get_string("lazy")),
+            1);
+}
+
+TEST_F(DexClassTest, reuseDeletedMemberStorage) {
+  auto* method = DexMethod::make_method("LFoo;.bar:()V");
+  DexMethod::erase_method(method);
+  DexMethod::delete_method_DO_NOT_USE(static_cast<DexMethod*>(method));
+  EXPECT_EQ(DexMethod::get_method("LFoo;.bar:()V"), nullptr);
+  EXPECT_EQ(DexMethod::make_method("LFoo;.baz:()V"), method);
+
+  auto* field = DexField::make_field("LFoo;.qux:I");
+  DexFieldRef::delete_field_DO_NOT_USE(field);
+  EXPECT_EQ(DexField::get_field("LFoo;.qux:I"), nullptr);
+  EXPECT_EQ(DexField::make_field("LFoo;.quux:I"), field);
+}
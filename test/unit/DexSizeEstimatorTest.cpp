@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+#include <sys/stat.h>
+
+#include "ConfigFiles.h"
+#include "DexOutput.h"
+#include "DexPosition.h"
+#include "DexSizeEstimator.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "InstructionLowering.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+
+class DexSizeEstimatorTest : public RedexTest {};
+
+namespace {
+
+DexClass* create_class(size_t i) {
+  auto name = "LFoo" + std::to_string(i) + ";";
+  auto getter = assembler::method_from_string(R"(
+    (method (public) ")" + name + R"(.get:()Ljava/lang/String;"
+     (
+      (load-param-object v1)
+      (iget-object v1 ")" + name + R"(.f:Ljava/lang/String;")
+      (move-result-pseudo-object v0)
+      (if-nez v0 :done)
+      (const-string "default value")
+      (move-result-pseudo-object v0)
+      (:done)
+      (return-object v0)
+     )
+    )
+  )");
+  auto setter = assembler::method_from_string(R"(
+    (method (public static) ")" + name + R"(.make:(ILjava/lang/String;)I"
+     (
+      (load-param v1)
+      (load-param-object v2)
+      (const-string "message )" + std::to_string(i) + R"(")
+      (move-result-pseudo-object v0)
+      (invoke-virtual (v2 v0) "Ljava/lang/String;.concat:(Ljava/lang/String;)Ljava/lang/String;")
+      (move-result-object v0)
+      (invoke-static (v0) "Ljava/lang/String;.valueOf:(Ljava/lang/Object;)Ljava/lang/String;")
+      (add-int/lit v1 v1 1)
+      (return v1)
+     )
+    )
+  )");
+  auto cls = assembler::class_with_methods(name, {getter, setter});
+  auto field = DexField::make_field(DexType::make_type(name),
+                                    DexString::make_string("f"),
+                                    DexType::make_type("Ljava/lang/String;"))
+                   ->make_concrete(ACC_PUBLIC);
+  cls->add_field(field);
+  return cls;
+}
+
+size_t write_dex(DexClasses& classes) {
+  DexStore store("classes");
+  store.add_classes(classes);
+  std::vector<DexStore> stores;
+  stores.emplace_back(std::move(store));
+  instruction_lowering::run(stores, true);
+
+  auto tmpdir = redex::make_tmp_dir("dex_size_estimator_test_%%%%%%%%");
+  ConfigFiles conf(Json::nullValue, tmpdir.path);
+  std::string meta = tmpdir.path + "/meta";
+  mkdir(meta.c_str(), 0755);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(""));
+  std::unordered_map<DexMethod*, uint64_t> method_to_id;
+  std::unordered_map<DexCode*, std::vector<DebugLineItem>> code_debug_lines;
+  auto stats = write_classes_to_dex(tmpdir.path + "/classes.dex",
+                                    &classes,
+                                    std::make_shared<GatheredTypes>(&classes),
+                                    nullptr,
+                                    0,
+                                    nullptr,
+                                    0,
+                                    conf,
+                                    pos_mapper.get(),
+                                    DebugInfoKind::NoCustomSymbolication,
+                                    &method_to_id,
+                                    &code_debug_lines,
+                                    nullptr,
+                                    "dex\n035\0");
+  return stats.num_bytes;
+}
+
+} // namespace
+
+TEST_F(DexSizeEstimatorTest, estimate_is_close_to_written_size) {
+  DexClasses classes;
+  DexSizeEstimator estimator;
+  for (size_t i = 0; i < 50; i++) {
+    auto cls = create_class(i);
+    classes.push_back(cls);
+    estimator.add_class(cls);
+  }
+  EXPECT_EQ(estimator.get_num_classes(), 50);
+  auto estimated = estimator.get_size();
+  auto actual = write_dex(classes);
+  EXPECT_GT(estimated, actual * 0.9);
+  EXPECT_LT(estimated, actual * 1.1);
+  EXPECT_LT(estimator.get_compressed_size(), estimated);
+}
+
+TEST_F(DexSizeEstimatorTest, shared_items_are_counted_once) {
+  auto foo0 = create_class(0);
+  auto foo1 = create_class(1);
+  DexSizeEstimator estimator;
+  auto first_bytes = estimator.add_class(foo0);
+  EXPECT_EQ(estimator.get_size(), first_bytes);
+
+  // The second class shares the header, the java.lang.String refs and the
+  // "default value" string with the first one.
+  auto second_bytes = estimator.get_added_bytes(foo1);
+  EXPECT_LT(second_bytes, first_bytes);
+  EXPECT_EQ(estimator.add_class(foo1), second_bytes);
+  EXPECT_EQ(estimator.get_size(), first_bytes + second_bytes);
+
+  estimator.remove_class(foo1);
+  EXPECT_EQ(estimator.get_size(), first_bytes);
+  EXPECT_EQ(estimator.get_added_bytes(foo1), second_bytes);
+
+  estimator.remove_class(foo0);
+  EXPECT_EQ(estimator.get_num_classes(), 0);
+  EXPECT_EQ(estimator.get_size(), 0);
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ConfigFiles.h"
+#include "DexOutput.h"
+#include "DexPosition.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "InstructionLowering.h"
+#include "RedexContext.h"
+#include "RedexOptions.h"
+#include "RedexTestUtils.h"
+#include "Tool.h"
+
+namespace {
+
+constexpr size_t kNumClasses = 5;
+
+DexClass* create_class(size_t i) {
+  auto name = "LFoo" + std::to_string(i) + ";";
+  auto getter = assembler::method_from_string(R"(
+    (method (public) ")" + name + R"(.get:()Ljava/lang/String;"
+     (
+      (load-param-object v1)
+      (iget-object v1 ")" + name + R"(.f:Ljava/lang/String;")
+      (move-result-pseudo-object v0)
+      (if-nez v0 :done)
+      (const-string "it's )" + std::to_string(i) + R"(")
+      (move-result-pseudo-object v0)
+      (:done)
+      (return-object v0)
+     )
+    )
+  )");
+  auto maker = assembler::method_from_string(R"(
+    (method (public static) ")" + name + R"(.make:()Ljava/lang/String;"
+     (
+      (new-instance ")" + name + R"(")
+      (move-result-pseudo-object v0)
+      (invoke-virtual (v0) ")" + name + R"(.get:()Ljava/lang/String;")
+      (move-result-object v0)
+      (return-object v0)
+     )
+    )
+  )");
+  auto cls = assembler::class_with_methods(name, {getter, maker});
+  auto field = DexField::make_field(DexType::make_type(name),
+                                    DexString::make_string("f"),
+                                    DexType::make_type("Ljava/lang/String;"))
+                   ->make_concrete(ACC_PUBLIC);
+  cls->add_field(field);
+  return cls;
+}
+
+// Writes a dex of a few classes to <dir>/dexen/classes.dex.
+void write_test_dex(const std::string& dir) {
+  g_redex = new RedexContext();
+  DexClasses classes;
+  for (size_t i = 0; i < kNumClasses; i++) {
+    classes.push_back(create_class(i));
+  }
+  DexStore store("classes");
+  store.add_classes(classes);
+  std::vector<DexStore> stores;
+  stores.emplace_back(std::move(store));
+  instruction_lowering::run(stores, true);
+
+  ConfigFiles conf(Json::nullValue, dir);
+  mkdir((dir + "/meta").c_str(), 0755);
+  mkdir((dir + "/dexen").c_str(), 0755);
+  mkdir((dir + "/apk").c_str(), 0755);
+  std::unique_ptr<PositionMapper> pos_mapper(PositionMapper::make(""));
+  std::unordered_map<DexMethod*, uint64_t> method_to_id;
+  std::unordered_map<DexCode*, std::vector<DebugLineItem>> code_debug_lines;
+  write_classes_to_dex(dir + "/dexen/classes.dex",
+                       &classes,
+                       std::make_shared<GatheredTypes>(&classes),
+                       nullptr,
+                       0,
+                       nullptr,
+                       0,
+                       conf,
+                       pos_mapper.get(),
+                       DebugInfoKind::NoCustomSymbolication,
+                       &method_to_id,
+                       &code_debug_lines,
+                       nullptr,
+                       "dex\n035\0");
+  delete g_redex;
+  g_redex = nullptr;
+}
+
+// Runs dex-sql-dump on the dex written by write_test_dex.
+void run_dump(const std::string& dir, std::vector<std::string> args) {
+  g_redex = new RedexContext();
+  auto* tool = ToolRegistry::get().get_tool("dex-sql-dump");
+  ASSERT_NE(tool, nullptr);
+  args.insert(args.end(), {"--jars", "", "--apkdir", dir + "/apk",
+                           "--dexendir", dir + "/dexen"});
+  po::options_description options;
+  tool->add_options(options);
+  po::variables_map vm;
+  po::store(po::command_line_parser(args).options(options).run(), vm);
+  po::notify(vm);
+  tool->run(vm);
+  delete g_redex;
+  g_redex = nullptr;
+}
+
+std::string read_file(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// Returns the tuples of every table in a dump with either one or several rows
+// per INSERT, in order.
+std::map<std::string, std::vector<std::string>> rows_by_table(
+    const std::string& sql) {
+  std::map<std::string, std::vector<std::string>> rows;
+  std::istringstream in(sql);
+  std::string line;
+  std::string table;
+  const std::string insert = "INSERT INTO ";
+  while (std::getline(in, line)) {
+    if (line.compare(0, insert.size(), insert) == 0) {
+      auto values = line.find(" VALUES");
+      table = line.substr(insert.size(), values - insert.size());
+      auto tuple = line.find('(', values);
+      if (tuple != std::string::npos) {
+        rows[table].push_back(line.substr(tuple, line.size() - tuple - 1));
+      }
+    } else if (!line.empty() && line[0] == '(') {
+      // A row of a multi-row INSERT, followed by ',' or ';'.
+      rows[table].push_back(line.substr(0, line.size() - 1));
+    }
+  }
+  return rows;
+}
+
+uint64_t read_le(const std::string& data, size_t* pos, size_t size) {
+  uint64_t v = 0;
+  for (size_t byte = 0; byte < size; byte++) {
+    v |= uint64_t(uint8_t(data.at(*pos + byte))) << (8 * byte);
+  }
+  *pos += size;
+  return v;
+}
+
+} // namespace
+
+class DexSqlDumpTest : public ::testing::Test {
+ protected:
+  DexSqlDumpTest() : m_tmpdir(redex::make_tmp_dir("dex_sql_dump_%%%%%%%%")) {
+    write_test_dex(m_tmpdir.path);
+    run_dump(m_tmpdir.path, {"--output", m_tmpdir.path + "/dump.sql"});
+    m_sql_rows = rows_by_table(read_file(m_tmpdir.path + "/dump.sql"));
+  }
+
+  redex::TempDir m_tmpdir;
+  std::map<std::string, std::vector<std::string>> m_sql_rows;
+};
+
+TEST_F(DexSqlDumpTest, batchedMatchesOneRowPerInsert) {
+  EXPECT_EQ(m_sql_rows.at("classes").size(), kNumClasses);
+  EXPECT_EQ(m_sql_rows.at("methods").size(), 2 * kNumClasses);
+  EXPECT_EQ(m_sql_rows.at("method_method_refs").size(), kNumClasses);
+
+  auto batched_path = m_tmpdir.path + "/batched.sql";
+  run_dump(m_tmpdir.path, {"--output", batched_path, "--format",
+                           "sql-batched", "--batch-size", "2"});
+  auto batched = read_file(batched_path);
+  EXPECT_EQ(rows_by_table(batched), m_sql_rows);
+
+  // 5 classes in batches of 2.
+  size_t class_inserts = 0;
+  for (size_t pos = 0;
+       (pos = batched.find("INSERT INTO classes VALUES", pos)) !=
+       std::string::npos;
+       pos++) {
+    class_inserts++;
+  }
+  EXPECT_EQ(class_inserts, 3);
+}
+
+TEST_F(DexSqlDumpTest, columnarMatchesOneRowPerInsert) {
+  auto dir = m_tmpdir.path + "/columnar";
+  run_dump(m_tmpdir.path, {"--output", dir, "--format", "columnar"});
+  auto data = read_file(dir + "/classes/items-00000.col");
+
+  ASSERT_GE(data.size(), 16);
+  EXPECT_EQ(data.substr(0, 8), std::string("RDXCOL1", 8));
+  size_t pos = 8;
+  auto num_rows = read_le(data, &pos, 4);
+  auto num_columns = read_le(data, &pos, 4);
+  ASSERT_EQ(num_rows, kNumClasses);
+  ASSERT_EQ(num_columns, 5);
+  std::vector<bool> is_text;
+  for (size_t col = 0; col < num_columns; col++) {
+    auto name_len = read_le(data, &pos, 4);
+    pos += name_len;
+    is_text.push_back(data.at(pos++) != 0);
+  }
+  EXPECT_EQ(is_text, (std::vector<bool>{false, true, true, true, false}));
+
+  // Rebuild the tuples of the SQL dump, whose classes columns are separated
+  // by a bare comma.
+  std::vector<std::string> tuples(num_rows);
+  for (size_t col = 0; col < num_columns; col++) {
+    std::vector<std::string> cells;
+    if (is_text[col]) {
+      std::vector<uint64_t> offsets;
+      for (size_t row = 0; row <= num_rows; row++) {
+        offsets.push_back(read_le(data, &pos, 4));
+      }
+      for (size_t row = 0; row < num_rows; row++) {
+        cells.push_back("'" +
+                        data.substr(pos + offsets[row],
+                                    offsets[row + 1] - offsets[row]) +
+                        "'");
+      }
+      pos += offsets.back();
+    } else {
+      for (size_t row = 0; row < num_rows; row++) {
+        cells.push_back(
+            std::to_string(static_cast<int64_t>(read_le(data, &pos, 8))));
+      }
+    }
+    for (size_t row = 0; row < num_rows; row++) {
+      tuples[row] += (col == 0 ? "(" : ",") + cells[row];
+    }
+  }
+  for (auto& tuple : tuples) {
+    tuple += ")";
+  }
+  EXPECT_EQ(pos, data.size());
+  EXPECT_EQ(tuples, m_sql_rows.at("classes"));
+
+  // Text is stored unescaped.
+  auto strings = read_file(dir + "/strings/items-00000.col");
+  EXPECT_NE(strings.find("it's 0"), std::string::npos);
+}
@@ -479,3 +479,68 @@ TEST_F(FastRegAllocTest, CheckCast2) {
 )");
   EXPECT_CODE_EQ(method->get_code(), expected_code.get());
 }
+
+/*
+ * Check that legalize() moves the params into the highest registers, where
+ * the Dex format expects them.
+ */
+TEST_F(FastRegAllocTest, LegalizeParams) {
+  auto method = assembler::method_from_string(R"(
+    (method (public static) "LFoo;.bar:(IJ)J"
+      (
+        (load-param v0)
+        (load-param-wide v1)
+        (int-to-long v3 v0)
+        (add-long v3 v3 v1)
+        (return-wide v3)
+      )
+    )
+)");
+  method->get_code()->set_registers_size(5);
+
+  size_t param_moves = 0;
+  {
+    fastregalloc::LinearScanAllocator allocator(method);
+    allocator.allocate();
+    EXPECT_TRUE(allocator.legalize(&param_moves));
+  }
+
+  auto* code = method->get_code();
+  auto regs_size = code->get_registers_size();
+  auto ii = InstructionIterable(code);
+  auto it = ii.begin();
+  ASSERT_EQ(it->insn->opcode(), IOPCODE_LOAD_PARAM);
+  EXPECT_EQ(it->insn->dest(), regs_size - 3);
+  ++it;
+  ASSERT_EQ(it->insn->opcode(), IOPCODE_LOAD_PARAM_WIDE);
+  EXPECT_EQ(it->insn->dest(), regs_size - 2);
+  // Each param that is not where allocate() put it is copied there.
+  for (size_t i = 0; i < param_moves; ++i) {
+    ++it;
+    EXPECT_TRUE(opcode::is_a_move(it->insn->opcode()));
+    EXPECT_GE(it->insn->src(0), regs_size - 3);
+  }
+}
+
+/*
+ * When more than 16 registers are live at an instruction that can only
+ * address 16, legalize() gives up, so that graph coloring can spill instead.
+ */
+TEST_F(FastRegAllocTest, LegalizeOperandOutOfRange) {
+  std::string body;
+  for (int i = 0; i < 17; ++i) {
+    body += "(const v" + std::to_string(i) + " " + std::to_string(i) + ")\n";
+  }
+  for (int i = 0; i < 17; ++i) {
+    body += "(neg-int v" + std::to_string(i) + " v" + std::to_string(i) + ")\n";
+  }
+  auto method = assembler::method_from_string(
+      "(method (public static) \"LFoo;.bar:()V\" (" + body + "(return-void)))");
+  method->get_code()->set_registers_size(17);
+
+  fastregalloc::LinearScanAllocator allocator(method);
+  allocator.allocate();
+  size_t param_moves = 0;
+  EXPECT_FALSE(allocator.legalize(&param_moves));
+  EXPECT_EQ(param_moves, 0);
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "HierarchyCache.h"
+
+#include <gtest/gtest.h>
+
+#include "Creators.h"
+#include "DexUtil.h"
+#include "MethodOverrideGraph.h"
+#include "RedexContext.h"
+#include "RedexTest.h"
+#include "Show.h"
+
+namespace mog = method_override_graph;
+
+namespace {
+
+DexClass* create_class(const char* name, DexType* super) {
+  ClassCreator cc(DexType::make_type(name));
+  cc.set_super(super);
+  return cc.create();
+}
+
+DexMethod* add_virtual_method(DexClass* cls, const char* name) {
+  auto method = DexMethod::make_method(show(cls->get_type()) + "." + name +
+                                       ":()V")
+                    ->make_concrete(ACC_PUBLIC, /* is_virtual */ true);
+  cls->add_method(method);
+  return method;
+}
+
+} // namespace
+
+class HierarchyCacheTest : public RedexTest {};
+
+TEST_F(HierarchyCacheTest, overrideGraphIsReusedUntilMethodsChange) {
+  auto base = create_class("LBase;", type::java_lang_Object());
+  auto sub = create_class("LSub;", base->get_type());
+  auto base_foo = add_virtual_method(base, "foo");
+  Scope scope{base, sub};
+
+  auto cache = g_redex->get_hierarchy_cache();
+  auto graph1 = mog::get_or_build_graph(scope);
+  auto graph2 = mog::get_or_build_graph(scope);
+  EXPECT_EQ(graph1, graph2);
+  EXPECT_EQ(cache->get_stats().hits, 1u);
+  EXPECT_EQ(cache->get_stats().misses, 1u);
+  EXPECT_TRUE(mog::get_overriding_methods(*graph2, base_foo).empty());
+
+  auto sub_foo = add_virtual_method(sub, "foo");
+  auto graph3 = mog::get_or_build_graph(scope);
+  EXPECT_NE(graph2, graph3);
+  EXPECT_EQ(cache->get_stats().misses, 2u);
+  auto overriding = mog::get_overriding_methods(*graph3, base_foo);
+  ASSERT_EQ(overriding.size(), 1u);
+  EXPECT_EQ(overriding[0], sub_foo);
+}
+
+TEST_F(HierarchyCacheTest, typeHierarchyIsRebuiltOnReparenting) {
+  auto a = create_class("LA;", type::java_lang_Object());
+  auto b = create_class("LB;", type::java_lang_Object());
+  auto c = create_class("LC;", a->get_type());
+  Scope scope{a, b, c};
+
+  auto ch1 = get_or_build_type_hierarchy(scope);
+  EXPECT_EQ(get_children(*ch1, a->get_type()).count(c->get_type()), 1u);
+  EXPECT_EQ(ch1, get_or_build_type_hierarchy(scope));
+
+  c->set_super_class(b->get_type());
+  auto ch2 = get_or_build_type_hierarchy(scope);
+  EXPECT_NE(ch1, ch2);
+  EXPECT_EQ(get_children(*ch2, a->get_type()).count(c->get_type()), 0u);
+  EXPECT_EQ(get_children(*ch2, b->get_type()).count(c->get_type()), 1u);
+}
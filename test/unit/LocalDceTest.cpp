@@ -15,6 +15,8 @@
 #include "LocalDcePass.h"
 #include "MethodOverrideGraph.h"
 #include "Purity.h"
+#include "PuritySummaryStore.h"
+#include "RedexContext.h"
 #include "RedexTest.h"
 #include "ScopeHelper.h"
 #include "Show.h"
@@ -585,6 +587,87 @@ TEST_F(LocalDceTryTest, invoked_static_method_with_pure_external_barrier) {
   EXPECT_CODE_EQ(ircode, expected_code.get());
 }
 
+TEST_F(LocalDceTryTest, no_side_effects_summaries_reused_until_edited) {
+  ClassCreator creator(DexType::make_type("LSummaryTest;"));
+  creator.set_super(type::java_lang_Object());
+
+  auto callee = DexMethod::make_method("LSummaryTest;.callee:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  callee->set_code(assembler::ircode_from_string(R"(
+                    (
+                      (return-void)
+                    )
+                    )"));
+  creator.add_method(callee);
+
+  auto caller = DexMethod::make_method("LSummaryTest;.caller:()V")
+                    ->make_concrete(ACC_PUBLIC | ACC_STATIC, false);
+  caller->set_code(assembler::ircode_from_string(R"(
+                    (
+                      (invoke-static () "LSummaryTest;.callee:()V")
+                      (return-void)
+                    )
+                    )"));
+  creator.add_method(caller);
+
+  Scope scope{type_class(type::java_lang_Object()), creator.create()};
+  init_classes::InitClassesWithSideEffects init_classes_with_side_effects(
+      scope, /* create_init_class_insns */ false);
+  std::unordered_set<DexMethodRef*> pure_methods;
+  auto override_graph = method_override_graph::build_graph(scope);
+  method::ClInitHasNoSideEffectsPredicate clinit_has_no_side_effects =
+      [&](const DexType* type) {
+        return !init_classes_with_side_effects.refine(type);
+      };
+  PuritySummaryKey summary_key{"test"};
+  auto compute = [&]() {
+    std::unordered_set<const DexMethod*> result;
+    compute_no_side_effects_methods(scope, override_graph.get(),
+                                    clinit_has_no_side_effects, pure_methods,
+                                    &result, &summary_key);
+    return result;
+  };
+  auto store = g_redex->get_purity_summaries();
+
+  auto result = compute();
+  EXPECT_TRUE(result.count(callee));
+  EXPECT_TRUE(result.count(caller));
+  auto stats = store->get_stats();
+  EXPECT_EQ(stats.reused, 0);
+  EXPECT_EQ(stats.closures_reused, 0);
+
+  // Nothing changed, so the closure is taken from the store.
+  EXPECT_EQ(compute(), result);
+  auto reused_stats = store->get_stats();
+  EXPECT_EQ(reused_stats.computed, stats.computed);
+  EXPECT_EQ(reused_stats.closures_reused, 1);
+
+  // Giving the callee a side effect also affects its caller, but only the
+  // callee is rescanned.
+  callee->set_code(assembler::ircode_from_string(R"(
+                    (
+                      (const v0 0)
+                      (monitor-enter v0)
+                      (return-void)
+                    )
+                    )"));
+  store->invalidate(std::vector<const DexMethod*>{callee});
+  result = compute();
+  EXPECT_FALSE(result.count(callee));
+  EXPECT_FALSE(result.count(caller));
+  auto edited_stats = store->get_stats();
+  EXPECT_EQ(edited_stats.computed, reused_stats.computed + 1);
+  EXPECT_EQ(edited_stats.closures_reused, 1);
+
+  // Other pure methods make for another key, with summaries of its own.
+  pure_methods.insert(callee);
+  result = compute();
+  EXPECT_TRUE(result.count(caller));
+  auto other_key_stats = store->get_stats();
+  EXPECT_GT(other_key_stats.computed, edited_stats.computed);
+  EXPECT_EQ(other_key_stats.closures_reused, 1);
+}
+
 TEST_F(LocalDceTryTest, new_instances_infinite_loop) {
   auto code = assembler::ircode_from_string(R"(
     (
@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <json/value.h>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ConfigFiles.h"
+#include "ControlFlow.h"
+#include "Creators.h"
+#include "DexClass.h"
+#include "DexUtil.h"
+#include "IRAssembler.h"
+#include "MethodPass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+
+namespace {
+
+// What the example passes did, in order.
+struct Log {
+  std::mutex mutex;
+  std::vector<std::string> events;
+  // The CFG each pass saw for each method.
+  std::unordered_map<std::string,
+                     std::unordered_map<const DexMethod*,
+                                        const cfg::ControlFlowGraph*>>
+      cfgs;
+
+  void add(const std::string& event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(event);
+  }
+
+  size_t first(const std::string& event) const {
+    return std::find(events.begin(), events.end(), event) - events.begin();
+  }
+};
+
+class ExampleMethodPass : public MethodPassWithStats<size_t> {
+ public:
+  ExampleMethodPass(const std::string& name, Log* log)
+      : MethodPassWithStats(name), m_log(log) {}
+
+  bool is_cfg_legacy() override { return true; }
+
+  bool should_visit(const DexMethod* method) const override {
+    return !skip_no_optimizations || !method->rstate.no_optimizations();
+  }
+
+  void prepare(DexStoresVector&, ConfigFiles&, PassManager&) override {
+    m_log->add("prepare " + name());
+  }
+
+  size_t process_method(DexMethod* method,
+                        cfg::ControlFlowGraph& cfg) override {
+    m_log->add("visit " + name());
+    std::this_thread::sleep_for(visit_delay);
+    std::lock_guard<std::mutex> lock(m_log->mutex);
+    m_log->cfgs[name()][method] = &cfg;
+    return 1;
+  }
+
+  void report(const size_t& visited, PassManager& mgr) override {
+    m_log->add("report " + name());
+    mgr.set_metric("visited_" + name(), visited);
+  }
+
+  bool skip_no_optimizations{false};
+  std::chrono::milliseconds visit_delay{0};
+
+ private:
+  Log* m_log;
+};
+
+} // namespace
+
+class MethodPassTest : public RedexTest {
+ protected:
+  DexStoresVector stores;
+  Log log;
+  std::unique_ptr<ExampleMethodPass> pass_a;
+  std::unique_ptr<ExampleMethodPass> pass_b;
+
+  void SetUp() override {
+    pass_a = std::make_unique<ExampleMethodPass>("ExampleMethodPassA", &log);
+    pass_b = std::make_unique<ExampleMethodPass>("ExampleMethodPassB", &log);
+
+    ClassCreator creator(DexType::make_type("LMethodPassTest;"));
+    creator.set_super(type::java_lang_Object());
+    for (const char* name : {"foo", "bar", "baz"}) {
+      auto method =
+          DexMethod::make_method("LMethodPassTest;", name, {}, "V")
+              ->make_concrete(ACC_PUBLIC | ACC_STATIC, /* is_virtual */ false);
+      method->set_code(assembler::ircode_from_string("((return-void))"));
+      creator.add_method(method);
+    }
+    DexStore store("classes");
+    store.add_classes({creator.create()});
+    stores.emplace_back(std::move(store));
+  }
+
+  const std::vector<PassManager::PassInfo>& run_passes(bool fuse) {
+    Json::Value config(Json::objectValue);
+    config["redex"] = Json::objectValue;
+    config["redex"]["passes"] = Json::arrayValue;
+    config["redex"]["passes"].append("ExampleMethodPassA");
+    config["redex"]["passes"].append("ExampleMethodPassB");
+    config["pass_manager"] = Json::objectValue;
+    config["pass_manager"]["fuse_method_passes"] = fuse;
+    // Checking the code after each pass would end every fused group.
+    config["ir_type_checker"] = Json::objectValue;
+    config["ir_type_checker"]["run_after_each_pass"] = false;
+    m_conf = std::make_unique<ConfigFiles>(config);
+    m_conf->parse_global_config();
+    std::vector<Pass*> passes{pass_a.get(), pass_b.get()};
+    m_manager = std::make_unique<PassManager>(passes, *m_conf);
+    m_manager->set_testing_mode();
+    m_manager->run_passes(stores, *m_conf);
+    return m_manager->get_pass_info();
+  }
+
+ private:
+  std::unique_ptr<ConfigFiles> m_conf;
+  std::unique_ptr<PassManager> m_manager;
+};
+
+TEST_F(MethodPassTest, unfused) {
+  const auto& pass_info = run_passes(/* fuse */ false);
+
+  EXPECT_LT(log.first("report ExampleMethodPassA"),
+            log.first("prepare ExampleMethodPassB"));
+  ASSERT_EQ(pass_info.size(), 2);
+  EXPECT_EQ(pass_info[0].metrics.at("visited_ExampleMethodPassA"), 3);
+  EXPECT_EQ(pass_info[1].metrics.at("visited_ExampleMethodPassB"), 3);
+  EXPECT_EQ(pass_info[0].metrics.count("fused_method_passes"), 0);
+}
+
+TEST_F(MethodPassTest, fused) {
+  const auto& pass_info = run_passes(/* fuse */ true);
+
+  // Both passes prepare before any method is visited, and each method is
+  // visited by both passes with the same CFG.
+  EXPECT_LT(log.first("prepare ExampleMethodPassB"),
+            log.first("visit ExampleMethodPassA"));
+  EXPECT_LT(log.first("visit ExampleMethodPassB"),
+            log.first("report ExampleMethodPassA"));
+  const auto& cfgs_a = log.cfgs.at("ExampleMethodPassA");
+  const auto& cfgs_b = log.cfgs.at("ExampleMethodPassB");
+  ASSERT_EQ(cfgs_a.size(), 3);
+  EXPECT_EQ(cfgs_a, cfgs_b);
+
+  // Metrics stay with the pass that produced them.
+  ASSERT_EQ(pass_info.size(), 2);
+  EXPECT_EQ(pass_info[0].metrics.at("visited_ExampleMethodPassA"), 3);
+  EXPECT_EQ(pass_info[0].metrics.count("visited_ExampleMethodPassB"), 0);
+  EXPECT_EQ(pass_info[1].metrics.at("visited_ExampleMethodPassB"), 3);
+  EXPECT_EQ(pass_info[1].metrics.count("visited_ExampleMethodPassA"), 0);
+  EXPECT_EQ(pass_info[0].metrics.at("fused_method_passes"), 2);
+  EXPECT_EQ(pass_info[1].metrics.at("fused_method_passes"), 2);
+}
+
+TEST_F(MethodPassTest, visitSeconds) {
+  pass_b->visit_delay = std::chrono::milliseconds(5);
+  std::vector<MethodPass*> passes{pass_a.get(), pass_b.get()};
+  std::vector<double> visit_seconds;
+  MethodPass::run_on_methods(passes, build_class_scope(stores),
+                             &visit_seconds);
+
+  // Only the visits of the slow pass take up time.
+  ASSERT_EQ(visit_seconds.size(), 2);
+  EXPECT_GE(visit_seconds[1], 0.015);
+  EXPECT_LT(visit_seconds[0], visit_seconds[1]);
+}
+
+TEST_F(MethodPassTest, shouldVisit) {
+  auto* foo = DexMethod::get_method("LMethodPassTest;.foo:()V")->as_def();
+  foo->rstate.set_no_optimizations();
+  // Building a CFG drops the unreachable instructions.
+  auto unreachable_code = []() {
+    return assembler::ircode_from_string(R"(
+      (
+        (return-void)
+        (const v0 0)
+        (return-void)
+      )
+    )");
+  };
+  foo->set_code(unreachable_code());
+  pass_a->skip_no_optimizations = true;
+  std::vector<MethodPass*> passes{pass_a.get(), pass_b.get()};
+  MethodPass::run_on_methods(passes, build_class_scope(stores));
+
+  EXPECT_EQ(log.cfgs.at("ExampleMethodPassA").count(foo), 0);
+  EXPECT_EQ(log.cfgs.at("ExampleMethodPassA").size(), 2);
+  EXPECT_EQ(log.cfgs.at("ExampleMethodPassB").count(foo), 1);
+  EXPECT_EQ(foo->get_code()->count_opcodes(), 1);
+
+  // Once no pass visits foo, its code is not even turned into a CFG.
+  foo->set_code(unreachable_code());
+  pass_b->skip_no_optimizations = true;
+  log.cfgs.clear();
+  MethodPass::run_on_methods(passes, build_class_scope(stores));
+  EXPECT_EQ(log.cfgs.at("ExampleMethodPassA").count(foo), 0);
+  EXPECT_EQ(log.cfgs.at("ExampleMethodPassB").count(foo), 0);
+  EXPECT_EQ(foo->get_code()->count_opcodes(), 3);
+}
@@ -89,6 +89,40 @@ TEST_F(ProguardMapTest, HandlesGeneratedComments) {
   EXPECT_EQ("LA;.a:I", pm.translate_field("Lcom/foo/bar;.do1:I"));
 }
 
+TEST_F(ProguardMapTest, ParsesLargeMapInChunks) {
+  // A map large enough to be parsed in several chunks, with members that
+  // refer to classes in other chunks.
+  constexpr size_t kNumClasses = 40000;
+  std::stringstream ss;
+  ss << "# compiler: R8\n";
+  for (size_t i = 0; i < kNumClasses; ++i) {
+    auto next = (i + 1) % kNumClasses;
+    auto prev = (i + kNumClasses - 1) % kNumClasses;
+    ss << "com.foo.C" << i << " -> a" << i << ":\n"
+       << "    com.foo.C" << next << " next -> n\n"
+       << "    1:1:com.foo.C" << prev << " prev():10:10 -> p\n";
+  }
+  ss << "com.foo.C0 -> z:\n";
+  ProguardMap pm(ss);
+
+  EXPECT_EQ("Lz;", pm.translate_class("Lcom/foo/C0;"));
+  EXPECT_EQ("La1;", pm.translate_class("Lcom/foo/C1;"));
+  EXPECT_EQ("La1;.n:La2;",
+            pm.translate_field("Lcom/foo/C1;.next:Lcom/foo/C2;"));
+  EXPECT_EQ("La39999;.n:Lz;",
+            pm.translate_field("Lcom/foo/C39999;.next:Lcom/foo/C0;"));
+  EXPECT_EQ("La20000;.p:()La19999;",
+            pm.translate_method("Lcom/foo/C20000;.prev:()Lcom/foo/C19999;"));
+  EXPECT_EQ("Lcom/foo/C1;.prev:()Lcom/foo/C0;",
+            pm.deobfuscate_method("La1;.p:()Lz;"));
+  EXPECT_THAT(
+      pm.method_lines("La20000;.p:()La19999;"),
+      AllOf(SizeIs(1),
+            UnorderedElementsAre(Pointee(ProguardLineRange(
+                1, 1, 10, 10,
+                "Lcom/foo/C20000;.prev:()Lcom/foo/C19999;")))));
+}
+
 TEST_F(ProguardMapTest, LineNumbers) {
   std::stringstream ss(
       "com.foo.bar -> A:\n"
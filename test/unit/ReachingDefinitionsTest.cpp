@@ -69,4 +69,61 @@ TEST_F(ReachingDefinitionsTest, ResetMoveResult) {
   code->clear_cfg();
 }
 
+TEST_F(ReachingDefinitionsTest, DenseAgreesWithEnvironment) {
+  auto code = assembler::ircode_from_string(R"((
+    (const v0 0)
+    (if-eqz v0 :else)
+    (const v1 1)
+    (const v0 1)
+    (goto :end)
+    (:else)
+    (const v0 2)
+    (:end)
+    (return v0)
+  ))");
+
+  code->build_cfg();
+  auto& cfg = code->cfg();
+  cfg.calculate_exit_block();
+
+  reaching_defs::FixpointIterator fp_iter(cfg);
+  fp_iter.run({});
+  reaching_defs::DenseFixpointIterator dense_fp_iter(cfg);
+  dense_fp_iter.run(reaching_defs::DenseDomain());
+
+  for (auto* block : cfg.blocks()) {
+    auto env = fp_iter.get_entry_state_at(block);
+    auto state = dense_fp_iter.get_entry_state_at(block);
+    for (auto& mie : ir_list::InstructionIterable(block)) {
+      for (reg_t reg : {0, 1}) {
+        auto defs = env.get(reg);
+        auto dense_defs = dense_fp_iter.get_definitions(state, reg);
+        if (defs.is_top()) {
+          // Not defined on all paths.
+          continue;
+        }
+        EXPECT_EQ(defs.size(), dense_defs.size());
+        for (auto* def : dense_defs) {
+          EXPECT_TRUE(defs.contains(def));
+        }
+      }
+      fp_iter.analyze_instruction(mie.insn, &env);
+      dense_fp_iter.analyze_instruction(mie.insn, &state);
+    }
+  }
+
+  // Both definitions of v0 in the branches reach the return, and v1, which is
+  // only defined in one of them, gets that definition.
+  auto state = dense_fp_iter.get_exit_state_at(cfg.exit_block());
+  auto v0_defs = dense_fp_iter.get_definitions(state, 0);
+  ASSERT_EQ(2, v0_defs.size());
+  EXPECT_EQ(1, v0_defs[0]->get_literal());
+  EXPECT_EQ(2, v0_defs[1]->get_literal());
+  auto v1_defs = dense_fp_iter.get_definitions(state, 1);
+  ASSERT_EQ(1, v1_defs.size());
+  EXPECT_EQ(1, v1_defs[0]->get_literal());
+
+  code->clear_cfg();
+}
+
 } // namespace
@@ -260,6 +260,65 @@ TEST_F(RegAllocTest, CombineAdjacentNodes) {
   EXPECT_FALSE(ig.get_node(2).is_active());
 }
 
+TEST_F(RegAllocTest, AdjacencyMatrixFallsBackToSparse) {
+  using namespace interference::impl;
+  AdjacencyMatrix matrix;
+  matrix.set(0, 1, AdjacencyMatrix::ADJACENT);
+  matrix.set(3, 2, AdjacencyMatrix::ADJACENT);
+  matrix.set(3, 2, AdjacencyMatrix::NOT_COALESCEABLE);
+  matrix.set(5, 4, AdjacencyMatrix::containment_flag(5, 4));
+  EXPECT_TRUE(matrix.is_dense());
+
+  // Far more registers than fit into a dense matrix.
+  reg_t big = 60000;
+  matrix.set(big, 1, AdjacencyMatrix::ADJACENT);
+  EXPECT_FALSE(matrix.is_dense());
+
+  EXPECT_EQ(matrix.get(1, 0), AdjacencyMatrix::ADJACENT);
+  EXPECT_EQ(matrix.get(2, 3),
+            AdjacencyMatrix::ADJACENT | AdjacencyMatrix::NOT_COALESCEABLE);
+  EXPECT_EQ(matrix.get(4, 5), AdjacencyMatrix::CONTAINS_HI_LO);
+  EXPECT_EQ(matrix.get(1, big), AdjacencyMatrix::ADJACENT);
+  EXPECT_EQ(matrix.get(0, big), 0);
+  EXPECT_EQ(matrix.get(2, 2), 0);
+
+  size_t num_pairs = 0;
+  matrix.for_each([&](reg_t lo, reg_t hi, uint8_t flags) {
+    EXPECT_LT(lo, hi);
+    EXPECT_EQ(matrix.get(lo, hi), flags);
+    ++num_pairs;
+  });
+  EXPECT_EQ(num_pairs, 4);
+}
+
+TEST_F(RegAllocTest, LargeGraph) {
+  using namespace interference::impl;
+  auto ig = GraphBuilder::create_empty();
+  reg_t big = 60000;
+  for (reg_t r : {reg_t(0), reg_t(1), reg_t(2), big}) {
+    GraphBuilder::make_node(&ig, r, RegisterType::NORMAL, /* max_vreg */ 3);
+  }
+  ig.add_edge(0, 1);
+  ig.add_coalesceable_edge(1, 2);
+  ig.add_containment_edge(2, 0);
+  // Makes the graph outgrow its dense adjacency matrix.
+  ig.add_edge(big, 0);
+  ig.add_containment_edge(1, big);
+
+  EXPECT_TRUE(ig.is_adjacent(1, 0));
+  EXPECT_FALSE(ig.is_coalesceable(0, 1));
+  EXPECT_TRUE(ig.is_adjacent(2, 1));
+  EXPECT_TRUE(ig.is_coalesceable(1, 2));
+  EXPECT_TRUE(ig.is_adjacent(0, big));
+  EXPECT_FALSE(ig.is_adjacent(0, 2));
+  EXPECT_TRUE(ig.has_containment_edge(2, 0));
+  EXPECT_FALSE(ig.has_containment_edge(0, 2));
+  EXPECT_TRUE(ig.has_containment_edge(1, big));
+  EXPECT_FALSE(ig.has_containment_edge(big, 1));
+  EXPECT_EQ(ig.get_node(0).weight(), 2);
+  EXPECT_EQ(ig.get_node(big).adjacent(), std::vector<reg_t>{0});
+}
+
 TEST_F(RegAllocTest, Coalesce) {
   auto code = assembler::ircode_from_string(R"(
     (
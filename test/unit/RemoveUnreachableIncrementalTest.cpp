@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+#include <json/json.h>
+#include <sys/stat.h>
+
+#include "ConfigFiles.h"
+#include "Creators.h"
+#include "DexStore.h"
+#include "IRAssembler.h"
+#include "LocalDcePass.h"
+#include "PassManager.h"
+#include "RedexTest.h"
+#include "RedexTestUtils.h"
+#include "RemoveUnreachable.h"
+#include "VirtualScope.h"
+
+class RemoveUnreachableIncrementalTest : public RedexTest {};
+
+namespace {
+
+DexMethod* make_static_method(ClassCreator* creator,
+                              const std::string& signature,
+                              const std::string& code) {
+  auto method = DexMethod::make_method(signature)->make_concrete(
+      ACC_PUBLIC | ACC_STATIC, false);
+  method->set_code(assembler::ircode_from_string(code));
+  creator->add_method(method);
+  return method;
+}
+
+} // namespace
+
+/*
+ * The second RemoveUnreachablePass run reuses the references gathered by the
+ * first for all methods but the one LocalDce edited in between, and still
+ * marks exactly what a full marking does.
+ */
+TEST_F(RemoveUnreachableIncrementalTest, localDceEditBetweenRuns) {
+  // Calling get_vmethods under the hood initializes the object-class, which
+  // we need in the tests to create a proper scope
+  virt_scope::get_vmethods(type::java_lang_Object());
+
+  ClassCreator callee_creator(DexType::make_type("LCallee;"));
+  callee_creator.set_super(type::java_lang_Object());
+  make_static_method(&callee_creator, "LCallee;.pure:()V", R"(
+    (
+      (return-void)
+    )
+  )");
+  auto callee_cls = callee_creator.create();
+
+  ClassCreator main_creator(DexType::make_type("LMain;"));
+  main_creator.set_super(type::java_lang_Object());
+  auto main = make_static_method(&main_creator, "LMain;.main:()V", R"(
+    (
+      (invoke-static () "LCallee;.pure:()V")
+      (invoke-static () "LMain;.helper:()V")
+      (return-void)
+    )
+  )");
+  // A side effect keeps LocalDce from removing the call.
+  make_static_method(&main_creator, "LMain;.helper:()V", R"(
+    (
+      (invoke-static () "Lunknown;.unknown:()V")
+      (return-void)
+    )
+  )");
+  auto main_cls = main_creator.create();
+  main_cls->rstate.set_root();
+  main->rstate.set_root();
+
+  DexStore store("classes");
+  store.add_classes({main_cls, callee_cls});
+  std::vector<DexStore> stores;
+  stores.emplace_back(std::move(store));
+
+  Json::Value json_conf;
+  json_conf["RemoveUnreachablePass"]["incremental_marking"] = true;
+  json_conf["RemoveUnreachablePass"]["verify_incremental_marking"] = true;
+  auto tmpdir = redex::make_tmp_dir("rmu_incremental_test_%%%%%%%%");
+  ConfigFiles conf(json_conf, tmpdir.path);
+  std::string meta = tmpdir.path + "/meta";
+  mkdir(meta.c_str(), 0755);
+  conf.parse_global_config();
+
+  RemoveUnreachablePass rmu;
+  LocalDcePass dce;
+  PassManager manager({&rmu, &dce, &rmu}, conf);
+  manager.set_testing_mode();
+  manager.run_passes(stores, conf);
+
+  // LocalDce removed the call to the pure method, which the second run then
+  // swept along with its class.
+  EXPECT_EQ(main->get_code()->count_opcodes(), 2);
+  EXPECT_EQ(stores[0].get_dexen()[0], std::vector<DexClass*>{main_cls});
+  EXPECT_EQ(main_cls->get_dmethods().size(), 2);
+
+  const auto& pass_info = manager.get_pass_info();
+  ASSERT_EQ(pass_info.size(), 3);
+  const auto& second_run = pass_info[2].metrics;
+  // Only the method LocalDce edited was gathered again.
+  EXPECT_EQ(second_run.at("incremental_marking.methods_gathered"), 1);
+  EXPECT_EQ(second_run.at("incremental_marking.methods_reused"), 1);
+}
@@ -12,6 +12,7 @@
 #include "DexClass.h"
 #include "RedexTest.h"
 #include "Resolver.h"
+#include "ResolverCache.h"
 
 DexFieldRef* make_field_ref(DexType* cls, const char* name, DexType* type) {
   return DexField::make_field(cls, DexString::make_string(name), type);
@@ -421,3 +422,81 @@ TEST_F(ResolverTest, ResolveMethod) {
   EXPECT_TRUE(resolve_method(g_method, MethodSearch::InterfaceVirtual) ==
               e_method);
 }
+
+TEST_F(ResolverTest, ResolveMethodAfterHierarchyChanges) {
+  create_method_scope();
+  auto* cache = g_redex->get_resolver_cache();
+
+  auto b_method = DexMethod::get_method("B.method:()V");
+  auto c_method = DexMethod::get_method("C.method:()V");
+  EXPECT_TRUE(resolve_method(c_method, MethodSearch::Virtual) == b_method);
+  auto stats = cache->get_stats();
+  EXPECT_TRUE(resolve_method(c_method, MethodSearch::Virtual) == b_method);
+  EXPECT_EQ(cache->get_stats().hits, stats.hits + 1);
+
+  // Defining the method in C changes the resolution of the ref.
+  auto c_method_def =
+      c_method->make_concrete(ACC_PUBLIC, /* is_virtual */ true);
+  type_class(c_method->get_class())->add_method(c_method_def);
+  auto g_method = DexMethod::get_method("G.method:()V");
+  auto h_surprise = DexMethod::make_method("H.surprise:()V");
+  EXPECT_TRUE(resolve_method(g_method, MethodSearch::Virtual) == nullptr);
+  EXPECT_TRUE(resolve_method(h_surprise, MethodSearch::Static) == nullptr);
+
+  // So does re-parenting a class on the way up.
+  type_class(g_method->get_class())->set_super_class(DexType::get_type("C"));
+  EXPECT_TRUE(resolve_method(g_method, MethodSearch::Virtual) == c_method_def);
+  auto b_surprise = DexMethod::get_method("B.surprise:()V")->as_def();
+  EXPECT_TRUE(resolve_method(h_surprise, MethodSearch::Static) == b_surprise);
+
+  // And removing the method it resolved to.
+  type_class(b_surprise->get_class())->remove_method(b_surprise);
+  EXPECT_TRUE(resolve_method(h_surprise, MethodSearch::Static) == nullptr);
+}
+
+TEST_F(ResolverTest, ResolveFieldAfterHierarchyChanges) {
+  create_field_scope();
+  auto int_t = DexType::get_type("I");
+  auto e_f1 = make_field_ref(DexType::get_type("E"), "f1", int_t);
+  EXPECT_TRUE(resolve_field(e_f1) == nullptr);
+  type_class(DexType::get_type("E"))->set_super_class(DexType::get_type("A"));
+  auto a_f1 = DexField::get_field("A.f1:I");
+  EXPECT_TRUE(resolve_field(e_f1) == a_f1);
+
+  auto e_f3 = make_field_ref(DexType::get_type("E"), "f3", int_t);
+  EXPECT_TRUE(resolve_field(e_f3, FieldSearch::Static) == nullptr);
+  auto c_f3 = make_field_def(DexType::get_type("C"), "f3", int_t,
+                             ACC_PUBLIC | ACC_STATIC);
+  type_class(DexType::get_type("C"))->add_field(c_f3);
+  type_class(DexType::get_type("E"))->set_super_class(DexType::get_type("C"));
+  EXPECT_TRUE(resolve_field(e_f3, FieldSearch::Static) == c_f3);
+}
+
+TEST_F(ResolverTest, ResolveMethodRefCreatedWhereOneWasDeleted) {
+  create_method_scope();
+
+  auto b_method = DexMethod::get_method("B.method:()V");
+  auto c_method = DexMethod::get_method("C.method:()V");
+  EXPECT_TRUE(resolve_method(c_method, MethodSearch::Virtual) == b_method);
+
+  // Deleted refs give their storage to the next ref created.
+  DexMethod::erase_method(c_method);
+  DexMethod::delete_method_DO_NOT_USE(static_cast<DexMethod*>(c_method));
+  auto c_nothing = DexMethod::make_method("C.nothing:()V");
+  ASSERT_EQ(c_nothing, c_method);
+  EXPECT_TRUE(resolve_method(c_nothing, MethodSearch::Virtual) == nullptr);
+}
+
+TEST_F(ResolverTest, ResolveFieldRefCreatedWhereOneWasDeleted) {
+  create_field_scope();
+  auto int_t = DexType::get_type("I");
+  auto e_f1 = make_field_ref(DexType::get_type("E"), "f1", int_t);
+  type_class(DexType::get_type("E"))->set_super_class(DexType::get_type("A"));
+  auto a_f1 = DexField::get_field("A.f1:I");
+  EXPECT_TRUE(resolve_field(e_f1) == a_f1);
+
+  DexFieldRef::delete_field_DO_NOT_USE(e_f1);
+  auto e_nothing = make_field_ref(DexType::get_type("E"), "nothing", int_t);
+  ASSERT_EQ(e_nothing, e_f1);
+  EXPECT_TRUE(resolve_field(e_nothing) == nullptr);
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "SuffixArray.h"
+
+using namespace outliner_impl;
+
+namespace {
+
+std::vector<uint32_t> naive_suffix_array(const std::vector<uint32_t>& text) {
+  std::vector<uint32_t> sa(text.size());
+  std::iota(sa.begin(), sa.end(), 0);
+  std::sort(sa.begin(), sa.end(), [&text](uint32_t a, uint32_t b) {
+    return std::lexicographical_compare(text.begin() + a, text.end(),
+                                        text.begin() + b, text.end());
+  });
+  return sa;
+}
+
+std::vector<uint32_t> naive_recurring_lengths(
+    const std::vector<uint32_t>& text) {
+  std::vector<uint32_t> lengths(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    for (size_t j = 0; j < text.size(); j++) {
+      if (i == j) {
+        continue;
+      }
+      uint32_t length = 0;
+      while (i + length < text.size() && j + length < text.size() &&
+             text[i + length] == text[j + length]) {
+        length++;
+      }
+      lengths[i] = std::max(lengths[i], length);
+    }
+  }
+  return lengths;
+}
+
+} // namespace
+
+TEST(SuffixArrayTest, empty) {
+  std::vector<uint32_t> text;
+  EXPECT_TRUE(build_suffix_array(text).empty());
+  EXPECT_TRUE(get_recurring_lengths(text).empty());
+}
+
+TEST(SuffixArrayTest, banana) {
+  // b=1, a=0, n=2
+  std::vector<uint32_t> text{1, 0, 2, 0, 2, 0};
+  auto sa = build_suffix_array(text);
+  EXPECT_EQ(sa, (std::vector<uint32_t>{5, 3, 1, 0, 4, 2}));
+  auto lcp = build_lcp_array(text, sa);
+  EXPECT_EQ(lcp, (std::vector<uint32_t>{0, 1, 3, 0, 0, 2}));
+  EXPECT_EQ(get_recurring_lengths(text),
+            (std::vector<uint32_t>{0, 3, 2, 3, 2, 1}));
+}
+
+TEST(SuffixArrayTest, separators_end_recurring_sequences) {
+  std::vector<uint32_t> text{0, 1, 2, 100, 0, 1, 2, 3, 101, 1, 2, 3};
+  auto lengths = get_recurring_lengths(text);
+  EXPECT_EQ(lengths[0], 3u);
+  EXPECT_EQ(lengths[4], 3u);
+  EXPECT_EQ(lengths[5], 3u);
+  EXPECT_EQ(lengths[9], 3u);
+  EXPECT_EQ(lengths[3], 0u);
+}
+
+TEST(SuffixArrayTest, matches_naive_implementation) {
+  std::mt19937 rng(0);
+  for (size_t iteration = 0; iteration < 50; iteration++) {
+    size_t size = rng() % 200;
+    uint32_t alphabet = 1 + rng() % 4;
+    std::vector<uint32_t> text(size);
+    for (auto& c : text) {
+      c = rng() % alphabet;
+    }
+    auto sa = build_suffix_array(text);
+    EXPECT_EQ(sa, naive_suffix_array(text));
+    EXPECT_EQ(get_recurring_lengths(text), naive_recurring_lengths(text));
+  }
+}
@@ -0,0 +1,522 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "DexIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dex_index {
+
+namespace {
+
+/*
+ * On-disk layout, all little endian and 4-byte aligned:
+ *
+ *   IndexHeader
+ *   IndexFile[num_files]
+ *   IndexName[num_names]
+ *   IndexEntry[num_entries]     grouped by name
+ *   IndexGram[num_grams]        sorted by gram
+ *   uint32_t[num_postings]      name ids, ascending within each gram
+ *   char[strings_size]          NUL-terminated names and file paths
+ */
+constexpr char kMagic[8] = {'D', 'E', 'X', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32_t kVersion = 1;
+
+struct IndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_files;
+  uint32_t num_names;
+  uint32_t num_entries;
+  uint32_t num_grams;
+  uint32_t num_postings;
+  uint64_t files_off;
+  uint64_t names_off;
+  uint64_t entries_off;
+  uint64_t grams_off;
+  uint64_t postings_off;
+  uint64_t strings_off;
+  uint64_t strings_size;
+};
+
+struct IndexFile {
+  uint64_t path_off;
+  uint32_t checksum;
+  uint32_t pad;
+};
+
+struct IndexName {
+  uint64_t str_off;
+  uint32_t entries_begin;
+  uint32_t entries_count;
+};
+
+struct IndexEntry {
+  uint32_t file;
+  uint32_t kind;
+  uint32_t idx;
+};
+
+struct IndexGram {
+  uint32_t gram;
+  uint32_t postings_begin;
+  uint32_t postings_count;
+};
+
+uint32_t gram_at(const char* s) {
+  return (uint32_t)(uint8_t)s[0] << 16 | (uint32_t)(uint8_t)s[1] << 8 |
+         (uint32_t)(uint8_t)s[2];
+}
+
+std::string format_method_name(ddump_data* rd, uint32_t idx) {
+  dex_method_id* method = rd->dex_method_ids + idx;
+  dex_proto_id* proto = rd->dex_proto_ids + method->protoidx;
+  std::string name = dex_string_by_type_idx(rd, method->classidx);
+  name += '.';
+  name += dex_string_by_idx(rd, method->nameidx);
+  name += ":(";
+  if (proto->param_off) {
+    uint32_t* tl = (uint32_t*)(rd->dexmmap + proto->param_off);
+    uint32_t count = *tl++;
+    uint16_t* types = (uint16_t*)tl;
+    for (uint32_t i = 0; i < count; i++) {
+      name += dex_string_by_type_idx(rd, types[i]);
+    }
+  }
+  name += ')';
+  name += dex_string_by_type_idx(rd, proto->rtypeidx);
+  return name;
+}
+
+// Skips a bracket expression starting at pattern[i] == '[' and returns the
+// position of its closing bracket.
+size_t skip_class(const std::string& pattern, size_t i) {
+  ++i;
+  if (i < pattern.size() && pattern[i] == '^') ++i;
+  // A leading ']' is a literal.
+  if (i < pattern.size() && pattern[i] == ']') ++i;
+  for (; i < pattern.size() && pattern[i] != ']'; ++i) {
+    if (pattern[i] == '\\') ++i;
+  }
+  return i;
+}
+
+// Number of characters following a '\' and an alphanumeric escape letter that
+// belong to the same escape.
+size_t escape_operand_length(const std::string& pattern, size_t i) {
+  switch (pattern[i]) {
+  case 'x':
+    return 2;
+  case 'u':
+    return 4;
+  case 'c':
+    return 1;
+  default: {
+    size_t n = 0;
+    if (isdigit((unsigned char)pattern[i])) {
+      while (i + 1 + n < pattern.size() &&
+             isdigit((unsigned char)pattern[i + 1 + n])) {
+        ++n;
+      }
+    }
+    return n;
+  }
+  }
+}
+
+} // namespace
+
+const char* kind_name(EntryKind kind) {
+  switch (kind) {
+  case EntryKind::STRING:
+    return "string";
+  case EntryKind::TYPE:
+    return "type";
+  case EntryKind::METHOD:
+    return "method";
+  case EntryKind::CLASS:
+    return "class";
+  }
+  return "unknown";
+}
+
+void IndexWriter::add(const std::string& name, EntryKind kind, uint32_t idx) {
+  auto it = m_name_ids.find(name);
+  if (it == m_name_ids.end()) {
+    it = m_name_ids.emplace(name, (uint32_t)m_names.size()).first;
+    m_names.push_back(&it->first);
+    m_entries.emplace_back();
+  }
+  m_entries[it->second].push_back(
+      PendingEntry{(uint32_t)m_files.size() - 1, kind, idx});
+}
+
+void IndexWriter::add_dex(ddump_data* rd) {
+  uint32_t checksum = rd->dexh->checksum;
+  m_files.emplace_back(rd->dex_filename, checksum);
+  for (uint32_t i = 0; i < rd->dexh->string_ids_size; i++) {
+    add(dex_string_by_idx(rd, i), EntryKind::STRING, i);
+  }
+  for (uint32_t i = 0; i < rd->dexh->type_ids_size; i++) {
+    add(dex_string_by_type_idx(rd, (uint16_t)i), EntryKind::TYPE, i);
+  }
+  for (uint32_t i = 0; i < rd->dexh->method_ids_size; i++) {
+    add(format_method_name(rd, i), EntryKind::METHOD, i);
+  }
+  for (uint32_t i = 0; i < rd->dexh->class_defs_size; i++) {
+    dex_class_def* cls_def = rd->dex_class_defs + i;
+    add(dex_string_by_type_idx(rd, cls_def->typeidx), EntryKind::CLASS, i);
+  }
+}
+
+void IndexWriter::write(const char* path) const {
+  IndexHeader header{};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.num_files = (uint32_t)m_files.size();
+  header.num_names = (uint32_t)m_names.size();
+
+  std::string strings;
+  std::vector<IndexFile> files;
+  files.reserve(m_files.size());
+  for (const auto& file : m_files) {
+    files.push_back(IndexFile{strings.size(), file.second, 0});
+    strings.append(file.first.c_str(), file.first.size() + 1);
+  }
+
+  std::vector<IndexName> names;
+  std::vector<IndexEntry> entries;
+  // Name ids are visited in ascending order, so every posting list comes out
+  // sorted; a name only needs to be compared against the last posting to
+  // drop repeated trigrams.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> postings;
+  names.reserve(m_names.size());
+  for (uint32_t id = 0; id < m_names.size(); id++) {
+    const std::string& name = *m_names[id];
+    names.push_back(IndexName{strings.size(), (uint32_t)entries.size(),
+                              (uint32_t)m_entries[id].size()});
+    strings.append(name.c_str(), name.size() + 1);
+    for (const auto& entry : m_entries[id]) {
+      entries.push_back(
+          IndexEntry{entry.file, static_cast<uint32_t>(entry.kind), entry.idx});
+    }
+    for (size_t i = 0; i + 3 <= name.size(); i++) {
+      auto& list = postings[gram_at(name.data() + i)];
+      if (list.empty() || list.back() != id) {
+        list.push_back(id);
+      }
+    }
+  }
+  header.num_entries = (uint32_t)entries.size();
+
+  std::vector<uint32_t> sorted_grams;
+  sorted_grams.reserve(postings.size());
+  for (const auto& pair : postings) {
+    sorted_grams.push_back(pair.first);
+  }
+  std::sort(sorted_grams.begin(), sorted_grams.end());
+  std::vector<IndexGram> grams;
+  std::vector<uint32_t> all_postings;
+  grams.reserve(sorted_grams.size());
+  for (uint32_t gram : sorted_grams) {
+    const auto& list = postings.at(gram);
+    grams.push_back(IndexGram{gram, (uint32_t)all_postings.size(),
+                              (uint32_t)list.size()});
+    all_postings.insert(all_postings.end(), list.begin(), list.end());
+  }
+  header.num_grams = (uint32_t)grams.size();
+  header.num_postings = (uint32_t)all_postings.size();
+
+  header.files_off = sizeof(IndexHeader);
+  header.names_off = header.files_off + files.size() * sizeof(IndexFile);
+  header.entries_off = header.names_off + names.size() * sizeof(IndexName);
+  header.grams_off = header.entries_off + entries.size() * sizeof(IndexEntry);
+  header.postings_off = header.grams_off + grams.size() * sizeof(IndexGram);
+  header.strings_off =
+      header.postings_off + all_postings.size() * sizeof(uint32_t);
+  header.strings_size = strings.size();
+
+  FILE* fd = fopen(path, "wb");
+  if (fd == nullptr) {
+    fprintf(stderr, "Cannot open index file %s for writing, bailing\n", path);
+    exit(1);
+  }
+  bool ok = fwrite(&header, sizeof(header), 1, fd) == 1;
+  auto write_vector = [&](const auto& vec) {
+    if (ok && !vec.empty()) {
+      ok = fwrite(vec.data(), sizeof(vec[0]), vec.size(), fd) == vec.size();
+    }
+  };
+  write_vector(files);
+  write_vector(names);
+  write_vector(entries);
+  write_vector(grams);
+  write_vector(all_postings);
+  ok = ok && fwrite(strings.data(), 1, strings.size(), fd) == strings.size();
+  ok = fclose(fd) == 0 && ok;
+  if (!ok) {
+    fprintf(stderr, "Failed to write index file %s, bailing\n", path);
+    exit(1);
+  }
+}
+
+Index::Index(const char* path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Cannot open index file %s, bailing\n", path);
+    exit(1);
+  }
+  struct stat stat;
+  if (fstat(fd, &stat)) {
+    fprintf(stderr, "Cannot fstat file %s, bailing\n", path);
+    exit(1);
+  }
+  m_size = stat.st_size;
+  if (m_size < sizeof(IndexHeader)) {
+    fprintf(stderr, "Index file %s is truncated, bailing\n", path);
+    exit(1);
+  }
+  void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Cannot mmap index file %s, bailing\n", path);
+    exit(1);
+  }
+  m_data = (const char*)data;
+  const auto* header = (const IndexHeader*)m_data;
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 ||
+      header->version != kVersion ||
+      header->strings_off + header->strings_size != m_size) {
+    fprintf(stderr, "Bad index file %s, bailing\n", path);
+    exit(1);
+  }
+}
+
+Index::~Index() {
+  if (m_data != nullptr) {
+    munmap((void*)m_data, m_size);
+  }
+}
+
+uint32_t Index::num_files() const {
+  return ((const IndexHeader*)m_data)->num_files;
+}
+
+const char* Index::file_path(uint32_t file) const {
+  const auto* header = (const IndexHeader*)m_data;
+  const auto* files = (const IndexFile*)(m_data + header->files_off);
+  return m_data + header->strings_off + files[file].path_off;
+}
+
+uint32_t Index::file_checksum(uint32_t file) const {
+  const auto* header = (const IndexHeader*)m_data;
+  const auto* files = (const IndexFile*)(m_data + header->files_off);
+  return files[file].checksum;
+}
+
+int Index::find_file(const char* path) const {
+  for (uint32_t i = 0; i < num_files(); i++) {
+    if (strcmp(file_path(i), path) == 0) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+std::vector<uint32_t> Index::candidates(
+    const std::vector<std::string>& literals) const {
+  const auto* header = (const IndexHeader*)m_data;
+  const auto* grams = (const IndexGram*)(m_data + header->grams_off);
+  const auto* grams_end = grams + header->num_grams;
+  const auto* postings = (const uint32_t*)(m_data + header->postings_off);
+
+  std::vector<const IndexGram*> lists;
+  for (const auto& literal : literals) {
+    for (size_t i = 0; i + 3 <= literal.size(); i++) {
+      uint32_t gram = gram_at(literal.data() + i);
+      const auto* it = std::lower_bound(
+          grams, grams_end, gram,
+          [](const IndexGram& g, uint32_t value) { return g.gram < value; });
+      if (it == grams_end || it->gram != gram) {
+        return {};
+      }
+      lists.push_back(it);
+    }
+  }
+
+  std::vector<uint32_t> result;
+  if (lists.empty()) {
+    result.resize(header->num_names);
+    for (uint32_t i = 0; i < header->num_names; i++) {
+      result[i] = i;
+    }
+    return result;
+  }
+  // Intersect starting from the shortest list, so that the working set only
+  // ever shrinks.
+  std::sort(lists.begin(), lists.end(),
+            [](const IndexGram* a, const IndexGram* b) {
+              return a->postings_count < b->postings_count;
+            });
+  lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+  const uint32_t* first = postings + lists[0]->postings_begin;
+  result.assign(first, first + lists[0]->postings_count);
+  for (size_t l = 1; l < lists.size() && !result.empty(); l++) {
+    const uint32_t* begin = postings + lists[l]->postings_begin;
+    const uint32_t* end = begin + lists[l]->postings_count;
+    size_t out = 0;
+    for (uint32_t id : result) {
+      begin = std::lower_bound(begin, end, id);
+      if (begin == end) {
+        break;
+      }
+      if (*begin == id) {
+        result[out++] = id;
+      }
+    }
+    result.resize(out);
+  }
+  return result;
+}
+
+void Index::search(const std::regex& re,
+                   const std::vector<std::string>& literals,
+                   uint32_t kinds,
+                   const std::function<void(const Match&)>& f) const {
+  const auto* header = (const IndexHeader*)m_data;
+  const auto* names = (const IndexName*)(m_data + header->names_off);
+  const auto* entries = (const IndexEntry*)(m_data + header->entries_off);
+  const char* strings = m_data + header->strings_off;
+  for (uint32_t id : candidates(literals)) {
+    const IndexName& name = names[id];
+    const IndexEntry* begin = entries + name.entries_begin;
+    const IndexEntry* end = begin + name.entries_count;
+    bool wanted = std::any_of(begin, end, [kinds](const IndexEntry& e) {
+      return (kinds & (1u << e.kind)) != 0;
+    });
+    const char* str = strings + name.str_off;
+    if (!wanted || !std::regex_search(str, re)) {
+      continue;
+    }
+    for (const IndexEntry* e = begin; e != end; ++e) {
+      if (kinds & (1u << e->kind)) {
+        f(Match{e->file, static_cast<EntryKind>(e->kind), e->idx, str});
+      }
+    }
+  }
+}
+
+std::vector<std::string> required_literals(const std::string& pattern) {
+  std::vector<std::string> literals;
+  std::string run;
+  // Whether the last character of `run` is the atom a following quantifier
+  // would apply to.
+  bool last_is_literal = false;
+  auto flush = [&]() {
+    if (!run.empty()) {
+      literals.push_back(run);
+      run.clear();
+    }
+    last_is_literal = false;
+  };
+  for (size_t i = 0; i < pattern.size(); i++) {
+    char c = pattern[i];
+    switch (c) {
+    case '\\':
+      if (i + 1 >= pattern.size()) {
+        return {};
+      }
+      if (isalnum((unsigned char)pattern[i + 1])) {
+        // A character class, an assertion or a coded character; none of
+        // them are worth decoding here.
+        flush();
+        ++i;
+        i += escape_operand_length(pattern, i);
+      } else {
+        run += pattern[++i];
+        last_is_literal = true;
+      }
+      break;
+    case '|':
+      // Nothing outside of a group is required by an alternation.
+      return {};
+    case '(': {
+      // Groups may be optional, repeated or alternations; skip them.
+      flush();
+      int depth = 1;
+      for (++i; i < pattern.size() && depth > 0; i++) {
+        if (pattern[i] == '\\') {
+          ++i;
+        } else if (pattern[i] == '[') {
+          i = skip_class(pattern, i);
+        } else if (pattern[i] == '(') {
+          ++depth;
+        } else if (pattern[i] == ')') {
+          --depth;
+        }
+      }
+      --i;
+      break;
+    }
+    case ')':
+      return {};
+    case '[':
+      flush();
+      i = skip_class(pattern, i);
+      break;
+    case '*':
+    case '?':
+    case '{':
+      // The preceding atom may not occur at all.
+      if (last_is_literal) {
+        run.pop_back();
+      }
+      flush();
+      if (c == '{') {
+        while (i < pattern.size() && pattern[i] != '}') {
+          ++i;
+        }
+      }
+      break;
+    case '+':
+    case '.':
+    case '^':
+    case '$':
+      flush();
+      break;
+    default:
+      run += c;
+      last_is_literal = true;
+      break;
+    }
+  }
+  flush();
+  return literals;
+}
+
+bool read_dex_checksum(const char* path, uint32_t* checksum) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  ssize_t n = pread(fd, checksum, sizeof(*checksum),
+                    offsetof(dex_header, checksum));
+  close(fd);
+  return n == sizeof(*checksum);
+}
+
+} // namespace dex_index
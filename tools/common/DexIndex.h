@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <functional>
+#include <regex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "DexCommon.h"
+
+/*
+ * A persistent, mmap-able index over the string, type, method and class
+ * tables of a set of dex files, so that tools like dexgrep and redexdump can
+ * answer name queries over hundreds of dexes without opening any of them.
+ *
+ * Every distinct name is stored once, together with the (dex file, table,
+ * index) entries it occurs in. Names are additionally indexed by their byte
+ * trigrams: a regex query extracts the literals any match must contain,
+ * intersects the posting lists of their trigrams and only runs the regex on
+ * the surviving candidates.
+ *
+ * Methods are indexed as "Lcls;.name:(args)ret".
+ */
+namespace dex_index {
+
+enum class EntryKind : uint32_t {
+  STRING = 0,
+  TYPE = 1,
+  METHOD = 2,
+  CLASS = 3,
+};
+
+constexpr uint32_t kind_bit(EntryKind kind) {
+  return 1u << static_cast<uint32_t>(kind);
+}
+
+constexpr uint32_t ALL_KINDS = kind_bit(EntryKind::STRING) |
+                               kind_bit(EntryKind::TYPE) |
+                               kind_bit(EntryKind::METHOD) |
+                               kind_bit(EntryKind::CLASS);
+
+const char* kind_name(EntryKind kind);
+
+struct Match {
+  uint32_t file;
+  EntryKind kind;
+  // Index into the dex table identified by `kind`.
+  uint32_t idx;
+  const char* name;
+};
+
+class IndexWriter {
+ public:
+  void add_dex(ddump_data* rd);
+  // Exits with an error message if the index cannot be written.
+  void write(const char* path) const;
+
+  size_t num_files() const { return m_files.size(); }
+  size_t num_names() const { return m_names.size(); }
+
+ private:
+  struct PendingEntry {
+    uint32_t file;
+    EntryKind kind;
+    uint32_t idx;
+  };
+  void add(const std::string& name, EntryKind kind, uint32_t idx);
+
+  std::vector<std::pair<std::string, uint32_t>> m_files;
+  std::unordered_map<std::string, uint32_t> m_name_ids;
+  std::vector<const std::string*> m_names;
+  std::vector<std::vector<PendingEntry>> m_entries;
+};
+
+class Index {
+ public:
+  // Maps the index at `path`; exits with an error message if it is missing or
+  // malformed.
+  explicit Index(const char* path);
+  ~Index();
+  Index(const Index&) = delete;
+  Index& operator=(const Index&) = delete;
+
+  uint32_t num_files() const;
+  const char* file_path(uint32_t file) const;
+  // Adler-32 checksum from the header of the dex when it was indexed.
+  uint32_t file_checksum(uint32_t file) const;
+  // Returns the id of the dex indexed under `path`, or -1.
+  int find_file(const char* path) const;
+
+  /*
+   * Calls `f` for every entry of a kind in `kinds` whose name matches `re`.
+   * `literals` must be substrings that every match of `re` contains, e.g. the
+   * result of required_literals(); they only narrow down the candidates.
+   * Matches are reported grouped by name, not in dex order.
+   */
+  void search(const std::regex& re,
+              const std::vector<std::string>& literals,
+              uint32_t kinds,
+              const std::function<void(const Match&)>& f) const;
+
+ private:
+  std::vector<uint32_t> candidates(
+      const std::vector<std::string>& literals) const;
+
+  const char* m_data{nullptr};
+  size_t m_size{0};
+};
+
+// Returns literal substrings that every string matched by the ECMAScript
+// regex `pattern` must contain. The result is conservative: it may be empty,
+// e.g. when the pattern has a top-level alternation.
+std::vector<std::string> required_literals(const std::string& pattern);
+
+// Reads the checksum from the header of the dex at `path` without mapping the
+// whole file. Returns false if the file cannot be read.
+bool read_dex_checksum(const char* path, uint32_t* checksum);
+
+} // namespace dex_index
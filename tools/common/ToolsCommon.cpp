@@ -272,7 +272,8 @@ void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
     dex_stats_t& input_totals,
-    std::vector<dex_stats_t>& input_dexes_stats) {
+    std::vector<dex_stats_t>& input_dexes_stats,
+    bool lazy_balloon) {
   always_assert_log(!stores.empty(),
                     "Cannot load classes into empty DexStoresVector");
   for (const auto& filename : dex_files) {
@@ -282,7 +283,10 @@ void load_classes_from_dexes_and_metadata(
       assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                    load_dex_magic_from_dex(location));
       dex_stats_t dex_stats;
-      DexClasses classes = load_classes_from_dex(location, &dex_stats);
+      DexClasses classes = load_classes_from_dex(
+          location, &dex_stats, /* balloon */ true,
+          /* throw_on_balloon_error */ true, /* support_dex_version */ 35,
+          lazy_balloon);
       input_totals += dex_stats;
       input_dexes_stats.push_back(dex_stats);
       stores[0].add_classes(std::move(classes));
@@ -303,7 +307,10 @@ void load_classes_from_dexes_and_metadata(
         assert_dex_magic_consistency(stores[0].get_dex_magic(),
                                      load_dex_magic_from_dex(location));
         dex_stats_t dex_stats;
-        DexClasses classes = load_classes_from_dex(location, &dex_stats);
+        DexClasses classes = load_classes_from_dex(
+            location, &dex_stats, /* balloon */ true,
+            /* throw_on_balloon_error */ true, /* support_dex_version */ 35,
+            lazy_balloon);
 
         input_totals += dex_stats;
         input_dexes_stats.push_back(dex_stats);
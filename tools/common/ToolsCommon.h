@@ -30,7 +30,8 @@ void load_classes_from_dexes_and_metadata(
     const std::vector<std::string>& dex_files,
     DexStoresVector& stores,
     dex_stats_t& input_totals,
-    std::vector<dex_stats_t>& input_dexes_stats);
+    std::vector<dex_stats_t>& input_dexes_stats,
+    bool lazy_balloon = false);
 
 std::string get_dex_output_name(const std::string& output_dir,
                                 const DexStore& store,
@@ -5,28 +5,135 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <getopt.h>
+#include <memory>
 #include <regex>
+#include <string>
+#include <vector>
 
 #include "DexCommon.h"
+#include "DexIndex.h"
 
 void print_usage() {
-  fprintf(stderr, "Usage: dexgrep <classname> <dexfile 1> <dexfile 2> ...\n");
+  fprintf(stderr,
+          "Usage: dexgrep [-l] [--index=<index>] <classname> "
+          "<dexfile 1> <dexfile 2> ...\n"
+          "       dexgrep --build-index=<index> <dexfile 1> <dexfile 2> ...\n"
+          "\nWith --index, dexes found unchanged in the index are not "
+          "opened;\nif no dexes are given, all indexed dexes are searched.\n");
+}
+
+void print_match(const char* dexfile, const char* name, bool files_only) {
+  if (files_only) {
+    printf("%s\n", dexfile);
+  } else {
+    printf("%s: %s\n", dexfile, name);
+  }
+}
+
+void grep_dex(const char* dexfile, const std::regex& re, bool files_only) {
+  ddump_data rd;
+  open_dex_file(dexfile, &rd);
+
+  auto size = rd.dexh->class_defs_size;
+  for (uint32_t j = 0; j < size; j++) {
+    dex_class_def* cls_def = rd.dex_class_defs + j;
+    char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
+    if (std::regex_search(name, re)) {
+      print_match(dexfile, name, files_only);
+    }
+  }
+}
+
+/*
+ * Searches the given dexes, or all indexed dexes if there are none, printing
+ * matches in the same order as a linear scan would. Dexes that are missing
+ * from the index or changed since it was built, and repeats of a dex, are
+ * scanned directly.
+ */
+void grep_index(const dex_index::Index& index,
+                const char* search_str,
+                const std::regex& re,
+                const std::vector<const char*>& dexfiles,
+                bool files_only) {
+  // Position of each indexed dex in the output, or -1 if it is not searched.
+  std::vector<int> order(index.num_files(), -1);
+  std::vector<bool> stale(dexfiles.size(), false);
+  if (dexfiles.empty()) {
+    for (uint32_t i = 0; i < index.num_files(); i++) {
+      order[i] = (int)i;
+    }
+  }
+  for (size_t i = 0; i < dexfiles.size(); i++) {
+    int file = index.find_file(dexfiles[i]);
+    uint32_t checksum;
+    // A dex that is given more than once keeps its first position; the later
+    // ones are scanned directly, so that its matches are printed each time.
+    if (file >= 0 && order[file] < 0 &&
+        dex_index::read_dex_checksum(dexfiles[i], &checksum) &&
+        checksum == index.file_checksum(file)) {
+      order[file] = (int)i;
+    } else {
+      stale[i] = true;
+    }
+  }
+
+  struct Hit {
+    int order;
+    uint32_t idx;
+    uint32_t file;
+    const char* name;
+  };
+  std::vector<Hit> hits;
+  index.search(re, dex_index::required_literals(search_str),
+               dex_index::kind_bit(dex_index::EntryKind::CLASS),
+               [&](const dex_index::Match& m) {
+                 if (order[m.file] >= 0) {
+                   hits.push_back(Hit{order[m.file], m.idx, m.file, m.name});
+                 }
+               });
+  std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+    return a.order != b.order ? a.order < b.order : a.idx < b.idx;
+  });
+  size_t num_searched = dexfiles.empty() ? index.num_files() : dexfiles.size();
+  size_t h = 0;
+  for (size_t i = 0; i < num_searched; i++) {
+    if (i < stale.size() && stale[i]) {
+      grep_dex(dexfiles[i], re, files_only);
+      continue;
+    }
+    for (; h < hits.size() && hits[h].order == (int)i; h++) {
+      print_match(index.file_path(hits[h].file), hits[h].name, files_only);
+    }
+  }
 }
 
 int main(int argc, char* argv[]) {
   bool files_only = false;
+  const char* index_path = nullptr;
+  const char* build_index_path = nullptr;
   char c;
   static const struct option options[] = {
       {"files-without-match", no_argument, nullptr, 'l'},
+      {"index", required_argument, nullptr, 'i'},
+      {"build-index", required_argument, nullptr, 'b'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, 0, nullptr, 0},
   };
   while ((c = getopt_long(argc, argv, "hl", &options[0], nullptr)) != -1) {
     switch (c) {
     case 'l':
       files_only = true;
       break;
+    case 'i':
+      index_path = optarg;
+      break;
+    case 'b':
+      build_index_path = optarg;
+      break;
     case 'h':
       print_usage();
       return 0;
@@ -36,7 +143,25 @@ int main(int argc, char* argv[]) {
     }
   }
 
-  if (optind == argc) {
+  if (build_index_path != nullptr) {
+    if (optind == argc) {
+      fprintf(stderr, "%s: no dex files given\n", argv[0]);
+      print_usage();
+      return 1;
+    }
+    dex_index::IndexWriter writer;
+    for (int i = optind; i < argc; ++i) {
+      ddump_data rd;
+      open_dex_file(argv[i], &rd);
+      writer.add_dex(&rd);
+    }
+    writer.write(build_index_path);
+    fprintf(stderr, "Indexed %zu names from %zu dex files into %s\n",
+            writer.num_names(), writer.num_files(), build_index_path);
+    return 0;
+  }
+
+  if (optind == argc || (index_path == nullptr && optind + 1 == argc)) {
     fprintf(stderr, "%s: no dex files given\n", argv[0]);
     print_usage();
     return 1;
@@ -45,22 +170,14 @@ int main(int argc, char* argv[]) {
   const char* search_str = argv[optind];
   std::regex re(search_str);
 
-  for (int i = optind + 1; i < argc; ++i) {
-    const char* dexfile = argv[i];
-    ddump_data rd;
-    open_dex_file(dexfile, &rd);
+  if (index_path != nullptr) {
+    dex_index::Index index(index_path);
+    std::vector<const char*> dexfiles(argv + optind + 1, argv + argc);
+    grep_index(index, search_str, re, dexfiles, files_only);
+    return 0;
+  }
 
-    auto size = rd.dexh->class_defs_size;
-    for (uint32_t j = 0; j < size; j++) {
-      dex_class_def* cls_def = rd.dex_class_defs + j;
-      char* name = dex_string_by_type_idx(&rd, cls_def->typeidx);
-      if (std::regex_search(name, re)) {
-        if (files_only) {
-          printf("%s\n", dexfile);
-        } else {
-          printf("%s: %s\n", dexfile, name);
-        }
-      }
-    }
+  for (int i = optind + 1; i < argc; ++i) {
+    grep_dex(argv[i], re, files_only);
   }
 }
@@ -6,14 +6,37 @@
  */
 
 #include "OatmealUtil.h"
+#include "mmap.h"
 #include <cerrno>
 #include <cstring>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 void write_buf(FileHandle& fh, ConstBuffer buf) {
   CHECK(fh.fwrite(buf.ptr, sizeof(char), buf.len) == buf.len);
 }
 
+std::unique_ptr<MappedFile> map_file(const std::string& filename) {
+  auto fh = FileHandle(fopen(filename.c_str(), "r"));
+  CHECK(fh.get() != nullptr,
+        "failed to open %s: %s",
+        filename.c_str(),
+        std::strerror(errno));
+  std::string error_msg;
+  std::unique_ptr<MappedFile> map(MappedFile::mmap_file(get_filesize(fh),
+                                                        PROT_READ,
+                                                        MAP_PRIVATE,
+                                                        fileno(fh.get()),
+                                                        filename.c_str(),
+                                                        &error_msg));
+  CHECK(map != nullptr, "failed to mmap %s", filename.c_str());
+  return map;
+}
+
+ConstBuffer to_buffer(const MappedFile& map) {
+  return ConstBuffer{reinterpret_cast<const char*>(map.begin()), map.size()};
+}
+
 void write_str_and_null(FileHandle& fh, const std::string& str) {
   const auto len = str.size() + 1;
   CHECK(fh.fwrite(str.c_str(), sizeof(char), len) == len);
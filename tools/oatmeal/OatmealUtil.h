@@ -11,10 +11,13 @@
 #include "DexOpcodeDefs.h"
 #include "file-utils.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -55,6 +58,34 @@ static void foreach_pair(const T1& t1, const T2& t2, const L& fn) {
   }
 }
 
+// Runs fn(i) for every i in [0, n) on up to one thread per core. Callers are
+// expected to write results into per-index slots and assemble them in order
+// afterwards, so that the output does not depend on scheduling.
+template <typename Fn>
+void parallel_for(size_t n, const Fn& fn) {
+  size_t num_threads =
+      std::min<size_t>(n, std::max(1u, std::thread::hardware_concurrency()));
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < n; i++) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back([&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        fn(i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
 template <uint32_t Width>
 uint32_t align(uint32_t in) {
   return (in + (Width - 1)) & -Width;
@@ -129,6 +160,12 @@ struct ConstBuffer {
 
 void write_buf(FileHandle& fh, ConstBuffer buf);
 
+class MappedFile;
+
+// Maps the whole file read-only. Exits if the file cannot be opened or mapped.
+std::unique_ptr<MappedFile> map_file(const std::string& filename);
+ConstBuffer to_buffer(const MappedFile& map);
+
 struct WritableBuffer {
   FileHandle& fh;
   char* begin;
@@ -29,6 +29,7 @@
 #include "dump-oat.h"
 #include "elf-writer.h"
 #include "memory-accounter.h"
+#include "mmap.h"
 #include "vdex.h"
 
 #include <algorithm>
@@ -1506,6 +1507,45 @@ void OatClasses_079::write(const std::vector<DexFileType>& dex_files,
   }
 }
 
+// Reads the name of a type the way the lookup tables have always hashed it:
+// `str_size` is the utf16 length from the string_data_item plus one, so names
+// with multi-byte characters are truncated, and hashing stops at the NUL.
+std::string read_lookup_table_name(ConstBuffer dex, uint32_t string_offset) {
+  CHECK(string_offset < dex.len);
+  auto ptr = const_cast<char*>(dex.ptr + string_offset);
+  const auto str_size = read_uleb128(&ptr) + 1;
+  const auto str_start = ptr - dex.ptr;
+  CHECK(str_start + str_size <= dex.len);
+  return std::string(ptr, str_size);
+}
+
+// The dex tables the lookup tables are built from, read in place.
+struct LookupTableInput {
+  DexFileHeader header;
+  const uint32_t* type_ids;
+  const uint32_t* string_ids;
+  const DexClassDef* class_defs;
+
+  explicit LookupTableInput(ConstBuffer dex) {
+    CHECK(dex.len >= sizeof(DexFileHeader));
+    memcpy(&header, dex.ptr, sizeof(DexFileHeader));
+    type_ids = reinterpret_cast<const uint32_t*>(
+        dex.slice(header.type_ids_off,
+                  header.type_ids_off + header.type_ids_size * sizeof(uint32_t))
+            .ptr);
+    string_ids = reinterpret_cast<const uint32_t*>(
+        dex.slice(header.string_ids_off,
+                  header.string_ids_off +
+                      header.string_ids_size * sizeof(uint32_t))
+            .ptr);
+    class_defs = reinterpret_cast<const DexClassDef*>(
+        dex.slice(header.class_defs_off,
+                  header.class_defs_off +
+                      header.class_defs_size * sizeof(DexClassDef))
+            .ptr);
+  }
+};
+
 class SamsungLookupTablesNil {
  public:
   template <typename DexFileListingType>
@@ -1557,20 +1597,26 @@ class SamsungLookupTables {
       const std::vector<DexInput>& dex_input_vec,
       const std::vector<DexFileListing_064::DexFile_064>& dex_files,
       FileHandle& cksum_fh) {
-    foreach_pair(
-        dex_input_vec,
-        dex_files,
-        [&](const DexInput& dex_input,
-            const DexFileListing_064::DexFile_064& dex_file) {
-          CHECK(dex_file.lookup_table_offset == cksum_fh.bytes_written());
-
-          auto table = build_lookup_table(dex_input.filename);
-
-          auto buf =
-              ConstBuffer{reinterpret_cast<const char*>(table.data.get()),
-                          table.byte_size()};
-          write_buf(cksum_fh, buf);
-        });
+    CHECK(dex_input_vec.size() == dex_files.size());
+    // Build the tables of all dexes concurrently, then write them in order.
+    std::vector<std::unique_ptr<LookupTable>> tables(dex_input_vec.size());
+    parallel_for(tables.size(), [&](size_t i) {
+      auto dex = map_file(dex_input_vec[i].filename);
+      MemoryAccounter::addFootprint(dex->size());
+      tables[i] = std::make_unique<LookupTable>(
+          build_lookup_table(to_buffer(*dex)));
+      MemoryAccounter::addFootprint(tables[i]->byte_size());
+      MemoryAccounter::removeFootprint(dex->size());
+    });
+    for (size_t i = 0; i < tables.size(); i++) {
+      CHECK(dex_files[i].lookup_table_offset == cksum_fh.bytes_written());
+      auto buf =
+          ConstBuffer{reinterpret_cast<const char*>(tables[i]->data.get()),
+                      tables[i]->byte_size()};
+      write_buf(cksum_fh, buf);
+      MemoryAccounter::removeFootprint(tables[i]->byte_size());
+      tables[i].reset();
+    }
   }
 
  private:
@@ -1610,14 +1656,10 @@ class SamsungLookupTables {
     return hash;
   }
 
-  static LookupTable build_lookup_table(const std::string& filename) {
-
-    auto dex_fh = FileHandle(fopen(filename.c_str(), "r"));
-
-    DexFileHeader header = {};
-    CHECK(dex_fh.fread(&header, sizeof(DexFileHeader), 1) == 1);
+  static LookupTable build_lookup_table(ConstBuffer dex) {
+    LookupTableInput input(dex);
 
-    const auto num_type_ids = header.type_ids_size;
+    const auto num_type_ids = input.header.type_ids_size;
 
     const auto lookup_table_size = numEntries(num_type_ids);
 
@@ -1626,58 +1668,14 @@ class SamsungLookupTables {
 
     memset(table_buf.get(), 0, lookup_table_size * sizeof(LookupTableEntry));
 
-    // Read type ids array.
-    std::unique_ptr<uint32_t[]> typeid_buf(new uint32_t[num_type_ids]);
-    CHECK(dex_fh.seek_set(header.type_ids_off));
-    CHECK(dex_fh.fread(typeid_buf.get(), sizeof(uint32_t), num_type_ids) ==
-          num_type_ids);
-
-    // Read the string ids array.
-    const auto num_string_ids = header.string_ids_size;
-    std::unique_ptr<uint32_t[]> stringid_buf(new uint32_t[num_string_ids]);
-    CHECK(dex_fh.seek_set(header.string_ids_off));
-    CHECK(dex_fh.fread(stringid_buf.get(), sizeof(uint32_t), num_string_ids) ==
-          num_string_ids);
-
-    constexpr int kTypeNameBufSize = 256;
-
-    char type_name_buf[kTypeNameBufSize] = {};
-
-    struct Retry {
-      uint32_t string_offset;
-      uint16_t data;
-      uint32_t hash;
-    };
-
-    std::vector<Retry> retry_indices;
+    const auto num_string_ids = input.header.string_ids_size;
 
     for (unsigned int i = 0; i < num_type_ids; i++) {
-      const auto string_id = typeid_buf[i];
+      const auto string_id = input.type_ids[i];
       CHECK(string_id < num_string_ids);
 
-      const auto string_offset = stringid_buf[string_id];
-
-      dex_fh.seek_set(string_offset);
-      auto read_size =
-          dex_fh.fread(type_name_buf, sizeof(char), kTypeNameBufSize);
-      CHECK(read_size > 0);
-
-      auto ptr = type_name_buf;
-      const auto str_size = read_uleb128(&ptr) + 1;
-      const auto str_start = ptr - type_name_buf;
-
-      std::string type_name;
-
-      if (str_start + str_size >= kTypeNameBufSize) {
-        std::unique_ptr<char[]> large_class_name_buf(new char[str_size]);
-        dex_fh.seek_set(string_offset + str_start);
-        CHECK(dex_fh.fread(large_class_name_buf.get(),
-                           sizeof(char),
-                           str_size) == str_size);
-        type_name = std::string(large_class_name_buf.get(), str_size);
-      } else {
-        type_name = std::string(ptr, str_size);
-      }
+      const auto string_offset = input.string_ids[string_id];
+      const auto type_name = read_lookup_table_name(dex, string_offset);
 
       const auto hash = hash_str(type_name);
       insert(table_buf.get(), lookup_table_size, hash, string_offset, i);
@@ -1777,25 +1775,29 @@ class LookupTables {
   static void write(const std::vector<DexInput>& dex_input_vec,
                     const std::vector<DexFileType>& dex_files,
                     FileHandle& cksum_fh) {
-    foreach_pair(
-        dex_input_vec,
-        dex_files,
-        [&](const DexInput& dex_input,
-            const DexFileListing_079::DexFile_079& dex_file) {
-          CHECK(dex_file.lookup_table_offset == cksum_fh.bytes_written());
-          const auto num_classes = dex_file.num_classes;
-
-          const auto lookup_table_size = numEntries(num_classes);
-          const auto lookup_table_byte_size =
-              lookup_table_size * sizeof(LookupTableEntry);
-
-          auto lookup_table_buf =
-              build_lookup_table(dex_input.filename, lookup_table_size);
-          auto buf =
-              ConstBuffer{reinterpret_cast<const char*>(lookup_table_buf.get()),
-                          lookup_table_byte_size};
-          write_buf(cksum_fh, buf);
-        });
+    CHECK(dex_input_vec.size() == dex_files.size());
+    // Build the tables of all dexes concurrently, then write them in order.
+    std::vector<std::unique_ptr<LookupTableEntry[]>> tables(
+        dex_input_vec.size());
+    parallel_for(tables.size(), [&](size_t i) {
+      auto dex = map_file(dex_input_vec[i].filename);
+      MemoryAccounter::addFootprint(dex->size());
+      const auto lookup_table_size = numEntries(dex_files[i].num_classes);
+      tables[i] = build_lookup_table(to_buffer(*dex), lookup_table_size);
+      MemoryAccounter::addFootprint(lookup_table_size *
+                                    sizeof(LookupTableEntry));
+      MemoryAccounter::removeFootprint(dex->size());
+    });
+    for (size_t i = 0; i < tables.size(); i++) {
+      CHECK(dex_files[i].lookup_table_offset == cksum_fh.bytes_written());
+      const auto lookup_table_byte_size =
+          numEntries(dex_files[i].num_classes) * sizeof(LookupTableEntry);
+      auto buf = ConstBuffer{reinterpret_cast<const char*>(tables[i].get()),
+                             lookup_table_byte_size};
+      write_buf(cksum_fh, buf);
+      MemoryAccounter::removeFootprint(lookup_table_byte_size);
+      tables[i].reset();
+    }
   }
 
  private:
@@ -1852,49 +1854,18 @@ class LookupTables {
   }
 
   static std::unique_ptr<LookupTableEntry[]> build_lookup_table(
-      const std::string& filename, uint32_t lookup_table_size) {
+      ConstBuffer dex, uint32_t lookup_table_size) {
 
     std::unique_ptr<LookupTableEntry[]> table_buf(
         new LookupTableEntry[lookup_table_size]);
     memset(table_buf.get(), 0, lookup_table_size * sizeof(LookupTableEntry));
 
-    auto dex_fh = FileHandle(fopen(filename.c_str(), "r"));
-
-    DexFileHeader header = {};
-    CHECK(dex_fh.fread(&header, sizeof(DexFileHeader), 1) == 1);
+    LookupTableInput input(dex);
 
-    const auto num_classes = header.class_defs_size;
+    const auto num_classes = input.header.class_defs_size;
     const auto mask = lookup_table_size - 1;
-
-    // TODO: This is probably the most memory hungry part of the whole building
-    // process, but total usage should still be <1MB for all the class strings.
-    // if this proves to be a problem we can build the lookup table with redex
-    // and ship it to the phone.
-
-    // Read type ids array.
-    const auto num_type_ids = header.type_ids_size;
-    std::unique_ptr<uint32_t[]> typeid_buf(new uint32_t[num_type_ids]);
-    CHECK(dex_fh.seek_set(header.type_ids_off));
-    CHECK(dex_fh.fread(typeid_buf.get(), sizeof(uint32_t), num_type_ids) ==
-          num_type_ids);
-
-    // Read the string ids array.
-    const auto num_string_ids = header.string_ids_size;
-    std::unique_ptr<uint32_t[]> stringid_buf(new uint32_t[num_string_ids]);
-    CHECK(dex_fh.seek_set(header.string_ids_off));
-    CHECK(dex_fh.fread(stringid_buf.get(), sizeof(uint32_t), num_string_ids) ==
-          num_string_ids);
-
-    CHECK(dex_fh.seek_set(header.class_defs_off));
-
-    std::unique_ptr<DexClassDef[]> class_defs_buf(new DexClassDef[num_classes]);
-    CHECK(dex_fh.fread(class_defs_buf.get(),
-                       sizeof(DexClassDef),
-                       num_classes) == num_classes);
-
-    constexpr int kClassNameBufSize = 256;
-
-    char class_name_buf[kClassNameBufSize] = {};
+    const auto num_type_ids = input.header.type_ids_size;
+    const auto num_string_ids = input.header.string_ids_size;
 
     struct Retry {
       uint32_t string_offset;
@@ -1905,33 +1876,12 @@ class LookupTables {
     std::vector<Retry> retry_indices;
 
     for (unsigned int i = 0; i < num_classes; i++) {
-      const auto class_idx = class_defs_buf[i].class_idx;
+      const auto class_idx = input.class_defs[i].class_idx;
       CHECK(class_idx < num_type_ids);
-      const auto string_id = typeid_buf[class_idx];
+      const auto string_id = input.type_ids[class_idx];
       CHECK(string_id < num_string_ids);
-      const auto string_offset = stringid_buf[string_id];
-
-      dex_fh.seek_set(string_offset);
-      auto read_size =
-          dex_fh.fread(class_name_buf, sizeof(char), kClassNameBufSize);
-      CHECK(read_size > 0);
-
-      auto ptr = class_name_buf;
-      const auto str_size = read_uleb128(&ptr) + 1;
-      const auto str_start = ptr - class_name_buf;
-
-      std::string class_name;
-
-      if (str_start + str_size >= kClassNameBufSize) {
-        std::unique_ptr<char[]> large_class_name_buf(new char[str_size]);
-        dex_fh.seek_set(string_offset + str_start);
-        CHECK(dex_fh.fread(large_class_name_buf.get(),
-                           sizeof(char),
-                           str_size) == str_size);
-        class_name = std::string(large_class_name_buf.get(), str_size);
-      } else {
-        class_name = std::string(ptr, str_size);
-      }
+      const auto string_offset = input.string_ids[string_id];
+      const auto class_name = read_lookup_table_name(dex, string_offset);
 
       const auto hash = hash_str(class_name);
       const auto data = make_lt_data(i, hash, mask);
@@ -3025,8 +2975,10 @@ void write_dex_file(const DexInput& input,
     END_TRACE("quicken_dex")
   } else {
     START_TRACE()
-    auto dex_fh = FileHandle(fopen(input.filename.c_str(), "r"));
-    stream_file(dex_fh, cksum_fh);
+    auto dex = map_file(input.filename);
+    MemoryAccounter::addFootprint(dex->size());
+    write_buf(cksum_fh, to_buffer(*dex));
+    MemoryAccounter::removeFootprint(dex->size());
     END_TRACE("stream_dex")
   }
 }
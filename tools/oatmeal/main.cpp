@@ -329,6 +329,10 @@ int build(const Arguments& args) {
                  args.samsung_mode,
                  args.quick_data_location);
 
+  if (args.dump_memory_usage) {
+    MemoryAccounter::printFootprint();
+  }
+
   return 0;
 }
 
@@ -9,7 +9,9 @@
 #include "OatmealUtil.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <sys/resource.h>
 #include <vector>
 
 namespace {
@@ -230,6 +232,35 @@ MemoryAccounterScope MemoryAccounter::NewScope(ConstBuffer buf) {
 
 MemoryAccounter* MemoryAccounter::Cur() { return MemoryAccounterImpl::Cur(); }
 
+namespace {
+
+std::atomic<size_t> s_footprint{0};
+std::atomic<size_t> s_peak_footprint{0};
+
+} // namespace
+
+void MemoryAccounter::addFootprint(size_t bytes) {
+  auto footprint = s_footprint += bytes;
+  auto peak = s_peak_footprint.load();
+  while (footprint > peak &&
+         !s_peak_footprint.compare_exchange_weak(peak, footprint)) {
+  }
+}
+
+void MemoryAccounter::removeFootprint(size_t bytes) {
+  CHECK(s_footprint.load() >= bytes);
+  s_footprint -= bytes;
+}
+
+void MemoryAccounter::printFootprint() {
+  printf("Peak footprint of build buffers: %zu bytes\n",
+         s_peak_footprint.load());
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    printf("Peak resident set size: %ld KiB\n", usage.ru_maxrss);
+  }
+}
+
 MemoryAccounterScope::MemoryAccounterScope(ConstBuffer buf) {
   MemoryAccounterImpl::accounter_stack_.push_back(
       std::unique_ptr<MultiBufferMemoryAccounter>(
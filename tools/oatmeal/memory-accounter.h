@@ -40,6 +40,13 @@ class MemoryAccounter {
   static MemoryAccounter* Cur();
   static MemoryAccounterScope NewScope(ConstBuffer buf);
 
+  // Building doesn't consume a tracked buffer; instead, the builders report
+  // the heap buffers and mapped inputs they hold, so that the peak footprint
+  // of building dexes in parallel can be printed. Safe to call concurrently.
+  static void addFootprint(size_t bytes);
+  static void removeFootprint(size_t bytes);
+  static void printFootprint();
+
   // Print a report of any memory in buf_ that has either never
   // been consumed, or has been consumed more than once.
   virtual void print() = 0;
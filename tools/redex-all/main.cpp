@@ -1182,12 +1182,16 @@ void redex_frontend(ConfigFiles& conf, /* input */
   const JsonWrapper& json_config = conf.get_json_config();
   dup_classes::read_dup_class_allowlist(json_config);
 
+  // With lazy ballooning, methods are converted to IRCode on first access.
+  // Methods that get removed before anything looks at them are never
+  // converted at all.
+  bool lazy_balloon = json_config.get("lazy_balloon", false);
   run_rethrow_first_aggregate([&]() {
     Timer t("Load classes from dexes");
     dex_stats_t input_totals;
     std::vector<dex_stats_t> input_dexes_stats;
     redex::load_classes_from_dexes_and_metadata(
-        args.dex_files, stores, input_totals, input_dexes_stats);
+        args.dex_files, stores, input_totals, input_dexes_stats, lazy_balloon);
     stats["input_stats"] = get_input_stats(input_totals, input_dexes_stats);
   });
 
@@ -1312,6 +1316,15 @@ void redex_backend(ConfigFiles& conf,
   finalize_resource_table(conf);
   check_required_resources(conf, false);
 
+  {
+    // Barrier for lazy ballooning: everything that survived the passes
+    // needs IRCode for lowering and output.
+    Timer t("Balloon pending methods");
+    size_t ballooned = balloon_all_pending(build_class_scope(stores));
+    stats["lazy_balloon"]["ballooned_in_backend"] =
+        Json::Value::UInt64(ballooned);
+  }
+
   instruction_lowering::Stats instruction_lowering_stats;
   {
     bool lower_with_cfg = true;
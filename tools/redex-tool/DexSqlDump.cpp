@@ -19,9 +19,18 @@ $ sqlite3 dex.db "SELECT COUNT(*) FROM dex;"   # verify sane-looking value
 $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 <..enter queries..>
 
+For large apps, --format sql-batched emits multi-row INSERTs, which sqlite
+loads much faster, and --format columnar writes one binary file per table
+and dex into the --output directory (see write_columnar below). The rows are
+the same in all formats.
+
 */
 
 #include <boost/algorithm/string/replace.hpp>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <queue>
 #include <unordered_map>
 #include <vector>
@@ -34,6 +43,7 @@ $ ./native/redex/tools/redex-tool/DexSqlQuery.py dex.db
 #include "Show.h"
 #include "Tool.h"
 #include "Walkers.h"
+#include "WorkQueue.h"
 
 namespace {
 
@@ -42,138 +52,433 @@ static std::unordered_map<DexMethod*, int> method_ids;
 static std::unordered_map<DexField*, int> field_ids;
 static std::unordered_map<const DexString*, int> string_ids;
 
-void dump_field_refs(FILE* fdout,
-                     const char* prefix,
-                     DexField* field,
-                     int field_id) {
-  static int next_string_ref = 0;
+/*
+ * Rows are collected per dex (and per range of classes for is_a) into
+ * columnar buffers, in parallel, and only then written out in the original
+ * order. Running row ids of the reference tables are numbered per chunk and
+ * rebased when the chunks are written.
+ */
+enum Table : uint8_t {
+  STRINGS,
+  CLASSES,
+  FIELDS,
+  METHODS,
+  FIELD_STRING_REFS,
+  METHOD_STRING_REFS,
+  METHOD_CLASS_REFS,
+  METHOD_FIELD_REFS,
+  METHOD_METHOD_REFS,
+  IS_A,
+  NUM_TABLES,
+};
+
+struct Column {
+  const char* name;
+  bool is_text;
+};
+
+struct TableSchema {
+  const char* name;
+  // Spelling of the VALUES clause of the one-row-per-INSERT dump.
+  const char* values_sep;
+  const char* col_sep;
+  // Whether the first column is a running row id that is not stored.
+  bool serial_id;
+  std::vector<Column> columns;
+};
+
+const std::vector<TableSchema>& schemas() {
+  static const std::vector<TableSchema> s_schemas = {
+      {"strings", "", ", ", false, {{"id", false}, {"text", true}}},
+      {"classes",
+       " ",
+       ",",
+       false,
+       {{"id", false},
+        {"dex", true},
+        {"name", true},
+        {"obfuscated_name", true},
+        {"access", false}}},
+      {"fields",
+       "",
+       ", ",
+       false,
+       {{"id", false},
+        {"class_id", false},
+        {"name", true},
+        {"obfuscated_name", true},
+        {"access", false}}},
+      {"methods",
+       " ",
+       ",",
+       false,
+       {{"id", false},
+        {"class_id", false},
+        {"name", true},
+        {"obfuscated_name", true},
+        {"access", false},
+        {"code_size", false}}},
+      {"field_string_refs",
+       " ",
+       ", ",
+       true,
+       {{"id", false}, {"field_id", false}, {"ref_string_id", false}}},
+      {"method_string_refs",
+       " ",
+       ", ",
+       true,
+       {{"id", false},
+        {"method_id", false},
+        {"ref_string_id", false},
+        {"opcode", false}}},
+      {"method_class_refs",
+       " ",
+       ", ",
+       true,
+       {{"id", false},
+        {"method_id", false},
+        {"ref_class_id", false},
+        {"opcode", false}}},
+      {"method_field_refs",
+       " ",
+       ", ",
+       true,
+       {{"id", false},
+        {"method_id", false},
+        {"ref_field_id", false},
+        {"opcode", false}}},
+      {"method_method_refs",
+       " ",
+       ", ",
+       true,
+       {{"id", false},
+        {"method_id", false},
+        {"ref_method_id", false},
+        {"opcode", false}}},
+      {"is_a",
+       "",
+       ", ",
+       true,
+       {{"id", false}, {"class_id", false}, {"is_a_class_id", false}}},
+  };
+  return s_schemas;
+}
+
+struct Cell {
+  /* implicit */ Cell(int64_t i) : i(i) {}
+  /* implicit */ Cell(std::string s) : is_text(true), s(std::move(s)) {}
+  /* implicit */ Cell(const char* s)
+      // A null name used to be printed by fprintf's %s as "(null)".
+      : is_text(true), s(s != nullptr ? s : "(null)") {}
+
+  bool is_text{false};
+  int64_t i{0};
+  std::string s;
+};
+
+struct TableRows {
+  size_t size{0};
+  // Indexed by column; only the vector matching the column's type is used.
+  std::vector<std::vector<int64_t>> ints;
+  std::vector<std::vector<std::string>> texts;
+};
+
+struct Chunk {
+  std::array<TableRows, NUM_TABLES> tables;
+  // Table of every row in the order the per-row dump interleaves them.
+  std::vector<Table> order;
+
+  void add(Table table, std::initializer_list<Cell> cells) {
+    const auto& schema = schemas()[table];
+    auto& rows = tables[table];
+    if (rows.ints.empty()) {
+      rows.ints.resize(schema.columns.size());
+      rows.texts.resize(schema.columns.size());
+    }
+    size_t col = schema.serial_id ? 1 : 0;
+    always_assert(cells.size() + col == schema.columns.size());
+    for (const auto& cell : cells) {
+      always_assert(cell.is_text == schema.columns[col].is_text);
+      if (cell.is_text) {
+        rows.texts[col].push_back(cell.s);
+      } else {
+        rows.ints[col].push_back(cell.i);
+      }
+      col++;
+    }
+    rows.size++;
+    order.push_back(table);
+  }
+};
+
+using SerialBases = std::array<int64_t, NUM_TABLES>;
+
+// Returns, for every chunk, the first running row id of each of its tables.
+std::vector<SerialBases> serial_bases(const std::vector<Chunk>& chunks) {
+  std::vector<SerialBases> bases(chunks.size());
+  SerialBases next{};
+  for (size_t c = 0; c < chunks.size(); c++) {
+    bases[c] = next;
+    for (size_t t = 0; t < NUM_TABLES; t++) {
+      next[t] += chunks[c].tables[t].size;
+    }
+  }
+  return bases;
+}
+
+int64_t int_cell(const TableSchema& schema,
+                 const TableRows& rows,
+                 size_t col,
+                 size_t row,
+                 int64_t serial_base) {
+  if (col == 0 && schema.serial_id) {
+    return serial_base + row;
+  }
+  return rows.ints[col][row];
+}
+
+void append_tuple(std::string& out,
+                  Table table,
+                  const TableRows& rows,
+                  size_t row,
+                  int64_t serial_base) {
+  const auto& schema = schemas()[table];
+  out += '(';
+  for (size_t col = 0; col < schema.columns.size(); col++) {
+    if (col != 0) {
+      out += schema.col_sep;
+    }
+    if (schema.columns[col].is_text) {
+      out += '\'';
+      out += rows.texts[col][row];
+      out += '\'';
+    } else {
+      out += std::to_string(int_cell(schema, rows, col, row, serial_base));
+    }
+  }
+  out += ')';
+}
+
+enum class OutputFormat {
+  // One INSERT per row.
+  SQL,
+  // Multi-row INSERTs of up to `batch_size` rows per table.
+  SQL_BATCHED,
+  // One binary file per chunk and table; see write_columnar().
+  COLUMNAR,
+};
+
+std::string render_sql(const Chunk& chunk,
+                       const SerialBases& bases,
+                       const char* prefix,
+                       OutputFormat format,
+                       size_t batch_size) {
+  std::string out;
+  if (format == OutputFormat::SQL) {
+    std::array<size_t, NUM_TABLES> cursors{};
+    for (auto table : chunk.order) {
+      out += "INSERT INTO ";
+      out += prefix;
+      out += schemas()[table].name;
+      out += " VALUES";
+      out += schemas()[table].values_sep;
+      append_tuple(out, table, chunk.tables[table], cursors[table]++,
+                   bases[table]);
+      out += ";\n";
+    }
+    return out;
+  }
+  for (size_t t = 0; t < NUM_TABLES; t++) {
+    auto table = static_cast<Table>(t);
+    const auto& rows = chunk.tables[t];
+    for (size_t row = 0; row < rows.size; row++) {
+      if (row % batch_size == 0) {
+        out += "INSERT INTO ";
+        out += prefix;
+        out += schemas()[t].name;
+        out += " VALUES\n";
+      } else {
+        out += ",\n";
+      }
+      append_tuple(out, table, rows, row, bases[t]);
+      if (row % batch_size == batch_size - 1 || row + 1 == rows.size) {
+        out += ";\n";
+      }
+    }
+  }
+  return out;
+}
+
+void write_sql_chunks(FILE* fdout,
+                      const std::vector<Chunk>& chunks,
+                      const char* prefix,
+                      OutputFormat format,
+                      size_t batch_size) {
+  auto bases = serial_bases(chunks);
+  std::vector<std::string> texts(chunks.size());
+  workqueue_run_for<size_t>(0, chunks.size(), [&](size_t c) {
+    texts[c] = render_sql(chunks[c], bases[c], prefix, format, batch_size);
+  });
+  fprintf(fdout, "BEGIN TRANSACTION;\n");
+  for (const auto& text : texts) {
+    fwrite(text.data(), 1, text.size(), fdout);
+  }
+  fprintf(fdout, "END TRANSACTION;\n");
+}
+
+/*
+ * Writes every non-empty table of every chunk to
+ * <dir>/<prefix><table>/<phase>-<chunk>.col, in parallel. All integers are
+ * little endian:
+ *
+ *   char[8] "RDXCOL1\0"
+ *   u32 num_rows, u32 num_columns
+ *   per column: u32 name_len, name, u8 is_text
+ *   per column, in order:
+ *     integer column: i64[num_rows]
+ *     text column:    u32 offsets[num_rows + 1], then the concatenated bytes
+ *
+ * Concatenating the files of a table in name order yields the rows in the
+ * same order as the SQL dump.
+ */
+void write_columnar(const std::string& dir,
+                    const char* phase,
+                    const std::vector<Chunk>& chunks,
+                    const char* prefix) {
+  auto bases = serial_bases(chunks);
+  workqueue_run_for<size_t>(0, chunks.size() * NUM_TABLES, [&](size_t i) {
+    size_t c = i / NUM_TABLES;
+    size_t t = i % NUM_TABLES;
+    const auto& rows = chunks[c].tables[t];
+    if (rows.size == 0) {
+      return;
+    }
+    const auto& schema = schemas()[t];
+    std::string out("RDXCOL1", 8);
+    auto put_le = [&out](uint64_t v, size_t size) {
+      for (size_t byte = 0; byte < size; byte++) {
+        out += static_cast<char>((v >> (8 * byte)) & 0xff);
+      }
+    };
+    auto put_u32 = [&put_le](uint32_t v) { put_le(v, sizeof(v)); };
+    put_u32(rows.size);
+    put_u32(schema.columns.size());
+    for (const auto& column : schema.columns) {
+      put_u32(strlen(column.name));
+      out += column.name;
+      out += static_cast<char>(column.is_text);
+    }
+    for (size_t col = 0; col < schema.columns.size(); col++) {
+      if (schema.columns[col].is_text) {
+        uint32_t offset = 0;
+        put_u32(offset);
+        for (const auto& text : rows.texts[col]) {
+          offset += text.size();
+          put_u32(offset);
+        }
+        for (const auto& text : rows.texts[col]) {
+          out += text;
+        }
+      } else {
+        for (size_t row = 0; row < rows.size; row++) {
+          int64_t v = int_cell(schema, rows, col, row, bases[c][t]);
+          put_le(static_cast<uint64_t>(v), sizeof(v));
+        }
+      }
+    }
+    char part[64];
+    snprintf(part, sizeof(part), "%s-%05zu.col", phase, c);
+    auto path = boost::filesystem::path(dir) /
+                (std::string(prefix) + schema.name) / part;
+    FILE* fd = fopen(path.string().c_str(), "wb");
+    always_assert_log(fd != nullptr, "Could not open %s for writing",
+                      path.string().c_str());
+    bool ok = fwrite(out.data(), 1, out.size(), fd) == out.size();
+    ok = fclose(fd) == 0 && ok;
+    always_assert_log(ok, "Could not write %s", path.string().c_str());
+  });
+}
+
+template <typename T>
+int64_t id_or_zero(const std::unordered_map<T*, int>& ids, T* item) {
+  // Lookups of unknown items used to go through operator[] and yield 0.
+  auto it = ids.find(item);
+  return it == ids.end() ? 0 : it->second;
+}
+
+void dump_field_refs(Chunk& chunk, DexField* field, int field_id) {
   auto* static_value = field->get_static_value();
   if (!static_value || (static_value->evtype() != DEVT_STRING)) return;
   auto* static_string_value = static_cast<DexEncodedValueString*>(static_value);
-  auto string_id = string_ids[static_string_value->string()];
-  fprintf(fdout,
-          "INSERT INTO %sfield_string_refs VALUES (%d, %d, %d);\n",
-          prefix,
-          next_string_ref++,
-          field_id,
-          string_id);
+  auto string_id = id_or_zero(string_ids, static_string_value->string());
+  chunk.add(FIELD_STRING_REFS, {field_id, string_id});
 }
 
-void dump_method_refs(FILE* fdout,
-                      const char* prefix,
-                      DexMethod* method,
-                      int method_id) {
+void dump_method_refs(Chunk& chunk, DexMethod* method, int method_id) {
   auto code = method->get_code();
   if (!code) return;
 
-  static int next_string_ref = 0;
-  static int next_class_ref = 0;
-  static int next_field_ref = 0;
-  static int next_method_ref = 0;
-
   for (auto& mie : InstructionIterable(code)) {
     auto insn = mie.insn;
     if (insn->has_string()) {
       if (string_ids.count(insn->get_string())) {
-        auto string_id = string_ids[insn->get_string()];
-        fprintf(fdout,
-                "INSERT INTO %smethod_string_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_string_ref++,
-                method_id,
-                string_id,
-                insn->opcode());
+        auto string_id = string_ids.at(insn->get_string());
+        chunk.add(METHOD_STRING_REFS,
+                  {method_id, string_id, (int64_t)insn->opcode()});
       }
     }
     if (insn->has_type()) {
       auto cls = type_class(insn->get_type());
       if (cls && class_ids.count(cls)) {
-        auto class_id = class_ids[cls];
-        fprintf(fdout,
-                "INSERT INTO %smethod_class_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_class_ref++,
-                method_id,
-                class_id,
-                insn->opcode());
+        auto class_id = class_ids.at(cls);
+        chunk.add(METHOD_CLASS_REFS,
+                  {method_id, class_id, (int64_t)insn->opcode()});
       }
     }
     if (insn->has_field()) {
       auto field = resolve_field(insn->get_field());
       if (field != nullptr && field_ids.count(field)) {
-        auto field_id = field_ids[field];
-        fprintf(fdout,
-                "INSERT INTO %smethod_field_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_field_ref++,
-                method_id,
-                field_id,
-                insn->opcode());
+        auto field_id = field_ids.at(field);
+        chunk.add(METHOD_FIELD_REFS,
+                  {method_id, field_id, (int64_t)insn->opcode()});
       }
     }
     if (insn->has_method()) {
       auto meth =
           resolve_method(insn->get_method(), opcode_to_search(insn), method);
       if (meth != nullptr && method_ids.count(meth)) {
-        auto method_ref_id = method_ids[meth];
-        fprintf(fdout,
-                "INSERT INTO %smethod_method_refs VALUES (%d, %d, %d, %d);\n",
-                prefix,
-                next_method_ref++,
-                method_id,
-                method_ref_id,
-                insn->opcode());
+        auto method_ref_id = method_ids.at(meth);
+        chunk.add(METHOD_METHOD_REFS,
+                  {method_id, method_ref_id, (int64_t)insn->opcode()});
       }
     }
   }
 }
 
-void dump_class(FILE* fdout,
-                const char* prefix,
-                const char* dex_id,
-                DexClass* cls,
-                int class_id) {
+void dump_class(Chunk& chunk, const char* dex_id, DexClass* cls, int class_id) {
   // TODO: annotations?
   // TODO: inheritance?
   // TODO: string usage
   // TODO: size estimate
   const auto& deobfuscated_name = cls->get_deobfuscated_name();
-  fprintf(fdout,
-          "INSERT INTO %sclasses VALUES (%d,'%s','%s','%s',%u);\n",
-          prefix,
-          class_id,
-          dex_id,
-          deobfuscated_name.c_str(),
-          cls->get_name()->c_str(),
-          cls->get_access());
+  chunk.add(CLASSES,
+            {class_id, dex_id, deobfuscated_name.c_str(),
+             cls->get_name()->c_str(), (int64_t)cls->get_access()});
 }
 
-void dump_field(FILE* fdout,
-                const char* prefix,
-                int class_id,
-                DexField* field,
-                int field_id) {
+void dump_field(Chunk& chunk, int class_id, DexField* field, int field_id) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: annotations?
   // TODO: string usage (encoded_value for static fields)
   const auto& deobfuscated_name = field->get_deobfuscated_name();
   auto field_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %sfields VALUES(%d, %d, '%s', '%s', %u);\n",
-          prefix,
-          field_id,
-          class_id,
-          field_name,
-          field->get_name()->c_str(),
-          field->get_access());
+  chunk.add(FIELDS,
+            {field_id, class_id, field_name, field->get_name()->c_str(),
+             (int64_t)field->get_access()});
 }
 
-void dump_method(FILE* fdout,
-                 const char* prefix,
-                 int class_id,
-                 DexMethod* method,
-                 int method_id) {
+void dump_method(Chunk& chunk, int class_id, DexMethod* method, int method_id) {
   // TODO: more fixup here on this crapped up name/signature
   // TODO: break down signature
   // TODO: throws?
@@ -182,23 +487,18 @@ void dump_method(FILE* fdout,
   // TODO: size estimate
   const auto& deobfuscated_name = method->get_deobfuscated_name();
   auto method_name = strchr(deobfuscated_name.c_str(), ';');
-  fprintf(fdout,
-          "INSERT INTO %smethods VALUES (%d,%d,'%s','%s',%d,%zu);\n",
-          prefix,
-          method_id,
-          class_id,
-          method_name,
-          method->get_name()->c_str(),
-          method->get_access(),
-          method->get_code() ? method->get_code()->sum_opcode_sizes() : 0);
+  chunk.add(METHODS,
+            {method_id, class_id, method_name, method->get_name()->c_str(),
+             (int64_t)method->get_access(),
+             (int64_t)(method->get_code()
+                           ? method->get_code()->sum_opcode_sizes()
+                           : 0)});
 }
 
-void dump_sql(FILE* fdout,
-              DexStoresVector& stores,
-              ProguardMap& pg_map,
-              const char* prefix) {
-  fprintf(fdout,
-          R"___(
+std::string create_tables_sql(const char* prefix) {
+  std::vector<char> buf(8192);
+  const char* fmt =
+      R"___(
 DROP TABLE IF EXISTS %1$sfield_string_refs;
 DROP TABLE IF EXISTS %1$smethod_string_refs;
 DROP TABLE IF EXISTS %1$smethod_field_refs;
@@ -269,115 +569,180 @@ CREATE TABLE %1$smethod_string_refs (
   ref_string_id INTEGER NOT NULL, -- fk:strings.id
   opcode INTEGER NOT NULL
 );
-)___",
-          prefix);
-  int next_class_id = 0;
-  int next_method_id = 0;
-  int next_field_id = 0;
-  int next_string_id = 0;
+)___";
+  int len = snprintf(buf.data(), buf.size(), fmt, prefix);
+  if (len >= (int)buf.size()) {
+    buf.resize(len + 1);
+    snprintf(buf.data(), buf.size(), fmt, prefix);
+  }
+  return std::string(buf.data(), len);
+}
 
-  // Dump all dex items
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
+struct DumpOptions {
+  OutputFormat format{OutputFormat::SQL};
+  size_t batch_size{500};
+  // Output directory, for OutputFormat::COLUMNAR.
+  std::string dir;
+};
+
+void dump_sql(FILE* fdout,
+              DexStoresVector& stores,
+              ProguardMap& pg_map,
+              const char* prefix,
+              const DumpOptions& opts) {
+  auto create_tables = create_tables_sql(prefix);
+  if (opts.format == OutputFormat::COLUMNAR) {
+    for (const auto& schema : schemas()) {
+      auto table_dir = std::string(prefix) + schema.name;
+      boost::filesystem::create_directories(boost::filesystem::path(opts.dir) /
+                                            table_dir);
+    }
+    FILE* fd = fopen(
+        (boost::filesystem::path(opts.dir) / "schema.sql").string().c_str(),
+        "w");
+    always_assert_log(fd != nullptr, "Could not open %s/schema.sql",
+                      opts.dir.c_str());
+    fwrite(create_tables.data(), 1, create_tables.size(), fd);
+    fclose(fd);
+  } else {
+    fwrite(create_tables.data(), 1, create_tables.size(), fdout);
+  }
+  auto write_chunks = [&](const char* phase, const std::vector<Chunk>& chunks) {
+    if (opts.format == OutputFormat::COLUMNAR) {
+      write_columnar(opts.dir, phase, chunks, prefix);
+    } else {
+      write_sql_chunks(fdout, chunks, prefix, opts.format, opts.batch_size);
+    }
+  };
+
+  struct DexInfo {
+    DexClasses* dex;
+    std::string dex_id;
+    std::vector<const DexString*> strings;
+    std::vector<int> string_ids;
+  };
+  std::vector<DexInfo> dexes;
   for (auto& store : stores) {
     auto store_name = store.get_name();
     auto& dexen = store.get_dexen();
     apply_deobfuscated_names(dexen, pg_map);
     for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      GatheredTypes gtypes(&dex);
-      auto strings = gtypes.get_cls_order_dexstring_emitlist();
-      for (auto dexstr : strings) {
-        int id = next_string_id++;
-        string_ids[dexstr] = id;
-        // Escape string before inserting. ' -> ''
-        std::string esc(dexstr->c_str());
-        boost::replace_all(esc, "'", "''");
-        fprintf(fdout,
-                "INSERT INTO %sstrings VALUES(%d, '%s');\n",
-                prefix,
-                id,
-                esc.c_str());
+      dexes.push_back(DexInfo{&dexen[dex_idx],
+                              store_name + "/" + std::to_string(dex_idx),
+                              {},
+                              {}});
+    }
+  }
+  workqueue_run_for<size_t>(0, dexes.size(), [&](size_t d) {
+    GatheredTypes gtypes(dexes[d].dex);
+    dexes[d].strings = gtypes.get_cls_order_dexstring_emitlist();
+  });
+
+  // Ids are handed out in dex order; a string present in several dexes is
+  // referenced by the id of its last occurrence.
+  int next_class_id = 0;
+  int next_method_id = 0;
+  int next_field_id = 0;
+  int next_string_id = 0;
+  for (auto& info : dexes) {
+    for (auto dexstr : info.strings) {
+      int id = next_string_id++;
+      string_ids[dexstr] = id;
+      info.string_ids.push_back(id);
+    }
+    for (const auto& cls : *info.dex) {
+      class_ids[cls] = next_class_id++;
+      for (auto field : cls->get_ifields()) {
+        field_ids[field] = next_field_id++;
       }
-      std::string dex_id_str(store_name + "/" + std::to_string(dex_idx));
-      const char* dex_id = dex_id_str.c_str();
-      for (const auto& cls : dex) {
-        int class_id = next_class_id++;
-        dump_class(fdout, prefix, dex_id, cls, class_id);
-        class_ids[cls] = class_id;
-        for (auto field : cls->get_ifields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (auto field : cls->get_sfields()) {
-          int field_id = next_field_id++;
-          field_ids[field] = field_id;
-          dump_field(fdout, prefix, class_id, field, field_id);
-        }
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = next_method_id++;
-          method_ids[meth] = meth_id;
-          dump_method(fdout, prefix, class_id, meth, meth_id);
-        }
+      for (auto field : cls->get_sfields()) {
+        field_ids[field] = next_field_id++;
+      }
+      for (const auto& meth : cls->get_dmethods()) {
+        method_ids[meth] = next_method_id++;
+      }
+      for (auto& meth : cls->get_vmethods()) {
+        method_ids[meth] = next_method_id++;
       }
     }
   }
-  fprintf(fdout, "END TRANSACTION;\n");
+
+  // Dump all dex items
+  std::vector<Chunk> chunks(dexes.size());
+  workqueue_run_for<size_t>(0, dexes.size(), [&](size_t d) {
+    const auto& info = dexes[d];
+    auto& chunk = chunks[d];
+    for (size_t i = 0; i < info.strings.size(); i++) {
+      std::string text(info.strings[i]->c_str());
+      if (opts.format != OutputFormat::COLUMNAR) {
+        // Escape string before inserting. ' -> ''
+        boost::replace_all(text, "'", "''");
+      }
+      chunk.add(STRINGS, {info.string_ids[i], std::move(text)});
+    }
+    const char* dex_id = info.dex_id.c_str();
+    for (const auto& cls : *info.dex) {
+      int class_id = class_ids.at(cls);
+      dump_class(chunk, dex_id, cls, class_id);
+      for (auto field : cls->get_ifields()) {
+        dump_field(chunk, class_id, field, field_ids.at(field));
+      }
+      for (auto field : cls->get_sfields()) {
+        dump_field(chunk, class_id, field, field_ids.at(field));
+      }
+      for (const auto& meth : cls->get_dmethods()) {
+        dump_method(chunk, class_id, meth, method_ids.at(meth));
+      }
+      for (auto& meth : cls->get_vmethods()) {
+        dump_method(chunk, class_id, meth, method_ids.at(meth));
+      }
+    }
+  });
+  write_chunks("items", chunks);
 
   // Dump references
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& store : stores) {
-    auto& dexen = store.get_dexen();
-    for (size_t dex_idx = 0; dex_idx < dexen.size(); ++dex_idx) {
-      auto& dex = dexen[dex_idx];
-      for (const auto& cls : dex) {
-        for (const auto& meth : cls->get_dmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (auto& meth : cls->get_vmethods()) {
-          int meth_id = method_ids[meth];
-          dump_method_refs(fdout, prefix, meth, meth_id);
-        }
-        for (const auto& field : cls->get_sfields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
-        for (const auto& field : cls->get_ifields()) {
-          int field_id = field_ids[field];
-          dump_field_refs(fdout, prefix, field, field_id);
-        }
+  chunks = std::vector<Chunk>(dexes.size());
+  workqueue_run_for<size_t>(0, dexes.size(), [&](size_t d) {
+    auto& chunk = chunks[d];
+    for (const auto& cls : *dexes[d].dex) {
+      for (const auto& meth : cls->get_dmethods()) {
+        dump_method_refs(chunk, meth, method_ids.at(meth));
+      }
+      for (auto& meth : cls->get_vmethods()) {
+        dump_method_refs(chunk, meth, method_ids.at(meth));
+      }
+      for (const auto& field : cls->get_sfields()) {
+        dump_field_refs(chunk, field, field_ids.at(field));
+      }
+      for (const auto& field : cls->get_ifields()) {
+        dump_field_refs(chunk, field, field_ids.at(field));
       }
     }
-  }
-  fprintf(fdout, "END TRANSACTION;\n");
+  });
+  write_chunks("refs", chunks);
 
   // Dump hierarchy
   auto scope = build_class_scope(stores);
   ClassHierarchy ch = build_type_hierarchy(scope);
-  int next_is_a_id = 0;
-  fprintf(fdout, "BEGIN TRANSACTION;\n");
-  for (auto& cls : scope) {
-    TypeSet results;
-    get_all_children_or_implementors(ch, scope, cls, results);
-    for (auto type : results) {
-      auto type_cls = type_class(type);
-      if (type_cls) {
-        fprintf(fdout,
-                "INSERT INTO %sis_a VALUES(%d, %d, %d);\n",
-                prefix,
-                next_is_a_id++,
-                class_ids[type_cls],
-                class_ids[cls]);
+  constexpr size_t kClassesPerChunk = 1024;
+  chunks = std::vector<Chunk>((scope.size() + kClassesPerChunk - 1) /
+                              kClassesPerChunk);
+  workqueue_run_for<size_t>(0, chunks.size(), [&](size_t c) {
+    size_t end = std::min(scope.size(), (c + 1) * kClassesPerChunk);
+    for (size_t i = c * kClassesPerChunk; i < end; i++) {
+      auto cls = scope[i];
+      TypeSet results;
+      get_all_children_or_implementors(ch, scope, cls, results);
+      for (auto type : results) {
+        auto type_cls = type_class(type);
+        if (type_cls) {
+          chunks[c].add(IS_A, {id_or_zero(class_ids, type_cls),
+                               id_or_zero(class_ids, cls)});
+        }
       }
     }
-  }
-  fprintf(fdout, "END TRANSACTION;\n");
+  });
+  write_chunks("is_a", chunks);
 }
 
 class DexSqlDump : public Tool {
@@ -394,9 +759,17 @@ class DexSqlDump : public Tool {
         "output,o",
         po::value<std::string>()->value_name("dex.sql"),
         "path to output sql dump file (defaults to "
-        "stdout)")("table-prefix,t",
-                   po::value<std::string>()->value_name("pre_"),
-                   "prefix to use on all table names");
+        "stdout), or output directory for --format columnar")(
+        "table-prefix,t",
+        po::value<std::string>()->value_name("pre_"),
+        "prefix to use on all table names")(
+        "format,f",
+        po::value<std::string>()->value_name("sql"),
+        "sql: one INSERT per row (default); sql-batched: multi-row INSERTs; "
+        "columnar: binary column files, one per table and dex")(
+        "batch-size",
+        po::value<size_t>()->value_name("500"),
+        "rows per INSERT for --format sql-batched");
   }
 
   void run(const po::variables_map& options) override {
@@ -406,12 +779,35 @@ class DexSqlDump : public Tool {
     ProguardMap pgmap(options.count("proguard-map")
                           ? options["proguard-map"].as<std::string>()
                           : "/dev/null");
-    const std::string& filename = options["output"].as<std::string>();
-    FILE* fdout =
-        options.count("output") ? fopen(filename.c_str(), "w") : stdout;
+    DumpOptions opts;
+    std::string format =
+        options.count("format") ? options["format"].as<std::string>() : "sql";
+    if (format == "sql-batched") {
+      opts.format = OutputFormat::SQL_BATCHED;
+    } else if (format == "columnar") {
+      opts.format = OutputFormat::COLUMNAR;
+    } else if (format != "sql") {
+      fprintf(stderr, "Unknown format %s; terminating\n", format.c_str());
+      exit(EXIT_FAILURE);
+    }
+    if (options.count("batch-size")) {
+      opts.batch_size = std::max<size_t>(1, options["batch-size"].as<size_t>());
+    }
+    std::string filename =
+        options.count("output") ? options["output"].as<std::string>() : "";
     std::string prefix = options.count("table-prefix")
                              ? options["table-prefix"].as<std::string>()
                              : "";
+    if (opts.format == OutputFormat::COLUMNAR) {
+      if (filename.empty()) {
+        fprintf(stderr, "--format columnar requires --output; terminating\n");
+        exit(EXIT_FAILURE);
+      }
+      opts.dir = filename;
+      dump_sql(nullptr, stores, pgmap, prefix.c_str(), opts);
+      return;
+    }
+    FILE* fdout = !filename.empty() ? fopen(filename.c_str(), "w") : stdout;
     if (!fdout) {
       fprintf(stderr,
               "Could not open %s for writing; terminating\n",
@@ -419,7 +815,7 @@ class DexSqlDump : public Tool {
       exit(EXIT_FAILURE);
     }
     auto* pfx_cstr = prefix.c_str();
-    dump_sql(fdout, stores, pgmap, pfx_cstr);
+    dump_sql(fdout, stores, pgmap, pfx_cstr, opts);
     fclose(fdout);
   }
 };
@@ -7,10 +7,12 @@
 
 #include "RedexDump.h"
 #include <getopt.h>
+#include <regex>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "DexIndex.h"
 #include "Formatters.h"
 #include "PrintUtil.h"
 
@@ -44,6 +46,14 @@ static const char ddump_usage_string[] =
     "-d, --debug: print debug info items in the data section\n"
     "-D, --ddebug=<addr>: disassemble debug info item at <addr>\n"
     "\n"
+    "index lookups:\n"
+    "--index=<file>: index built by `dexgrep --build-index`\n"
+    "--lookup=<regex>: print the indexed strings, types, methods and "
+    "classes\n"
+    "    matching <regex> instead of dumping dexes; -s, -t, -m and -c "
+    "restrict\n"
+    "    the tables searched. No dex file needs to be given.\n"
+    "\n"
     "printing options:\n"
     "--clean: suppress indices and offsets\n"
     "--no-headers: suppress headers\n"
@@ -68,6 +78,8 @@ int main(int argc, char* argv[]) {
   bool redexdump_debug = false;
   uint32_t ddebug_offset = 0;
   int no_headers = 0;
+  const char* index_path = nullptr;
+  const char* lookup = nullptr;
 
   char c;
   static const struct option options[] = {
@@ -91,6 +103,8 @@ int main(int argc, char* argv[]) {
       {"raw", no_argument, (int*)&raw, 1},
       {"escape", no_argument, (int*)&escape, 1},
       {"no-headers", no_argument, &no_headers, 1},
+      {"index", required_argument, nullptr, 'I'},
+      {"lookup", required_argument, nullptr, 'L'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, 0, nullptr, 0},
   };
@@ -146,6 +160,12 @@ int main(int argc, char* argv[]) {
     case 'D':
       sscanf(optarg, "%x", &ddebug_offset);
       break;
+    case 'I':
+      index_path = optarg;
+      break;
+    case 'L':
+      lookup = optarg;
+      break;
     case 'h':
       puts(ddump_usage_string);
       return 0;
@@ -159,6 +179,32 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  if (lookup != nullptr) {
+    if (index_path == nullptr) {
+      fprintf(stderr, "%s: --lookup requires --index\n", argv[0]);
+      return 1;
+    }
+    uint32_t kinds = 0;
+    if (string) kinds |= dex_index::kind_bit(dex_index::EntryKind::STRING);
+    if (type) kinds |= dex_index::kind_bit(dex_index::EntryKind::TYPE);
+    if (meth) kinds |= dex_index::kind_bit(dex_index::EntryKind::METHOD);
+    if (clsdef) kinds |= dex_index::kind_bit(dex_index::EntryKind::CLASS);
+    if (all || kinds == 0) kinds = dex_index::ALL_KINDS;
+    dex_index::Index index(index_path);
+    std::regex re(lookup);
+    index.search(re, dex_index::required_literals(lookup), kinds,
+                 [&](const dex_index::Match& m) {
+                   if (clean) {
+                     printf("%s %s %s\n", index.file_path(m.file),
+                            dex_index::kind_name(m.kind), m.name);
+                   } else {
+                     printf("%s %s [%u] %s\n", index.file_path(m.file),
+                            dex_index::kind_name(m.kind), m.idx, m.name);
+                   }
+                 });
+    return 0;
+  }
+
   if (optind == argc) {
     fprintf(stderr, "%s: no dex files given; use -h for help\n", argv[0]);
     return 1;
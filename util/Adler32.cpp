@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "Adler32.h"
+
+#include <zlib.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define ADLER32_HAVE_SSSE3 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Largest prime smaller than 65536.
+constexpr uint32_t kBase = 65521;
+// Largest n such that 255n(n+1)/2 + (n+1)(kBase-1) <= 2^32-1, i.e. the
+// number of bytes that can be summed before s2 has to be reduced.
+constexpr size_t kNMax = 5552;
+
+uint32_t adler32_zlib(uint32_t adler, const uint8_t* buf, size_t len) {
+  // zlib takes a uInt length.
+  constexpr size_t kMaxChunk = 1u << 30;
+  while (len > 0) {
+    size_t n = len < kMaxChunk ? len : kMaxChunk;
+    adler = (uint32_t)adler32(adler, (const Bytef*)buf, (uInt)n);
+    buf += n;
+    len -= n;
+  }
+  return adler;
+}
+
+#ifdef ADLER32_HAVE_SSSE3
+
+bool cpu_has_ssse3() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return ecx & (1u << 9);
+}
+
+/*
+ * Processes 32-byte blocks: s1 is the sum of the bytes, and s2 the sum of the
+ * bytes weighted by their distance to the end of the block, plus 32 times the
+ * value of s1 at the start of the block.
+ */
+__attribute__((target("ssse3"))) uint32_t adler32_ssse3(uint32_t adler,
+                                                        const uint8_t* buf,
+                                                        size_t len) {
+  constexpr size_t kBlockSize = 32;
+  uint32_t s1 = adler & 0xffff;
+  uint32_t s2 = adler >> 16;
+
+  size_t blocks = len / kBlockSize;
+  len -= blocks * kBlockSize;
+  const __m128i taps_hi = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23,
+                                        22, 21, 20, 19, 18, 17);
+  const __m128i taps_lo =
+      _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  while (blocks > 0) {
+    size_t n = kNMax / kBlockSize;
+    if (n > blocks) {
+      n = blocks;
+    }
+    blocks -= n;
+
+    // The contribution of the incoming s1 to s2 is 32 * n * s1; it is added
+    // in via v_ps, which accumulates the value of s1 before each block.
+    __m128i v_ps = _mm_set_epi32(0, 0, 0, (int)(s1 * n));
+    __m128i v_s2 = _mm_set_epi32(0, 0, 0, (int)s2);
+    __m128i v_s1 = zero;
+    do {
+      const __m128i bytes_hi = _mm_loadu_si128((const __m128i*)buf);
+      const __m128i bytes_lo = _mm_loadu_si128((const __m128i*)(buf + 16));
+      v_ps = _mm_add_epi32(v_ps, v_s1);
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes_hi, zero));
+      v_s2 = _mm_add_epi32(
+          v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes_hi, taps_hi), ones));
+      v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(bytes_lo, zero));
+      v_s2 = _mm_add_epi32(
+          v_s2, _mm_madd_epi16(_mm_maddubs_epi16(bytes_lo, taps_lo), ones));
+      buf += kBlockSize;
+    } while (--n);
+    v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+    // Horizontal sums. The byte sums only occupy lanes 0 and 2.
+    constexpr int kSwapPairs = _MM_SHUFFLE(1, 0, 3, 2);
+    constexpr int kSwapAdjacent = _MM_SHUFFLE(2, 3, 0, 1);
+    v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, kSwapPairs));
+    s1 += (uint32_t)_mm_cvtsi128_si32(v_s1);
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, kSwapAdjacent));
+    v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, kSwapPairs));
+    s2 = (uint32_t)_mm_cvtsi128_si32(v_s2);
+
+    s1 %= kBase;
+    s2 %= kBase;
+  }
+
+  // Fewer than 32 bytes are left.
+  for (size_t i = 0; i < len; i++) {
+    s1 += buf[i];
+    s2 += s1;
+  }
+  s1 %= kBase;
+  s2 %= kBase;
+  return s1 | (s2 << 16);
+}
+
+#endif // ADLER32_HAVE_SSSE3
+
+using Adler32Fn = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+Adler32Fn select_adler32(bool use_simd) {
+#ifdef ADLER32_HAVE_SSSE3
+  static const bool has_ssse3 = cpu_has_ssse3();
+  if (use_simd && has_ssse3) {
+    return adler32_ssse3;
+  }
+#else
+  (void)use_simd;
+#endif
+  return adler32_zlib;
+}
+
+Adler32Fn s_adler32 = select_adler32(/* use_simd */ true);
+
+} // namespace
+
+uint32_t adler32_update(uint32_t adler, const uint8_t* buf, size_t len) {
+  if (buf == nullptr) {
+    // Like zlib, return the initial value.
+    return 1;
+  }
+  return s_adler32(adler, buf, len);
+}
+
+bool adler32_use_simd(bool enable) {
+  s_adler32 = select_adler32(enable);
+  return s_adler32 != adler32_zlib;
+}
@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Continues an Adler-32 checksum over `len` bytes, like zlib's adler32(). As
+ * in zlib, a null `buf` returns the initial value 1. Uses SSSE3 when the CPU
+ * supports it.
+ */
+uint32_t adler32_update(uint32_t adler, const uint8_t* buf, size_t len);
+
+/*
+ * Selects the implementation used by adler32_update. By default, the vectorized
+ * implementation is used when available, and zlib's otherwise. Returns whether
+ * the vectorized implementation is in use. Only meant for testing and
+ * benchmarking; not thread-safe.
+ */
+bool adler32_use_simd(bool enable);
@@ -14,6 +14,13 @@
 
 #include <cstring>
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__))
+#define SHA1_HAVE_X86_SHA_NI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
 static const unsigned char PADDING[128] = {
     0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
     0,    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -206,6 +213,118 @@ static void sha1_transform(unsigned int state[5],
   memset((unsigned char*)x, 0, sizeof(x));
 }
 
+static void sha1_transform_blocks_portable(unsigned int state[5],
+                                           const unsigned char* blocks,
+                                           unsigned int num_blocks) {
+  for (unsigned int i = 0; i < num_blocks; i++) {
+    sha1_transform(state, blocks + i * 64);
+  }
+}
+
+#ifdef SHA1_HAVE_X86_SHA_NI
+
+static bool cpu_has_sha_ni() {
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  bool ssse3 = ecx & (1u << 9);
+  bool sse41 = ecx & (1u << 19);
+  if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  bool sha = ebx & (1u << 29);
+  return ssse3 && sse41 && sha;
+}
+
+/*
+ * SHA1 transformation of whole blocks with the x86 SHA extensions. Each
+ * sha1rnds4 performs four rounds; the message schedule for rounds 16-79 is
+ * computed four words at a time with sha1msg1/sha1msg2.
+ */
+__attribute__((target("sha,ssse3,sse4.1"))) static void
+sha1_transform_blocks_sha_ni(unsigned int state[5],
+                             const unsigned char* blocks,
+                             unsigned int num_blocks) {
+  const __m128i byte_swap =
+      _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd = _mm_loadu_si128((const __m128i*)state);
+  abcd = _mm_shuffle_epi32(abcd, 0x1B);
+  __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+  for (unsigned int b = 0; b < num_blocks; b++) {
+    const unsigned char* block = blocks + b * 64;
+    __m128i abcd_saved = abcd;
+    __m128i e0_saved = e0;
+    __m128i msg[4];
+    __m128i e_next = e0;
+    // Fully unrolled, so that the round function below is a constant.
+#pragma GCC unroll 20
+    for (int i = 0; i < 20; i++) {
+      __m128i& w = msg[i & 3];
+      if (i < 4) {
+        w = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i*)(block + i * 16)), byte_swap);
+      } else {
+        // W[i] = msg2(msg1(W[i-4], W[i-3]) ^ W[i-2], W[i-1])
+        w = _mm_sha1msg2_epu32(
+            _mm_xor_si128(_mm_sha1msg1_epu32(w, msg[(i + 1) & 3]),
+                          msg[(i + 2) & 3]),
+            msg[(i + 3) & 3]);
+      }
+      __m128i e = i == 0 ? _mm_add_epi32(e_next, w)
+                         : _mm_sha1nexte_epu32(e_next, w);
+      e_next = abcd;
+      switch (i / 5) {
+      case 0:
+        abcd = _mm_sha1rnds4_epu32(abcd, e, 0);
+        break;
+      case 1:
+        abcd = _mm_sha1rnds4_epu32(abcd, e, 1);
+        break;
+      case 2:
+        abcd = _mm_sha1rnds4_epu32(abcd, e, 2);
+        break;
+      default:
+        abcd = _mm_sha1rnds4_epu32(abcd, e, 3);
+        break;
+      }
+    }
+    e0 = _mm_sha1nexte_epu32(e_next, e0_saved);
+    abcd = _mm_add_epi32(abcd, abcd_saved);
+  }
+
+  abcd = _mm_shuffle_epi32(abcd, 0x1B);
+  _mm_storeu_si128((__m128i*)state, abcd);
+  state[4] = (unsigned int)_mm_extract_epi32(e0, 3);
+}
+
+#endif // SHA1_HAVE_X86_SHA_NI
+
+using Sha1TransformBlocks = void (*)(unsigned int*,
+                                     const unsigned char*,
+                                     unsigned int);
+
+static Sha1TransformBlocks select_sha1_transform_blocks(bool use_hardware) {
+#ifdef SHA1_HAVE_X86_SHA_NI
+  static const bool has_sha_ni = cpu_has_sha_ni();
+  if (use_hardware && has_sha_ni) {
+    return sha1_transform_blocks_sha_ni;
+  }
+#else
+  (void)use_hardware;
+#endif
+  return sha1_transform_blocks_portable;
+}
+
+static Sha1TransformBlocks sha1_transform_blocks =
+    select_sha1_transform_blocks(/* use_hardware */ true);
+
+bool sha1_use_hardware(bool enable) {
+  sha1_transform_blocks = select_sha1_transform_blocks(enable);
+  return sha1_transform_blocks != sha1_transform_blocks_portable;
+}
+
 /*
  * SHA1 initialization. Begins an SHA1 operation, writing a new context.
  */
@@ -245,10 +364,11 @@ void sha1_update(Sha1Context* context,
   if (inputLen >= partLen) {
     memcpy((unsigned char*)&context->buffer[index], (unsigned char*)input,
            partLen);
-    sha1_transform(context->state, context->buffer);
+    sha1_transform_blocks(context->state, context->buffer, 1);
 
-    for (i = partLen; i + 63 < inputLen; i += 64)
-      sha1_transform(context->state, &input[i]);
+    unsigned int num_blocks = (inputLen - partLen) / 64;
+    sha1_transform_blocks(context->state, &input[partLen], num_blocks);
+    i = partLen + num_blocks * 64;
 
     index = 0;
   } else
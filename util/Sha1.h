@@ -34,6 +34,14 @@ void sha1_update(Sha1Context* context,
                  const unsigned char* input,
                  unsigned int inputLen);
 
+/*
+ * Selects the block transformation used by sha1_update. By default, the CPU's
+ * SHA extensions are used when available, and a portable implementation
+ * otherwise. Returns whether the hardware implementation is in use. Only meant
+ * for testing and benchmarking; not thread-safe.
+ */
+bool sha1_use_hardware(bool enable);
+
 /*
  * SHA1 finalization. Ends an SHA1 message-digest operation, writing the
  * message digest and zeroizing the context.